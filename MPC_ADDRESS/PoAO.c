@@ -44,6 +44,7 @@
 #include <time.h>
 #include "PoAO.h"
 #include "sha256.h"
+#include "../common/stats.h"
 
 #define CH(e,f,g) ((e & f) ^ ((~e) & g))
 
@@ -68,15 +69,32 @@
 
 int debug = 0;
 
-static int RAND_bytes(unsigned char * buf, int numBytes)
+/*
+ * PoAO is built without OpenSSL, for WASM too, so the --seed stream of
+ * common/seed.h hashes with sha256.c and the unseeded bytes come from rand().
+ */
+#define SEED_OWN_SHA256
+
+static int seed_sha256(const void * a, size_t aLen, const void * b, size_t bLen, unsigned char out[32])
+{
+	SHA256_CTX ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, (const BYTE *)a, aLen);
+	sha256_update(&ctx, (const BYTE *)b, bLen);
+	sha256_final(&ctx, out);
+	return 0;
+}
+
+static int seed_system(unsigned char * buf, int numBytes)
 {
 	while (numBytes-- > 0)
-	{
-		*buf = (unsigned char) (rand() & 0xFF);
-		buf++;
-	}
+		*buf++ = (unsigned char) (rand() & 0xFF);
 	return 1;
 }
+
+#include "../common/seed.h"
+
 /*
 void handleErrors(void)
 {
@@ -727,6 +745,7 @@ static int mpc_verify(a* as, int e, z * zp) {
 	randomness[1] = malloc(rSize);
 	getAllRandomness(zs.ke, randomness[0]);
 	getAllRandomness(zs.ke1, randomness[1]);
+	stats_add(STATS_TAPE_BYTES, 2 * rSize);
 
 	int *randCount =calloc(1,sizeof(int)) ;
 	int *countY = calloc(1,sizeof(int)) ;
@@ -1297,6 +1316,7 @@ static int mpc_verify(a* as, int e, z * zp) {
 	if (mpc_ADD_verify(t0,ccc,buf[4],&zs.ve,&zs.ve1,randomness,randCount,countY)==1)
 		return 1;
 
+	stats_add(STATS_GATES, *countY);
 	free(countY);
 	free(randCount);
 	free(randomness[0]);
@@ -2305,10 +2325,10 @@ static int writeToFile(char filename[], void* data, int size, int numItems) {
 
 
 static int secretShare(unsigned char* input, int numBytes, unsigned char output[3][numBytes]) {
-	if(RAND_bytes(output[0], numBytes) != 1) {
+	if(seed_bytes(output[0], numBytes) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
 	}
-	if(RAND_bytes(output[1], numBytes) != 1) {
+	if(seed_bytes(output[1], numBytes) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
 	}
 	for (int j = 0; j < numBytes; j++) {
@@ -2420,6 +2440,7 @@ static int printonce=0;
 		}
 	}
 
+	stats_add(STATS_GATES, *countY);
 	//Explicitly add y to view
 	for(int i = 0; i<5; i++) {
 		views[0].y[*countY] = 	((uint32_t)hashes[0][i * 4 + 0] << 24) | ((uint32_t)hashes[0][i * 4 + 1] << 16)
@@ -2771,8 +2792,9 @@ char * generate_poc(char * username, char * secret, char * params)
 	memset(message,0,sizeof(message));
 	strncpy(message,username,USER_LEN);
 	strcat(message," knows the public key to this address");
+	stats_begin("keys");
 	srand((unsigned) time(NULL));
-	if(RAND_bytes(garbage, 4) != 1) {
+	if(seed_bytes(garbage, 4) != 1) {
 		printf("RAND_bytes failed crypto, aborting");
 		return NULL;
 	}
@@ -2782,18 +2804,19 @@ char * generate_poc(char * username, char * secret, char * params)
 		printf("secret is [%s]\n",secret);
 
 	//Generating keys
-	if(RAND_bytes((unsigned char *)keys, NUM_ROUNDS*3*16) != 1) {
+	if(seed_bytes((unsigned char *)keys, NUM_ROUNDS*3*16) != 1) {
 		printf("RAND_bytes failed crypto, aborting");
 		return NULL;
 	}
-	if(RAND_bytes((unsigned char *)rs, NUM_ROUNDS*3*4) != 1) {
+	if(seed_bytes((unsigned char *)rs, NUM_ROUNDS*3*4) != 1) {
 		printf("RAND_bytes failed crypto, aborting");
 		return NULL;
 	}
 	
 
 	//Sharing secrets
-	if(RAND_bytes((unsigned char *)shares, NUM_ROUNDS*3*KEY_LEN) != 1) {
+	stats_begin("sharing");
+	if(seed_bytes((unsigned char *)shares, NUM_ROUNDS*3*KEY_LEN) != 1) {
 		printf("RAND_bytes failed crypto, aborting");
 		return NULL;
 	}
@@ -2804,12 +2827,16 @@ char * generate_poc(char * username, char * secret, char * params)
 
 	}
 	//Generating randomness
+	stats_begin("randomness");
 	for(int k=0; k<NUM_ROUNDS; k++) {
 		for(int j = 0; j<3; j++) {
 			randomness[k][j] = malloc(rSize*sizeof(unsigned char));
 			getAllRandomness(keys[k][j], randomness[k][j]);
 		}
 	}
+	stats_add(STATS_TAPE_BYTES, (uint64_t)NUM_ROUNDS * 3 * rSize);
+
+	stats_begin("mpc");
 
 	a_z = malloc((sizeof(a)+sizeof(z))*NUM_ROUNDS);
 	as = (a *) a_z;
@@ -2823,6 +2850,7 @@ char * generate_poc(char * username, char * secret, char * params)
 		}
 	}
 
+	stats_begin("commit");
 	for(int k=0; k<NUM_ROUNDS; k++) {
 		unsigned char hash1[RIPEMD160_DIGEST_LENGTH];
 		H(keys[k][0], &localViews[k][0], rs[k][0], hash1);
@@ -2832,14 +2860,17 @@ char * generate_poc(char * username, char * secret, char * params)
 		H(keys[k][2], &localViews[k][2], rs[k][2], hash1);
 		memcpy(as[k].h[2], hash1, 20);
 	}
+	stats_add(STATS_HASH_BYTES, (uint64_t)NUM_ROUNDS * 3 * (16 + sizeof(View) + 4 + SHA256_DIGEST_LENGTH));
 
 	//Generating E
+	stats_begin("challenge");
 	int es[NUM_ROUNDS];
 	uint32_t finalHash[5];
 	for (int j = 0; j < 5; j++) {
 		finalHash[j] = as[0].yp[0][j]^as[0].yp[1][j]^as[0].yp[2][j];
 	}
 	H3(message, finalHash, as, NUM_ROUNDS, es);
+	stats_add(STATS_HASH_BYTES, strlen(message) + 20 + sizeof(a) * NUM_ROUNDS + SHA256_DIGEST_LENGTH);
 
 	if (debug)
 	{
@@ -2848,12 +2879,14 @@ char * generate_poc(char * username, char * secret, char * params)
 
 	//Packing Z
 //	z* zs = malloc(sizeof(z)*NUM_ROUNDS);
+	stats_begin("prove");
 
 	for(int i = 0; i<NUM_ROUNDS; i++) {
 		prove(&zs[i],es[i],keys[i],rs[i], localViews[i]);
 		free(localViews[i]);
 	}
 
+	stats_begin("write");
 	uint32_t combined[5];
 	unsigned char shahash[32];
 	addrbuf[0] = 0;
@@ -2885,6 +2918,7 @@ char * generate_poc(char * username, char * secret, char * params)
 //	bin2hex((unsigned char *)zs,sizeof(z)*NUM_ROUNDS,proof+(sizeof(a)*NUM_ROUNDS*2));
 	free(a_z);
 	strcat(proof,"\"}");
+	stats_report("PoAO", NUM_ROUNDS);
 
 	if (debug)
 		printf("address: %s\n",addrstr);
@@ -2946,6 +2980,7 @@ char * verify_poc(char * prooffile)
 	as = (a *) a_z;
 	size_t asize = (sizeof(a)+sizeof(z))*NUM_ROUNDS;
 	zs = (z *) (a_z+(sizeof(a)*NUM_ROUNDS));
+	stats_begin("read");
 	if (debug)
 	{
 		printf("proof received [%s]\n",prooffile);
@@ -3006,12 +3041,15 @@ char * verify_poc(char * prooffile)
 		}
 		printf("\n");
 	}
+	stats_begin("challenge");
 	H3(message,y, as, NUM_ROUNDS, es);
+	stats_add(STATS_HASH_BYTES, strlen(message) + 20 + sizeof(a) * NUM_ROUNDS + SHA256_DIGEST_LENGTH);
 	if (debug)
 	{
 		printf("message is [%s], length %ld e0 is %d\n",message,strlen(message),es[0]);
 	}
 	
+	stats_begin("verify");
 	int verifyResult = 0;
         for(int i = 0; i<NUM_ROUNDS; i++) {
 		verifyResult = mpc_verify(&(as[i]), es[i], &(zs[i]));
@@ -3022,6 +3060,8 @@ char * verify_poc(char * prooffile)
 			passed = 0;
 		}	
 	}
+	stats_add(STATS_HASH_BYTES, (uint64_t)NUM_ROUNDS * 2 * (16 + sizeof(View) + 4 + SHA256_DIGEST_LENGTH));
+	stats_report("PoAO_VERIFIER", NUM_ROUNDS);
 	free(a_z);
 	if (!passed)
 	{
@@ -3089,10 +3129,22 @@ void clearbuf(char * ret)
 int main(int argc, char * argv[])
 {
 	char * rc;
+	char * prog = argv[0];
 
+	if (stats_init(NULL) != 0)
+		return -1;
+
+	// --seed STRING before the function makes the proof reproducible, common/seed.h
+	if ((argc > 2) && (strcmp(argv[1], "--seed") == 0))
+	{
+		seed_init(argv[2]);
+		argv[2] = prog;
+		argv += 2;
+		argc -= 2;
+	}
 	if ((argc != 5) && (argc != 3))
 	{
-		printf("Usage: %s <func: 1=generate> <message> <key/proof> <params>\n",argv[0]);
+		printf("Usage: %s [--seed STRING] <func: 1=generate> <message> <key/proof> <params>\n",argv[0]);
 		printf("Usage: %s <func: 2=verify> <proof file>\n",argv[0]);
 		return -1;
 	}	       
@@ -3108,7 +3160,7 @@ int main(int argc, char * argv[])
 	}
 	else
 	{
-		printf("Usage: %s <func: 1=generate> <message> <key/proof> <params>\n",argv[0]);
+		printf("Usage: %s [--seed STRING] <func: 1=generate> <message> <key/proof> <params>\n",argv[0]);
 		printf("Usage: %s <func: 2=verify> <proof file>\n",argv[0]);
 		return -1;
 	}	       
@@ -0,0 +1,301 @@
+/*
+ ============================================================================
+ Name        : MPC_BRISTOL.c
+ Author      : Tan Teik Guan
+ Version     : 0.1
+ Description : MPC proof of knowledge of an input to a Bristol Fashion circuit
+ ============================================================================
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sharedbristol.h"
+#include "../common/arena.h"
+#include "../common/cli.h"
+#include "../common/seed.h"
+#include "omp.h"
+
+
+int NUM_ROUNDS = 136;
+
+
+/*
+ * Proves one secret input of inBytes bytes and writes the proof to file, as
+ * the header and the raw a and z records or, with hexOut, as one line of hex.
+ */
+int proveInput(const unsigned char* input, FILE* file, int hexOut) {
+	long totalCrypto, totalSS, totalRandom, totalMpc, totalHash;
+	long inMilli, inMilliA, inMilliE, inMilliZ, inMilliWrite;
+	unsigned char (*rs)[3][4];
+	unsigned char (*keys)[3][16];
+	unsigned char* as;
+	unsigned char* views;
+	unsigned char* shares;
+	unsigned char* randomness;
+	int* es;
+	unsigned char* zs;
+
+	//All per round state of the proof lives in one arena
+	arena ar;
+	if (arena_init(&ar, ARENA_BYTES(NUM_ROUNDS * sizeof(*rs)) + ARENA_BYTES(NUM_ROUNDS * sizeof(*keys))
+			+ ARENA_BYTES((size_t)NUM_ROUNDS * aSize) + ARENA_BYTES((size_t)NUM_ROUNDS * 3 * viewSize)
+			+ ARENA_BYTES((size_t)NUM_ROUNDS * 2 * inBytes + 1) + ARENA_BYTES((size_t)NUM_ROUNDS * 3 * tapeBytes + 1)
+			+ ARENA_BYTES(NUM_ROUNDS * sizeof(int)) + ARENA_BYTES((size_t)NUM_ROUNDS * zSize)) != 0) {
+		printf("Unable to allocate memory for %d rounds!\n", NUM_ROUNDS);
+		return 1;
+	}
+	rs = arena_alloc(&ar, NUM_ROUNDS * sizeof(*rs));
+	keys = arena_alloc(&ar, NUM_ROUNDS * sizeof(*keys));
+	as = arena_alloc(&ar, (size_t)NUM_ROUNDS * aSize);
+	views = arena_alloc(&ar, (size_t)NUM_ROUNDS * 3 * viewSize);
+	shares = arena_alloc(&ar, (size_t)NUM_ROUNDS * 2 * inBytes + 1);
+	randomness = arena_alloc(&ar, (size_t)NUM_ROUNDS * 3 * tapeBytes + 1);
+	es = arena_alloc(&ar, NUM_ROUNDS * sizeof(int));
+	zs = arena_alloc(&ar, (size_t)NUM_ROUNDS * zSize);
+
+	//Generating keys
+	stats_reset();
+	stats_begin("keys");
+	if(seed_bytes((unsigned char *)keys, NUM_ROUNDS*3*16) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		arena_free(&ar);
+		return 1;
+	}
+	if(seed_bytes((unsigned char *)rs, NUM_ROUNDS*3*4) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		arena_free(&ar);
+		return 1;
+	}
+	totalCrypto = stats_end();
+
+	//Sharing secrets, into the input part of each view
+	stats_begin("sharing");
+	if((inBytes > 0) && (seed_bytes(shares, NUM_ROUNDS*2*inBytes) != 1)) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		arena_free(&ar);
+		return 1;
+	}
+	#pragma omp parallel for
+	for(int k=0; k<NUM_ROUNDS; k++) {
+		unsigned char* x[3];
+		for (int j = 0; j < 3; j++)
+			x[j] = views + ((size_t)k * 3 + j) * viewSize + tapeBytes;
+		memcpy(x[0], shares + (size_t)k * 2 * inBytes, inBytes);
+		memcpy(x[1], shares + (size_t)k * 2 * inBytes + inBytes, inBytes);
+		for (int j = 0; j < inBytes; j++) {
+			x[2][j] = input[j] ^ x[0][j] ^ x[1][j];
+		}
+	}
+	totalSS = stats_end();
+
+	//Generating randomness
+	stats_begin("randomness");
+	if (tapeBytes) {
+		#pragma omp parallel for
+		for(int k=0; k<NUM_ROUNDS; k++) {
+			tape_expandKeys(3, keys[k], TAPE_IV, randomness + (size_t)k * 3 * tapeBytes, tapeBytes);
+		}
+	}
+	stats_add(STATS_TAPE_BYTES, (uint64_t)NUM_ROUNDS * 3 * tapeBytes);
+	totalRandom = stats_end();
+
+	//Running the circuit, rounds spread over the threads in bitsliced batches of up to BRIS_LANES
+	stats_begin("mpc");
+	int batchSize = (NUM_ROUNDS + omp_get_max_threads() - 1) / omp_get_max_threads();
+	if (batchSize > BRIS_LANES)
+		batchSize = BRIS_LANES;
+	int numBatches = (NUM_ROUNDS + batchSize - 1) / batchSize;
+	#pragma omp parallel for
+	for(int b=0; b<numBatches; b++) {
+		uint64_t* w = malloc(3 * sizeof(uint64_t) * brisCircuit.numSlots);
+		brisLanes bl;
+
+		bl.lanes = (NUM_ROUNDS - b * batchSize < batchSize) ? NUM_ROUNDS - b * batchSize : batchSize;
+		bl.secretWires = secretWires;
+		bl.pub = publicInput;
+		for (int l = 0; l < bl.lanes; l++) {
+			int k = b * batchSize + l;
+			for (int j = 0; j < 3; j++) {
+				unsigned char* v = views + ((size_t)k * 3 + j) * viewSize;
+				bl.x[l][j] = v + tapeBytes;
+				bl.tape[l][j] = randomness + ((size_t)k * 3 + j) * tapeBytes;
+				bl.y[l][j] = v;
+				bl.out[l][j] = A_YP(as + (size_t)k * aSize, j);
+			}
+		}
+		bris_prove(&brisCircuit, &bl, w);
+		free(w);
+	}
+	stats_add(STATS_GATES, (uint64_t)NUM_ROUNDS * brisCircuit.numGates);
+	totalMpc = stats_end();
+
+	//Committing
+	stats_begin("commit");
+	#pragma omp parallel for
+	for(int k=0; k<NUM_ROUNDS; k+=HASH_ROUNDS) {
+		int n = (NUM_ROUNDS - k < HASH_ROUNDS) ? NUM_ROUNDS - k : HASH_ROUNDS;
+		H_many(n, &keys[k], views + (size_t)k * 3 * viewSize, &rs[k], as + (size_t)k * aSize);
+	}
+	stats_add(STATS_HASH_BYTES, (uint64_t)NUM_ROUNDS * 3 * (16 + viewSize + 4));
+	totalHash = stats_end();
+	inMilliA = stats_totalMs();
+
+	//Generating E
+	stats_begin("challenge");
+	unsigned char* y = malloc(outBytes + 1);
+	reconstruct(as, y);
+	H3(y, as, NUM_ROUNDS, es);
+	stats_add(STATS_HASH_BYTES, sizeof(brisHeader) + outBytes + (uint64_t)aSize * NUM_ROUNDS);
+	inMilliE = stats_end();
+
+
+	//Packing Z
+	stats_begin("prove");
+	#pragma omp parallel for
+	for(int k = 0; k<NUM_ROUNDS; k++) {
+		unsigned char* zr = zs + (size_t)k * zSize;
+		int e = es[k];
+		memcpy(Z_KE(zr), keys[k][e], 16);
+		memcpy(Z_KE1(zr), keys[k][(e + 1) % 3], 16);
+		memcpy(Z_RE(zr), rs[k][e], 4);
+		memcpy(Z_RE1(zr), rs[k][(e + 1) % 3], 4);
+		memcpy(Z_VE(zr), views + ((size_t)k * 3 + e) * viewSize, viewSize);
+		memcpy(Z_VE1(zr), views + ((size_t)k * 3 + (e + 1) % 3) * viewSize, viewSize);
+	}
+	inMilliZ = stats_end();
+
+
+	//Writing to file
+	stats_begin("write");
+	if (hexOut) {
+		cli_hexWrite(file, &brisHeader, sizeof(brisHeader));
+		cli_hexWrite(file, as, (size_t)aSize * NUM_ROUNDS);
+		cli_hexWrite(file, zs, (size_t)zSize * NUM_ROUNDS);
+		fputc('\n', file);
+	}
+	else {
+		fwrite(&brisHeader, sizeof(brisHeader), 1, file);
+		fwrite(as, aSize, NUM_ROUNDS, file);
+		fwrite(zs, zSize, NUM_ROUNDS, file);
+	}
+
+	inMilliWrite = stats_end();
+	arena_free(&ar);
+
+	inMilli = stats_totalMs();
+	stats_report("MPC_BRISTOL", NUM_ROUNDS);
+
+	long sumOfParts = 0;
+
+	printf("Generating A: %ju\n", (uintmax_t)inMilliA);
+	printf("	Generating keys: %ju\n", (uintmax_t)totalCrypto);
+	sumOfParts += totalCrypto;
+	printf("	Generating randomness: %ju\n", (uintmax_t)totalRandom);
+	sumOfParts += totalRandom;
+	printf("	Sharing secrets: %ju\n", (uintmax_t)totalSS);
+	sumOfParts += totalSS;
+	printf("	Running MPC circuit: %ju\n", (uintmax_t)totalMpc);
+	sumOfParts += totalMpc;
+	printf("	Committing: %ju\n", (uintmax_t)totalHash);
+	sumOfParts += totalHash;
+	printf("	*Accounted for*: %ju\n", (uintmax_t)sumOfParts);
+	printf("Generating E: %ju\n", (uintmax_t)inMilliE);
+	printf("Packing Z: %ju\n", (uintmax_t)inMilliZ);
+	printf("Writing file: %ju\n", (uintmax_t)inMilliWrite);
+	printf("Total: %ld\n",inMilli);
+	printf("Output: ");
+	for (int j = 0; j < outBytes; j++)
+		printf("%02X", y[j]);
+	printf("\n\n");
+	free(y);
+
+	return ferror(file) ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	unsigned char* input;
+	char* line = NULL;
+	size_t cap = 0;
+	long i, n;
+
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_PROVER | CLI_CIRCUIT, &opt) != 0)
+		return 1;
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	seed_init(opt.seed);
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	srand((unsigned) time(NULL));
+	init_EVP();
+	if (bristol_setup(opt.circuit, opt.publicInput) != 0)
+		return 1;
+	input = malloc(inBytes + 1);
+
+	if (opt.batch) {
+		FILE* proofs = cli_batchOutput(&opt);
+		int ret = 0;
+
+		if (!proofs) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		bristol_printCircuit();
+		printf("Iterations of circuit: %d\n", NUM_ROUNDS);
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			i = cli_message(&opt, line, n, input, inBytes);
+			if ((i != inBytes) || (proveInput(input, proofs, 1) != 0)) {
+				printf("Unable to prove: %s\n", line);
+				fputc('\n', proofs);
+				ret = 1;
+			}
+		}
+		free(line);
+		free(input);
+		if (fclose(proofs) != 0)
+			ret = 1;
+		cleanup_EVP();
+		return ret;
+	}
+
+	bristol_printCircuit();
+	if (opt.inputFile)
+		i = cli_readFile(&opt, opt.inputFile, input, inBytes);
+	else {
+		printf("Enter the secret input (%d bytes%s): ", inBytes, opt.hex ? ", hex encoded" : "");
+		n = cli_readLine(stdin, &line, &cap);
+		i = (n < 0) ? -1 : cli_message(&opt, line, n, input, inBytes);
+		free(line);
+	}
+	if (i != inBytes) {
+		printf("Input must be %d bytes!\n", inBytes);
+		return 1;
+	}
+	printf("Iterations of circuit: %d\n", NUM_ROUNDS);
+
+	char outputFile[FILENAME_MAX];
+	cli_proofName(opt.out, NUM_ROUNDS, outputFile, sizeof(outputFile));
+	FILE* file = fopen(outputFile, "wb");
+	if (!file) {
+		printf("Unable to open file!");
+		return 1;
+	}
+	int ret = proveInput(input, file, 0);
+	free(input);
+	if ((fclose(file) != 0) || (ret != 0)) {
+		printf("Unable to write proof!\n");
+		return 1;
+	}
+	printf("Proof output to file %s", outputFile);
+
+	cleanup_EVP();
+	return EXIT_SUCCESS;
+}
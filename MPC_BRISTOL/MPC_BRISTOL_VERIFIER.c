@@ -0,0 +1,165 @@
+/*
+ ============================================================================
+ Name        : MPC_BRISTOL_VERIFIER.c
+ Author      : Tan Teik Guan
+ Version     : 0.1
+ Description : Verifies a proof for a Bristol Fashion circuit generated by MPC_BRISTOL.c
+ ============================================================================
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "sharedbristol.h"
+#include "../common/cli.h"
+
+int NUM_ROUNDS = 136;
+
+
+/*
+ * Checks a proof of a header and NUM_ROUNDS a and z records. Returns 0 when
+ * every round verifies.
+ */
+int verifyProof(const unsigned char* proof, size_t proofSize) {
+	long inMilli;
+	int passed = 1;
+
+	stats_reset();
+	stats_begin("read");
+	if (proofSize != sizeof(bristolHeader) + (size_t)NUM_ROUNDS * (aSize + zSize)) {
+		printf("Invalid proof file size\n");
+		return 1;
+	}
+	if (memcmp(proof, &brisHeader, sizeof(bristolHeader)) != 0) {
+		printf("Proof is not for this circuit and public input\n");
+		return 1;
+	}
+	const unsigned char* as = proof + sizeof(bristolHeader);
+	const unsigned char* zs = as + (size_t)NUM_ROUNDS * aSize;
+
+
+	unsigned char* y = malloc(outBytes + 1);
+	reconstruct(as, y);
+	printf("Proof for output: ");
+	for(int i=0;i<outBytes;i++) {
+		printf("%02X", y[i]);
+	}
+	printf("\n");
+
+	inMilli = stats_end();
+	printf("Loading files: %ld\n", inMilli);
+
+
+	stats_begin("challenge");
+	int* es = malloc(NUM_ROUNDS * sizeof(int));
+	H3(y, as, NUM_ROUNDS, es);
+	stats_add(STATS_HASH_BYTES, sizeof(brisHeader) + outBytes + (uint64_t)aSize * NUM_ROUNDS);
+	free(y);
+	inMilli = stats_end();
+	printf("Generating E: %ld\n", inMilli);
+
+
+	stats_begin("verify");
+	int batchSize = (NUM_ROUNDS + omp_get_max_threads() - 1) / omp_get_max_threads();
+	if (batchSize > BRIS_LANES)
+		batchSize = BRIS_LANES;
+	int numBatches = (NUM_ROUNDS + batchSize - 1) / batchSize;
+	#pragma omp parallel for
+	for(int b = 0; b<numBatches; b++) {
+		int first = b * batchSize;
+		int n = (NUM_ROUNDS - first < batchSize) ? NUM_ROUNDS - first : batchSize;
+		uint64_t bad = verify(as + (size_t)first * aSize, zs + (size_t)first * zSize, &es[first], n);
+		for (int l = 0; l < n; l++) {
+			if ((bad >> l) & 1) {
+				printf("Not Verified %d\n", first + l);
+				passed = 0;
+			}
+		}
+	}
+	free(es);
+	inMilli = stats_end();
+	printf("Verifying: %ld\n", inMilli);
+
+
+	inMilli = stats_totalMs();
+	stats_report("MPC_BRISTOL_VERIFIER", NUM_ROUNDS);
+
+	printf("Total time: %ld\n", inMilli);
+	printf("Time per round: %.2f\n", (double)inMilli / NUM_ROUNDS);
+
+	return passed ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	int ret = 0;
+
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_VERIFIER | CLI_CIRCUIT, &opt) != 0)
+		return 1;
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	init_EVP();
+	if (bristol_setup(opt.circuit, opt.publicInput) != 0)
+		return 1;
+
+	if (opt.batch) {
+		FILE* results = cli_batchOutput(&opt);
+		unsigned char* proof = NULL;
+		char* line = NULL;
+		size_t cap = 0;
+		long n;
+
+		if (!results) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		bristol_printCircuit();
+		printf("Iterations of circuit: %d\n", NUM_ROUNDS);
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			proof = realloc(proof, n / 2 + 1);
+			long proofSize = cli_hexDecode(line, n, proof, n / 2);
+			if ((proofSize >= 0) && (verifyProof(proof, proofSize) == 0))
+				fprintf(results, "Verified ok\n");
+			else {
+				fprintf(results, "Not Verified\n");
+				ret = 1;
+			}
+		}
+		free(proof);
+		free(line);
+		fclose(results);
+	}
+	else {
+		char outputFile[FILENAME_MAX];
+		size_t proofSize;
+
+		bristol_printCircuit();
+		printf("Iterations of circuit: %d\n", NUM_ROUNDS);
+		cli_proofName(opt.inputFile, NUM_ROUNDS, outputFile, sizeof(outputFile));
+		const unsigned char* proof = mapProof(outputFile, &proofSize);
+		if (!proof) {
+			printf("Unable to open file!");
+			return 1;
+		}
+		ret = verifyProof(proof, proofSize);
+		unmapProof(proof, proofSize);
+		if (ret == 0)
+			printf("Verified ok\n");
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("Peak RSS: %ld KB\n", usage.ru_maxrss);
+
+	cleanup_EVP();
+	return ret;
+}
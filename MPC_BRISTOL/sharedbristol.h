@@ -0,0 +1,299 @@
+/*
+ * Name: sharedbristol.h
+ * Author: Tan Teik Guan
+ * Description: Common functions for the Bristol circuit prover and verifier
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * ZKBoo proofs, made as MPC_SHA256.c makes them, for a circuit loaded from a
+ * Bristol Fashion file (common/bristol.h). The first input values of the
+ * circuit are the secret input. The last ones may be public, given as a file
+ * whose bytes cover those values exactly. The statement is "I know a secret
+ * input that, with this public input, gives this output". A proof is
+ *
+ *   bristolHeader          hashes of the circuit file and the public input
+ *   NUM_ROUNDS a records   yp[3][outBytes], h[3][32]
+ *   NUM_ROUNDS z records   ke[16], ke1[16], re[4], re1[4], ve, ve1
+ *
+ * A view is the party's view words, 8 bytes per AND group, followed by its
+ * share of the secret input. The output shares are not part of the view, the
+ * verifier recomputes them from the two opened views. The header is hashed
+ * into the challenges, so a proof only verifies with the same circuit and
+ * public input.
+ */
+
+#ifndef SHAREDBRISTOL_H_
+#define SHAREDBRISTOL_H_
+#include <openssl/sha.h>
+#include <openssl/conf.h>
+#include <openssl/evp.h>
+#include <openssl/err.h>
+#ifdef _WIN32
+#include <openssl/applink.c>
+#endif
+#include <openssl/rand.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "omp.h"
+#include "../common/tapes.h"
+#include "../common/hashmany.h"
+#include "../common/mapproof.h"
+#include "../common/stats.h"
+#include "../common/bristol.h"
+
+#define VERBOSE FALSE
+
+#define BRISTOL_MAGIC "BRISTOL1"
+
+typedef struct {
+	char magic[8];
+	unsigned char circuitHash[32];
+	unsigned char publicHash[32];
+} bristolHeader;
+
+#define GETBIT(x, i) (((x) >> (i)) & 0x01)
+
+bristolCircuit brisCircuit;
+bristolHeader brisHeader;
+unsigned char* publicInput = NULL;
+int secretWires;
+int inBytes, outBytes, tapeBytes, viewSize, aSize, zSize;
+
+// Fields of the a and z records
+#define A_YP(r, p) ((r) + (p) * outBytes)
+#define A_H(r, p) ((r) + 3 * outBytes + (p) * 32)
+#define Z_KE(r) (r)
+#define Z_KE1(r) ((r) + 16)
+#define Z_RE(r) ((r) + 32)
+#define Z_RE1(r) ((r) + 36)
+#define Z_VE(r) ((r) + 40)
+#define Z_VE1(r) ((r) + 40 + viewSize)
+
+/*
+ * Loads the circuit and the public input, splits the input wires into secret
+ * and public ones and sets the record sizes and brisHeader. Returns 0 on
+ * success, otherwise prints what is wrong and returns 1.
+ */
+int bristol_setup(const char* circuitFile, const char* publicFile) {
+	long len, publicLen = 0;
+	unsigned char* text;
+	int publicWires = 0;
+
+	if (bris_load(&brisCircuit, circuitFile) != 0)
+		return 1;
+	text = bris_readFile(circuitFile, &len);
+	if (!text) {
+		printf("Unable to read circuit %s\n", circuitFile);
+		return 1;
+	}
+	memset(&brisHeader, 0, sizeof(brisHeader));
+	memcpy(brisHeader.magic, BRISTOL_MAGIC, sizeof(brisHeader.magic));
+	SHA256(text, len, brisHeader.circuitHash);
+	free(text);
+
+	if (publicFile) {
+		publicInput = bris_readFile(publicFile, &publicLen);
+		if (!publicInput) {
+			printf("Unable to read public input %s\n", publicFile);
+			return 1;
+		}
+		// As many of the last input values as the file has bytes for
+		for (int v = brisCircuit.numInputs - 1; (v > 0) && ((publicWires + 7) / 8 < publicLen); v--)
+			publicWires += brisCircuit.inputWidth[v];
+		if ((publicWires + 7) / 8 != publicLen) {
+			printf("Public input of %ld bytes does not cover whole input values of the circuit\n", publicLen);
+			return 1;
+		}
+	}
+	else
+		publicInput = calloc(1, 1);
+	SHA256(publicInput, publicLen, brisHeader.publicHash);
+
+	secretWires = brisCircuit.inputWires - publicWires;
+	inBytes = (secretWires + 7) / 8;
+	outBytes = (brisCircuit.outputWires + 7) / 8;
+	tapeBytes = 8 * brisCircuit.numGroups;
+	viewSize = tapeBytes + inBytes;
+	aSize = 3 * outBytes + 3 * 32;
+	zSize = 2 * 16 + 2 * 4 + 2 * viewSize;
+	return 0;
+}
+
+void bristol_printCircuit() {
+	printf("Circuit: %d gates, %d ANDs, AND depth %d, %d secret and %d public input bits, %d output bits\n",
+		brisCircuit.numGates, brisCircuit.numAnds, brisCircuit.depth, secretWires,
+		brisCircuit.inputWires - secretWires, brisCircuit.outputWires);
+}
+
+#define TAPE_IV ((unsigned char *)"01234567890123456")
+
+void init_EVP() {
+	tape_init();
+	hash_init();
+}
+
+void cleanup_EVP() {
+	bris_free(&brisCircuit);
+	free(publicInput);
+	crypto_cleanup();
+}
+
+void H(const unsigned char k[16], const unsigned char* view, const unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, k, 16);
+	EVP_DigestUpdate(ctx, view, viewSize);
+	EVP_DigestUpdate(ctx, r, 4);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
+}
+
+/*
+ * H() of the three views of n rounds side by side (common/hashmany.h), for
+ * rounds whose views follow each other in views and whose a records in as.
+ */
+void H_many(int n, unsigned char keys[][3][16], const unsigned char* views, unsigned char rs[][3][4], unsigned char* as) {
+	const void* in[3 * n];
+	unsigned char* out[3 * n];
+	hashMany h;
+
+	hash_begin(&h, crypto_sha256, 3 * n);
+	for (int i = 0; i < 3 * n; i++)
+		in[i] = keys[i / 3][i % 3];
+	hash_update(&h, in, 16);
+	for (int i = 0; i < 3 * n; i++)
+		in[i] = views + (size_t)i * viewSize;
+	hash_update(&h, in, viewSize);
+	for (int i = 0; i < 3 * n; i++) {
+		in[i] = rs[i / 3][i % 3];
+		out[i] = A_H(as + (size_t)(i / 3) * aSize, i % 3);
+	}
+	hash_update(&h, in, 4);
+	hash_final(&h, out);
+}
+
+
+void H3(const unsigned char* y, const unsigned char* as, int s, int* es) {
+
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, &brisHeader, sizeof(brisHeader));
+	EVP_DigestUpdate(ctx, y, outBytes);
+	EVP_DigestUpdate(ctx, as, (size_t)aSize * s);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
+
+	//Pick bits from hash
+	int i = 0;
+	int bitTracker = 0;
+	while(i < s) {
+		if(bitTracker >= SHA256_DIGEST_LENGTH*8) { //Generate new hash as we have run out of bits in the previous hash
+			ctx = crypto_digest(crypto_sha256);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
+			bitTracker = 0;
+		}
+
+		int b1 = GETBIT(hash[bitTracker/8], bitTracker % 8);
+		int b2 = GETBIT(hash[(bitTracker+1)/8], (bitTracker+1) % 8);
+		if(b1 == 0) {
+			if(b2 == 0) {
+				es[i] = 0;
+				bitTracker += 2;
+				i++;
+			} else {
+				es[i] = 1;
+				bitTracker += 2;
+				i++;
+			}
+		} else {
+			if(b2 == 0) {
+				es[i] = 2;
+				bitTracker += 2;
+				i++;
+			} else {
+				bitTracker += 2;
+			}
+		}
+	}
+
+}
+
+void reconstruct(const unsigned char* a, unsigned char* y) {
+	for (int i = 0; i < outBytes; i++)
+		y[i] = A_YP(a, 0)[i] ^ A_YP(a, 1)[i] ^ A_YP(a, 2)[i];
+}
+
+
+/*
+ * Verifies the n <= BRIS_LANES rounds whose a and z records start at as and
+ * zs, with challenges es. Returns the rounds that fail, bit l for round l.
+ */
+uint64_t verify(const unsigned char* as, const unsigned char* zs, const int* es, int n) {
+	unsigned char* tapes = malloc(2 * n * tapeBytes + 1);
+	unsigned char* outs = malloc(2 * n * outBytes + 1);
+	uint64_t* w = malloc(2 * sizeof(uint64_t) * brisCircuit.numSlots);
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	uint64_t bad = 0;
+	brisLanes bl;
+
+	bl.lanes = n;
+	bl.secretWires = secretWires;
+	bl.pub = publicInput;
+	for (int l = 0; l < n; l++) {
+		const unsigned char* ar = as + (size_t)l * aSize;
+		const unsigned char* zr = zs + (size_t)l * zSize;
+		int e = es[l];
+
+		H(Z_KE(zr), Z_VE(zr), Z_RE(zr), hash);
+		if (memcmp(A_H(ar, e), hash, 32) != 0) {
+#if VERBOSE
+			printf("Failing at %d", __LINE__);
+#endif
+			bad |= (uint64_t)1 << l;
+		}
+		H(Z_KE1(zr), Z_VE1(zr), Z_RE1(zr), hash);
+		if (memcmp(A_H(ar, (e + 1) % 3), hash, 32) != 0) {
+#if VERBOSE
+			printf("Failing at %d", __LINE__);
+#endif
+			bad |= (uint64_t)1 << l;
+		}
+
+		if (tapeBytes) {
+			tape_expand(Z_KE(zr), TAPE_IV, tapes + (2 * l) * tapeBytes, tapeBytes);
+			tape_expand(Z_KE1(zr), TAPE_IV, tapes + (2 * l + 1) * tapeBytes, tapeBytes);
+		}
+		for (int p = 0; p < 2; p++) {
+			const unsigned char* v = p ? Z_VE1(zr) : Z_VE(zr);
+			bl.tape[l][p] = tapes + (2 * l + p) * tapeBytes;
+			bl.yv[l][p] = v;
+			bl.x[l][p] = v + tapeBytes;
+			bl.out[l][p] = outs + (2 * l + p) * outBytes;
+		}
+	}
+	stats_add(STATS_HASH_BYTES, (uint64_t)n * 2 * (16 + viewSize + 4));
+	stats_add(STATS_TAPE_BYTES, (uint64_t)n * 2 * tapeBytes);
+
+	bad |= bris_verify(&brisCircuit, &bl, w);
+	stats_add(STATS_GATES, (uint64_t)n * brisCircuit.numGates);
+
+	for (int l = 0; l < n; l++) {
+		const unsigned char* ar = as + (size_t)l * aSize;
+		if ((memcmp(A_YP(ar, es[l]), bl.out[l][0], outBytes) != 0) ||
+			(memcmp(A_YP(ar, (es[l] + 1) % 3), bl.out[l][1], outBytes) != 0)) {
+#if VERBOSE
+			printf("Failing at %d", __LINE__);
+#endif
+			bad |= (uint64_t)1 << l;
+		}
+	}
+
+	free(tapes);
+	free(outs);
+	free(w);
+	return bad;
+}
+
+
+#endif /* SHAREDBRISTOL_H_ */
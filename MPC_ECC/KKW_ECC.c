@@ -43,47 +43,68 @@
 #include <string.h>
 #include <time.h>
 #include "KKW_shared.h"
+#include "../common/seed.h"
 #include "omp.h"
 
 
 int main(int argc, char * argv[]) 
 {
 //	setbuf(stdout, NULL);
-	SHA256_CTX ctx;
+	EVP_MD_CTX * ctx;
 	MP_INT mod;
 	srand((unsigned) time(NULL));
+	if (stats_init(NULL) != 0)
+		return -1;
 	init_EVP();
 
+	// --seed STRING before the key seed makes the proof reproducible, common/seed.h
+	if ((argc == 4) && (strcmp(argv[1], "--seed") == 0))
+	{
+		if (seed_init(argv[2]) != 0)
+			return -1;
+		argv[2] = argv[0];
+		argv += 2;
+		argc -= 2;
+	}
 	if (argc != 2)
 	{
-		printf("Usage: %s <seed>\n",argv[0]);
+		printf("Usage: %s [--seed STRING] <seed>\n",argv[0]);
 		return -1;
 	}
 
 	unsigned char input[SHA256_DIGEST_LENGTH] = {0}; // 512 bits
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx,argv[1],strlen(argv[1]));
-	SHA256_Final(input,&ctx);
+	ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx,argv[1],strlen(argv[1]));
+	EVP_DigestFinal_ex(ctx,input,NULL);
 		
 	mpz_init_set_str(&mod,CURVE_P,16);
 
-	unsigned char masterkeys[NUM_ROUNDS][16];
+	int masterDepth = seedtree_depth(NUM_ROUNDS);
+	unsigned char mastertree[SEEDTREE_NODES(masterDepth)][16];
+	unsigned char (*masterkeys)[16] = &mastertree[(1 << masterDepth) - 1];
 	unsigned char keys[NUM_ROUNDS][NUM_PARTIES][16];
 	unsigned char rsseed[20];
 	unsigned char rs[NUM_ROUNDS][NUM_PARTIES][4];
 
         //Generating keys
-	Compute_RAND((unsigned char *)masterkeys, NUM_ROUNDS*16,input,SHA256_DIGEST_LENGTH);  
+	stats_begin("keys");
+	Compute_RAND(mastertree[0], 16,input,SHA256_DIGEST_LENGTH);  
+	seedtree_expand(mastertree, masterDepth, NULL);
 	memset(rsseed,0,20);
-	RAND_bytes((unsigned char *)&rsseed[4],16);
+	seed_bytes((unsigned char *)&rsseed[4],16);
+	#pragma omp parallel for
 	for (int j = 0; j < NUM_ROUNDS; j++)
 	{
-		Compute_RAND((unsigned char *)keys[j], NUM_PARTIES*16,masterkeys[j],16);  
-		memcpy((unsigned char *)rsseed,&j,sizeof(int));
-		Compute_RAND((unsigned char *)rs[j],NUM_PARTIES*4,rsseed,20);
+		unsigned char roundseed[20];
+		partyKeys(masterkeys[j], keys[j]);
+		memcpy(roundseed,rsseed,20);
+		memcpy(roundseed,&j,sizeof(int));
+		Compute_RAND((unsigned char *)rs[j],NUM_PARTIES*4,roundseed,20);
 	}
         //Sharing secrets
+	stats_begin("sharing");
 	unsigned char shares[NUM_ROUNDS][NUM_PARTIES][ECC_INPUTS];
+	#pragma omp parallel for
 	for (int j=0;j<NUM_ROUNDS;j++)
 	{
 		for (int k=0;k<NUM_PARTIES;k++)
@@ -91,9 +112,10 @@ int main(int argc, char * argv[])
 	}
 
         //Generating randomness
+	stats_begin("randomness");
 	unsigned char *randomness[NUM_ROUNDS][NUM_PARTIES];
 
-//	#pragma omp parallel for
+	#pragma omp parallel for
 	for(int k=0; k<NUM_ROUNDS; k++) {
 		for(int j = 0; j<NUM_PARTIES; j++) {
 			randomness[k][j]= (unsigned char *)malloc(rSize);
@@ -101,86 +123,107 @@ int main(int argc, char * argv[])
 			getAllRandomness(keys[k][j], randomness[k][j]);
 		}
 	}
+	stats_add(STATS_TAPE_BYTES, (uint64_t)NUM_ROUNDS * NUM_PARTIES * rSize);
+
 	//compute AUX Tape
-	SHA256_CTX hctx,H1ctx,H2ctx;
+	stats_begin("preprocess");
+	EVP_MD_CTX * hctx;
 	unsigned char temphash1[SHA256_DIGEST_LENGTH];
 	unsigned char temphash2[SHA256_DIGEST_LENGTH];
 	unsigned char temphash3[SHA256_DIGEST_LENGTH];
-	SHA256_Init(&H1ctx);
+	unsigned char H1[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
+
+	//Rounds are independent, their digests are folded into H1 in round order afterwards
+	#pragma omp parallel for
 	for (int k = 0; k<NUM_ROUNDS;k++)
 	{
+		EVP_MD_CTX ** rctx;
+		unsigned char com[SHA256_DIGEST_LENGTH];
+
 		computeAuxTape(randomness[k],shares[k]);
-		SHA256_Init(&hctx);
+		rctx = crypto_digests(crypto_sha256, 2);
 		for (int j = 0; j < NUM_PARTIES; j++)
 		{
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, keys[k][j], 16);
+			EVP_DigestInit_ex(rctx[1], crypto_sha256, NULL);
+			EVP_DigestUpdate(rctx[1], keys[k][j], 16);
 			if (j == (NUM_PARTIES-1))
-				SHA256_Update(&ctx, randomness[k][j], rSize);
-			SHA256_Update(&ctx, rs[k][j], 4);
-			SHA256_Final(temphash1,&ctx);
-			SHA256_Update(&hctx, temphash1, SHA256_DIGEST_LENGTH);
+				EVP_DigestUpdate(rctx[1], randomness[k][j], rSize);
+			EVP_DigestUpdate(rctx[1], rs[k][j], 4);
+			EVP_DigestFinal_ex(rctx[1], com, NULL);
+			EVP_DigestUpdate(rctx[0], com, SHA256_DIGEST_LENGTH);
 		}
-		SHA256_Final(temphash1,&hctx);
-		SHA256_Update(&H1ctx, temphash1, SHA256_DIGEST_LENGTH);
+		EVP_DigestFinal_ex(rctx[0], H1[k], NULL);
 	}
-	SHA256_Final(temphash1,&H1ctx);
+	hctx = crypto_digest(crypto_sha256);
+	for (int k = 0; k<NUM_ROUNDS;k++)
+		EVP_DigestUpdate(hctx, H1[k], SHA256_DIGEST_LENGTH);
+	EVP_DigestFinal_ex(hctx, temphash1, NULL);
+	stats_add(STATS_HASH_BYTES, (uint64_t)NUM_ROUNDS * (NUM_PARTIES * (16 + 4 + SHA256_DIGEST_LENGTH) + rSize + SHA256_DIGEST_LENGTH));
 
 	//Running MPC-SHA2 online
+	stats_begin("online");
 	unsigned char masked_result[NUM_ROUNDS][2][ECC_PUBKEY_LENGTH];
 	unsigned char party_result[2][NUM_PARTIES][ECC_PUBKEY_LENGTH];
 	unsigned char maskedInputs[NUM_ROUNDS][ECC_INPUTS];
 	View localViews[NUM_ROUNDS][NUM_PARTIES];
 	unsigned char H2[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
-	SHA256_Init(&H2ctx);
-//	#pragma omp parallel for
+	#pragma omp parallel for
 	for(int k=0; k<NUM_ROUNDS; k++) {
 		int countY = 0;
+		unsigned char results[2][NUM_PARTIES][ECC_PUBKEY_LENGTH];
+		EVP_MD_CTX * rctx;
 
-		mpc_compute(masked_result[k],maskedInputs[k],shares[k],input, ECC_INPUTS, randomness[k], localViews[k],party_result,&countY);
-		SHA256_Init(&hctx);
-		SHA256_Update(&hctx,maskedInputs[k],ECC_INPUTS);
-		SHA256_Update(&hctx,masked_result[k],ECC_PUBKEY_LENGTH);
+		mpc_compute(masked_result[k],maskedInputs[k],shares[k],input, ECC_INPUTS, randomness[k], localViews[k],results,&countY);
+		rctx = crypto_digest(crypto_sha256);
+		EVP_DigestUpdate(rctx,maskedInputs[k],ECC_INPUTS);
+		EVP_DigestUpdate(rctx,masked_result[k],ECC_PUBKEY_LENGTH);
 		for (int j=0;j<NUM_PARTIES;j++)
-			SHA256_Update(&hctx, localViews[k][j].y,ySize*4);
-		SHA256_Update(&hctx, rs[k], NUM_PARTIES*4);
-		SHA256_Final(H2[k],&hctx);
-		SHA256_Update(&H2ctx, H2[k], SHA256_DIGEST_LENGTH);
+			EVP_DigestUpdate(rctx, localViews[k][j].y,ySize*4);
+		EVP_DigestUpdate(rctx, rs[k], NUM_PARTIES*4);
+		EVP_DigestFinal_ex(rctx,H2[k],NULL);
+		stats_add(STATS_GATES, countY);
+		stats_add(STATS_HASH_BYTES, ECC_INPUTS + 2 * ECC_PUBKEY_LENGTH + NUM_PARTIES * (ySize * 4 + 4) + SHA256_DIGEST_LENGTH);
 		if (k == 0)
-		{
-			MP_INT pubx, puby, tempx, tempy;
-			mpz_init(&pubx);
-			mpz_init(&puby);
-			mpz_init(&tempx);
-			mpz_init(&tempy);
-			printf("Result of ECC\nGx: ");
-			mpz_import(&pubx,ECC_PUBKEY_LENGTH,1,1,0,0,masked_result[k][0]);
-			mpz_import(&puby,ECC_PUBKEY_LENGTH,1,1,0,0,masked_result[k][1]);
-			for (int i=0;i<NUM_PARTIES;i++)
-			{
-				mpz_import(&tempx,ECC_PUBKEY_LENGTH,1,1,0,0,party_result[0][i]);
-				mpz_import(&tempy,ECC_PUBKEY_LENGTH,1,1,0,0,party_result[1][i]);
-				ecAddPoint(&pubx,&puby,&tempx,&tempy);
-			}
-			mpz_out_str(stdout, 16, &pubx);
-			printf("\nGy: ");
-			mpz_out_str(stdout, 16, &puby);
-			printf("\n");
-		}
+			memcpy(party_result,results,sizeof(results));
+	}
+	hctx = crypto_digest(crypto_sha256);
+	for (int k = 0; k<NUM_ROUNDS;k++)
+		EVP_DigestUpdate(hctx, H2[k], SHA256_DIGEST_LENGTH);
+	EVP_DigestFinal_ex(hctx, temphash2, NULL);
+
+	MP_INT pubx, puby, tempx, tempy;
+	mpz_init(&pubx);
+	mpz_init(&puby);
+	mpz_init(&tempx);
+	mpz_init(&tempy);
+	printf("Result of ECC\nGx: ");
+	mpz_import(&pubx,ECC_PUBKEY_LENGTH,1,1,0,0,masked_result[0][0]);
+	mpz_import(&puby,ECC_PUBKEY_LENGTH,1,1,0,0,masked_result[0][1]);
+	for (int i=0;i<NUM_PARTIES;i++)
+	{
+		mpz_import(&tempx,ECC_PUBKEY_LENGTH,1,1,0,0,party_result[0][i]);
+		mpz_import(&tempy,ECC_PUBKEY_LENGTH,1,1,0,0,party_result[1][i]);
+		ecAddPoint(&pubx,&puby,&tempx,&tempy);
 	}
-	SHA256_Final(temphash2,&H2ctx);
+	mpz_out_str(stdout, 16, &pubx);
+	printf("\nGy: ");
+	mpz_out_str(stdout, 16, &puby);
+	printf("\n");
 
-	SHA256_Init(&hctx);
-	SHA256_Update(&hctx, temphash1, SHA256_DIGEST_LENGTH);
-	SHA256_Update(&hctx, temphash2, SHA256_DIGEST_LENGTH);
-	SHA256_Final(temphash3,&hctx);
+	hctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(hctx, temphash1, SHA256_DIGEST_LENGTH);
+	EVP_DigestUpdate(hctx, temphash2, SHA256_DIGEST_LENGTH);
+	EVP_DigestFinal_ex(hctx, temphash3, NULL);
 
 	//Committing
+	stats_begin("challenge");
 	z kkwProof;
 	int es[NUM_ROUNDS];
+	memset(&kkwProof,0,sizeof(z));
 	memcpy(kkwProof.H,temphash3,SHA256_DIGEST_LENGTH);
 	memcpy(kkwProof.rsseed,&rsseed[4],16);
 	H3(temphash3, NUM_ONLINE, es);
+	seedtree_reveal(mastertree, masterDepth, NUM_ROUNDS, es, kkwProof.masterkeys);
 
 	int masterkeycount = 0;
 	int onlinecount = 0;
@@ -189,30 +232,25 @@ int main(int argc, char * argv[])
 	{
 		if (!es[i])
 		{
-			memcpy(kkwProof.masterkeys[masterkeycount],masterkeys[i],16);
 			memcpy(kkwProof.H2[masterkeycount++],H2[i],SHA256_DIGEST_LENGTH);
 		}
 		else
 		{
 			memcpy(kkwProof.auxBits[onlinecount],randomness[i][NUM_PARTIES-1],rSize);
 			memcpy(kkwProof.maskedInput[onlinecount],maskedInputs[i],ECC_INPUTS);
-			int partycount = 0;
+			revealPartyKeys(masterkeys[i],es[i]-1,kkwProof.keys[onlinecount]);
 			for (int j = 0; j < NUM_PARTIES; j++)
 			{
-				if ((j+1) != es[i])
-				{
-					memcpy(kkwProof.keys[onlinecount][partycount++],keys[i][j],16);
-				}
-				else
+				if ((j+1) == es[i])
 				{
-					SHA256_Init(&ctx);
-					SHA256_Update(&ctx,keys[i][j],16);
+					ctx = crypto_digest(crypto_sha256);
+					EVP_DigestUpdate(ctx,keys[i][j],16);
 					if (j == (NUM_PARTIES-1))
 					{
-						SHA256_Update(&ctx, randomness[i][NUM_PARTIES-1], rSize);
+						EVP_DigestUpdate(ctx, randomness[i][NUM_PARTIES-1], rSize);
 					}
-					SHA256_Update(&ctx, rs[i][j], 4);
-					SHA256_Final(kkwProof.com[onlinecount],&ctx);
+					EVP_DigestUpdate(ctx, rs[i][j], 4);
+					EVP_DigestFinal_ex(ctx,kkwProof.com[onlinecount],NULL);
 					memcpy(&kkwProof.views[onlinecount],&localViews[i][j],sizeof(View));
 				}
 				free(randomness[i][j]);
@@ -222,6 +260,7 @@ int main(int argc, char * argv[])
 	}
 		
 	//Writing to file
+	stats_begin("write");
 	FILE *file;
 	char outputFile[100];
 
@@ -234,6 +273,7 @@ int main(int argc, char * argv[])
 	fwrite(&kkwProof, sizeof(z), 1, file);
 
 	fclose(file);
+	stats_report("KKW_ECC", NUM_ROUNDS);
 	mpz_clear(&mod);
 
 	printf("Proof output to file %s\n", outputFile);
@@ -52,6 +52,8 @@ int isOnline(int es[NUM_ROUNDS], int round)
 
 int main(int argc, char * argv[]) {
 
+	if (stats_init(NULL) != 0)
+		return -1;
 	init_EVP();
 	
 	z kkwProof;
@@ -64,6 +66,7 @@ int main(int argc, char * argv[]) {
 		return -1;
 	}
 
+	stats_begin("read");
 	file = fopen(argv[1], "rb");
 	if (!file) {
 		printf("Unable to open file %s!\n",argv[1]);
@@ -71,6 +74,7 @@ int main(int argc, char * argv[]) {
 	fread(&kkwProof, sizeof(z), 1, file);
 	fclose(file);
 
+	stats_begin("challenge");
 	int es[NUM_ROUNDS];
 	memset(es,0,NUM_ROUNDS*sizeof(int));
 	H3(kkwProof.H, NUM_ONLINE, es);
@@ -90,33 +94,47 @@ int main(int argc, char * argv[]) {
 	memset(shares,0,NUM_ROUNDS*NUM_PARTIES*ECC_INPUTS);
 	memcpy(&rsseed[4],kkwProof.rsseed,16);
 	int roundctr = 0;
-	int partyctr = 0;
 	int onlinectr = 0;
+	stats_begin("randomness");
+	int masterDepth = seedtree_depth(NUM_ROUNDS);
+	unsigned char mastertree[SEEDTREE_NODES(masterDepth)][16];
+	unsigned char (*masterkeys)[16] = &mastertree[(1 << masterDepth) - 1];
+	//The nodes past the ones the online rounds call for are zero, so the proof has one encoding
+	static const unsigned char zeroNode[16];
+	for (int j = seedtree_fill(mastertree, masterDepth, NUM_ROUNDS, es, kkwProof.masterkeys); j < MASTER_NODES; j++)
+	{
+		if (memcmp(kkwProof.masterkeys[j],zeroNode,16))
+		{
+			printf("Error: Unused master key node is not zero\n");
+			return -1;
+		}
+	}
 	for (int j = 0; j < NUM_ROUNDS; j++)
 	{
 		memcpy((unsigned char *)rsseed,&j,sizeof(int));
 		Compute_RAND((unsigned char *)rs[j],NUM_PARTIES*4,rsseed,20);
 		if (!isOnline(es,j))
 		{
-			Compute_RAND((unsigned char *)keys[j], NUM_PARTIES*16,kkwProof.masterkeys[roundctr++],16);
+			partyKeys(masterkeys[j], keys[j]);
 
 			for (int k = 0; k < NUM_PARTIES; k++)
 			{
 				Compute_RAND((unsigned char *)&(shares[j][k]),ECC_INPUTS,(unsigned char *)keys[j][k],16);
 				getAllRandomness(keys[j][k], randomness[j][k]);
+				stats_add(STATS_TAPE_BYTES, rSize);
 			}
 			computeAuxTape(randomness[j],shares[j]);
 		}
 		else
 		{
-			partyctr = 0;
+			fillPartyKeys(kkwProof.keys[onlinectr],es[j]-1,keys[j]);
 			for (int k = 0; k < NUM_PARTIES;k++)
 			{
 				if ((k+1) != es[j])
 				{
-					memcpy((unsigned char *)keys[j][k],kkwProof.keys[onlinectr][partyctr++],16);
 					Compute_RAND((unsigned char *)&(shares[j][k]),ECC_INPUTS,(unsigned char *)keys[j][k],16);
 					getAllRandomness(keys[j][k], randomness[j][k]);
+					stats_add(STATS_TAPE_BYTES, rSize);
 				}
 				else
 				{
@@ -129,7 +147,8 @@ int main(int argc, char * argv[]) {
 			onlinectr++;
 		}
 	}
-	SHA256_CTX ctx,hctx,H1ctx,H2ctx;
+	//Hctx[0] runs over the rounds, Hctx[1] over one round and Hctx[2] over one party
+	EVP_MD_CTX ** Hctx;
 	unsigned char H1hash[SHA256_DIGEST_LENGTH];
 	unsigned char H2hash[SHA256_DIGEST_LENGTH];
 	unsigned char temphash1[SHA256_DIGEST_LENGTH];
@@ -141,16 +160,17 @@ int main(int argc, char * argv[]) {
 
 	roundctr = 0;
 
-	SHA256_Init(&H1ctx);
+	stats_begin("preprocess");
+	Hctx = crypto_digests(crypto_sha256, 3);
 	for (int k = 0; k<NUM_ROUNDS;k++)
 	{
 		if (!isOnline(es,k))
 		{
-			SHA256_Init(&hctx);
+			EVP_DigestInit_ex(Hctx[1], crypto_sha256, NULL);
 			for (int j = 0; j < NUM_PARTIES; j++)
 			{
-				SHA256_Init(&ctx);
-				SHA256_Update(&ctx, keys[k][j], 16);
+				EVP_DigestInit_ex(Hctx[2], crypto_sha256, NULL);
+				EVP_DigestUpdate(Hctx[2], keys[k][j], 16);
 				if (j == (NUM_PARTIES-1))
 				{
 /*
@@ -164,46 +184,48 @@ int main(int argc, char * argv[]) {
 						pos++;
 					}
 */
-             				SHA256_Update(&ctx, randomness[k][NUM_PARTIES-1], rSize);
+             				EVP_DigestUpdate(Hctx[2], randomness[k][NUM_PARTIES-1], rSize);
 				}
-				SHA256_Update(&ctx, rs[k][j], 4);
-				SHA256_Final(temphash1, &ctx);
-				SHA256_Update(&hctx,temphash1,SHA256_DIGEST_LENGTH);
+				EVP_DigestUpdate(Hctx[2], rs[k][j], 4);
+				EVP_DigestFinal_ex(Hctx[2], temphash1, NULL);
+				EVP_DigestUpdate(Hctx[1],temphash1,SHA256_DIGEST_LENGTH);
 				free(randomness[k][j]);
   			}
-			SHA256_Final(temphash2,&hctx);
-			SHA256_Update(&H1ctx, temphash2, SHA256_DIGEST_LENGTH);
+			EVP_DigestFinal_ex(Hctx[1],temphash2,NULL);
+			EVP_DigestUpdate(Hctx[0], temphash2, SHA256_DIGEST_LENGTH);
 		}
 		else
 		{
-			SHA256_Init(&hctx);
+			EVP_DigestInit_ex(Hctx[1], crypto_sha256, NULL);
 			for (int j = 0; j < NUM_PARTIES; j++)
 			{
 				if ((j+1) != es[k])
 				{
-					SHA256_Init(&ctx);
-					SHA256_Update(&ctx, keys[k][j], 16);
+					EVP_DigestInit_ex(Hctx[2], crypto_sha256, NULL);
+					EVP_DigestUpdate(Hctx[2], keys[k][j], 16);
 					if (j == (NUM_PARTIES-1))
 					{
-             					SHA256_Update(&ctx, kkwProof.auxBits[roundctr], rSize);
+             					EVP_DigestUpdate(Hctx[2], kkwProof.auxBits[roundctr], rSize);
 					}
-					SHA256_Update(&ctx, rs[k][j], 4);
-					SHA256_Final(temphash1, &ctx);
+					EVP_DigestUpdate(Hctx[2], rs[k][j], 4);
+					EVP_DigestFinal_ex(Hctx[2], temphash1, NULL);
 				}
 				else
 				{
 					memcpy(temphash1,kkwProof.com[roundctr],SHA256_DIGEST_LENGTH);
 				}
-				SHA256_Update(&hctx,temphash1,SHA256_DIGEST_LENGTH);
+				EVP_DigestUpdate(Hctx[1],temphash1,SHA256_DIGEST_LENGTH);
 			}
-			SHA256_Final(temphash2,&hctx);
-			SHA256_Update(&H1ctx, temphash2, SHA256_DIGEST_LENGTH);
+			EVP_DigestFinal_ex(Hctx[1],temphash2,NULL);
+			EVP_DigestUpdate(Hctx[0], temphash2, SHA256_DIGEST_LENGTH);
 			roundctr++;
 		}
 	}
-	SHA256_Final(H1hash,&H1ctx);
+	EVP_DigestFinal_ex(Hctx[0],H1hash,NULL);
+	stats_add(STATS_HASH_BYTES, (uint64_t)NUM_ROUNDS * (NUM_PARTIES * (16 + 4 + SHA256_DIGEST_LENGTH) + rSize + SHA256_DIGEST_LENGTH));
 
-	SHA256_Init(&H2ctx);
+	stats_begin("online");
+	Hctx = crypto_digests(crypto_sha256, 2);
 	roundctr = 0;
 	onlinectr = 0;
 	for (int k=0; k < NUM_ROUNDS; k++)
@@ -211,32 +233,35 @@ int main(int argc, char * argv[]) {
 		int countY = 0;
 		if (!isOnline(es,k))
 		{
-			SHA256_Update(&H2ctx,kkwProof.H2[roundctr++],SHA256_DIGEST_LENGTH);
+			EVP_DigestUpdate(Hctx[0],kkwProof.H2[roundctr++],SHA256_DIGEST_LENGTH);
 		}
 		else
 		{
-			SHA256_Init(&hctx);
-			SHA256_Update(&hctx,kkwProof.maskedInput[onlinectr],ECC_INPUTS);
+			EVP_DigestInit_ex(Hctx[1], crypto_sha256, NULL);
+			EVP_DigestUpdate(Hctx[1],kkwProof.maskedInput[onlinectr],ECC_INPUTS);
 			memcpy(&localViews[onlinectr][es[k]-1],&kkwProof.views[onlinectr],sizeof(View));
 			mpc_compute(masked_result,kkwProof.maskedInput[onlinectr],shares[k],NULL,es[k]-1,randomness[k],localViews[onlinectr],party_result,&countY);
-			SHA256_Update(&hctx,masked_result,SHA256_DIGEST_LENGTH);
+			EVP_DigestUpdate(Hctx[1],masked_result,SHA256_DIGEST_LENGTH);
 			for (int j = 0; j < NUM_PARTIES; j++)
-				SHA256_Update(&hctx, localViews[onlinectr][j].y,ySize*4);
-			SHA256_Update(&hctx,rs[k],NUM_PARTIES*4);
-			SHA256_Final(temphash1,&hctx);
-			SHA256_Update(&H2ctx,temphash1,SHA256_DIGEST_LENGTH);
+				EVP_DigestUpdate(Hctx[1], localViews[onlinectr][j].y,ySize*4);
+			EVP_DigestUpdate(Hctx[1],rs[k],NUM_PARTIES*4);
+			EVP_DigestFinal_ex(Hctx[1],temphash1,NULL);
+			EVP_DigestUpdate(Hctx[0],temphash1,SHA256_DIGEST_LENGTH);
+			stats_add(STATS_GATES, countY);
+			stats_add(STATS_HASH_BYTES, ECC_INPUTS + 2 * ECC_PUBKEY_LENGTH + NUM_PARTIES * (ySize * 4 + 4) + SHA256_DIGEST_LENGTH);
 			for (int j = 0; j<NUM_PARTIES;j++)
 				free(randomness[k][j]);
 
 			onlinectr++;
 		}
 	}
-	SHA256_Final(H2hash,&H2ctx);
+	EVP_DigestFinal_ex(Hctx[0],H2hash,NULL);
 
-	SHA256_Init(&hctx);
-	SHA256_Update(&hctx,H1hash,SHA256_DIGEST_LENGTH);
-	SHA256_Update(&hctx,H2hash,SHA256_DIGEST_LENGTH);
-	SHA256_Final(temphash1,&hctx);
+	Hctx = crypto_digests(crypto_sha256, 1);
+	EVP_DigestUpdate(Hctx[0],H1hash,SHA256_DIGEST_LENGTH);
+	EVP_DigestUpdate(Hctx[0],H2hash,SHA256_DIGEST_LENGTH);
+	EVP_DigestFinal_ex(Hctx[0],temphash1,NULL);
+	stats_report("KKW_ECC_VERIFIER", NUM_ROUNDS);
 
 	if (memcmp(temphash1,kkwProof.H,SHA256_DIGEST_LENGTH))
 	{
@@ -58,6 +58,9 @@
 #endif
 #include <openssl/rand.h>
 #include <gmp.h>
+#include "../common/tapes.h"
+#include "../common/stats.h"
+#include "../common/seedtree.h"
 
 #define VERBOSE FALSE
 #define ToBytes(x) (x == 0)? 0:((x-1)/8+1)
@@ -107,6 +110,8 @@ static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 #define ECC_INPUTS 32
 #define ECC_PUBKEY_LENGTH 32 
 #define NUM_ONLINE 4 // out of NUM_ROUNDS
+#define PARTY_DEPTH 5 // log2(NUM_PARTIES), the co-path of a hidden party
+#define MASTER_NODES 5 // most seed tree nodes the rounds that are not online take
 
 typedef struct {
 	uint32_t y[ySize];
@@ -115,9 +120,9 @@ typedef struct {
 typedef struct {
 	unsigned char rsseed[16];
 	unsigned char H[SHA256_DIGEST_LENGTH];
-	unsigned char masterkeys[NUM_ROUNDS-NUM_ONLINE][16];
+	unsigned char masterkeys[MASTER_NODES][16]; // seed tree nodes, unused ones zero
 	unsigned char H2[NUM_ROUNDS-NUM_ONLINE][SHA256_DIGEST_LENGTH];
-	unsigned char keys[NUM_ONLINE][NUM_PARTIES-1][16];
+	unsigned char keys[NUM_ONLINE][PARTY_DEPTH][16]; // co-path of the hidden party
 	unsigned char com[NUM_ONLINE][SHA256_DIGEST_LENGTH];
 	unsigned char auxBits[NUM_ONLINE][rSize];
 	unsigned char maskedInput[NUM_ONLINE][ECC_INPUTS];
@@ -143,21 +148,20 @@ void Compute_RAND(unsigned char * output, int size, unsigned char * seed, int se
 	char * tempptr = output;
 	uint32_t count = 1;
 
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, namestr, strlen(namestr));
-	SHA256_Update(&ctx, &seedLen, sizeof(int));
-	SHA256_Update(&ctx, seed, seedLen);
-	SHA256_Update(&ctx, &size, sizeof(int));
-	SHA256_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, namestr, strlen(namestr));
+	EVP_DigestUpdate(ctx, &seedLen, sizeof(int));
+	EVP_DigestUpdate(ctx, seed, seedLen);
+	EVP_DigestUpdate(ctx, &size, sizeof(int));
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 	while (size > 0)
 	{
-		SHA256_Init(&ctx);
-		SHA256_Update(&ctx, &count, sizeof(int));
-		SHA256_Update(&ctx, &seedLen, sizeof(int));
-		SHA256_Update(&ctx, seed, seedLen);
-		SHA256_Update(&ctx, hash, sizeof(hash));
-		SHA256_Final(hash, &ctx);
+		ctx = crypto_digest(crypto_sha256);
+		EVP_DigestUpdate(ctx, &count, sizeof(int));
+		EVP_DigestUpdate(ctx, &seedLen, sizeof(int));
+		EVP_DigestUpdate(ctx, seed, seedLen);
+		EVP_DigestUpdate(ctx, hash, sizeof(hash));
+		EVP_DigestFinal_ex(ctx, hash, NULL);
 		if (size >= SHA256_DIGEST_LENGTH)
 		{
 			memcpy(tempptr,hash,SHA256_DIGEST_LENGTH);
@@ -192,38 +196,53 @@ EVP_CIPHER_CTX setupAES(unsigned char key[16]) {
 
 }
 */
+#define TAPE_IV ((unsigned char *)"01234567890123456")
+
+// AES-CTR keystream of the key, see common/tapes.h
 void getAllRandomness(unsigned char key[16], unsigned char *randomness) {
-	//Generate randomness: We use 728*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 728*32/128 = 182 iterations
-
-	EVP_CIPHER_CTX * ctx = EVP_CIPHER_CTX_new();
-	unsigned char * iv = (unsigned char *) "01234567890123456";
-	EVP_CIPHER_CTX_init(ctx);
-	//ctx = setupAES(key);
-	unsigned char *plaintext =
-			(unsigned char *)"0000000000000000";
-	int len;
-	if (1 != EVP_EncryptInit_ex(ctx,EVP_aes_128_ctr(),NULL,key,iv))
-		handleErrors();
+	tape_expand(key, TAPE_IV, randomness, rSize);
+}
+
+/*
+ * The party keys of a round are the leaves of a seed tree (common/seedtree.h)
+ * rooted at its master key. An online round reveals the co-path of the
+ * hidden party, the verifier expands it to every other party's key.
+ */
+void partyKeys(const unsigned char masterkey[16], unsigned char keys[NUM_PARTIES][16]) {
+	unsigned char tree[SEEDTREE_NODES(PARTY_DEPTH)][16];
 
-	for(int j=0;j<(rSize/16);j++) {
-		if(1 != EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
+	memcpy(tree[0], masterkey, 16);
+	seedtree_expand(tree, PARTY_DEPTH, NULL);
+	memcpy(keys, tree[NUM_PARTIES - 1], NUM_PARTIES * 16);
+}
 
-	}
-	EVP_CIPHER_CTX_cleanup(ctx);
-	EVP_CIPHER_CTX_free(ctx);
+void revealPartyKeys(const unsigned char masterkey[16], int hiddenParty, unsigned char path[PARTY_DEPTH][16]) {
+	unsigned char tree[SEEDTREE_NODES(PARTY_DEPTH)][16];
+	int hidden[NUM_PARTIES] = {0};
+
+	memcpy(tree[0], masterkey, 16);
+	seedtree_expand(tree, PARTY_DEPTH, NULL);
+	hidden[hiddenParty] = 1;
+	seedtree_reveal(tree, PARTY_DEPTH, NUM_PARTIES, hidden, path);
+}
+
+// keys of every party but hiddenParty, whose key is left zero
+void fillPartyKeys(const unsigned char path[PARTY_DEPTH][16], int hiddenParty, unsigned char keys[NUM_PARTIES][16]) {
+	unsigned char tree[SEEDTREE_NODES(PARTY_DEPTH)][16];
+	int hidden[NUM_PARTIES] = {0};
+
+	hidden[hiddenParty] = 1;
+	seedtree_fill(tree, PARTY_DEPTH, NUM_PARTIES, hidden, path);
+	memcpy(keys, tree[NUM_PARTIES - 1], NUM_PARTIES * 16);
+	memset(keys[hiddenParty], 0, 16);
 }
 
 void init_EVP() {
-	ERR_load_crypto_strings();
-	OpenSSL_add_all_algorithms();
-	//OPENSSL_config(NULL);
+	tape_init();
 }
 
 void cleanup_EVP() {
-	EVP_cleanup();
-	ERR_free_strings();
+	crypto_cleanup();
 }
 
 void H3(unsigned char finalhash[SHA256_DIGEST_LENGTH], int s, int es[NUM_ROUNDS]) {
@@ -231,22 +250,21 @@ void H3(unsigned char finalhash[SHA256_DIGEST_LENGTH], int s, int es[NUM_ROUNDS]
 	unsigned char hash[SHA256_DIGEST_LENGTH];
 	int i = NUM_ROUNDS;
 	int j;
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, finalhash, SHA256_DIGEST_LENGTH);
-	SHA256_Update(&ctx, &i, sizeof(int));
-	SHA256_Update(&ctx, &s, sizeof(int));
-	SHA256_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, finalhash, SHA256_DIGEST_LENGTH);
+	EVP_DigestUpdate(ctx, &i, sizeof(int));
+	EVP_DigestUpdate(ctx, &s, sizeof(int));
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 
 	//Pick bits from hash
 	memset(es,0,sizeof(int)*NUM_ROUNDS);
 	int bitTracker = 0;
 	while(s>0) {
 		if(bitTracker >= 32) { //Generate new hash as we have run out of bits in the previous hash
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, hash, sizeof(hash));
-			SHA256_Update(&ctx, &s, sizeof(int));
-			SHA256_Final(hash, &ctx);
+			ctx = crypto_digest(crypto_sha256);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestUpdate(ctx, &s, sizeof(int));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
 			bitTracker = 0;
 		}
 		memcpy((unsigned char *)&i,&hash[bitTracker],4);
@@ -333,28 +351,14 @@ void setBit(uint8_t* bytes, uint32_t bitNumber, uint8_t val)
 				& ~(1 << (7 - (bitNumber % 8)))) | (val << (7 - (bitNumber % 8)));
 }
 
+/*
+ * Bit pos of a big endian byte string, counted from the top of the little
+ * endian word it lands in. Worked out directly rather than from a table
+ * filled on first use, which rounds running in parallel would race on.
+ */
 int toEndian32(int pos)
 {
-	static int init = 0;
-	static uint32_t a[32];
-	int count;
-	if (!init)
-	{
-		for (int i = 0 ; i < 32; i++)
-		{
-			a[i] = 0;
-			count = 32;
-			setBit((unsigned char *)&a[i],i,1);
-			while (a[i] > 0)
-			{
-				a[i]>>=1;
-				count--;
-			}
-			a[i] = count;
-		}
-		init =1 ;
-	}
-	return a[pos]; 
+	return 31 - (8 * (pos / 8) + 7 - pos % 8);
 }
 
 
@@ -40,8 +40,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <sys/resource.h>
 #include "sharedripe.h"
+#include "../common/cli.h"
 
 int NUM_ROUNDS = 32;
 
@@ -55,33 +56,23 @@ void printbits(uint32_t n) {
 
 
 
-int main(void) {
-	setbuf(stdout, NULL);
-	init_EVP();
-	openmp_thread_setup();
-	struct timeval begin, delta;
-	
+/*
+ * Checks a proof of NUM_ROUNDS a and z records. Returns 0 when every round
+ * verifies.
+ */
+int verifyProof(const unsigned char* proof, size_t proofSize) {
+	long inMilli;
 	int passed = 1;
 
-	printf("Iterations of RIPEMD: %d\n", NUM_ROUNDS);
-
-	
-	a as[NUM_ROUNDS];
-	z zs[NUM_ROUNDS];
-	FILE *file;
-
-	char outputFile[3*sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "rb");
-	if (!file) {
-		printf("Unable to open file!");
+	if (proofSize != NUM_ROUNDS * (sizeof(a) + sizeof(z))) {
+		printf("Invalid proof file size\n");
+		return 1;
 	}
-	fread(&as, sizeof(a), NUM_ROUNDS, file);
-	fread(&zs, sizeof(z), NUM_ROUNDS, file);
-	fclose(file);
-
-	gettimeofday(&begin,NULL);
+	const a* as = (const a*)proof;
+	const z* zs = (const z*)(proof + NUM_ROUNDS * sizeof(a));
 
+	stats_reset();
+	stats_begin("challenge");
 	uint32_t y[5];
 	reconstruct(as[0].yp[0],as[0].yp[1],as[0].yp[2],y);
 	printf("Proof for hash: ");
@@ -94,11 +85,13 @@ int main(void) {
 
 	int es[NUM_ROUNDS];
 	H3(y, as, NUM_ROUNDS, es);
+	stats_add(STATS_HASH_BYTES, sizeof(y) + sizeof(a) * NUM_ROUNDS);
 
 
+	stats_begin("verify");
 	#pragma omp parallel for
 	for(int i = 0; i<NUM_ROUNDS; i++) {
-		int verifyResult = verify(as[i], es[i], zs[i]);
+		int verifyResult = verify(&as[i], es[i], &zs[i]);
 		if (verifyResult != 0) {
 			printf("Not Verified %d\n", i);
 			passed = 0;
@@ -107,15 +100,75 @@ int main(void) {
 	if (passed)
 		printf("Verified ok\n");
 	
-	gettimeofday(&delta,NULL);
-        unsigned long inMilli = (delta.tv_sec - begin.tv_sec)*1000000 + (delta.tv_usec - begin.tv_usec);
-        inMilli /= 1000;	
+	inMilli = stats_totalMs();
+	stats_report("MPC_RIPEMD160_VERIFIER", NUM_ROUNDS);
 
 	printf("Total time: %ld miliseconds\n", inMilli);
-	
+	printf("Time per round: %.2f miliseconds\n", (double)inMilli / NUM_ROUNDS);
+
+	return passed ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	int ret = 0;
+
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_VERIFIER, &opt) != 0)
+		return 1;
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	init_EVP();
+
+	if (opt.batch) {
+		FILE* results = cli_batchOutput(&opt);
+		unsigned char* proof = NULL;
+		char* line = NULL;
+		size_t cap = 0;
+		long n;
+
+		if (!results) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		printf("Iterations of RIPEMD: %d\n", NUM_ROUNDS);
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			proof = realloc(proof, n / 2 + 1);
+			long proofSize = cli_hexDecode(line, n, proof, n / 2);
+			if ((proofSize >= 0) && (verifyProof(proof, proofSize) == 0))
+				fprintf(results, "Verified ok\n");
+			else {
+				fprintf(results, "Not Verified\n");
+				ret = 1;
+			}
+		}
+		free(proof);
+		free(line);
+		fclose(results);
+	}
+	else {
+		char outputFile[FILENAME_MAX];
+		size_t proofSize;
+
+		printf("Iterations of RIPEMD: %d\n", NUM_ROUNDS);
+		cli_proofName(opt.inputFile, NUM_ROUNDS, outputFile, sizeof(outputFile));
+		const unsigned char* proof = mapProof(outputFile, &proofSize);
+		if (!proof) {
+			printf("Unable to open file!");
+			return 1;
+		}
+		ret = verifyProof(proof, proofSize);
+		unmapProof(proof, proofSize);
+	}
 
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("Peak RSS: %ld KB\n", usage.ru_maxrss);
 
-	openmp_thread_cleanup();
 	cleanup_EVP();
-	return EXIT_SUCCESS;
+	return ret;
 }
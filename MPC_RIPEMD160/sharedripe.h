@@ -46,7 +46,14 @@
 #include <openssl/applink.c>
 #endif
 #include <openssl/rand.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "omp.h"
+#include "../common/tapes.h"
+#include "../common/mapproof.h"
+#include "../common/stats.h"
+#include "../common/circuit.h"
 
 #define VERBOSE 1 
 
@@ -63,7 +70,8 @@ static const uint32_t hJJ =  0x50a28be6;
 
 //#define ySize 736
 #define ySize 879 
-#define rSize 3496 
+// 875 AND/ADD gates of 4 bytes each, rounded up to whole AES blocks
+#define rSize 3504
 
 typedef struct {
 	unsigned char x[64];
@@ -88,6 +96,112 @@ typedef struct {
 #define GETBIT(x, i) (((x) >> (i)) & 0x01)
 #define SETBIT(x, i, b)   x= (b)&1 ? (x)|((uint32_t)1 << (i)) : (x)&(~((uint32_t)1 << (i)))
 
+// Message word and rotation of each step, left line then right line
+static const int ripeX[2][80] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	  7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+	  3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+	  1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+	  4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13 },
+	{ 5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+	  6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+	  15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+	  8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+	  12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11 }
+};
+static const int ripeS[2][80] = {
+	{ 11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+	  7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+	  11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+	  11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+	  9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6 },
+	{ 8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+	  9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+	  9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+	  15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+	  8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11 }
+};
+// Round function (0 = F .. 4 = J) and constant of each round of each line
+static const int ripeF[2][5] = { { 0, 1, 2, 3, 4 }, { 4, 3, 2, 1, 0 } };
+static const uint32_t ripeK[2][5] = { { 0, hG, hH, hI, hJ }, { hJJ, hII, hHH, hGG, 0 } };
+
+circuit ripemd160Circuit;
+
+// F, G, H, I, J as in the original gadgets, OR being ~(~x & ~y)
+int ripemd160_f(circuit* c, int f, int x1, int x2, int x3) {
+	int t0, t1;
+
+	switch (f) {
+	case 0:
+		return circ_xor(c, circ_xor(c, x1, x2), x3);
+	case 1:
+		t0 = circ_and(c, x1, x2);
+		t1 = circ_not(c, x1);
+		t1 = circ_and(c, t1, x3);
+		return circ_or(c, t0, t1);
+	case 2:
+		t0 = circ_not(c, x2);
+		t1 = circ_or(c, x1, t0);
+		return circ_xor(c, t1, x3);
+	case 3:
+		t0 = circ_and(c, x1, x3);
+		t1 = circ_not(c, x3);
+		t1 = circ_and(c, x2, t1);
+		return circ_or(c, t0, t1);
+	default:
+		t0 = circ_not(c, x3);
+		t1 = circ_or(c, x2, t0);
+		return circ_xor(c, t1, x1);
+	}
+}
+
+/*
+ * RIPEMD-160 of one block, from the 16 little endian words of the padded
+ * block to the 5 words of the hash, in the gate order of the original
+ * gadgets: the 80 steps of the left line, the 80 of the right line, then the
+ * final additions.
+ */
+void ripemd160_circuit(circuit* c) {
+	int v[2][5];
+	int t0, t1;
+
+	circ_init(c, 16);
+	for (int l = 0; l < 2; l++) {
+		for (int i = 0; i < 5; i++)
+			v[l][i] = circ_const(c, hA[i]);
+		for (int j = 0; j < 80; j++) {
+			// a..e of step j, which rotate by one word every step
+			int* a = &v[l][(5 - j % 5) % 5];
+			int* b = &v[l][(6 - j % 5) % 5];
+			int* cc = &v[l][(7 - j % 5) % 5];
+			int* d = &v[l][(8 - j % 5) % 5];
+			int* e = &v[l][(9 - j % 5) % 5];
+			uint32_t K = ripeK[l][j / 16];
+
+			t0 = ripemd160_f(c, ripeF[l][j / 16], *b, *cc, *d);
+			t0 = circ_add(c, t0, ripeX[l][j]);
+			if (K)
+				t0 = circ_addk(c, t0, K);
+			t0 = circ_add(c, t0, *a);
+			t0 = circ_rotl(c, t0, ripeS[l][j]);
+			*a = circ_add(c, t0, *e);
+			*cc = circ_rotl(c, *cc, 10);
+		}
+	}
+
+	t0 = circ_addk(c, v[0][2], hA[1]);
+	t1 = circ_add(c, t0, v[1][3]);
+	circ_output(c, t1);
+	t0 = circ_addk(c, v[0][3], hA[2]);
+	circ_output(c, circ_add(c, t0, v[1][4]));
+	t0 = circ_addk(c, v[0][4], hA[3]);
+	circ_output(c, circ_add(c, t0, v[1][0]));
+	t0 = circ_addk(c, v[0][0], hA[4]);
+	circ_output(c, circ_add(c, t0, v[1][1]));
+	t0 = circ_addk(c, v[0][1], hA[0]);
+	circ_output(c, circ_add(c, t0, v[1][2]));
+}
+
 
 void handleErrors(void)
 {
@@ -95,26 +209,11 @@ void handleErrors(void)
 	abort();
 }
 
-void getAllRandomness(unsigned char key[16], unsigned char randomness[rSize]) {
-	//Generate randomness: We use 728*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 728*32/128 = 182 iterations
-
-	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-	unsigned char * iv = (unsigned char *) "01234567890123456";
-	EVP_CIPHER_CTX_init(ctx);
- 	//ctx = setupAES(key);
-	unsigned char *plaintext =
-			(unsigned char *)"0000000000000000";
-	int len;
-	if (1 != EVP_EncryptInit_ex(ctx,EVP_aes_128_ctr(),NULL,key,iv))
-		handleErrors();
-	for(int j=0;j<(rSize/16);j++) {
-		if(1 != EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
+#define TAPE_IV ((unsigned char *)"01234567890123456")
 
-	}
-	EVP_CIPHER_CTX_cleanup(ctx);
-	EVP_CIPHER_CTX_free(ctx);
+// AES-CTR keystream of the key, see common/tapes.h
+void getAllRandomness(const unsigned char key[16], unsigned char randomness[rSize]) {
+	tape_expand(key, TAPE_IV, randomness, rSize);
 }
 
 uint32_t getRandom32(unsigned char randomness[rSize], int randCount) {
@@ -133,43 +232,44 @@ uint64_t getRandom64(unsigned char randomness[rSize], int randCount) {
 
 
 void init_EVP() {
-	ERR_load_crypto_strings();
-	OpenSSL_add_all_algorithms();
-	//OPENSSL_config(NULL);
+	tape_init();
+	if (!crypto_ripemd160) {
+		printf("RIPEMD-160 is not available from OpenSSL\n");
+		exit(1);
+	}
+	ripemd160_circuit(&ripemd160Circuit);
 }
 
 void cleanup_EVP() {
-	EVP_cleanup();
-	ERR_free_strings();
+	circ_free(&ripemd160Circuit);
+	crypto_cleanup();
 }
 
-void H(unsigned char k[16], View v, unsigned char r[4], unsigned char hash[RIPEMD160_DIGEST_LENGTH]) {
-	RIPEMD160_CTX ctx;
-	RIPEMD160_Init(&ctx);
-	RIPEMD160_Update(&ctx, k, 16);
-	RIPEMD160_Update(&ctx, &v, sizeof(v));
-	RIPEMD160_Update(&ctx, r, 4);
-	RIPEMD160_Final(hash, &ctx);
+void H(const unsigned char k[16], const View* v, const unsigned char r[4], unsigned char hash[RIPEMD160_DIGEST_LENGTH]) {
+	EVP_MD_CTX* ctx = crypto_digest(crypto_ripemd160);
+	EVP_DigestUpdate(ctx, k, 16);
+	EVP_DigestUpdate(ctx, v, sizeof(View));
+	EVP_DigestUpdate(ctx, r, 4);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 }
 
 
-void H3(uint32_t y[5], a* as, int s, int* es) {
+void H3(uint32_t y[5], const a* as, int s, int* es) {
 
 	unsigned char hash[RIPEMD160_DIGEST_LENGTH];
-	RIPEMD160_CTX ctx;
-	RIPEMD160_Init(&ctx);
-	RIPEMD160_Update(&ctx, y, 20);
-	RIPEMD160_Update(&ctx, as, sizeof(a)*s);
-	RIPEMD160_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_ripemd160);
+	EVP_DigestUpdate(ctx, y, 20);
+	EVP_DigestUpdate(ctx, as, sizeof(a)*s);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 
 	//Pick bits from hash
 	int i = 0;
 	int bitTracker = 0;
 	while(i < s) {
 		if(bitTracker >= RIPEMD160_DIGEST_LENGTH*8) { //Generate new hash as we have run out of bits in the previous hash
-			RIPEMD160_Init(&ctx);
-			RIPEMD160_Update(&ctx, hash, sizeof(hash));
-			RIPEMD160_Final(hash, &ctx);
+			ctx = crypto_digest(crypto_ripemd160);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
 			bitTracker = 0;
 		}
 
@@ -198,353 +298,48 @@ void H3(uint32_t y[5], a* as, int s, int* es) {
 
 }
 
-void output(View v, uint32_t* result) {
-	memcpy(result, &v.y[ySize - 5], 20);
+void output(const View* v, uint32_t* result) {
+	memcpy(result, &v->y[ySize - 5], 20);
 }
 
-void reconstruct(uint32_t* y0, uint32_t* y1, uint32_t* y2, uint32_t* result) {
+void reconstruct(const uint32_t* y0, const uint32_t* y1, const uint32_t* y2, uint32_t* result) {
 	for (int i = 0; i < 5; i++) {
 		result[i] = y0[i] ^ y1[i] ^ y2[i];
 	}
 }
 
-void mpc_XOR2(uint32_t x[2], uint32_t y[2], uint32_t z[2]) {
-	z[0] = x[0] ^ y[0];
-	z[1] = x[1] ^ y[1];
-}
-
-void mpc_NEGATE2(uint32_t x[2], uint32_t z[2]) {
-	z[0] = ~x[0];
-	z[1] = ~x[1];
-}
-
-omp_lock_t *locks;
-
-void openmp_locking_callback(int mode, int type, char *file, int line)
-{
-  if (mode & CRYPTO_LOCK)
-  {
-    omp_set_lock(&locks[type]);
-  }
-  else
-  {
-    omp_unset_lock(&locks[type]);
-  }
-}
-
-
-unsigned long openmp_thread_id(void)
-{
-  return (unsigned long)omp_get_thread_num();
-}
-
-void openmp_thread_setup(void)
-{
-  int i;
-
-  locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(omp_lock_t));
-  for (i=0; i<CRYPTO_num_locks(); i++)
-  {
-    omp_init_lock(&locks[i]);
-  }
-
-  CRYPTO_set_id_callback((unsigned long (*)())openmp_thread_id);
-  CRYPTO_set_locking_callback((void (*)())openmp_locking_callback);
-}
-
-void openmp_thread_cleanup(void)
-{
-  int i;
-
-  CRYPTO_set_id_callback(NULL);
-  CRYPTO_set_locking_callback(NULL);
-  for (i=0; i<CRYPTO_num_locks(); i++)
-    omp_destroy_lock(&locks[i]);
-  OPENSSL_free(locks);
-}
-
-
-int mpc_AND_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint32_t t = 0;
-
-	t = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	if(ve.y[*countY] != t) {
-		return 1;
-	}
-	z[0] = t;
-	z[1] = ve1.y[*countY];
-
-	(*countY)++;
-	return 0;
-}
-
-
-int mpc_ADD_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint8_t a[2], b[2];
-
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0]^ve.y[*countY],i);
-		a[1]=GETBIT(x[1]^ve1.y[*countY],i);
-
-		b[0]=GETBIT(y[0]^ve.y[*countY],i);
-		b[1]=GETBIT(y[1]^ve1.y[*countY],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		if(GETBIT(ve.y[*countY],i+1) != (t ^ (a[0]&b[0]) ^ GETBIT(ve.y[*countY],i) ^ GETBIT(r[0],i))) {
-			return 1;
-		}
-	}
-
-	z[0]=x[0]^y[0]^ve.y[*countY];
-	z[1]=x[1]^y[1]^ve1.y[*countY];
-	(*countY)++;
-	return 0;
-}
-
-void mpc_LEFTROTATE2(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = LEFTROTATE(x[0], i);
-	z[1] = LEFTROTATE(x[1], i);
-}
-
-void mpc_RIGHTSHIFT2(uint32_t x[2], int i, uint32_t z[2]) {
-	z[0] = x[0] >> i;
-	z[1] = x[1] >> i;
-}
-
-int mpc_OR_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) 
-{
-	uint32_t t0[3];
-	uint32_t t1[3];
-	uint32_t t2[3];
-
-	mpc_NEGATE2(x,t0);
-	mpc_NEGATE2(y,t1);
-	if (mpc_AND_verify(t0,t1,t2,ve,ve1,randomness,randCount,countY) == 1)
-	{
-		return 1;
-	}
-	mpc_NEGATE2(t2,z);
-	return 0;
-}
-
-void mpc_F2(uint32_t x1[2], uint32_t x2[2], uint32_t x3[2], uint32_t z[2])
-{
-	uint32_t t0[2] = { 0 };
-
-	mpc_XOR2(x1,x2,t0);
-	mpc_XOR2(t0,x3,z);
-}
-
-int mpc_G2(uint32_t x1[2], uint32_t x2[2], uint32_t x3[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY) {
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-
-	if (mpc_AND_verify(x1,x2,t0,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_NEGATE2(x1,t1);
-	if (mpc_AND_verify(t1,x3,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_OR_verify(t0,t2,z,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	return 0;
-}
-
-int mpc_H2(uint32_t x1[2], uint32_t x2[2], uint32_t x3[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY) {
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-
-        mpc_NEGATE2(x2,t0);
-	if (mpc_OR_verify(x1,t0,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_XOR2(t1,x3,z);
-	return 0;
-
-}
-
 
-int mpc_I2(uint32_t x1[2], uint32_t x2[2], uint32_t x3[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY) {
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-
-	if (mpc_AND_verify(x1,x3,t0,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_NEGATE2(x3,t1);
-	if (mpc_AND_verify(x2,t1,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_OR_verify(t0,t2,z,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	return 0;
-}
-
-
-int mpc_J2(uint32_t x1[2], uint32_t x2[2], uint32_t x3[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY) {
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-
-        mpc_NEGATE2(x3,t0);
-	if (mpc_OR_verify(x2,t0,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_XOR2(t1,x1,z);
-	return 0;
-}
-
-int mpc_FF2(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t d[2], uint32_t e[2], uint32_t x[2], uint32_t s, View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY)
-{
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-	uint32_t t3[2] = { 0 };
-
-	mpc_F2(b,c,d,t0);
-	if (mpc_ADD_verify(t0,x,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t1,a,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(t2,s,t3);
-	if (mpc_ADD_verify(t3,e,a,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(c,10,c);
-	return 0;
-
-}
-
-int mpc_GG2(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t d[2], uint32_t e[2], uint32_t x[2], uint32_t s, uint32_t C, View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY)
-{
-	uint32_t Cbuf[2] = {C,C};
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-	uint32_t t3[2] = { 0 };
-	uint32_t t4[2] = { 0 };
-
-	if(mpc_G2(b,c,d,t0,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t0,x,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t1,Cbuf,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t2,a,t3,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(t3,s,t4);
-	if (mpc_ADD_verify(t4,e,a,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(c,10,c);
-	return 0;
-}
-
-int mpc_HH2(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t d[2], uint32_t e[2], uint32_t x[2], uint32_t s, uint32_t C, View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY)
-{
-	uint32_t Cbuf[2] = {C,C};
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-	uint32_t t3[2] = { 0 };
-	uint32_t t4[2] = { 0 };
-
-	if(mpc_H2(b,c,d,t0,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t0,x,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t1,Cbuf,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t2,a,t3,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(t3,s,t4);
-	if (mpc_ADD_verify(t4,e,a,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(c,10,c);
-	return 0;
-}
-
-int mpc_II2(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t d[2], uint32_t e[2], uint32_t x[2], uint32_t s, uint32_t C, View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY)
-{
-	uint32_t Cbuf[2] = {C,C};
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-	uint32_t t3[2] = { 0 };
-	uint32_t t4[2] = { 0 };
-
-	if(mpc_I2(b,c,d,t0,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t0,x,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t1,Cbuf,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t2,a,t3,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(t3,s,t4);
-	if (mpc_ADD_verify(t4,e,a,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(c,10,c);
-	return 0;
-}
-
-int mpc_JJ2(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t d[2], uint32_t e[2], uint32_t x[2], uint32_t s, uint32_t C, View ve, View ve1, unsigned char randomness[2][rSize], int * randCount, int* countY)
-{
-	uint32_t Cbuf[2] = {C,C};
-	uint32_t t0[2] = { 0 };
-	uint32_t t1[2] = { 0 };
-	uint32_t t2[2] = { 0 };
-	uint32_t t3[2] = { 0 };
-	uint32_t t4[2] = { 0 };
-
-	if(mpc_J2(b,c,d,t0,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t0,x,t1,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t1,Cbuf,t2,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(t2,a,t3,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(t3,s,t4);
-	if (mpc_ADD_verify(t4,e,a,ve,ve1,randomness,randCount,countY) == 1)
-		return 1;
-	mpc_LEFTROTATE2(c,10,c);
-	return 0;
-}
-
-int verify(a a, int e, z z) {
+int verify(const a* a, int e, const z* z) {
 	unsigned char* hash = malloc(RIPEMD160_DIGEST_LENGTH);
-	H(z.ke, z.ve, z.re, hash);
+	H(z->ke, &z->ve, z->re, hash);
 
-	if (memcmp(a.h[e], hash, 20) != 0) {
+	if (memcmp(a->h[e], hash, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
-	H(z.ke1, z.ve1, z.re1, hash);
-	if (memcmp(a.h[(e + 1) % 3], hash, 20) != 0) {
+	H(z->ke1, &z->ve1, z->re1, hash);
+	if (memcmp(a->h[(e + 1) % 3], hash, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 	free(hash);
+	stats_add(STATS_HASH_BYTES, 2 * (16 + sizeof(View) + 4));
 
 	uint32_t* result = malloc(20);
-	output(z.ve, result);
-	if (memcmp(a.yp[e], result, 20) != 0) {
+	output(&z->ve, result);
+	if (memcmp(a->yp[e], result, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 
-	output(z.ve1, result);
-	if (memcmp(a.yp[(e + 1) % 3], result, 20) != 0) {
+	output(&z->ve1, result);
+	if (memcmp(a->yp[(e + 1) % 3], result, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
@@ -553,407 +348,29 @@ int verify(a a, int e, z z) {
 
 	free(result);
 	unsigned char randomness[2][rSize];
-	getAllRandomness(z.ke, randomness[0]);
-	getAllRandomness(z.ke1, randomness[1]);
+	getAllRandomness(z->ke, randomness[0]);
+	getAllRandomness(z->ke1, randomness[1]);
+	stats_add(STATS_TAPE_BYTES, 2 * rSize);
 
-	int* randCount = calloc(1, sizeof(int));
-	int* countY = calloc(1, sizeof(int));
+	const unsigned char* tapes[2] = { randomness[0], randomness[1] };
+	uint32_t* w = malloc(2 * sizeof(uint32_t) * ripemd160Circuit.numWires);
+	int randCount = 0, countY = 0;
 
-	uint32_t X[16][2];
 	for (int j = 0; j < 16; j++) {
-		X[j][0] =  ((uint32_t)z.ve.x[j * 4 + 0] << 0) | ((uint32_t)z.ve.x[j * 4 + 1] << 8)
-			| ((uint32_t)z.ve.x[j * 4 + 2] << 16) | ((uint32_t)z.ve.x[j * 4 + 3] << 24);
-		X[j][1] =  ((uint32_t)z.ve1.x[j * 4 + 0] << 0) | ((uint32_t)z.ve1.x[j * 4 + 1] << 8)
-			| ((uint32_t)z.ve1.x[j * 4 + 2] << 16) | ((uint32_t)z.ve1.x[j * 4 + 3] << 24);
+		w[2 * j] =  ((uint32_t)z->ve.x[j * 4 + 0] << 0) | ((uint32_t)z->ve.x[j * 4 + 1] << 8)
+			| ((uint32_t)z->ve.x[j * 4 + 2] << 16) | ((uint32_t)z->ve.x[j * 4 + 3] << 24);
+		w[2 * j + 1] =  ((uint32_t)z->ve1.x[j * 4 + 0] << 0) | ((uint32_t)z->ve1.x[j * 4 + 1] << 8)
+			| ((uint32_t)z->ve1.x[j * 4 + 2] << 16) | ((uint32_t)z->ve1.x[j * 4 + 3] << 24);
 	}
-
-	uint32_t buf[5][2] = {{ hA[0],hA[0] },
-				{hA[1],hA[1]},
-				{hA[2],hA[2]},
-				{hA[3],hA[3]},
-				{hA[4],hA[4]}};
-
-	uint32_t s0[2], s1[2];
-	uint32_t t0[2], t1[2];
-	uint32_t aa[2] = { hA[0],hA[0] };
-	uint32_t bb[2] = { hA[1],hA[1] };
-	uint32_t cc[2] = { hA[2],hA[2] };
-	uint32_t dd[2] = { hA[3],hA[3] };
-	uint32_t ee[2] = { hA[4],hA[4] };
-	uint32_t aaa[2] = { hA[0],hA[0] };
-	uint32_t bbb[2] = { hA[1],hA[1] };
-	uint32_t ccc[2] = { hA[2],hA[2] };
-	uint32_t ddd[2] = { hA[3],hA[3] };
-	uint32_t eee[2] = { hA[4],hA[4] };
-	uint32_t temp1[3], temp2[3], maj[3];
-
-	// round 1 
-	if (mpc_FF2(aa, bb, cc, dd, ee, X[0], 11, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ee, aa, bb, cc, dd, X[1], 14, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(dd, ee, aa, bb, cc, X[2], 15, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(cc, dd, ee, aa, bb, X[3], 12, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(bb, cc, dd, ee, aa, X[4], 5, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(aa, bb, cc, dd, ee, X[5], 8, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ee, aa, bb, cc, dd, X[6], 7, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(dd, ee, aa, bb, cc, X[7], 9, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(cc, dd, ee, aa, bb, X[8], 11, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(bb, cc, dd, ee, aa, X[9], 13, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(aa, bb, cc, dd, ee, X[10], 14, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ee, aa, bb, cc, dd, X[11], 15, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(dd, ee, aa, bb, cc, X[12], 6, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(cc, dd, ee, aa, bb, X[13], 7, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(bb, cc, dd, ee, aa, X[14], 9, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(aa, bb, cc, dd, ee, X[15], 8, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// round 2
-	if (mpc_GG2(ee, aa, bb, cc, dd, X[7], 7, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(dd, ee, aa, bb, cc, X[4], 6, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(cc, dd, ee, aa, bb, X[13], 8, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(bb, cc, dd, ee, aa, X[1], 13, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(aa, bb, cc, dd, ee, X[10], 11, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ee, aa, bb, cc, dd, X[6], 9, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(dd, ee, aa, bb, cc, X[15], 7, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(cc, dd, ee, aa, bb, X[3], 15, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(bb, cc, dd, ee, aa, X[12], 7, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(aa, bb, cc, dd, ee, X[0], 12, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ee, aa, bb, cc, dd, X[9], 15, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(dd, ee, aa, bb, cc, X[5], 9, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(cc, dd, ee, aa, bb, X[2], 11, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(bb, cc, dd, ee, aa, X[14], 7, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(aa, bb, cc, dd, ee, X[11], 13, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ee, aa, bb, cc, dd, X[8], 12, hG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// round 3
-	
-	if (mpc_HH2(dd, ee, aa, bb, cc, X[3], 11, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(cc, dd, ee, aa, bb, X[10], 13, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(bb, cc, dd, ee, aa, X[14], 6, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(aa, bb, cc, dd, ee, X[4], 7, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ee, aa, bb, cc, dd, X[9], 14, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(dd, ee, aa, bb, cc, X[15], 9, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(cc, dd, ee, aa, bb, X[8], 13, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(bb, cc, dd, ee, aa, X[1], 15, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(aa, bb, cc, dd, ee, X[2], 14, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ee, aa, bb, cc, dd, X[7], 8, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(dd, ee, aa, bb, cc, X[0], 13, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(cc, dd, ee, aa, bb, X[6], 6, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(bb, cc, dd, ee, aa, X[13], 5, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(aa, bb, cc, dd, ee, X[11], 12, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ee, aa, bb, cc, dd, X[5], 7, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(dd, ee, aa, bb, cc, X[12], 5, hH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// round 4
-	
-	if (mpc_II2(cc, dd, ee, aa, bb, X[1], 11, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(bb, cc, dd, ee, aa, X[9], 12, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(aa, bb, cc, dd, ee, X[11], 14, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ee, aa, bb, cc, dd, X[10], 15, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(dd, ee, aa, bb, cc, X[0], 14, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(cc, dd, ee, aa, bb, X[8], 15, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(bb, cc, dd, ee, aa, X[12], 9, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(aa, bb, cc, dd, ee, X[4], 8, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ee, aa, bb, cc, dd, X[13], 9, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(dd, ee, aa, bb, cc, X[3], 14, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(cc, dd, ee, aa, bb, X[7], 5, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(bb, cc, dd, ee, aa, X[15], 6, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(aa, bb, cc, dd, ee, X[14], 8, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ee, aa, bb, cc, dd, X[5], 6, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(dd, ee, aa, bb, cc, X[6], 5, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(cc, dd, ee, aa, bb, X[2], 12, hI, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// round 5
-
-	if (mpc_JJ2(bb, cc, dd, ee, aa, X[4], 9, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(aa, bb, cc, dd, ee, X[0], 15, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ee, aa, bb, cc, dd, X[5], 5, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(dd, ee, aa, bb, cc, X[9], 11, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(cc, dd, ee, aa, bb, X[7], 6, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(bb, cc, dd, ee, aa, X[12], 8, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(aa, bb, cc, dd, ee, X[2], 13, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ee, aa, bb, cc, dd, X[10], 12, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(dd, ee, aa, bb, cc, X[14], 5, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(cc, dd, ee, aa, bb, X[1], 12, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(bb, cc, dd, ee, aa, X[3], 13, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(aa, bb, cc, dd, ee, X[8], 14, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ee, aa, bb, cc, dd, X[11], 11, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(dd, ee, aa, bb, cc, X[6], 8, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(cc, dd, ee, aa, bb, X[15], 5, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(bb, cc, dd, ee, aa, X[13], 6, hJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// alt round 1
-	if (mpc_JJ2(aaa, bbb, ccc, ddd, eee, X[5], 8, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(eee, aaa, bbb, ccc, ddd, X[14], 9, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ddd, eee, aaa, bbb, ccc, X[7], 9, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ccc, ddd, eee, aaa, bbb, X[0], 11, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(bbb, ccc, ddd, eee, aaa, X[9], 13, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(aaa, bbb, ccc, ddd, eee, X[2], 15, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(eee, aaa, bbb, ccc, ddd, X[11], 15, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ddd, eee, aaa, bbb, ccc, X[4], 5, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ccc, ddd, eee, aaa, bbb, X[13], 7, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(bbb, ccc, ddd, eee, aaa, X[6], 7, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(aaa, bbb, ccc, ddd, eee, X[15], 8, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(eee, aaa, bbb, ccc, ddd, X[8], 11, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ddd, eee, aaa, bbb, ccc, X[1], 14, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(ccc, ddd, eee, aaa, bbb, X[10], 14, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(bbb, ccc, ddd, eee, aaa, X[3], 12, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_JJ2(aaa, bbb, ccc, ddd, eee, X[12], 6, hJJ, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// alt round 2
-
-	if (mpc_II2(eee, aaa, bbb, ccc, ddd, X[6], 9, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ddd, eee, aaa, bbb, ccc, X[11], 13, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ccc, ddd, eee, aaa, bbb, X[3], 15, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(bbb, ccc, ddd, eee, aaa, X[7], 7, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(aaa, bbb, ccc, ddd, eee, X[0], 12, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(eee, aaa, bbb, ccc, ddd, X[13], 8, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ddd, eee, aaa, bbb, ccc, X[5], 9, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ccc, ddd, eee, aaa, bbb, X[10], 11, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(bbb, ccc, ddd, eee, aaa, X[14], 7, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(aaa, bbb, ccc, ddd, eee, X[15], 7, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(eee, aaa, bbb, ccc, ddd, X[8], 12, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ddd, eee, aaa, bbb, ccc, X[12], 7, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(ccc, ddd, eee, aaa, bbb, X[4], 6, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(bbb, ccc, ddd, eee, aaa, X[9], 15, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(aaa, bbb, ccc, ddd, eee, X[1], 13, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_II2(eee, aaa, bbb, ccc, ddd, X[2], 11, hII, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// alt round 3
-	if (mpc_HH2(ddd, eee, aaa, bbb, ccc, X[15], 9, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ccc, ddd, eee, aaa, bbb, X[5], 7, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(bbb, ccc, ddd, eee, aaa, X[1], 15, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(aaa, bbb, ccc, ddd, eee, X[3], 11, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(eee, aaa, bbb, ccc, ddd, X[7], 8, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ddd, eee, aaa, bbb, ccc, X[14], 6, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ccc, ddd, eee, aaa, bbb, X[6], 6, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(bbb, ccc, ddd, eee, aaa, X[9], 14, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(aaa, bbb, ccc, ddd, eee, X[11], 12, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(eee, aaa, bbb, ccc, ddd, X[8], 13, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ddd, eee, aaa, bbb, ccc, X[12], 5, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ccc, ddd, eee, aaa, bbb, X[2], 14, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(bbb, ccc, ddd, eee, aaa, X[10], 13, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(aaa, bbb, ccc, ddd, eee, X[0], 13, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(eee, aaa, bbb, ccc, ddd, X[4], 7, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_HH2(ddd, eee, aaa, bbb, ccc, X[13], 5, hHH, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// alt round 4
-	if (mpc_GG2(ccc, ddd, eee, aaa, bbb, X[8], 15, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(bbb, ccc, ddd, eee, aaa, X[6], 5, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(aaa, bbb, ccc, ddd, eee, X[4], 8, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(eee, aaa, bbb, ccc, ddd, X[1], 11, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ddd, eee, aaa, bbb, ccc, X[3], 14, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ccc, ddd, eee, aaa, bbb, X[11], 14, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(bbb, ccc, ddd, eee, aaa, X[15], 6, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(aaa, bbb, ccc, ddd, eee, X[0], 14, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(eee, aaa, bbb, ccc, ddd, X[5], 6, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ddd, eee, aaa, bbb, ccc, X[12], 9, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ccc, ddd, eee, aaa, bbb, X[2], 12, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(bbb, ccc, ddd, eee, aaa, X[13], 9, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(aaa, bbb, ccc, ddd, eee, X[9], 12, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(eee, aaa, bbb, ccc, ddd, X[7], 5, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ddd, eee, aaa, bbb, ccc, X[10], 15, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_GG2(ccc, ddd, eee, aaa, bbb, X[14], 8, hGG, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	// alt round 5
-	if (mpc_FF2(bbb, ccc, ddd, eee, aaa, X[12], 8, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(aaa, bbb, ccc, ddd, eee, X[15], 5, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(eee, aaa, bbb, ccc, ddd, X[10], 12, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ddd, eee, aaa, bbb, ccc, X[4], 9, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ccc, ddd, eee, aaa, bbb, X[1], 12, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(bbb, ccc, ddd, eee, aaa, X[5], 5, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(aaa, bbb, ccc, ddd, eee, X[8], 14, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(eee, aaa, bbb, ccc, ddd, X[7], 6, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ddd, eee, aaa, bbb, ccc, X[6], 8, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ccc, ddd, eee, aaa, bbb, X[2], 13, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(bbb, ccc, ddd, eee, aaa, X[13], 6, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(aaa, bbb, ccc, ddd, eee, X[14], 5, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(eee, aaa, bbb, ccc, ddd, X[0], 15, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ddd, eee, aaa, bbb, ccc, X[3], 13, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(ccc, ddd, eee, aaa, bbb, X[9], 11, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-	if (mpc_FF2(bbb, ccc, ddd, eee, aaa, X[11], 11, z.ve, z.ve1, randomness, randCount, countY) == 1)
-		return 1;
-
-	 if (mpc_ADD_verify(cc,buf[1],t0,z.ve,z.ve1,randomness,randCount,countY)==1)
-		 return 1;
-	if (mpc_ADD_verify(t0,ddd,t1,z.ve,z.ve1,randomness,randCount,countY) == 1)
-		return 1;
-	if (mpc_ADD_verify(dd,buf[2],t0,z.ve,z.ve1,randomness,randCount,countY) ==1)
-		return 1;
-	if (mpc_ADD_verify(t0,eee,buf[1],z.ve,z.ve1,randomness,randCount,countY) ==1)
-		return 1;
-	if (mpc_ADD_verify(ee,buf[3],t0,z.ve,z.ve1,randomness,randCount,countY)==1)
-		return 1;
-	if (mpc_ADD_verify(t0,aaa,buf[2],z.ve,z.ve1,randomness,randCount,countY)==1)
-		return 1;
-	if (mpc_ADD_verify(aa,buf[4],t0,z.ve,z.ve1,randomness,randCount,countY)==1)
-		return 1;
-	if (mpc_ADD_verify(t0,bbb,buf[3],z.ve,z.ve1,randomness,randCount,countY)==1)
-		return 1;
-	if (mpc_ADD_verify(bb,buf[0],t0,z.ve,z.ve1,randomness,randCount,countY)== 1)
-		return 1;
-	if (mpc_ADD_verify(t0,ccc,buf[4],z.ve,z.ve1,randomness,randCount,countY)==1)
+	if (circ_verify(&ripemd160Circuit, w, tapes, &randCount, z->ve.y, z->ve1.y, &countY) != 0) {
+#if VERBOSE
+		printf("Failing at %d, view word %d", __LINE__, countY);
+#endif
+		free(w);
 		return 1;
-
-	free(randCount);
-	free(countY);
+	}
+	free(w);
+	stats_add(STATS_GATES, countY);
 
 	return 0;
 }
@@ -17,8 +17,16 @@
 #include <openssl/applink.c>
 #endif
 #include <openssl/rand.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "omp.h"
-const int NUM_ROUNDS = 136;
+#include "../common/tapes.h"
+#include "../common/hashmany.h"
+#include "../common/mapproof.h"
+#include "../common/stats.h"
+#include "../common/circuit.h"
+int NUM_ROUNDS = 136;
 #define VERBOSE FALSE
 
 
@@ -40,6 +48,7 @@ static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 		0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
 
 #define ySize 370
+#define rSize 1472
 
 typedef struct {
 	unsigned char x[64];
@@ -65,60 +74,94 @@ typedef struct {
 #define GETBIT(x, i) (((x) >> (i)) & 0x01)
 #define SETBIT(x, i, b)   x= (b)&1 ? (x)|(1 << (i)) : (x)&(~(1 << (i)))
 
+circuit sha1Circuit;
 
+/*
+ * SHA-1 of one block, from the 16 big endian words of the padded block to
+ * the 5 words of the hash, in the gate order of the original gadgets.
+ */
+void sha1_circuit(circuit* c) {
+	int w[80];
+	int v[5];
+	int f, temp;
+	uint32_t k;
 
+	circ_init(c, 16);
+	for (int j = 0; j < 16; j++)
+		w[j] = j;
+	for (int j = 16; j < 80; j++) {
+		temp = circ_xor(c, w[j-3], w[j-8]);
+		temp = circ_xor(c, temp, w[j-14]);
+		temp = circ_xor(c, temp, w[j-16]);
+		w[j] = circ_rotl(c, temp, 1);
+	}
 
-void handleErrors(void)
-{
-	ERR_print_errors_fp(stderr);
-	abort();
-}
-
-
-EVP_CIPHER_CTX setupAES(unsigned char key[16]) {
-	EVP_CIPHER_CTX ctx;
-	EVP_CIPHER_CTX_init(&ctx);
-
-	///* A 128 bit key */
-	//unsigned char *key = (unsigned char *)"01234567890123456";
+	// a..e
+	for (int i = 0; i < 5; i++)
+		v[i] = circ_const(c, hA[i]);
+	for (int i = 0; i < 80; i++) {
+		if(i <= 19) {
+			//f = d ^ (b & (c ^ d))
+			f = circ_xor(c, v[2], v[3]);
+			f = circ_and(c, v[1], f);
+			f = circ_xor(c, v[3], f);
+			k = 0x5A827999;
+		}
+		else if(i <= 39) {
+			f = circ_xor(c, v[1], v[2]);
+			f = circ_xor(c, v[3], f);
+			k = 0x6ED9EBA1;
+		}
+		else if(i <= 59) {
+			//f = MAJ(b,c,d) = (b ^ c) & (b ^ d) ^ b
+			temp = circ_xor(c, v[1], v[2]);
+			f = circ_xor(c, v[1], v[3]);
+			f = circ_and(c, temp, f);
+			f = circ_xor(c, f, v[1]);
+			k = 0x8F1BBCDC;
+		}
+		else {
+			f = circ_xor(c, v[1], v[2]);
+			f = circ_xor(c, v[3], f);
+			k = 0xCA62C1D6;
+		}
 
-	/* A 128 bit IV */
-	unsigned char *iv = (unsigned char *)"01234567890123456";
+		//temp = (a leftrotate 5) + f + e + k + w[i]
+		temp = circ_rotl(c, v[0], 5);
+		temp = circ_add(c, f, temp);
+		temp = circ_add(c, v[4], temp);
+		temp = circ_addk(c, temp, k);
+		temp = circ_add(c, w[i], temp);
+
+		v[4] = v[3];
+		v[3] = v[2];
+		v[2] = circ_rotl(c, v[1], 30);
+		v[1] = v[0];
+		v[0] = temp;
+	}
 
-	/* Create and initialise the context */
-	//if(!(ctx = EVP_CIPHER_CTX_new())) handleErrors();
+	for (int i = 0; i < 5; i++)
+		circ_output(c, circ_addk(c, v[i], hA[i]));
+}
 
-	/* Initialise the encryption operation. IMPORTANT - ensure you use a key
-	 * and IV size appropriate for your cipher
-	 * In this example we are using 256 bit AES (i.e. a 256 bit key). The
-	 * IV size for *most* modes is the same as the block size. For AES this
-	 * is 128 bits */
-	if(1 != EVP_EncryptInit_ex(&ctx, EVP_aes_128_ctr(), NULL, key, iv))
-		handleErrors();
 
-	return ctx;
 
 
+void handleErrors(void)
+{
+	ERR_print_errors_fp(stderr);
+	abort();
 }
 
-void getAllRandomness(unsigned char key[16], unsigned char randomness[1472]) {
-	//Generate randomness: We use 365*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 365*32/128 = 91.25 iterations. Let's just round up.
 
-	EVP_CIPHER_CTX ctx;
-	ctx = setupAES(key);
-	unsigned char *plaintext =
-			(unsigned char *)"0000000000000000";
-	int len;
-	for(int j=0;j<92;j++) {
-		if(1 != EVP_EncryptUpdate(&ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
+#define TAPE_IV ((unsigned char *)"01234567890123456")
 
-	}
-	EVP_CIPHER_CTX_cleanup(&ctx);
+// AES-CTR keystream of the key, see common/tapes.h
+void getAllRandomness(const unsigned char key[16], unsigned char randomness[rSize]) {
+	tape_expand(key, TAPE_IV, randomness, rSize);
 }
 
-uint32_t getRandom32(unsigned char randomness[1472], int randCount) {
+uint32_t getRandom32(unsigned char randomness[rSize], int randCount) {
 	uint32_t ret;
 //	printf("Randomness at %d: %02X %02X %02X %02X\n", randCount, randomness[randCount], randomness[randCount+1], randomness[randCount+2], randomness[randCount+3]);
 	memcpy(&ret, &randomness[randCount], 4);
@@ -128,44 +171,66 @@ uint32_t getRandom32(unsigned char randomness[1472], int randCount) {
 
 void init_EVP() {
 	/* Initialise the library */
-	ERR_load_crypto_strings();
-	OpenSSL_add_all_algorithms();
-	OPENSSL_config(NULL);
+	tape_init();
+	hash_init();
+	sha1_circuit(&sha1Circuit);
 }
 
 void cleanup_EVP() {
 	/* Clean up */
-	EVP_cleanup();
-	ERR_free_strings();
+	circ_free(&sha1Circuit);
+	crypto_cleanup();
 }
 
-void H(unsigned char k[16], View v, unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, k, 16);
-	SHA256_Update(&ctx, &v, sizeof(v));
-	SHA256_Update(&ctx, r, 4);
-	SHA256_Final(hash, &ctx);
+void H(const unsigned char k[16], const View* v, const unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, k, 16);
+	EVP_DigestUpdate(ctx, v, sizeof(View));
+	EVP_DigestUpdate(ctx, r, 4);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
+}
+
+/*
+ * H() of the three views of n rounds side by side (common/hashmany.h),
+ * as[k].h[j] gets the commitment of party j of round k.
+ */
+void H_many(int n, unsigned char keys[][3][16], View views[][3], unsigned char rs[][3][4], a* as) {
+	const void* in[3 * n];
+	unsigned char* out[3 * n];
+	hashMany h;
+
+	hash_begin(&h, crypto_sha256, 3 * n);
+	for (int i = 0; i < 3 * n; i++)
+		in[i] = keys[i / 3][i % 3];
+	hash_update(&h, in, 16);
+	for (int i = 0; i < 3 * n; i++)
+		in[i] = &views[i / 3][i % 3];
+	hash_update(&h, in, sizeof(View));
+	for (int i = 0; i < 3 * n; i++) {
+		in[i] = rs[i / 3][i % 3];
+		out[i] = as[i / 3].h[i % 3];
+	}
+	hash_update(&h, in, 4);
+	hash_final(&h, out);
 }
 
 
-void H3(uint32_t y[8], a* as, int s, int* es) {
+void H3(uint32_t y[8], const a* as, int s, int* es) {
 
 	unsigned char hash[SHA256_DIGEST_LENGTH];
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, y, 20);
-	SHA256_Update(&ctx, as, sizeof(a)*s);
-	SHA256_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, y, 20);
+	EVP_DigestUpdate(ctx, as, sizeof(a)*s);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 
 	//Pick bits from hash
 	int i = 0;
 	int bitTracker = 0;
 	while(i < s) {
 		if(bitTracker >= SHA256_DIGEST_LENGTH*8) { //Generate new hash
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, hash, sizeof(hash));
-			SHA256_Final(hash, &ctx);
+			ctx = crypto_digest(crypto_sha256);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
 			bitTracker = 0;
 			//printf("Generated new hash\n");
 		}
@@ -199,192 +264,48 @@ void H3(uint32_t y[8], a* as, int s, int* es) {
 	}*/
 }
 
-void output(View v, uint32_t* result) {
-	memcpy(result, &v.y[ySize - 5], 20);
+void output(const View* v, uint32_t* result) {
+	memcpy(result, &v->y[ySize - 5], 20);
 }
 
-void reconstruct(uint32_t* y0, uint32_t* y1, uint32_t* y2, uint32_t* result) {
+void reconstruct(const uint32_t* y0, const uint32_t* y1, const uint32_t* y2, uint32_t* result) {
 	for (int i = 0; i < 8; i++) {
 		result[i] = y0[i] ^ y1[i] ^ y2[i];
 	}
 }
 
-void mpc_XOR2(uint32_t x[2], uint32_t y[2], uint32_t z[2]) {
-	z[0] = x[0] ^ y[0];
-	z[1] = x[1] ^ y[1];
-}
-
-void mpc_NEGATE2(uint32_t x[2], uint32_t z[2]) {
-	z[0] = ~x[0];
-	z[1] = ~x[1];
-}
-
-omp_lock_t *locks;
-
-// Locking callback
-void openmp_locking_callback(int mode, int type, char *file, int line)
-{
-  if (mode & CRYPTO_LOCK)
-  {
-    omp_set_lock(&locks[type]);
-  }
-  else
-  {
-    omp_unset_lock(&locks[type]);
-  }
-}
-
-// Thread ID callback
-unsigned long openmp_thread_id(void)
-{
-  return (unsigned long)omp_get_thread_num();
-}
-
-void openmp_thread_setup(void)
-{
-  int i;
-
-  locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(omp_lock_t));
-  for (i=0; i<CRYPTO_num_locks(); i++)
-  {
-    omp_init_lock(&locks[i]);
-  }
-
-  CRYPTO_set_id_callback((unsigned long (*)())openmp_thread_id);
-  CRYPTO_set_locking_callback((void (*)())openmp_locking_callback);
-}
-
-void openmp_thread_cleanup(void)
-{
-  int i;
-
-  CRYPTO_set_id_callback(NULL);
-  CRYPTO_set_locking_callback(NULL);
-  for (i=0; i<CRYPTO_num_locks(); i++)
-    omp_destroy_lock(&locks[i]);
-  OPENSSL_free(locks);
-}
-
-
-int mpc_AND_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint32_t t = 0;
-
-	t = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	if(ve.y[*countY] != t) {
-		return 1;
-	}
-	z[0] = t;
-	z[1] = ve1.y[*countY];
-
-	(*countY)++;
-	return 0;
-}
-
-
-int mpc_ADD_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint8_t a[2], b[2];
-
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0]^ve.y[*countY],i);
-		a[1]=GETBIT(x[1]^ve1.y[*countY],i);
-
-		b[0]=GETBIT(y[0]^ve.y[*countY],i);
-		b[1]=GETBIT(y[1]^ve1.y[*countY],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		if(GETBIT(ve.y[*countY],i+1) != (t ^ (a[0]&b[0]) ^ GETBIT(ve.y[*countY],i) ^ GETBIT(r[0],i))) {
-			return 1;
-		}
-	}
-
-	z[0]=x[0]^y[0]^ve.y[*countY];
-	z[1]=x[1]^y[1]^ve1.y[*countY];
-	(*countY)++;
-	return 0;
-}
-
-void mpc_RIGHTROTATE2(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = RIGHTROTATE(x[0], i);
-	z[1] = RIGHTROTATE(x[1], i);
-}
-
-void mpc_LEFTROTATE2(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = LEFTROTATE(x[0], i);
-	z[1] = LEFTROTATE(x[1], i);
-}
-
-void mpc_RIGHTSHIFT2(uint32_t x[2], int i, uint32_t z[2]) {
-	z[0] = x[0] >> i;
-	z[1] = x[1] >> i;
-}
-
-
-int mpc_MAJ_verify(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t z[3], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-	uint32_t t0[3];
-	uint32_t t1[3];
-
-	mpc_XOR2(a, b, t0);
-	mpc_XOR2(a, c, t1);
-	if(mpc_AND_verify(t0, t1, z, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
-	}
-	mpc_XOR2(z, a, z);
-	return 0;
-}
-
-int mpc_CH_verify(uint32_t e[2], uint32_t f[2], uint32_t g[2], uint32_t z[2], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-
-	uint32_t t0[3];
-	mpc_XOR2(f,g,t0);
-	if(mpc_AND_verify(e, t0, t0, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
-	}
-	mpc_XOR2(t0,g,z);
 
-
-	return 0;
-}
-
-
-int verify(a a, int e, z z) {
+int verify(const a* a, int e, const z* z) {
 	unsigned char* hash = malloc(SHA256_DIGEST_LENGTH);
-	H(z.ke, z.ve, z.re, hash);
+	H(z->ke, &z->ve, z->re, hash);
 
-	if (memcmp(a.h[e], hash, 32) != 0) {
+	if (memcmp(a->h[e], hash, 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
-	H(z.ke1, z.ve1, z.re1, hash);
-	if (memcmp(a.h[(e + 1) % 3], hash, 32) != 0) {
+	H(z->ke1, &z->ve1, z->re1, hash);
+	if (memcmp(a->h[(e + 1) % 3], hash, 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 	free(hash);
+	stats_add(STATS_HASH_BYTES, 2 * (16 + sizeof(View) + 4));
 
 	uint32_t* result = malloc(20);
-	output(z.ve, result);
-	if (memcmp(a.yp[e], result, 20) != 0) {
+	output(&z->ve, result);
+	if (memcmp(a->yp[e], result, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 
-	output(z.ve1, result);
-	if (memcmp(a.yp[(e + 1) % 3], result, 20) != 0) {
+	output(&z->ve1, result);
+	if (memcmp(a->yp[(e + 1) % 3], result, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
@@ -394,153 +315,33 @@ int verify(a a, int e, z z) {
 	free(result);
 
 	unsigned char *randomness[2];
-	randomness[0] = malloc(1472*sizeof(unsigned char));
-	randomness[1] = malloc(1472*sizeof(unsigned char));
-	getAllRandomness(z.ke, randomness[0]);
-	getAllRandomness(z.ke1, randomness[1]);
+	randomness[0] = malloc(rSize*sizeof(unsigned char));
+	randomness[1] = malloc(rSize*sizeof(unsigned char));
+	getAllRandomness(z->ke, randomness[0]);
+	getAllRandomness(z->ke1, randomness[1]);
+	stats_add(STATS_TAPE_BYTES, 2 * rSize);
 
-	int* randCount = calloc(1, sizeof(int));
-	int* countY = calloc(1, sizeof(int));
-
-	uint32_t w[80][2];
+	uint32_t* w = malloc(2 * sizeof(uint32_t) * sha1Circuit.numWires);
+	int randCount = 0, countY = 0;
+	int failed;
 
 	for (int j = 0; j < 16; j++) {
-		w[j][0] = (z.ve.x[j * 4] << 24) | (z.ve.x[j * 4 + 1] << 16)
-								| (z.ve.x[j * 4 + 2] << 8) | z.ve.x[j * 4 + 3];
-		w[j][1] = (z.ve1.x[j * 4] << 24) | (z.ve1.x[j * 4 + 1] << 16)
-								| (z.ve1.x[j * 4 + 2] << 8) | z.ve1.x[j * 4 + 3];
-	}
-
-	uint32_t temp[3];
-	for (int j = 16; j < 80; j++) {
-		mpc_XOR2(w[j-3], w[j-8], temp);
-		mpc_XOR2(temp, w[j-14], temp);
-		mpc_XOR2(temp, w[j-16], temp);
-		mpc_LEFTROTATE2(temp,1,w[j]);
-
-		//printf("W[%d]: %02X\n", j, w[j][0]^w[j][1]^w[j][2]);
-	}
-
-
-
-	uint32_t va[2] = { hA[0],hA[0] };
-	uint32_t vb[2] = { hA[1],hA[1] };
-	uint32_t vc[2] = { hA[2],hA[2] };
-	uint32_t vd[2] = { hA[3],hA[3] };
-	uint32_t ve[2] = { hA[4],hA[4] };
-	uint32_t f[2];
-	uint32_t k;
-	uint32_t temp1[2];
-	for (int i = 0; i < 80; i++) {
-		if(i <= 19) {
-			//f = d ^ (b & (c ^ d))
-			mpc_XOR2(vc,vd,f);
-			if(mpc_AND_verify(vb, f, f, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-				if(i == 0) {
-					printf("*countY: %d\n", *countY);
-					printf("F[%d]: %02X\n", i, f[0]^f[1]);
-					printf("View_1: %02X\n", z.ve.y[(*countY)]);
-					printf("View_2: %02X\n", z.ve1.y[(*countY)]);
-				}
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-				return 1;
-			}
-			mpc_XOR2(vd,f,f);
-			k = 0x5A827999;
-		}
-		else if(i <= 39) {
-			mpc_XOR2(vb,vc,f);
-			mpc_XOR2(vd,f,f);
-			k = 0x6ED9EBA1;
-		}
-		else if(i <= 59) {
-			//f = MAJ(b,c,d)
-			if(mpc_MAJ_verify(vb,vc,vd,f, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-				printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-				return 1;
-			}
-			k = 0x8F1BBCDC;
-		}
-		else {
-			mpc_XOR2(vb,vc,f);
-			mpc_XOR2(vd,f,f);
-			k = 0xCA62C1D6;
-		}
-
-
-		//temp = (a leftrotate 5) + f + e + k + w[i]
-		mpc_LEFTROTATE2(va,5,temp);
-		if(mpc_ADD_verify(f,temp,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-		if(mpc_ADD_verify(ve,temp,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-		temp1[0] = k;
-		temp1[1] = k;
-		if(mpc_ADD_verify(temp,temp1,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-		if(mpc_ADD_verify(w[i],temp,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-		memcpy(ve, vd, sizeof(uint32_t) * 2);
-		memcpy(vd, vc, sizeof(uint32_t) * 2);
-		mpc_LEFTROTATE2(vb,30,vc);
-		memcpy(vb, va, sizeof(uint32_t) * 2);
-		memcpy(va, temp, sizeof(uint32_t) * 2);
-	}
-
-	uint32_t hHa[8][3] = { { hA[0],hA[0],hA[0]  }, { hA[1],hA[1],hA[1] }, { hA[2],hA[2],hA[2] }, { hA[3],hA[3],hA[3] },
-			{ hA[4],hA[4],hA[4] }, { hA[5],hA[5],hA[5] }, { hA[6],hA[6],hA[6] }, { hA[7],hA[7],hA[7] } };
-	if(mpc_ADD_verify(hHa[0], va, hHa[0], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+		w[2 * j] = (z->ve.x[j * 4] << 24) | (z->ve.x[j * 4 + 1] << 16)
+								| (z->ve.x[j * 4 + 2] << 8) | z->ve.x[j * 4 + 3];
+		w[2 * j + 1] = (z->ve1.x[j * 4] << 24) | (z->ve1.x[j * 4 + 1] << 16)
+								| (z->ve1.x[j * 4 + 2] << 8) | z->ve1.x[j * 4 + 3];
 	}
-	if(mpc_ADD_verify(hHa[1], vb, hHa[1], z.ve, z.ve1, randomness, randCount, countY) == 1) {
+	failed = circ_verify(&sha1Circuit, w, (const unsigned char **)randomness, &randCount, z->ve.y, z->ve1.y, &countY);
+	free(w);
+	free(randomness[0]);
+	free(randomness[1]);
+	if (failed) {
 #if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[2], vc, hHa[2], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[3], vd, hHa[3], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[4], ve, hHa[4], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
+		printf("Failing at %d, view word %d", __LINE__, countY);
 #endif
 		return 1;
 	}
-	//printf("CountY: %d\n", countY);
+	stats_add(STATS_GATES, countY);
 
 	return 0;
 }
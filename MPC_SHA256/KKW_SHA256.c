@@ -46,12 +46,46 @@
 #include "omp.h"
 
 
+// Party keys and commitment randomness of round k
+void roundKeys(roundSet * ws, int k, unsigned char masterkey[16], unsigned char rsseed[20])
+{
+	unsigned char roundseed[20];
+
+	partyKeys(masterkey, ws->keys);
+	memcpy(roundseed,rsseed,20);
+	memcpy(roundseed,&k,sizeof(int));
+	Compute_RAND((unsigned char *)ws->rs,NUM_PARTIES*4,roundseed,20);
+}
+
+/*
+ * Runs round k in ws: keys, input shares, tapes, the aux tape and the party
+ * commitments into h1, then MPC-SHA2 into views and h2.
+ */
+void proveRound(roundSet * ws, int k, unsigned char masterkey[16], unsigned char rsseed[20], unsigned char * input, int numBytes,
+		View views[NUM_PARTIES], unsigned char aux[rSize], unsigned char h1[SHA256_DIGEST_LENGTH], unsigned char h2[SHA256_DIGEST_LENGTH],
+		unsigned char maskedInput[SHA256_INPUTS], unsigned char result[SHA256_DIGEST_LENGTH], unsigned char results[NUM_PARTIES][SHA256_DIGEST_LENGTH], int * countY)
+{
+	roundKeys(ws, k, masterkey, rsseed);
+	for (int j = 0; j < NUM_PARTIES; j++)
+		Compute_RAND((unsigned char *)&(ws->shares[j]),SHA256_INPUTS,(unsigned char *)ws->keys[j],16);
+	roundTapes(ws, -1, NULL);
+	computeAuxTape(ws->tape, ws->shares);
+	slicedToTape(ws->tape, NUM_PARTIES-1, aux);
+	roundCommit(ws, aux, -1, NULL, h1);
+
+	memset(views, 0, NUM_PARTIES * sizeof(View));
+	mpc_sha256(result, maskedInput, ws->shares, input, numBytes, ws->tape, views, results, countY);
+	roundViewsDigest(ws, views, maskedInput, result, h2);
+	stats_add(STATS_GATES, *countY);
+}
+
 int main(int argc, char * argv[]) 
 {
 //	setbuf(stdout, NULL);
 	srand((unsigned) time(NULL));
+	if (stats_init(NULL) != 0)
+		return -1;
 	init_EVP();
-	openmp_thread_setup();
 
 	printf("Enter the string to be hashed (Max 55 characters): ");
 	char userInput[56]; //55 is max length as we only support 447 bits = 55.875 bytes
@@ -68,170 +102,168 @@ int main(int argc, char * argv[])
 	for(int j = 0; j<i; j++) {
 		input[j] = userInput[j];
 	}
-	unsigned char masterkeys[NUM_ROUNDS][16];
-	unsigned char keys[NUM_ROUNDS][NUM_PARTIES][16];
+	int masterDepth = seedtree_depth(NUM_ROUNDS);
+	unsigned char mastertree[SEEDTREE_NODES(masterDepth)][16];
+	unsigned char (*masterkeys)[16] = &mastertree[(1 << masterDepth) - 1];
 	unsigned char rsseed[20];
-	unsigned char rs[NUM_ROUNDS][NUM_PARTIES][4];
 
         //Generating keys
-	Compute_RAND((unsigned char *)masterkeys, NUM_ROUNDS*16,input,strlen(userInput));  
+	stats_begin("keys");
+	Compute_RAND(mastertree[0], 16,input,strlen(userInput));  
+	seedtree_expand(mastertree, masterDepth, NULL);
 	memset(rsseed,0,20);
 //	RAND_bytes((unsigned char *)&rsseed[4],16);
-	for (int j = 0; j < NUM_ROUNDS; j++)
+
+	//Views and aux tapes of every round are kept for the proof while they fit in VIEW_CACHE_BYTES,
+	//otherwise the online rounds are run again once the challenge is known
+	int cacheRounds = ((size_t)NUM_ROUNDS * (NUM_PARTIES * sizeof(View) + rSize) <= VIEW_CACHE_BYTES);
+	arena ar = {0};
+	View (*viewCache)[NUM_PARTIES] = NULL;
+	unsigned char (*auxCache)[rSize] = NULL;
+	int numSets = omp_get_max_threads();
+	roundSet * sets = calloc(numSets, sizeof(roundSet));
+	if (!sets || (cacheRounds && (arena_init(&ar, ARENA_BYTES(NUM_ROUNDS * sizeof(*viewCache)) + ARENA_BYTES(NUM_ROUNDS * rSize)) != 0)))
 	{
-		Compute_RAND((unsigned char *)keys[j], NUM_PARTIES*16,masterkeys[j],16);  
-		memcpy((unsigned char *)rsseed,&j,sizeof(int));
-		Compute_RAND((unsigned char *)rs[j],NUM_PARTIES*4,rsseed,20);
+		printf("Unable to allocate %d rounds of %d parties\n", NUM_ROUNDS, NUM_PARTIES);
+		return -1;
 	}
-        //Sharing secrets
-	unsigned char shares[NUM_ROUNDS][NUM_PARTIES][SHA256_INPUTS];
-	for (int j=0;j<NUM_ROUNDS;j++)
+	if (cacheRounds)
 	{
-		for (int k=0;k<NUM_PARTIES;k++)
-			Compute_RAND((unsigned char *)&(shares[j][k]),SHA256_INPUTS,(unsigned char *)keys[j][k],16);
+		viewCache = arena_alloc(&ar, NUM_ROUNDS * sizeof(*viewCache));
+		auxCache = arena_alloc(&ar, NUM_ROUNDS * rSize);
 	}
 
-        //Generating randomness
-	unsigned char randomness[NUM_ROUNDS][NUM_PARTIES][rSize];
-	memset(randomness,0,NUM_ROUNDS*NUM_PARTIES*rSize);
-
-//	#pragma omp parallel for
-	for(int k=0; k<NUM_ROUNDS; k++) {
-		for(int j = 0; j<NUM_PARTIES; j++) {
-			getAllRandomness(keys[k][j], randomness[k][j]);
-		}
-	}
-	//compute AUX Tape
-	SHA256_CTX ctx,hctx,H1ctx,H2ctx;
+	//Rounds are independent, each runs start to end in its thread's working set and
+	//their digests are folded into H1 and H2 in round order afterwards
+	stats_begin("rounds");
+	EVP_MD_CTX ** Hctx;
+	EVP_MD_CTX * hctx;
 	unsigned char temphash1[SHA256_DIGEST_LENGTH];
 	unsigned char temphash2[SHA256_DIGEST_LENGTH];
 	unsigned char temphash3[SHA256_DIGEST_LENGTH];
-
-	SHA256_Init(&H1ctx);
-	for (int k = 0; k<NUM_ROUNDS;k++)
-	{
-		computeAuxTape(randomness[k],shares[k]);
-		SHA256_Init(&hctx);
-		for (int j = 0; j < NUM_PARTIES; j++)
-		{
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, keys[k][j], 16);
-			if (j == (NUM_PARTIES-1))
-			{
-/*
-				size_t pos = 0;
-				memset(auxBits,0,rSize/8+1);
-				// need to include aux tape
-				for (int i = 1; i < rSize; i+=2)
-				{
-					uint8_t auxBit = getBit(randomness[k][j],i);
-					setBit(auxBits[k],pos,auxBit);
-					pos++;
-				}
-*/
-				SHA256_Update(&ctx, randomness[k][j], rSize);
-			}
-			SHA256_Update(&ctx, rs[k][j], 4);
-			SHA256_Final(temphash1,&ctx);
-			SHA256_Update(&hctx, temphash1, SHA256_DIGEST_LENGTH);
-		}
-		SHA256_Final(temphash1,&hctx);
-		SHA256_Update(&H1ctx, temphash1, SHA256_DIGEST_LENGTH);
-	}
-	SHA256_Final(temphash1,&H1ctx);
-
-	//Running MPC-SHA2 online
-	unsigned char masked_result[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
-	unsigned char party_result[NUM_PARTIES][SHA256_DIGEST_LENGTH];
-	unsigned char maskedInputs[NUM_ROUNDS][SHA256_INPUTS];
-	View localViews[NUM_ROUNDS][NUM_PARTIES];
+	unsigned char H1[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
 	unsigned char H2[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
-	SHA256_Init(&H2ctx);
-//	#pragma omp parallel for
+	unsigned char maskedInputs[NUM_ROUNDS][SHA256_INPUTS];
+	unsigned char masked_result[SHA256_DIGEST_LENGTH];
+	unsigned char party_result[NUM_PARTIES][SHA256_DIGEST_LENGTH];
+	int countY0 = 0;
+	int failed = 0;
+	#pragma omp parallel for
 	for(int k=0; k<NUM_ROUNDS; k++) {
+		roundSet * ws = &sets[omp_get_thread_num()];
 		int countY = 0;
+		unsigned char result[SHA256_DIGEST_LENGTH];
+		unsigned char results[NUM_PARTIES][SHA256_DIGEST_LENGTH];
 
-		mpc_sha256(masked_result[k],maskedInputs[k],shares[k],input, i, randomness[k], localViews[k],party_result,&countY);
-		SHA256_Init(&hctx);
-		SHA256_Update(&hctx,maskedInputs[k],SHA256_INPUTS);
-		SHA256_Update(&hctx,masked_result[k],SHA256_DIGEST_LENGTH);
-		for (int j=0;j<NUM_PARTIES;j++)
-			SHA256_Update(&hctx, localViews[k][j].y,ySize*4);
-		SHA256_Update(&hctx, rs[k], NUM_PARTIES*4);
-		SHA256_Final(H2[k],&hctx);
-		SHA256_Update(&H2ctx, H2[k], SHA256_DIGEST_LENGTH);
+		if (!ws->tape && (initRoundSet(ws) != 0))
+		{
+			failed = 1;
+			continue;
+		}
+		proveRound(ws, k, masterkeys[k], rsseed, input, i, cacheRounds ? viewCache[k] : ws->views, cacheRounds ? auxCache[k] : ws->auxTape,
+				H1[k], H2[k], maskedInputs[k], result, results, &countY);
 		if (k == 0)
 		{
-			printf("countY %d result of hash:",countY);
-			for (int j=0;j<SHA256_DIGEST_LENGTH;j++)
-			{
-				unsigned char temp = masked_result[k][j];
-				for (int i=0;i<NUM_PARTIES;i++)
-				{
-					temp ^= party_result[i][j];
-				}
-				printf("%02X",temp);
-			}
-			printf("\n");
+			countY0 = countY;
+			memcpy(masked_result,result,sizeof(result));
+			memcpy(party_result,results,sizeof(results));
+		}
+	}
+	if (failed)
+		return -1;
+	Hctx = crypto_digests(crypto_sha256, 2);
+	for (int k = 0; k<NUM_ROUNDS;k++)
+	{
+		EVP_DigestUpdate(Hctx[0], H1[k], SHA256_DIGEST_LENGTH);
+		EVP_DigestUpdate(Hctx[1], H2[k], SHA256_DIGEST_LENGTH);
+	}
+	EVP_DigestFinal_ex(Hctx[0], temphash1, NULL);
+	EVP_DigestFinal_ex(Hctx[1], temphash2, NULL);
+
+	printf("countY %d result of hash:",countY0);
+	for (int j=0;j<SHA256_DIGEST_LENGTH;j++)
+	{
+		unsigned char temp = masked_result[j];
+		for (int i=0;i<NUM_PARTIES;i++)
+		{
+			temp ^= party_result[i][j];
 		}
+		printf("%02X",temp);
 	}
-	SHA256_Final(temphash2,&H2ctx);
+	printf("\n");
 
-	SHA256_Init(&hctx);
-	SHA256_Update(&hctx, temphash1, SHA256_DIGEST_LENGTH);
-	SHA256_Update(&hctx, temphash2, SHA256_DIGEST_LENGTH);
-	SHA256_Final(temphash3,&hctx);
+	hctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(hctx, temphash1, SHA256_DIGEST_LENGTH);
+	EVP_DigestUpdate(hctx, temphash2, SHA256_DIGEST_LENGTH);
+	EVP_DigestFinal_ex(hctx, temphash3, NULL);
 
 	//Committing
+	stats_begin("challenge");
 	z kkwProof;
 	int es[NUM_ROUNDS];
+	memset(&kkwProof,0,sizeof(z));
 	memcpy(kkwProof.H,temphash3,SHA256_DIGEST_LENGTH);
 	memcpy(kkwProof.rsseed,&rsseed[4],16);
 	H3(temphash3, NUM_ONLINE, es);
+	seedtree_reveal(mastertree, masterDepth, NUM_ROUNDS, es, kkwProof.masterkeys);
 
 	int masterkeycount = 0;
 	int onlinecount = 0;
+	int online[NUM_ONLINE];
 
 	for (int i = 0; i < NUM_ROUNDS;i++)
 	{
 		if (!es[i])
-		{
-			memcpy(kkwProof.masterkeys[masterkeycount],masterkeys[i],16);
 			memcpy(kkwProof.H2[masterkeycount++],H2[i],SHA256_DIGEST_LENGTH);
+		else
+			online[onlinecount++] = i;
+	}
+
+	//Opening the online rounds, from the cache or by running them again
+	stats_begin("open");
+	#pragma omp parallel for
+	for (int o = 0; o < NUM_ONLINE; o++)
+	{
+		roundSet * ws = &sets[omp_get_thread_num()];
+		int k = online[o];
+		int hidden = es[k]-1;
+
+		if (!ws->tape && (initRoundSet(ws) != 0))
+		{
+			failed = 1;
+			continue;
 		}
+		View * views = cacheRounds ? viewCache[k] : ws->views;
+		unsigned char * aux = cacheRounds ? auxCache[k] : ws->auxTape;
+		if (cacheRounds)
+			roundKeys(ws, k, masterkeys[k], rsseed);
 		else
 		{
-			memcpy(kkwProof.auxBits[onlinecount],randomness[i][NUM_PARTIES-1],rSize);
-			memcpy(kkwProof.maskedInput[onlinecount],maskedInputs[i],SHA256_INPUTS);
-			int partycount = 0;
-			for (int j = 0; j < NUM_PARTIES; j++)
-			{
-				if ((j+1) != es[i])
-				{
-					memcpy(kkwProof.keys[onlinecount][partycount++],keys[i][j],16);
-				}
-				else
-				{
-					SHA256_Init(&ctx);
-					SHA256_Update(&ctx,keys[i][j],16);
-					if (j == (NUM_PARTIES-1))
-					{
-						SHA256_Update(&ctx, randomness[i][NUM_PARTIES-1], rSize);
-					}
-					SHA256_Update(&ctx, rs[i][j], 4);
-					SHA256_Final(kkwProof.com[onlinecount],&ctx);
-					memcpy(&kkwProof.views[onlinecount],&localViews[i][j],sizeof(View));
-				}
-			}
-			onlinecount++;
+			int countY = 0;
+			unsigned char h1[SHA256_DIGEST_LENGTH], h2[SHA256_DIGEST_LENGTH], maskedInput[SHA256_INPUTS];
+			unsigned char result[SHA256_DIGEST_LENGTH];
+			unsigned char results[NUM_PARTIES][SHA256_DIGEST_LENGTH];
+			proveRound(ws, k, masterkeys[k], rsseed, input, i, views, aux, h1, h2, maskedInput, result, results, &countY);
 		}
+		memcpy(kkwProof.auxBits[o],aux,rSize);
+		memcpy(kkwProof.maskedInput[o],maskedInputs[k],SHA256_INPUTS);
+		revealPartyKeys(masterkeys[k],hidden,kkwProof.keys[o]);
+		partyCommit(ws,hidden,aux,kkwProof.com[o]);
+		memcpy(&kkwProof.views[o],&views[hidden],sizeof(View));
 	}
+	if (failed)
+		return -1;
+	for (int j = 0; j < numSets; j++)
+		freeRoundSet(&sets[j]);
+	free(sets);
+	arena_free(&ar);
 		
 	//Writing to file
+	stats_begin("write");
 	FILE *file;
 	char outputFile[100];
 
-	sprintf(outputFile, "out%i-%i.bin", NUM_ROUNDS,NUM_ONLINE);
+	sprintf(outputFile, PROOF_NAME, NUM_PARTIES,NUM_ROUNDS,NUM_ONLINE);
 	file = fopen(outputFile, "wb");
 	if (!file) {
 		printf("Unable to open file!");
@@ -240,10 +272,11 @@ int main(int argc, char * argv[])
 	fwrite(&kkwProof, sizeof(z), 1, file);
 
 	fclose(file);
+	stats_report("KKW_SHA256", NUM_ROUNDS);
 
 	printf("Proof output to file %s\n", outputFile);
+	printf("%d parties, %d rounds, %d online: %lu byte proof\n", NUM_PARTIES, NUM_ROUNDS, NUM_ONLINE, (unsigned long)sizeof(z));
 
-	openmp_thread_cleanup();
 	cleanup_EVP();
 	return EXIT_SUCCESS;
 }
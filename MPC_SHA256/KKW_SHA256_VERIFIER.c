@@ -52,199 +52,147 @@ int isOnline(int es[NUM_ROUNDS], int round)
 
 int main(int argc, char * argv[]) {
 	setbuf(stdout, NULL);
+	if (stats_init(NULL) != 0)
+		return -1;
 	init_EVP();
-	openmp_thread_setup();
 	
 	z kkwProof;
 	FILE *file;
+	char defaultFile[100];
+	const char *inputFile = defaultFile;
 	static int once = 0;
 
-	if (argc !=2)
+	if (argc > 2)
 	{
-		printf("Usage: %s <proof file name>\n",argv[0]);
+		printf("Usage: %s [proof file name]\n",argv[0]);
 		return -1;
 	}
+	//The proof of this build's parameter set by default
+	if (argc == 2)
+		inputFile = argv[1];
+	else
+		sprintf(defaultFile, PROOF_NAME, NUM_PARTIES,NUM_ROUNDS,NUM_ONLINE);
 
-	file = fopen(argv[1], "rb");
+	stats_begin("read");
+	file = fopen(inputFile, "rb");
 	if (!file) {
-		printf("Unable to open file %s!\n",argv[1]);
+		printf("Unable to open file %s!\n",inputFile);
+		return -1;
+	}
+	//A proof of another parameter set has another size
+	if ((fread(&kkwProof, sizeof(z), 1, file) != 1) || (fgetc(file) != EOF)) {
+		printf("%s is not a %d party, %d round proof!\n",inputFile,NUM_PARTIES,NUM_ROUNDS);
+		fclose(file);
+		return -1;
 	}
-	fread(&kkwProof, sizeof(z), 1, file);
 	fclose(file);
 
+	stats_begin("challenge");
 	int es[NUM_ROUNDS];
 	memset(es,0,NUM_ROUNDS*sizeof(int));
 	H3(kkwProof.H, NUM_ONLINE, es);
 
-	unsigned char keys[NUM_ROUNDS][NUM_PARTIES][16];
 	unsigned char rsseed[20];
-	unsigned char rs[NUM_ROUNDS][NUM_PARTIES][4];
-	unsigned char shares[NUM_ROUNDS][NUM_PARTIES][SHA256_INPUTS];
-	unsigned char randomness[NUM_ROUNDS][NUM_PARTIES][rSize];
-	memset(randomness,0,NUM_ROUNDS*NUM_PARTIES*rSize);
-
-	memset(shares,0,NUM_ROUNDS*NUM_PARTIES*SHA256_INPUTS);
+	roundSet ws;
+	if (initRoundSet(&ws) != 0)
+		return -1;
 	memcpy(&rsseed[4],kkwProof.rsseed,16);
 	int roundctr = 0;
-	int partyctr = 0;
 	int onlinectr = 0;
-	for (int j = 0; j < NUM_ROUNDS; j++)
+	stats_begin("keys");
+	int masterDepth = seedtree_depth(NUM_ROUNDS);
+	unsigned char mastertree[SEEDTREE_NODES(masterDepth)][16];
+	unsigned char (*masterkeys)[16] = &mastertree[(1 << masterDepth) - 1];
+	//The nodes past the ones the online rounds call for are zero, so the proof has one encoding
+	static const unsigned char zeroNode[16];
+	for (int j = seedtree_fill(mastertree, masterDepth, NUM_ROUNDS, es, kkwProof.masterkeys); j < MASTER_NODES; j++)
 	{
-		memcpy((unsigned char *)rsseed,&j,sizeof(int));
-		Compute_RAND((unsigned char *)rs[j],NUM_PARTIES*4,rsseed,20);
-		if (!isOnline(es,j))
+		if (memcmp(kkwProof.masterkeys[j],zeroNode,16))
 		{
-			Compute_RAND((unsigned char *)keys[j], NUM_PARTIES*16,kkwProof.masterkeys[roundctr++],16);
-
-			for (int k = 0; k < NUM_PARTIES; k++)
-			{
-				Compute_RAND((unsigned char *)&(shares[j][k]),SHA256_INPUTS,(unsigned char *)keys[j][k],16);
-				getAllRandomness(keys[j][k], randomness[j][k]);
-			}
-			computeAuxTape(randomness[j],shares[j]);
-		}
-		else
-		{
-			partyctr = 0;
-			for (int k = 0; k < NUM_PARTIES;k++)
-			{
-				if ((k+1) != es[j])
-				{
-					memcpy((unsigned char *)keys[j][k],kkwProof.keys[onlinectr][partyctr++],16);
-					Compute_RAND((unsigned char *)&(shares[j][k]),SHA256_INPUTS,(unsigned char *)keys[j][k],16);
-					getAllRandomness(keys[j][k], randomness[j][k]);
-				}
-				else
-				{
-					// ?? online how
-					memset(randomness[j][k],0,rSize);
-				}
-
-			}
-			memcpy(randomness[j][NUM_PARTIES-1],kkwProof.auxBits[onlinectr],rSize);
-			onlinectr++;
+			printf("Error: Unused master key node is not zero\n");
+			return -1;
 		}
 	}
-	SHA256_CTX ctx,hctx,H1ctx,H2ctx;
+
+	EVP_MD_CTX ** Hctx;
+	EVP_MD_CTX * hctx;
+	unsigned char H1[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
+	unsigned char H2[NUM_ROUNDS][SHA256_DIGEST_LENGTH];
 	unsigned char H1hash[SHA256_DIGEST_LENGTH];
 	unsigned char H2hash[SHA256_DIGEST_LENGTH];
 	unsigned char temphash1[SHA256_DIGEST_LENGTH];
-	unsigned char temphash2[SHA256_DIGEST_LENGTH];
 	unsigned char masked_result[SHA256_DIGEST_LENGTH];
 	unsigned char party_result[NUM_PARTIES][SHA256_DIGEST_LENGTH];
-	View localViews[NUM_ONLINE][NUM_PARTIES];
-	memset(localViews,0,NUM_ONLINE*NUM_PARTIES*sizeof(View));
 
-	roundctr = 0;
-
-	SHA256_Init(&H1ctx);
-	for (int k = 0; k<NUM_ROUNDS;k++)
+	//One round at a time in one working set, its digests are folded into H1 and H2 afterwards
+	stats_begin("rounds");
+	for (int k = 0; k < NUM_ROUNDS; k++)
 	{
+		int hidden = isOnline(es,k) ? es[k]-1 : -1;
+		int countY = 0;
+
 		if (!isOnline(es,k))
-		{
-			SHA256_Init(&hctx);
-			for (int j = 0; j < NUM_PARTIES; j++)
-			{
-				SHA256_Init(&ctx);
-				SHA256_Update(&ctx, keys[k][j], 16);
-				if (j == (NUM_PARTIES-1))
-				{
-/*
-					size_t pos = 0;
-					memset(auxBits,0,rSize/8+1);
-                               	 // need to include aux tape
-    					for (int i = 1; i < rSize; i+=2)
-       					{
-						uint8_t auxBit = getBit(randomness[k][j],i);
-						setBit(auxBits,pos,auxBit);
-						pos++;
-					}
-*/
-             				SHA256_Update(&ctx, randomness[k][NUM_PARTIES-1], rSize);
-				}
-				SHA256_Update(&ctx, rs[k][j], 4);
-				SHA256_Final(temphash1, &ctx);
-				SHA256_Update(&hctx,temphash1,SHA256_DIGEST_LENGTH);
-  			}
-			SHA256_Final(temphash2,&hctx);
-			SHA256_Update(&H1ctx, temphash2, SHA256_DIGEST_LENGTH);
-		}
+			partyKeys(masterkeys[k], ws.keys);
 		else
+			fillPartyKeys(kkwProof.keys[onlinectr],hidden,ws.keys);
+		memcpy((unsigned char *)rsseed,&k,sizeof(int));
+		Compute_RAND((unsigned char *)ws.rs,NUM_PARTIES*4,rsseed,20);
+		for (int j = 0; j < NUM_PARTIES; j++)
 		{
-			SHA256_Init(&hctx);
-			for (int j = 0; j < NUM_PARTIES; j++)
-			{
-				if ((j+1) != es[k])
-				{
-					SHA256_Init(&ctx);
-					SHA256_Update(&ctx, keys[k][j], 16);
-					if (j == (NUM_PARTIES-1))
-					{
-             					SHA256_Update(&ctx, kkwProof.auxBits[roundctr], rSize);
-					}
-					SHA256_Update(&ctx, rs[k][j], 4);
-					SHA256_Final(temphash1, &ctx);
-				}
-				else
-				{
-					memcpy(temphash1,kkwProof.com[roundctr],SHA256_DIGEST_LENGTH);
-				}
-				SHA256_Update(&hctx,temphash1,SHA256_DIGEST_LENGTH);
-			}
-			SHA256_Final(temphash2,&hctx);
-			SHA256_Update(&H1ctx, temphash2, SHA256_DIGEST_LENGTH);
-			roundctr++;
+			if (j != hidden)
+				Compute_RAND((unsigned char *)&(ws.shares[j]),SHA256_INPUTS,(unsigned char *)ws.keys[j],16);
+			else
+				memset(ws.shares[j],0,SHA256_INPUTS);
 		}
-	}
-	SHA256_Final(H1hash,&H1ctx);
-
-	SHA256_Init(&H2ctx);
-	roundctr = 0;
-	onlinectr = 0;
-	for (int k=0; k < NUM_ROUNDS; k++)
-	{
-		int countY = 0;
 		if (!isOnline(es,k))
 		{
-			SHA256_Update(&H2ctx,kkwProof.H2[roundctr++],SHA256_DIGEST_LENGTH);
+			roundTapes(&ws, -1, NULL);
+			computeAuxTape(ws.tape, ws.shares);
+			slicedToTape(ws.tape, NUM_PARTIES-1, ws.auxTape);
+			roundCommit(&ws, ws.auxTape, -1, NULL, H1[k]);
+			memcpy(H2[k], kkwProof.H2[roundctr++], SHA256_DIGEST_LENGTH);
+			continue;
 		}
-		else
+		roundTapes(&ws, hidden, kkwProof.auxBits[onlinectr]);
+		roundCommit(&ws, kkwProof.auxBits[onlinectr], hidden, kkwProof.com[onlinectr], H1[k]);
+
+		memset(ws.views, 0, NUM_PARTIES * sizeof(View));
+		memcpy(&ws.views[hidden],&kkwProof.views[onlinectr],sizeof(View));
+		mpc_sha256(masked_result,kkwProof.maskedInput[onlinectr],ws.shares,NULL,hidden,ws.tape,ws.views,party_result,&countY);
+		if (0)
 		{
-			SHA256_Init(&hctx);
-			SHA256_Update(&hctx,kkwProof.maskedInput[onlinectr],SHA256_INPUTS);
-			memcpy(&localViews[onlinectr][es[k]-1],&kkwProof.views[onlinectr],sizeof(View));
-			mpc_sha256(masked_result,kkwProof.maskedInput[onlinectr],shares[k],NULL,es[k]-1,randomness[k],localViews[onlinectr],party_result,&countY);
-			if (0)
+			printf("mpc round %d verification of hash: ",k);
+			for (int j=0;j<SHA256_DIGEST_LENGTH;j++)
 			{
-				printf("mpc round %d verification of hash: ",k);
-				for (int j=0;j<SHA256_DIGEST_LENGTH;j++)
+				unsigned char temp = masked_result[j];
+				for (int i=0;i<NUM_PARTIES;i++)
 				{
-					unsigned char temp = masked_result[j];
-					for (int i=0;i<NUM_PARTIES;i++)
-					{
-						temp ^= party_result[i][j];
-					}
-					printf("%02X",temp);
+					temp ^= party_result[i][j];
 				}
-				printf("\n");
-		//		once = 1;
+				printf("%02X",temp);
 			}
-			SHA256_Update(&hctx,masked_result,SHA256_DIGEST_LENGTH);
-			for (int j = 0; j < 32; j++)
-				SHA256_Update(&hctx, localViews[onlinectr][j].y,ySize*4);
-			SHA256_Update(&hctx,rs[k],NUM_PARTIES*4);
-			SHA256_Final(temphash1,&hctx);
-			SHA256_Update(&H2ctx,temphash1,SHA256_DIGEST_LENGTH);
-
-			onlinectr++;
+			printf("\n");
+	//		once = 1;
 		}
+		roundViewsDigest(&ws, ws.views, kkwProof.maskedInput[onlinectr], masked_result, H2[k]);
+		stats_add(STATS_GATES, countY);
+		onlinectr++;
+	}
+	freeRoundSet(&ws);
+	Hctx = crypto_digests(crypto_sha256, 2);
+	for (int k = 0; k < NUM_ROUNDS; k++)
+	{
+		EVP_DigestUpdate(Hctx[0], H1[k], SHA256_DIGEST_LENGTH);
+		EVP_DigestUpdate(Hctx[1], H2[k], SHA256_DIGEST_LENGTH);
 	}
-	SHA256_Final(H2hash,&H2ctx);
+	EVP_DigestFinal_ex(Hctx[0], H1hash, NULL);
+	EVP_DigestFinal_ex(Hctx[1], H2hash, NULL);
 
-	SHA256_Init(&hctx);
-	SHA256_Update(&hctx,H1hash,SHA256_DIGEST_LENGTH);
-	SHA256_Update(&hctx,H2hash,SHA256_DIGEST_LENGTH);
-	SHA256_Final(temphash1,&hctx);
+	hctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(hctx,H1hash,SHA256_DIGEST_LENGTH);
+	EVP_DigestUpdate(hctx,H2hash,SHA256_DIGEST_LENGTH);
+	EVP_DigestFinal_ex(hctx,temphash1,NULL);
+	stats_report("KKW_SHA256_VERIFIER", NUM_ROUNDS);
 
 	if (memcmp(temphash1,kkwProof.H,SHA256_DIGEST_LENGTH))
 	{
@@ -267,7 +215,6 @@ int main(int argc, char * argv[]) {
 	}
 	
 	
-	openmp_thread_cleanup();
 	cleanup_EVP();
 	return EXIT_SUCCESS;
 }
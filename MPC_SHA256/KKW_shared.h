@@ -58,6 +58,10 @@
 #endif
 #include <openssl/rand.h>
 #include "omp.h"
+#include "../common/arena.h"
+#include "../common/tapes.h"
+#include "../common/stats.h"
+#include "../common/seedtree.h"
 
 #define VERBOSE FALSE
 #define ToBytes(x) (x == 0)? 0:((x-1)/8+1)
@@ -84,10 +88,86 @@ static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 #define ySize (728 + 8)
 //#define rSize 2912 
 #define rSize (45392/8) // 2912*2 = 5824 
+#define SHA256_INPUTS 64
+
+/*
+ * Parameter sets: NUM_PARTIES parties, NUM_ROUNDS rounds of which NUM_ONLINE
+ * are opened online. A prover who cheats in the preprocessing of k rounds gets
+ * through only if all k are online, and each of the other online rounds needs
+ * the hidden party guessed, so with N parties, M rounds and t online (Katz,
+ * Kolesnikov and Wang, CCS 2018) the soundness error is
+ *
+ *   max over k = 0..t of C(M - k, t - k) / C(M, t) * N^-(t - k)
+ *
+ * Every set keeps the 2^-20 of the 32 party set with the fewest rounds for its
+ * online rounds:
+ *
+ *   N    M    t  error
+ *   32   28   7  2^-20.18
+ *   64   45   5  2^-20.22  4 online would take 78 rounds
+ *   128  75   4  2^-20.21  3 online would take 237 rounds
+ *   256  194  3  2^-20.19
+ *
+ * With 4 online rounds and 128 or more parties the k = t term, 1 / C(M, t),
+ * is the largest and does not depend on N, so 256 parties with 4 online would
+ * need the same 75 rounds as 128 parties for a slower and larger proof. The 256 party set
+ * takes 3 online rounds instead: the smallest proof, at about 7 times the
+ * prover time of the 128 party set. Pick one at build time with
+ * -DKKW_PARTIES=64 (make KKW_PARTIES=64).
+ *
+ * PARTY_DEPTH is log2(NUM_PARTIES), the co-path of a hidden party in its
+ * round's seed tree. MASTER_NODES is the most seed tree nodes it takes to
+ * reveal the master keys of the rounds that are not online, over every choice
+ * of online rounds.
+ *
+ * Proofs are written to out<parties>-<rounds>-<online>.bin (PROOF_NAME), so
+ * the proofs of different sets do not overwrite each other.
+ */
+#ifndef KKW_PARTIES
+#define KKW_PARTIES 32
+#endif
+#if KKW_PARTIES == 32
 #define NUM_PARTIES 32 
 #define NUM_ROUNDS 28 
-#define SHA256_INPUTS 64
 #define NUM_ONLINE 7  // out of NUM_ROUNDS
+#define PARTY_DEPTH 5
+#define MASTER_NODES 14
+#elif KKW_PARTIES == 64
+#define NUM_PARTIES 64
+#define NUM_ROUNDS 45
+#define NUM_ONLINE 5
+#define PARTY_DEPTH 6
+#define MASTER_NODES 16
+#elif KKW_PARTIES == 128
+#define NUM_PARTIES 128
+#define NUM_ROUNDS 75
+#define NUM_ONLINE 4
+#define PARTY_DEPTH 7
+#define MASTER_NODES 17
+#elif KKW_PARTIES == 256
+#define NUM_PARTIES 256
+#define NUM_ROUNDS 194
+#define NUM_ONLINE 3
+#define PARTY_DEPTH 8
+#define MASTER_NODES 19
+#else
+#error "KKW_PARTIES must be 32, 64, 128 or 256"
+#endif
+#define PARTY_LANES (NUM_PARTIES / 32)
+#define PROOF_NAME "out%i-%i-%i.bin" // NUM_PARTIES, NUM_ROUNDS, NUM_ONLINE
+
+// Upper bound on the views and aux tapes the prover keeps until the challenge
+#ifndef VIEW_CACHE_BYTES
+#define VIEW_CACHE_BYTES (16 * 1024 * 1024)
+#endif
+
+/*
+ * One bit per party: party j is bit j % 32 of lane j / 32, counted from the
+ * top as getBit32() does. A GCC vector, so the gate XORs and ANDs over all
+ * parties are single 64, 128 or 256 bit operations.
+ */
+typedef uint32_t partyWord __attribute__((vector_size(NUM_PARTIES / 8)));
+#define tSize ((rSize * 8 + 31) / 32 * 32) // tape bits, whole 32 bit blocks
 
 typedef struct {
 	uint32_t y[ySize];
@@ -96,9 +176,9 @@ typedef struct {
 typedef struct {
 	unsigned char rsseed[16];
 	unsigned char H[SHA256_DIGEST_LENGTH];
-	unsigned char masterkeys[NUM_ROUNDS-NUM_ONLINE][16];
+	unsigned char masterkeys[MASTER_NODES][16]; // seed tree nodes, unused ones zero
 	unsigned char H2[NUM_ROUNDS-NUM_ONLINE][SHA256_DIGEST_LENGTH];
-	unsigned char keys[NUM_ONLINE][NUM_PARTIES-1][16];
+	unsigned char keys[NUM_ONLINE][PARTY_DEPTH][16]; // co-path of the hidden party
 	unsigned char com[NUM_ONLINE][SHA256_DIGEST_LENGTH];
 	unsigned char auxBits[NUM_ONLINE][rSize];
 	unsigned char maskedInput[NUM_ONLINE][SHA256_INPUTS];
@@ -123,21 +203,20 @@ void Compute_RAND(unsigned char * output, int size, unsigned char * seed, int se
 	char * tempptr = output;
 	uint32_t count = 1;
 
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, namestr, strlen(namestr));
-	SHA256_Update(&ctx, &seedLen, sizeof(int));
-	SHA256_Update(&ctx, seed, seedLen);
-	SHA256_Update(&ctx, &size, sizeof(int));
-	SHA256_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, namestr, strlen(namestr));
+	EVP_DigestUpdate(ctx, &seedLen, sizeof(int));
+	EVP_DigestUpdate(ctx, seed, seedLen);
+	EVP_DigestUpdate(ctx, &size, sizeof(int));
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 	while (size > 0)
 	{
-		SHA256_Init(&ctx);
-		SHA256_Update(&ctx, &count, sizeof(int));
-		SHA256_Update(&ctx, &seedLen, sizeof(int));
-		SHA256_Update(&ctx, seed, seedLen);
-		SHA256_Update(&ctx, hash, sizeof(hash));
-		SHA256_Final(hash, &ctx);
+		ctx = crypto_digest(crypto_sha256);
+		EVP_DigestUpdate(ctx, &count, sizeof(int));
+		EVP_DigestUpdate(ctx, &seedLen, sizeof(int));
+		EVP_DigestUpdate(ctx, seed, seedLen);
+		EVP_DigestUpdate(ctx, hash, sizeof(hash));
+		EVP_DigestFinal_ex(ctx, hash, NULL);
 		if (size >= SHA256_DIGEST_LENGTH)
 		{
 			memcpy(tempptr,hash,SHA256_DIGEST_LENGTH);
@@ -172,27 +251,16 @@ EVP_CIPHER_CTX setupAES(unsigned char key[16]) {
 
 }
 */
-void getAllRandomness(unsigned char key[16], unsigned char randomness[rSize]) {
-	//Generate randomness: We use 728*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 728*32/128 = 182 iterations
-
-	EVP_CIPHER_CTX * ctx = EVP_CIPHER_CTX_new();
-	unsigned char * iv = (unsigned char *) "01234567890123456";
-	EVP_CIPHER_CTX_init(ctx);
-	//ctx = setupAES(key);
-	unsigned char *plaintext =
-			(unsigned char *)"0000000000000000";
-	int len;
-	if (1 != EVP_EncryptInit_ex(ctx,EVP_aes_128_ctr(),NULL,key,iv))
-		handleErrors();
-
-	for(int j=0;j<(rSize/16);j++) {
-		if(1 != EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
+#define TAPE_IV ((unsigned char *)"01234567890123456")
 
-	}
-	EVP_CIPHER_CTX_cleanup(ctx);
-	EVP_CIPHER_CTX_free(ctx);
+/*
+ * AES-CTR keystream of the key, see common/tapes.h. rSize is not a multiple
+ * of 16 and the tape has always been whole blocks only, with the last
+ * rSize % 16 bytes left zero; proofs depend on that.
+ */
+void getAllRandomness(unsigned char key[16], unsigned char randomness[rSize]) {
+	tape_expand(key, TAPE_IV, randomness, rSize - rSize % 16);
+	memset(randomness + rSize - rSize % 16, 0, rSize % 16);
 }
 
 uint32_t getRandom32(unsigned char randomness[rSize], int randCount) {
@@ -202,15 +270,46 @@ uint32_t getRandom32(unsigned char randomness[rSize], int randCount) {
 }
 
 
+/*
+ * The party keys of a round are the leaves of a seed tree (common/seedtree.h)
+ * rooted at its master key. An online round reveals the co-path of the
+ * hidden party, the verifier expands it to every other party's key.
+ */
+void partyKeys(const unsigned char masterkey[16], unsigned char keys[NUM_PARTIES][16]) {
+	unsigned char tree[SEEDTREE_NODES(PARTY_DEPTH)][16];
+
+	memcpy(tree[0], masterkey, 16);
+	seedtree_expand(tree, PARTY_DEPTH, NULL);
+	memcpy(keys, tree[NUM_PARTIES - 1], NUM_PARTIES * 16);
+}
+
+void revealPartyKeys(const unsigned char masterkey[16], int hiddenParty, unsigned char path[PARTY_DEPTH][16]) {
+	unsigned char tree[SEEDTREE_NODES(PARTY_DEPTH)][16];
+	int hidden[NUM_PARTIES] = {0};
+
+	memcpy(tree[0], masterkey, 16);
+	seedtree_expand(tree, PARTY_DEPTH, NULL);
+	hidden[hiddenParty] = 1;
+	seedtree_reveal(tree, PARTY_DEPTH, NUM_PARTIES, hidden, path);
+}
+
+// keys of every party but hiddenParty, whose key is left zero
+void fillPartyKeys(const unsigned char path[PARTY_DEPTH][16], int hiddenParty, unsigned char keys[NUM_PARTIES][16]) {
+	unsigned char tree[SEEDTREE_NODES(PARTY_DEPTH)][16];
+	int hidden[NUM_PARTIES] = {0};
+
+	hidden[hiddenParty] = 1;
+	seedtree_fill(tree, PARTY_DEPTH, NUM_PARTIES, hidden, path);
+	memcpy(keys, tree[NUM_PARTIES - 1], NUM_PARTIES * 16);
+	memset(keys[hiddenParty], 0, 16);
+}
+
 void init_EVP() {
-	ERR_load_crypto_strings();
-	OpenSSL_add_all_algorithms();
-	//OPENSSL_config(NULL);
+	tape_init();
 }
 
 void cleanup_EVP() {
-	EVP_cleanup();
-	ERR_free_strings();
+	crypto_cleanup();
 }
 
 void H3(unsigned char finalhash[SHA256_DIGEST_LENGTH], int s, int es[NUM_ROUNDS]) {
@@ -218,22 +317,21 @@ void H3(unsigned char finalhash[SHA256_DIGEST_LENGTH], int s, int es[NUM_ROUNDS]
 	unsigned char hash[SHA256_DIGEST_LENGTH];
 	int i = NUM_ROUNDS;
 	int j;
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, finalhash, SHA256_DIGEST_LENGTH);
-	SHA256_Update(&ctx, &i, sizeof(int));
-	SHA256_Update(&ctx, &s, sizeof(int));
-	SHA256_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, finalhash, SHA256_DIGEST_LENGTH);
+	EVP_DigestUpdate(ctx, &i, sizeof(int));
+	EVP_DigestUpdate(ctx, &s, sizeof(int));
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 
 	//Pick bits from hash
 	memset(es,0,sizeof(int)*NUM_ROUNDS);
 	int bitTracker = 0;
 	while(s>0) {
 		if(bitTracker >= 32) { //Generate new hash as we have run out of bits in the previous hash
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, hash, sizeof(hash));
-			SHA256_Update(&ctx, &s, sizeof(int));
-			SHA256_Final(hash, &ctx);
+			ctx = crypto_digest(crypto_sha256);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestUpdate(ctx, &s, sizeof(int));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
 			bitTracker = 0;
 		}
 		memcpy((unsigned char *)&i,&hash[bitTracker],4);
@@ -257,51 +355,6 @@ void H3(unsigned char finalhash[SHA256_DIGEST_LENGTH], int s, int es[NUM_ROUNDS]
 
 }
 
-omp_lock_t *locks;
-
-void openmp_locking_callback(int mode, int type, char *file, int line)
-{
-  if (mode & CRYPTO_LOCK)
-  {
-    omp_set_lock(&locks[type]);
-  }
-  else
-  {
-    omp_unset_lock(&locks[type]);
-  }
-}
-
-
-unsigned long openmp_thread_id(void)
-{
-  return (unsigned long)omp_get_thread_num();
-}
-
-void openmp_thread_setup(void)
-{
-  int i;
-
-  locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(omp_lock_t));
-  for (i=0; i<CRYPTO_num_locks(); i++)
-  {
-    omp_init_lock(&locks[i]);
-  }
-
-  CRYPTO_set_id_callback((unsigned long (*)())openmp_thread_id);
-  CRYPTO_set_locking_callback((void (*)())openmp_locking_callback);
-}
-
-void openmp_thread_cleanup(void)
-{
-  int i;
-
-  CRYPTO_set_id_callback(NULL);
-  CRYPTO_set_locking_callback(NULL);
-  for (i=0; i<CRYPTO_num_locks(); i++)
-    omp_destroy_lock(&locks[i]);
-  OPENSSL_free(locks);
-}
-
 // from Picnic Project
 //
 /* For an input bit b = 0 or 1, return the word of all b bits, i.e.,
@@ -332,100 +385,167 @@ void setBit32(uint32_t * value, uint32_t bitNumber, uint8_t b)
 	*value = (b&1)? (*value)|(1<<(31-bitNumber)) : (*value)&(~(1<<(31-bitNumber)));
 }
 
-uint8_t getParityFromWordArray(uint32_t * array, uint32_t size, uint32_t bitNumber)
+/* Set a specific bit in a byte array to a given value */
+void setBit(uint8_t* bytes, uint32_t bitNumber, uint8_t val)
 {
-	uint8_t parity = 0;
+	bytes[bitNumber / 8] = (bytes[bitNumber >> 3]
+				& ~(1 << (7 - (bitNumber % 8)))) | (val << (7 - (bitNumber % 8)));
+}
 
-	for (int i=0;i<size;i++)
-	{
-		parity ^= getBit32(array[i],bitNumber);
-	}
-	return parity;
+/*
+ * Bit pos of a big endian byte string, counted from the top of the little
+ * endian word it lands in. Worked out directly rather than from a table
+ * filled on first use, which rounds running in parallel would race on.
+ */
+int toEndian32(int pos)
+{
+	return 31 - (8 * (pos / 8) + 7 - pos % 8);
 }
 
 
-/* Get one bit from a 32-bit int array for all parties*/
-uint32_t getBitFromWordArray(const uint32_t* array, uint32_t size, uint32_t bitNumber)
+static uint32_t consol(uint32_t array[NUM_PARTIES])
 {
-	if (size == 1)
-	{
-		return getBit32(array[0], bitNumber);
-	}
-	else
-	{
-		return getBit32(array[size-1], bitNumber) | (getBitFromWordArray(array,size-1,bitNumber)<<1);
-	}
-	
+	uint32_t ret = 0;
+	for (int i = 0; i<NUM_PARTIES;i++)
+		ret ^= array[i];
+	return ret;
 }
 
-/* Set a specific bit in a byte array to a given value */
-void setBit(uint8_t* bytes, uint32_t bitNumber, uint8_t val)
+static inline uint32_t partyParity(const partyWord * x)
 {
-	bytes[bitNumber / 8] = (bytes[bitNumber >> 3]
-				& ~(1 << (7 - (bitNumber % 8)))) | (val << (7 - (bitNumber % 8)));
+	uint32_t y = (*x)[0];
+
+	for (int l = 1; l < PARTY_LANES; l++)
+		y ^= (*x)[l];
+	y ^= (y >> 1);
+	y ^= (y >> 2);
+	y ^= (y >> 4);
+	y ^= (y >> 8);
+	y ^= (y >> 16);
+	return y & 1;
 }
 
-int toEndian32(int pos)
+static inline uint8_t getPartyBit(const partyWord * x, int party)
+{
+	return getBit32((*x)[party / 32], party % 32);
+}
+
+void setPartyBit(partyWord * x, int party, uint8_t b)
 {
-	static int init = 0;
-	static uint32_t a[32];
-	int count;
-	if (!init)
+	uint32_t bit = 1U << (31 - party % 32);
+
+	(*x)[party / 32] = (b&1)? (*x)[party / 32] | bit : (*x)[party / 32] & ~bit;
+}
+
+/*
+ * Transposes a 32x32 bit matrix in place, bits counted from the top as in
+ * getBit32(): bit j of a[i] swaps with bit i of a[j]. Turns the words of 32
+ * parties into one word per bit position holding that bit of every party
+ * (party j at bit j, as getBit32() counts), and back.
+ */
+void transpose32(uint32_t a[32])
+{
+	uint32_t m = 0x0000FFFF;
+	uint32_t t;
+
+	for (int j = 16; j != 0; j >>= 1, m ^= (m << j))
 	{
-		for (int i = 0 ; i < 32; i++)
+		for (int k = 0; k < 32; k = (k + j + 1) & ~j)
 		{
-			a[i] = 0;
-			count = 32;
-			setBit((unsigned char *)&a[i],i,1);
-			while (a[i] > 0)
-			{
-				a[i]>>=1;
-				count--;
-			}
-			a[i] = count;
+			t = (a[k] ^ (a[k + j] >> j)) & m;
+			a[k] ^= t;
+			a[k + j] ^= (t << j);
 		}
-		init =1 ;
 	}
-	return a[pos]; 
 }
 
-
-static uint32_t parity32(uint32_t x)
+/*
+ * The party tapes bit sliced: word n of tape holds bit n of every party's
+ * tape, so a gate takes the bits of all parties in one read instead of a
+ * getBit() per party. Built 32 bits at a time with transpose32(), one lane
+ * of 32 parties per call from their tapes in randomness.
+ */
+void sliceLane(unsigned char randomness[32][rSize], int lane, partyWord tape[tSize])
 {
-	uint32_t y = x ^ (x >> 1);
+	uint32_t block[32];
 
-	y ^= (y >> 2);
-	y ^= (y >> 4);
-	y ^= (y >> 8);
-	y ^= (y >> 16);
-	return y & 1;
+	for (int n = 0; n < tSize; n += 32)
+	{
+		for (int i = 0; i < 32; i++)
+		{
+			block[i] = 0;
+			for (int b = 0; b < 4; b++)
+				if (n / 8 + b < rSize)
+					block[i] |= (uint32_t)randomness[i][n / 8 + b] << (24 - 8 * b);
+		}
+		transpose32(block);
+		for (int i = 0; i < 32; i++)
+			tape[n + i][lane] = block[i];
+	}
 }
 
-static uint32_t int32ToWord(uint32_t x[NUM_PARTIES], int posn)
+/* Writes one party's tape back from the sliced tape */
+void slicedToTape(partyWord tape[tSize], int party, unsigned char randomness[rSize])
 {
-	uint32_t shares;
+	uint32_t block[32];
 
-	for (size_t i = 0; i < NUM_PARTIES;i++) // NUM_PARTIES = 32 
+	for (int n = 0; n < tSize; n += 32)
 	{
-		uint8_t bit = getBit32(x[i],posn);
-		setBit32(&shares,i,bit);
+		for (int i = 0; i < 32; i++)
+			block[i] = tape[n + i][party / 32];
+		transpose32(block);
+		for (int b = 0; b < 4; b++)
+			if (n / 8 + b < rSize)
+				randomness[n / 8 + b] = block[party % 32] >> (24 - 8 * b);
 	}
-	return shares;
+}
 
+/*
+ * Party words to one word per bit position, see transpose32(). With one lane
+ * a partyWord is a plain word and the transpose is done in place.
+ */
+static void sliceWords(uint32_t x[NUM_PARTIES], partyWord xt[32])
+{
+	uint32_t block[32];
+
+	if (PARTY_LANES == 1)
+	{
+		memcpy(xt, x, sizeof(block));
+		transpose32((uint32_t *)xt);
+		return;
+	}
+	for (int l = 0; l < PARTY_LANES; l++)
+	{
+		memcpy(block, &x[32 * l], sizeof(block));
+		transpose32(block);
+		for (int i = 0; i < 32; i++)
+			xt[i][l] = block[i];
+	}
 }
 
-static uint32_t tapesToWord(unsigned char randomness[NUM_PARTIES][rSize],int * randCount)
+/* And back */
+static void unsliceWords(partyWord xt[32], uint32_t x[NUM_PARTIES])
 {
-	uint32_t shares;
+	uint32_t block[32];
 
-	for (size_t i = 0; i < NUM_PARTIES;i++) // NUM_PARTIES = 32 
+	if (PARTY_LANES == 1)
+	{
+		memcpy(x, xt, sizeof(block));
+		transpose32(x);
+		return;
+	}
+	for (int l = 0; l < PARTY_LANES; l++)
 	{
-		uint8_t bit = getBit(randomness[i],*randCount);
-		setBit32(&shares,i,bit);
+		for (int i = 0; i < 32; i++)
+			block[i] = xt[i][l];
+		transpose32(block);
+		memcpy(&x[32 * l], block, sizeof(block));
 	}
-	*randCount += 1;
+}
 
-	return shares;  
+static inline const partyWord * tapesToWord(partyWord tape[tSize],int * randCount)
+{
+	return &tape[(*randCount)++];
 }
 
 void mpc_RIGHTROTATE(uint32_t x[NUM_PARTIES], int j, uint32_t z[NUM_PARTIES]) {
@@ -451,96 +571,86 @@ void mpc_XOR(uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PA
 		z[i] = x[i] ^ y[i];
 }
 
-int32_t aux_bit_AND(uint8_t mask_a, uint8_t mask_b, unsigned char randomness[NUM_PARTIES][rSize], int *randCount)
+static inline void aux_bit_AND(uint8_t mask_a, uint8_t mask_b, partyWord tape[tSize], int *randCount, partyWord * output_mask)
 {
-	uint32_t output_mask = tapesToWord(randomness,randCount);
+	*output_mask = *tapesToWord(tape,randCount);
 
-	size_t lastParty = NUM_PARTIES-1;
-	uint32_t and_helper = tapesToWord(randomness,randCount);
-	setBit32(&and_helper,NUM_PARTIES-1,0);
-	uint8_t aux_bit = (mask_a & mask_b) ^ parity32(and_helper);
-	setBit(randomness[lastParty], *randCount-1,aux_bit);
-
-	return output_mask;
+	// the last party's bit, the bottom one of the last lane, is the aux bit
+	partyWord and_helper = *tapesToWord(tape,randCount);
+	and_helper[PARTY_LANES-1] &= ~1U;
+	uint8_t aux_bit = (mask_a & mask_b) ^ partyParity(&and_helper);
+	tape[*randCount-1][PARTY_LANES-1] = and_helper[PARTY_LANES-1] | aux_bit;
 } 	
 
-void aux_AND(uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount) 
+void aux_AND(uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount) 
 {
 	uint8_t mask_a,mask_b;
-	uint32_t output_mask; // NUM_PARTIES=32
+	uint32_t x_mask = consol(x), y_mask = consol(y);
+	partyWord zt[32];
 
 	for (int i = 0; i < 32;i++) 
 	{
-		mask_a = getParityFromWordArray(x,NUM_PARTIES,i);  
-		mask_b = getParityFromWordArray(y,NUM_PARTIES,i);  
-
-		output_mask = aux_bit_AND(mask_a,mask_b,randomness,randCount);
+		mask_a = getBit32(x_mask,i);
+		mask_b = getBit32(y_mask,i);
 
-		for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-		{
-			setBit32(&z[j],i,output_mask & 0x01);
-			output_mask>>=1;
-		}
+		aux_bit_AND(mask_a,mask_b,tape,randCount,&zt[i]);
 	}
-
+	unsliceWords(zt,z);
 
 }
 
-void aux_ADD(uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount) {
+void aux_ADD(uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount) {
 
-	uint32_t aANDb, prev_carry = 0;
-	uint32_t carry[NUM_PARTIES] = {0};
+	partyWord aANDb, prev_carry;
+	partyWord carry[32]; // sliced, carry[i] is the carry into bit i
+	uint32_t carryWords[NUM_PARTIES];
+	uint32_t x_mask = consol(x), y_mask = consol(y);
 	uint8_t mask_a, mask_b;
 
 	// sum = x ^ y ^ c
 	// carry = ((x ^ c) & (y ^ c)) ^ c
-	memset(carry,0,sizeof(uint32_t)*NUM_PARTIES);
+	memset(carry,0,sizeof(carry));
 	for (int i = 31; i > 0; i--)
 	{
-		prev_carry = getBitFromWordArray(carry,NUM_PARTIES,i);
-		mask_a = parity32(getBitFromWordArray(x,NUM_PARTIES,i) ^ prev_carry);  
-		mask_b = parity32(getBitFromWordArray(y,NUM_PARTIES,i) ^ prev_carry);  
+		prev_carry = carry[i];
+		mask_a = getBit32(x_mask,i) ^ partyParity(&prev_carry);
+		mask_b = getBit32(y_mask,i) ^ partyParity(&prev_carry);
 
-		aANDb = aux_bit_AND(mask_a,mask_b,randomness,randCount);
-		aANDb ^= prev_carry;
-		{
-			for (int j = (NUM_PARTIES-1); j >= 0; j--)
-			{
-				setBit32(&carry[j],i-1,(aANDb & 0x01));
-				aANDb>>=1;
-			}
-		}
+		aux_bit_AND(mask_a,mask_b,tape,randCount,&aANDb);
+		carry[i-1] = aANDb ^ prev_carry;
 	}
+	unsliceWords(carry,carryWords);
 
 	for (int i=0;i<NUM_PARTIES;i++)
-		z[i] = x[i]^y[i]^carry[i];
+		z[i] = x[i]^y[i]^carryWords[i];
 
 
 }
 
-void aux_MAJ(uint32_t a[NUM_PARTIES], uint32_t b[NUM_PARTIES], uint32_t c[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount) {
+void aux_MAJ(uint32_t a[NUM_PARTIES], uint32_t b[NUM_PARTIES], uint32_t c[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount) {
 	uint32_t t0[NUM_PARTIES];
 	uint32_t t1[NUM_PARTIES];
 
 	mpc_XOR(a, b, t0);
 	mpc_XOR(a, c, t1);
-	aux_AND(t0, t1, z, randomness, randCount);
+	aux_AND(t0, t1, z, tape, randCount);
 	mpc_XOR(z, a, z);
 }
 
 
-void aux_CH(uint32_t e[NUM_PARTIES], uint32_t f[NUM_PARTIES], uint32_t g[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount) {
+void aux_CH(uint32_t e[NUM_PARTIES], uint32_t f[NUM_PARTIES], uint32_t g[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount) {
 	uint32_t t0[NUM_PARTIES]; 
 
 	//e & (f^g) ^ g
 	mpc_XOR(f,g,t0);
-	aux_AND(e,t0,t0, randomness, randCount);
+	aux_AND(e,t0,t0, tape, randCount);
 	mpc_XOR(t0,g,z);
 
 }
 
 
-int computeAuxTape(unsigned char randomness[NUM_PARTIES][rSize],unsigned char shares[NUM_PARTIES][SHA256_INPUTS])
+// Writes the aux bits into the last party's bits of the sliced tape
+int computeAuxTape(partyWord tape[tSize],unsigned char shares[NUM_PARTIES][SHA256_INPUTS])
 {
 	int randCount = 0;
 
@@ -573,9 +683,9 @@ int computeAuxTape(unsigned char randomness[NUM_PARTIES][rSize],unsigned char sh
 		mpc_RIGHTSHIFT(w[j-2], 10, t1);
 		mpc_XOR(t0, t1, s1);
 		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
-		aux_ADD(w[j-16], s0, t1, randomness, &randCount);
-		aux_ADD(w[j-7], t1, t1, randomness, &randCount);
-		aux_ADD(t1, s1, w[j], randomness, &randCount);
+		aux_ADD(w[j-16], s0, t1, tape, &randCount);
+		aux_ADD(w[j-7], t1, t1, tape, &randCount);
+		aux_ADD(t1, s1, w[j], tape, &randCount);
 
 	}
 
@@ -616,19 +726,19 @@ int computeAuxTape(unsigned char randomness[NUM_PARTIES][rSize],unsigned char sh
 
 		//t0 = h + s1
 
-		aux_ADD(h, s1, t0, randomness, &randCount);
+		aux_ADD(h, s1, t0, tape, &randCount);
 
 
-		aux_CH(e, f, g, t1, randomness, &randCount);
+		aux_CH(e, f, g, t1, tape, &randCount);
 
 		//t1 = t0 + t1 (h+s1+ch)
-		aux_ADD(t0, t1, t1, randomness, &randCount);
+		aux_ADD(t0, t1, t1, tape, &randCount);
 
 		for (int j = 0; j < NUM_PARTIES; j++)
 			temp3[j] = k[i];	
-		aux_ADD(t1, temp3, t1, randomness, &randCount);
+		aux_ADD(t1, temp3, t1, tape, &randCount);
 
-		aux_ADD(t1, w[i], temp1, randomness, &randCount);
+		aux_ADD(t1, w[i], temp1, tape, &randCount);
 
 		//s0 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22);
 		mpc_RIGHTROTATE(a, 2, t0);
@@ -638,22 +748,22 @@ int computeAuxTape(unsigned char randomness[NUM_PARTIES][rSize],unsigned char sh
 		mpc_XOR(t0, t1, s0);
 
 
-		aux_MAJ(a, b, c, maj, randomness, &randCount);
+		aux_MAJ(a, b, c, maj, tape, &randCount);
 
 		//temp2 = s0+maj;
-		aux_ADD(s0, maj, temp2, randomness, &randCount);
+		aux_ADD(s0, maj, temp2, tape, &randCount);
 
 		memcpy(h, g, sizeof(uint32_t) * NUM_PARTIES);
 		memcpy(g, f, sizeof(uint32_t) * NUM_PARTIES);
 		memcpy(f, e, sizeof(uint32_t) * NUM_PARTIES);
 		//e = d+temp1;
-		aux_ADD(d, temp1, e, randomness, &randCount);
+		aux_ADD(d, temp1, e, tape, &randCount);
 		memcpy(d, c, sizeof(uint32_t) * NUM_PARTIES);
 		memcpy(c, b, sizeof(uint32_t) * NUM_PARTIES);
 		memcpy(b, a, sizeof(uint32_t) * NUM_PARTIES);
 		//a = temp1+temp2;
 
-		aux_ADD(temp1, temp2, a, randomness, &randCount);
+		aux_ADD(temp1, temp2, a, tape, &randCount);
 	}
 	uint32_t hHa[8][NUM_PARTIES];
 	for (int i = 0;i < 8;i++)
@@ -661,14 +771,14 @@ int computeAuxTape(unsigned char randomness[NUM_PARTIES][rSize],unsigned char sh
 		for (int j = 0;j < NUM_PARTIES;j++)
 			hHa[i][j] = hA[i];
 	}
-	aux_ADD(hHa[0], a, hHa[0], randomness, &randCount);
-	aux_ADD(hHa[1], b, hHa[1], randomness, &randCount);
-	aux_ADD(hHa[2], c, hHa[2], randomness, &randCount);
-	aux_ADD(hHa[3], d, hHa[3], randomness, &randCount);
-	aux_ADD(hHa[4], e, hHa[4], randomness, &randCount);
-	aux_ADD(hHa[5], f, hHa[5], randomness, &randCount);
-	aux_ADD(hHa[6], g, hHa[6], randomness, &randCount);
-	aux_ADD(hHa[7], h, hHa[7], randomness, &randCount);
+	aux_ADD(hHa[0], a, hHa[0], tape, &randCount);
+	aux_ADD(hHa[1], b, hHa[1], tape, &randCount);
+	aux_ADD(hHa[2], c, hHa[2], tape, &randCount);
+	aux_ADD(hHa[3], d, hHa[3], tape, &randCount);
+	aux_ADD(hHa[4], e, hHa[4], tape, &randCount);
+	aux_ADD(hHa[5], f, hHa[5], tape, &randCount);
+	aux_ADD(hHa[6], g, hHa[6], tape, &randCount);
+	aux_ADD(hHa[7], h, hHa[7], tape, &randCount);
 
 //	printf("computeAuxTape: randCount %d\n",randCount);
 	return 0;
@@ -687,91 +797,90 @@ void printbits(uint32_t n) {
 
 }
 
-int mpc_AND_verify(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) 
+int mpc_AND_verify(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) 
 {
 	uint8_t a, b;
-	uint32_t mask_a, mask_b;
-	uint32_t aANDb, and_helper;
-	uint32_t s_shares;
-
+	partyWord aANDb, and_helper;
+	partyWord s_shares;
+	partyWord xt[32], yt[32], zt[32], st[32];
+	uint32_t viewWords[NUM_PARTIES];
+	uint32_t unopenView = views[unopenParty].y[*countY];
+
+	sliceWords(x,xt);
+	sliceWords(y,yt);
 	for (int i=0;i < 32;i++)
 	{
-		aANDb = tapesToWord(randomness,randCount);
-		and_helper = tapesToWord(randomness,randCount);
+		aANDb = *tapesToWord(tape,randCount);
+		and_helper = *tapesToWord(tape,randCount);
 		a = getBit32(x_state,i);
 		b = getBit32(y_state,i);
-		mask_a = getBitFromWordArray(x,NUM_PARTIES,i);
-		mask_b = getBitFromWordArray(y,NUM_PARTIES,i);
 
+		s_shares = (extend(a) & yt[i]) ^ (extend(b) & xt[i]) ^ and_helper ^ aANDb;
+		setPartyBit(&s_shares,unopenParty,getBit32(unopenView,i));
 
-		s_shares = (extend(a) & mask_b) ^ (extend(b) & mask_a) ^ and_helper ^ aANDb;
-		setBit32(&s_shares,unopenParty,getBit32(views[unopenParty].y[*countY],i));
-
-		for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-		{
-			setBit32(&z[j],i,aANDb & 0x01);
-			aANDb >>=1;
-		}
-		setBit32(z_state,i,parity32(s_shares)^(a&b));
-		// write s_shares to view									                 
-		for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-		{
-			setBit32(&views[j].y[*countY],i,s_shares & 0x01);
-			s_shares >>=1;
-		}
+		zt[i] = aANDb;
+		setBit32(z_state,i,partyParity(&s_shares)^(a&b));
+		st[i] = s_shares;
 	}
+	unsliceWords(zt,z);
+	// write s_shares to view
+	unsliceWords(st,viewWords);
+	for (int j = 0; j < NUM_PARTIES; j++)
+		views[j].y[*countY] = viewWords[j];
 
 	*countY+=1;
 	return 0;
 }
 
-void mpc_AND(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY) 
+void mpc_AND(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY) 
 {
 	uint8_t a, b;
-	uint32_t mask_a, mask_b;
-	uint32_t aANDb, and_helper;
-	uint32_t s_shares;
+	partyWord aANDb, and_helper;
+	partyWord s_shares;
+	partyWord xt[32], yt[32], zt[32], st[32];
+	uint32_t viewWords[NUM_PARTIES];
 
+	sliceWords(x,xt);
+	sliceWords(y,yt);
 	for (int i=0;i < 32;i++)
 	{
-		aANDb = tapesToWord(randomness,randCount);
-		and_helper = tapesToWord(randomness,randCount);
+		aANDb = *tapesToWord(tape,randCount);
+		and_helper = *tapesToWord(tape,randCount);
 		a = getBit32(x_state,i);
 		b = getBit32(y_state,i);
-		mask_a = getBitFromWordArray(x,NUM_PARTIES,i);
-		mask_b = getBitFromWordArray(y,NUM_PARTIES,i);
-
 
-		s_shares = (extend(a) & mask_b) ^ (extend(b) & mask_a) ^ and_helper ^ aANDb;
-		for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-		{
-			setBit32(&z[j],i,aANDb & 0x01);
-			aANDb >>=1;
-		}
-		setBit32(z_state,i,parity32(s_shares)^(a&b));
-		// write s_shares to view									                 
-		for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-		{
-			setBit32(&views[j].y[*countY],i,s_shares & 0x01);
-			s_shares >>=1;
-		}
+		s_shares = (extend(a) & yt[i]) ^ (extend(b) & xt[i]) ^ and_helper ^ aANDb;
+		zt[i] = aANDb;
+		setBit32(z_state,i,partyParity(&s_shares)^(a&b));
+		st[i] = s_shares;
 	}
+	unsliceWords(zt,z);
+	// write s_shares to view
+	unsliceWords(st,viewWords);
+	for (int j = 0; j < NUM_PARTIES; j++)
+		views[j].y[*countY] = viewWords[j];
 
 	*countY+=1;
 }
 
-int mpc_ADD_verify(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) {
+int mpc_ADD_verify(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) {
 
 // sum = x^y^c
 // carry = ((x^c)&(y^c))^c
 //
-	uint32_t aANDb, and_helper;
-	uint32_t mask_a, mask_b, mask_c = 0;
-	uint32_t carry[NUM_PARTIES] = {0};
+	partyWord aANDb, and_helper;
+	partyWord mask_a, mask_b, mask_c;
+	partyWord carry[32]; // sliced, carry[i] is the carry into bit i
+	partyWord xt[32], yt[32], st[32];
+	uint32_t carryWords[NUM_PARTIES], viewWords[NUM_PARTIES];
 	uint8_t a, b, c = 0;
-	uint32_t s_shares;
-	uint32_t val;
+	partyWord s_shares;
+	uint32_t unopenView = views[unopenParty].y[*countY];
 
+	memset(carry,0,sizeof(carry));
+	memset(st,0,sizeof(st));
+	sliceWords(x,xt);
+	sliceWords(y,yt);
 	*z_state = 0;
 	for (int i=31; i>=0; i--)
 	{
@@ -780,45 +889,48 @@ int mpc_ADD_verify(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint3
 		setBit32(z_state,i,a^b^c);
 		if (i>0)
 		{
-			mask_c = getBitFromWordArray(carry,NUM_PARTIES,i);
-			mask_a = getBitFromWordArray(x,NUM_PARTIES,i) ^ mask_c;
-			mask_b = getBitFromWordArray(y,NUM_PARTIES,i) ^ mask_c;
+			mask_c = carry[i];
+			mask_a = xt[i] ^ mask_c;
+			mask_b = yt[i] ^ mask_c;
 
-			aANDb = tapesToWord(randomness,randCount);
-			and_helper = tapesToWord(randomness,randCount);
+			aANDb = *tapesToWord(tape,randCount);
+			and_helper = *tapesToWord(tape,randCount);
 			s_shares = (extend(a) & mask_b) ^ (extend(b) & mask_a) ^ and_helper ^ aANDb;
-			setBit32(&s_shares,unopenParty,getBit32(views[unopenParty].y[*countY],i));
-			c = parity32(s_shares)^(a&b)^c;
-			aANDb ^= mask_c;
-
-			for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-			{
-				setBit32(&views[j].y[*countY],i,s_shares & 0x01);
-				s_shares >>=1;
-				setBit32(&carry[j],i-1,aANDb & 0x01);
-				aANDb >>=1;
-			}
+			setPartyBit(&s_shares,unopenParty,getBit32(unopenView,i));
+			c = partyParity(&s_shares)^(a&b)^c;
+			st[i] = s_shares;
+			carry[i-1] = aANDb ^ mask_c;
 		}
 	}
+	unsliceWords(carry,carryWords);
+	// bit 0 has no carry out, the view keeps what it held there
+	unsliceWords(st,viewWords);
+	for (int j = 0; j < NUM_PARTIES; j++)
+		views[j].y[*countY] = (views[j].y[*countY] & 0x80000000) | (viewWords[j] & 0x7FFFFFFF);
 	*countY+= 1;
 	for (int i=0;i<NUM_PARTIES;i++)
-		z[i] = x[i]^y[i]^carry[i];
+		z[i] = x[i]^y[i]^carryWords[i];
 
 	return 0;
 }
 
-void mpc_ADD(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY) {
+void mpc_ADD(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[NUM_PARTIES], uint32_t y[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY) {
 
 // sum = x^y^c
 // carry = ((x^c)&(y^c))^c
 //
-	uint32_t aANDb, and_helper;
-	uint32_t mask_a, mask_b, mask_c = 0;
-	uint32_t carry[NUM_PARTIES] = {0};
+	partyWord aANDb, and_helper;
+	partyWord mask_a, mask_b, mask_c;
+	partyWord carry[32]; // sliced, carry[i] is the carry into bit i
+	partyWord xt[32], yt[32], st[32];
+	uint32_t carryWords[NUM_PARTIES], viewWords[NUM_PARTIES];
 	uint8_t a, b, c = 0;
-	uint32_t s_shares;
-	uint32_t val;
+	partyWord s_shares;
 
+	memset(carry,0,sizeof(carry));
+	memset(st,0,sizeof(st));
+	sliceWords(x,xt);
+	sliceWords(y,yt);
 	*z_state = 0;
 	for (int i=31; i>=0; i--)
 	{
@@ -827,34 +939,32 @@ void mpc_ADD(uint32_t x_state, uint32_t y_state, uint32_t * z_state, uint32_t x[
 		setBit32(z_state,i,a^b^c);
 		if (i>0)
 		{
-			mask_c = getBitFromWordArray(carry,NUM_PARTIES,i);
-			mask_a = getBitFromWordArray(x,NUM_PARTIES,i) ^ mask_c;
-			mask_b = getBitFromWordArray(y,NUM_PARTIES,i) ^ mask_c;
+			mask_c = carry[i];
+			mask_a = xt[i] ^ mask_c;
+			mask_b = yt[i] ^ mask_c;
 
-			aANDb = tapesToWord(randomness,randCount);
-			and_helper = tapesToWord(randomness,randCount);
+			aANDb = *tapesToWord(tape,randCount);
+			and_helper = *tapesToWord(tape,randCount);
 			s_shares = (extend(a) & mask_b) ^ (extend(b) & mask_a) ^ and_helper ^ aANDb;
-			c = parity32(s_shares)^(a&b)^c;
-			aANDb ^= mask_c;
-
-			for (int j = (NUM_PARTIES-1); j >= 0 ; j--)
-			{
-				setBit32(&views[j].y[*countY],i,s_shares & 0x01);
-				s_shares >>=1;
-				setBit32(&carry[j],i-1,aANDb & 0x01);
-				aANDb >>=1;
-			}
+			c = partyParity(&s_shares)^(a&b)^c;
+			st[i] = s_shares;
+			carry[i-1] = aANDb ^ mask_c;
 		}
 	}
+	unsliceWords(carry,carryWords);
+	// bit 0 has no carry out, the view keeps what it held there
+	unsliceWords(st,viewWords);
+	for (int j = 0; j < NUM_PARTIES; j++)
+		views[j].y[*countY] = (views[j].y[*countY] & 0x80000000) | (viewWords[j] & 0x7FFFFFFF);
 	*countY+= 1;
 	for (int i=0;i<NUM_PARTIES;i++)
-		z[i] = x[i]^y[i]^carry[i];
+		z[i] = x[i]^y[i]^carryWords[i];
 
 }
 
 
 
-int mpc_MAJ_verify(uint32_t a_state, uint32_t b_state, uint32_t c_state, uint32_t * z_state, uint32_t a[NUM_PARTIES], uint32_t b[NUM_PARTIES], uint32_t c[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) {
+int mpc_MAJ_verify(uint32_t a_state, uint32_t b_state, uint32_t c_state, uint32_t * z_state, uint32_t a[NUM_PARTIES], uint32_t b[NUM_PARTIES], uint32_t c[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) {
 	uint32_t t0[NUM_PARTIES];
 	uint32_t t1[NUM_PARTIES];
 	uint32_t t0_state, t1_state;
@@ -865,14 +975,14 @@ int mpc_MAJ_verify(uint32_t a_state, uint32_t b_state, uint32_t c_state, uint32_
 	mpc_XOR(a, c, t1);
 	t1_state = a_state ^ c_state;
 
-	if (mpc_AND_verify(t0_state, t1_state, z_state, t0, t1, z, randomness, randCount, views, countY, unopenParty))
+	if (mpc_AND_verify(t0_state, t1_state, z_state, t0, t1, z, tape, randCount, views, countY, unopenParty))
 		return -1;
 	mpc_XOR(z, a, z);
 	*z_state = a_state ^ (*z_state);
 	return 0;
 }
 
-void mpc_MAJ(uint32_t a_state, uint32_t b_state, uint32_t c_state, uint32_t * z_state, uint32_t a[NUM_PARTIES], uint32_t b[NUM_PARTIES], uint32_t c[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY) {
+void mpc_MAJ(uint32_t a_state, uint32_t b_state, uint32_t c_state, uint32_t * z_state, uint32_t a[NUM_PARTIES], uint32_t b[NUM_PARTIES], uint32_t c[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY) {
 	uint32_t t0[NUM_PARTIES];
 	uint32_t t1[NUM_PARTIES];
 	uint32_t t0_state, t1_state;
@@ -883,13 +993,13 @@ void mpc_MAJ(uint32_t a_state, uint32_t b_state, uint32_t c_state, uint32_t * z_
 	mpc_XOR(a, c, t1);
 	t1_state = a_state ^ c_state;
 
-	mpc_AND(t0_state, t1_state, z_state, t0, t1, z, randomness, randCount, views, countY);
+	mpc_AND(t0_state, t1_state, z_state, t0, t1, z, tape, randCount, views, countY);
 	mpc_XOR(z, a, z);
 	*z_state = a_state ^ (*z_state);
 }
 
 
-int mpc_CH_verify(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t *z_state, uint32_t e[NUM_PARTIES], uint32_t f[NUM_PARTIES], uint32_t g[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) {
+int mpc_CH_verify(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t *z_state, uint32_t e[NUM_PARTIES], uint32_t f[NUM_PARTIES], uint32_t g[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY, int unopenParty) {
 	uint32_t t0[NUM_PARTIES];
 	uint32_t t0_state;
 
@@ -897,7 +1007,7 @@ int mpc_CH_verify(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t
 	mpc_XOR(f,g,t0);
 	t0_state = f_state ^ g_state;
 
-	if (mpc_AND_verify(e_state, t0_state, &t0_state, e,t0,t0, randomness, randCount, views, countY, unopenParty))
+	if (mpc_AND_verify(e_state, t0_state, &t0_state, e,t0,t0, tape, randCount, views, countY, unopenParty))
 		return -1;
 	mpc_XOR(t0,g,z);
 	*z_state = t0_state ^ g_state;
@@ -905,7 +1015,7 @@ int mpc_CH_verify(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t
 	return 0;
 }
 
-void mpc_CH(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t *z_state, uint32_t e[NUM_PARTIES], uint32_t f[NUM_PARTIES], uint32_t g[NUM_PARTIES], uint32_t z[NUM_PARTIES], unsigned char randomness[NUM_PARTIES][rSize], int* randCount, View views[NUM_PARTIES], int* countY) {
+void mpc_CH(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t *z_state, uint32_t e[NUM_PARTIES], uint32_t f[NUM_PARTIES], uint32_t g[NUM_PARTIES], uint32_t z[NUM_PARTIES], partyWord tape[tSize], int* randCount, View views[NUM_PARTIES], int* countY) {
 	uint32_t t0[NUM_PARTIES];
 	uint32_t t0_state;
 
@@ -913,23 +1023,15 @@ void mpc_CH(uint32_t e_state, uint32_t f_state, uint32_t g_state, uint32_t *z_st
 	mpc_XOR(f,g,t0);
 	t0_state = f_state ^ g_state;
 
-	mpc_AND(e_state, t0_state, &t0_state, e,t0,t0, randomness, randCount, views, countY);
+	mpc_AND(e_state, t0_state, &t0_state, e,t0,t0, tape, randCount, views, countY);
 	mpc_XOR(t0,g,z);
 	*z_state = t0_state ^ g_state;
 
 }
 
-static uint32_t consol(uint32_t array[NUM_PARTIES])
-{
-	uint32_t ret = 0;
-	for (int i = 0; i<NUM_PARTIES;i++)
-		ret ^= array[i];
-	return ret;
-}
-
 
 
-int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char masked_input[SHA256_INPUTS], unsigned char shares[NUM_PARTIES][SHA256_INPUTS], unsigned char * inputs, int numBytes, unsigned char randomness[NUM_PARTIES][rSize], View views[NUM_PARTIES], unsigned char party_result[NUM_PARTIES][SHA256_DIGEST_LENGTH], int* countY) 
+int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char masked_input[SHA256_INPUTS], unsigned char shares[NUM_PARTIES][SHA256_INPUTS], unsigned char * inputs, int numBytes, partyWord tape[tSize], View views[NUM_PARTIES], unsigned char party_result[NUM_PARTIES][SHA256_DIGEST_LENGTH], int* countY) 
 {
 
 	if ((inputs) && (numBytes > 55))
@@ -1007,17 +1109,17 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
 		if (inputs)
 		{
-			mpc_ADD(w_state[j-16],s0_state,&t1_state,w[j-16], s0, t1, randomness, &randCount, views, countY);
-			mpc_ADD(w_state[j-7],t1_state,&t1_state, w[j-7], t1, t1, randomness, &randCount, views, countY);
-			mpc_ADD(t1_state, s1_state, &(w_state[j]), t1, s1, w[j], randomness, &randCount, views, countY);
+			mpc_ADD(w_state[j-16],s0_state,&t1_state,w[j-16], s0, t1, tape, &randCount, views, countY);
+			mpc_ADD(w_state[j-7],t1_state,&t1_state, w[j-7], t1, t1, tape, &randCount, views, countY);
+			mpc_ADD(t1_state, s1_state, &(w_state[j]), t1, s1, w[j], tape, &randCount, views, countY);
 		}
 		else
 		{
-			if (mpc_ADD_verify(w_state[j-16],s0_state,&t1_state,w[j-16], s0, t1, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(w_state[j-16],s0_state,&t1_state,w[j-16], s0, t1, tape, &randCount, views, countY, numBytes))
 				return -1;
-			if (mpc_ADD_verify(w_state[j-7],t1_state,&t1_state, w[j-7], t1, t1, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(w_state[j-7],t1_state,&t1_state, w[j-7], t1, t1, tape, &randCount, views, countY, numBytes))
 				return -1;
-			if (mpc_ADD_verify(t1_state, s1_state, &(w_state[j]), t1, s1, w[j], randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(t1_state, s1_state, &(w_state[j]), t1, s1, w[j], tape, &randCount, views, countY, numBytes))
 				return -1;
 		}
 
@@ -1081,33 +1183,33 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 		temp3_state = k[i];
 		if (inputs)
 		{
-			mpc_ADD(h_state, s1_state, &t0_state, h, s1, t0, randomness, &randCount, views,countY);
+			mpc_ADD(h_state, s1_state, &t0_state, h, s1, t0, tape, &randCount, views,countY);
 
-			mpc_CH(e_state, f_state, g_state, &t1_state, e, f, g, t1, randomness, &randCount, views, countY);
+			mpc_CH(e_state, f_state, g_state, &t1_state, e, f, g, t1, tape, &randCount, views, countY);
 
 		//t1 = t0 + t1 (h+s1+ch)
-			mpc_ADD(t0_state, t1_state, &t1_state, t0, t1, t1, randomness, &randCount, views, countY);
+			mpc_ADD(t0_state, t1_state, &t1_state, t0, t1, t1, tape, &randCount, views, countY);
 
-			mpc_ADD(t1_state, temp3_state, &t1_state, t1,temp3, t1, randomness, &randCount, views, countY);
+			mpc_ADD(t1_state, temp3_state, &t1_state, t1,temp3, t1, tape, &randCount, views, countY);
 
-			mpc_ADD(t1_state, w_state[i], &temp1_state, t1, w[i], temp1, randomness, &randCount, views, countY);
+			mpc_ADD(t1_state, w_state[i], &temp1_state, t1, w[i], temp1, tape, &randCount, views, countY);
 		}
 		else
 		{
-			if (mpc_ADD_verify(h_state, s1_state, &t0_state, h, s1, t0, randomness, &randCount, views,countY, numBytes) )
+			if (mpc_ADD_verify(h_state, s1_state, &t0_state, h, s1, t0, tape, &randCount, views,countY, numBytes) )
 				return -1;
 
-			if (mpc_CH_verify(e_state, f_state, g_state, &t1_state, e, f, g, t1, randomness, &randCount, views, countY, numBytes))
+			if (mpc_CH_verify(e_state, f_state, g_state, &t1_state, e, f, g, t1, tape, &randCount, views, countY, numBytes))
 				return -1;
 
 		//t1 = t0 + t1 (h+s1+ch)
-			if (mpc_ADD_verify(t0_state, t1_state, &t1_state, t0, t1, t1, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(t0_state, t1_state, &t1_state, t0, t1, t1, tape, &randCount, views, countY, numBytes))
 				return -1;
 
-			if (mpc_ADD_verify(t1_state, temp3_state, &t1_state, t1,temp3, t1, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(t1_state, temp3_state, &t1_state, t1,temp3, t1, tape, &randCount, views, countY, numBytes))
 				return -1;
 
-			if (mpc_ADD_verify(t1_state, w_state[i], &temp1_state, t1, w[i], temp1, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(t1_state, w_state[i], &temp1_state, t1, w[i], temp1, tape, &randCount, views, countY, numBytes))
 				return -1;
 
 		}
@@ -1130,16 +1232,16 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 
 		if (inputs)
 		{
-			mpc_MAJ(a_state, b_state, c_state, &maj_state, a, b, c, maj, randomness, &randCount, views, countY);
+			mpc_MAJ(a_state, b_state, c_state, &maj_state, a, b, c, maj, tape, &randCount, views, countY);
 
 		//temp2 = s0+maj;
-			mpc_ADD(s0_state, maj_state, &temp2_state, s0, maj, temp2, randomness, &randCount, views, countY);
+			mpc_ADD(s0_state, maj_state, &temp2_state, s0, maj, temp2, tape, &randCount, views, countY);
 		}
 		else
 		{
-			if (mpc_MAJ_verify(a_state, b_state, c_state, &maj_state, a, b, c, maj, randomness, &randCount, views, countY, numBytes))
+			if (mpc_MAJ_verify(a_state, b_state, c_state, &maj_state, a, b, c, maj, tape, &randCount, views, countY, numBytes))
 				return -1;
-			if (mpc_ADD_verify(s0_state, maj_state, &temp2_state, s0, maj, temp2, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(s0_state, maj_state, &temp2_state, s0, maj, temp2, tape, &randCount, views, countY, numBytes))
 				return -1;
 
 		}
@@ -1153,11 +1255,11 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 		//e = d+temp1;
 		if (inputs)
 		{
-			mpc_ADD(d_state, temp1_state, &e_state, d, temp1, e, randomness, &randCount, views, countY);
+			mpc_ADD(d_state, temp1_state, &e_state, d, temp1, e, tape, &randCount, views, countY);
 		}
 		else
 		{
-			if (mpc_ADD_verify(d_state, temp1_state, &e_state, d, temp1, e, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(d_state, temp1_state, &e_state, d, temp1, e, tape, &randCount, views, countY, numBytes))
 				return -1;
 		}
 		memcpy(d,c,sizeof(uint32_t) * NUM_PARTIES);
@@ -1170,11 +1272,11 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 
 		if (inputs)
 		{
-			mpc_ADD(temp1_state, temp2_state, &a_state, temp1, temp2, a, randomness, &randCount, views, countY);
+			mpc_ADD(temp1_state, temp2_state, &a_state, temp1, temp2, a, tape, &randCount, views, countY);
 		}
 		else
 		{
-			if (mpc_ADD_verify(temp1_state, temp2_state, &a_state, temp1, temp2, a, randomness, &randCount, views, countY, numBytes))
+			if (mpc_ADD_verify(temp1_state, temp2_state, &a_state, temp1, temp2, a, tape, &randCount, views, countY, numBytes))
 				return -1;
 		}
 
@@ -1189,32 +1291,32 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 	}
 	if (inputs)
 	{
-		mpc_ADD(hHa_state[0], a_state, &hHa_state[0], hHa[0], a, hHa[0], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[1], b_state, &hHa_state[1], hHa[1], b, hHa[1], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[2], c_state, &hHa_state[2], hHa[2], c, hHa[2], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[3], d_state, &hHa_state[3], hHa[3], d, hHa[3], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[4], e_state, &hHa_state[4], hHa[4], e, hHa[4], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[5], f_state, &hHa_state[5], hHa[5], f, hHa[5], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[6], g_state, &hHa_state[6], hHa[6], g, hHa[6], randomness, &randCount, views, countY);
-		mpc_ADD(hHa_state[7], h_state, &hHa_state[7], hHa[7], h, hHa[7], randomness, &randCount, views, countY);
+		mpc_ADD(hHa_state[0], a_state, &hHa_state[0], hHa[0], a, hHa[0], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[1], b_state, &hHa_state[1], hHa[1], b, hHa[1], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[2], c_state, &hHa_state[2], hHa[2], c, hHa[2], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[3], d_state, &hHa_state[3], hHa[3], d, hHa[3], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[4], e_state, &hHa_state[4], hHa[4], e, hHa[4], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[5], f_state, &hHa_state[5], hHa[5], f, hHa[5], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[6], g_state, &hHa_state[6], hHa[6], g, hHa[6], tape, &randCount, views, countY);
+		mpc_ADD(hHa_state[7], h_state, &hHa_state[7], hHa[7], h, hHa[7], tape, &randCount, views, countY);
 	}
 	else
 	{
-		if (mpc_ADD_verify(hHa_state[0], a_state, &hHa_state[0], hHa[0], a, hHa[0], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[0], a_state, &hHa_state[0], hHa[0], a, hHa[0], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[1], b_state, &hHa_state[1], hHa[1], b, hHa[1], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[1], b_state, &hHa_state[1], hHa[1], b, hHa[1], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[2], c_state, &hHa_state[2], hHa[2], c, hHa[2], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[2], c_state, &hHa_state[2], hHa[2], c, hHa[2], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[3], d_state, &hHa_state[3], hHa[3], d, hHa[3], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[3], d_state, &hHa_state[3], hHa[3], d, hHa[3], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[4], e_state, &hHa_state[4], hHa[4], e, hHa[4], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[4], e_state, &hHa_state[4], hHa[4], e, hHa[4], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[5], f_state, &hHa_state[5], hHa[5], f, hHa[5], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[5], f_state, &hHa_state[5], hHa[5], f, hHa[5], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[6], g_state, &hHa_state[6], hHa[6], g, hHa[6], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[6], g_state, &hHa_state[6], hHa[6], g, hHa[6], tape, &randCount, views, countY, numBytes))
 			return -1;
-		if (mpc_ADD_verify(hHa_state[7], h_state, &hHa_state[7], hHa[7], h, hHa[7], randomness, &randCount, views, countY, numBytes))
+		if (mpc_ADD_verify(hHa_state[7], h_state, &hHa_state[7], hHa[7], h, hHa[7], tape, &randCount, views, countY, numBytes))
 			return -1;
 	}
 
@@ -1265,6 +1367,125 @@ int mpc_sha256(unsigned char masked_result[SHA256_DIGEST_LENGTH], unsigned char
 	return 0;
 }
 
+/*
+ * The working set of one round: its party keys, commitment randomness, input
+ * shares, tapes and views, from one arena. The tapes are only held bit
+ * sliced; they are expanded a lane of 32 parties at a time into a scratch of
+ * 32 tapes that stays in cache while it is sliced. Each thread takes one set
+ * and reuses it for every round it runs, so memory grows with the threads
+ * rather than with NUM_ROUNDS.
+ */
+typedef struct {
+	arena ar;
+	unsigned char (*keys)[16];
+	unsigned char (*rs)[4];
+	unsigned char (*shares)[SHA256_INPUTS];
+	unsigned char (*lane)[rSize];
+	unsigned char * auxTape; // the last party's tape after computeAuxTape()
+	partyWord * tape;
+	View * views;
+} roundSet;
+
+int initRoundSet(roundSet * ws)
+{
+	if (arena_init(&ws->ar, ARENA_BYTES(NUM_PARTIES * 16) + ARENA_BYTES(NUM_PARTIES * 4)
+			+ ARENA_BYTES(NUM_PARTIES * SHA256_INPUTS) + ARENA_BYTES(32 * rSize) + ARENA_BYTES(rSize)
+			+ ARENA_BYTES(tSize * sizeof(partyWord)) + ARENA_BYTES(NUM_PARTIES * sizeof(View))) != 0)
+	{
+		printf("Unable to allocate a round of %d parties\n", NUM_PARTIES);
+		return -1;
+	}
+	ws->keys = arena_alloc(&ws->ar, NUM_PARTIES * 16);
+	ws->rs = arena_alloc(&ws->ar, NUM_PARTIES * 4);
+	ws->shares = arena_alloc(&ws->ar, NUM_PARTIES * SHA256_INPUTS);
+	ws->lane = arena_alloc(&ws->ar, 32 * rSize);
+	ws->auxTape = arena_alloc(&ws->ar, rSize);
+	ws->tape = arena_alloc(&ws->ar, tSize * sizeof(partyWord));
+	ws->views = arena_alloc(&ws->ar, NUM_PARTIES * sizeof(View));
+	return 0;
+}
+
+void freeRoundSet(roundSet * ws)
+{
+	arena_free(&ws->ar);
+}
+
+/*
+ * Expands the party keys into the sliced tape. The tape of hiddenParty (-1
+ * for none) is left zero, and aux, when given, is the last party's tape in
+ * place of its key's.
+ */
+void roundTapes(roundSet * ws, int hiddenParty, const unsigned char * aux)
+{
+	for (int l = 0; l < PARTY_LANES; l++)
+	{
+		for (int i = 0; i < 32; i++)
+		{
+			int j = 32 * l + i;
+			if (j == hiddenParty)
+				memset(ws->lane[i], 0, rSize);
+			else if ((j == NUM_PARTIES - 1) && aux)
+				memcpy(ws->lane[i], aux, rSize);
+			else
+			{
+				getAllRandomness(ws->keys[j], ws->lane[i]);
+				stats_add(STATS_TAPE_BYTES, rSize);
+			}
+		}
+		sliceLane(ws->lane, l, ws->tape);
+	}
+}
+
+// Commitment of one party in ctx: its key, the aux tape for the last party, and its rs
+void partyDigest(EVP_MD_CTX * ctx, roundSet * ws, int party, const unsigned char aux[rSize], unsigned char com[SHA256_DIGEST_LENGTH])
+{
+	EVP_DigestInit_ex(ctx, crypto_sha256, NULL);
+	EVP_DigestUpdate(ctx, ws->keys[party], 16);
+	if (party == (NUM_PARTIES-1))
+		EVP_DigestUpdate(ctx, aux, rSize);
+	EVP_DigestUpdate(ctx, ws->rs[party], 4);
+	EVP_DigestFinal_ex(ctx, com, NULL);
+}
+
+void partyCommit(roundSet * ws, int party, const unsigned char aux[rSize], unsigned char com[SHA256_DIGEST_LENGTH])
+{
+	partyDigest(crypto_digest(crypto_sha256), ws, party, aux, com);
+}
+
+// The round's H1 digest over every party's commitment, com standing in for hiddenParty's (-1 for none)
+void roundCommit(roundSet * ws, const unsigned char aux[rSize], int hiddenParty, const unsigned char * com, unsigned char digest[SHA256_DIGEST_LENGTH])
+{
+	EVP_MD_CTX ** ctx = crypto_digests(crypto_sha256, 2);
+	unsigned char partyCom[SHA256_DIGEST_LENGTH];
+
+	for (int j = 0; j < NUM_PARTIES; j++)
+	{
+		if (j == hiddenParty)
+			EVP_DigestUpdate(ctx[0], com, SHA256_DIGEST_LENGTH);
+		else
+		{
+			partyDigest(ctx[1], ws, j, aux, partyCom);
+			EVP_DigestUpdate(ctx[0], partyCom, SHA256_DIGEST_LENGTH);
+		}
+	}
+	EVP_DigestFinal_ex(ctx[0], digest, NULL);
+	stats_add(STATS_HASH_BYTES, NUM_PARTIES * (16 + 4 + SHA256_DIGEST_LENGTH) + rSize);
+}
+
+// The round's H2 digest over the masked input and result, the views and rs
+void roundViewsDigest(roundSet * ws, const View views[NUM_PARTIES], const unsigned char maskedInput[SHA256_INPUTS], const unsigned char maskedResult[SHA256_DIGEST_LENGTH], unsigned char digest[SHA256_DIGEST_LENGTH])
+{
+	EVP_MD_CTX * ctx = crypto_digest(crypto_sha256);
+
+	EVP_DigestUpdate(ctx, maskedInput, SHA256_INPUTS);
+	EVP_DigestUpdate(ctx, maskedResult, SHA256_DIGEST_LENGTH);
+	for (int j = 0; j < NUM_PARTIES; j++)
+		EVP_DigestUpdate(ctx, views[j].y, ySize*4);
+	EVP_DigestUpdate(ctx, ws->rs, NUM_PARTIES*4);
+	EVP_DigestFinal_ex(ctx, digest, NULL);
+	stats_add(STATS_HASH_BYTES, SHA256_INPUTS + SHA256_DIGEST_LENGTH + NUM_PARTIES * (ySize * 4 + 4));
+}
+
 void printdigest(unsigned char * digest)
 {
 	for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
@@ -15,16 +15,15 @@
 #include <string.h>
 #include <time.h>
 #include "shared.h"
+#include "../common/arena.h"
+#include "../common/cli.h"
+#include "../common/seed.h"
 #include "omp.h"
 
 
 #define CH(e,f,g) ((e & f) ^ ((~e) & g))
 
 
-int totalRandom = 0;
-int totalSha = 0;
-int totalSS = 0;
-int totalHash = 0;
 int NUM_ROUNDS = 136;
 
 
@@ -50,130 +49,6 @@ void printbits(uint32_t n) {
 
 
 
-void mpc_XOR(uint32_t x[3], uint32_t y[3], uint32_t z[3]) {
-	z[0] = x[0] ^ y[0];
-	z[1] = x[1] ^ y[1];
-	z[2] = x[2] ^ y[2];
-}
-
-
-
-void mpc_AND(uint32_t x[3], uint32_t y[3], uint32_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint32_t r[3] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount), getRandom32(randomness[2], *randCount)};
-	*randCount += 4;
-	uint32_t t[3] = { 0 };
-
-	t[0] = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	t[1] = (x[1] & y[2]) ^ (x[2] & y[1]) ^ (x[1] & y[1]) ^ r[1] ^ r[2];
-	t[2] = (x[2] & y[0]) ^ (x[0] & y[2]) ^ (x[2] & y[2]) ^ r[2] ^ r[0];
-	z[0] = t[0];
-	z[1] = t[1];
-	z[2] = t[2];
-	views[0].y[*countY] = z[0];
-	views[1].y[*countY] = z[1];
-	views[2].y[*countY] = z[2];
-	(*countY)++;
-}
-
-
-
-void mpc_NEGATE(uint32_t x[3], uint32_t z[3]) {
-	z[0] = ~x[0];
-	z[1] = ~x[1];
-	z[2] = ~x[2];
-}
-
-
-
-void mpc_ADD(uint32_t x[3], uint32_t y[3], uint32_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint32_t c[3] = { 0 };
-	uint32_t r[3] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount), getRandom32(randomness[2], *randCount)};
-	*randCount += 4;
-
-	uint8_t a[3], b[3];
-
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0]^c[0],i);
-		a[1]=GETBIT(x[1]^c[1],i);
-		a[2]=GETBIT(x[2]^c[2],i);
-
-		b[0]=GETBIT(y[0]^c[0],i);
-		b[1]=GETBIT(y[1]^c[1],i);
-		b[2]=GETBIT(y[2]^c[2],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		SETBIT(c[0],i+1, t ^ (a[0]&b[0]) ^ GETBIT(c[0],i) ^ GETBIT(r[0],i));
-
-		t = (a[1]&b[2]) ^ (a[2]&b[1]) ^ GETBIT(r[2],i);
-		SETBIT(c[1],i+1, t ^ (a[1]&b[1]) ^ GETBIT(c[1],i) ^ GETBIT(r[1],i));
-
-		t = (a[2]&b[0]) ^ (a[0]&b[2]) ^ GETBIT(r[0],i);
-		SETBIT(c[2],i+1, t ^ (a[2]&b[2]) ^ GETBIT(c[2],i) ^ GETBIT(r[2],i));
-
-
-	}
-
-	z[0]=x[0]^y[0]^c[0];
-	z[1]=x[1]^y[1]^c[1];
-	z[2]=x[2]^y[2]^c[2];
-
-
-	views[0].y[*countY] = c[0];
-	views[1].y[*countY] = c[1];
-	views[2].y[*countY] = c[2];
-	*countY += 1;
-
-
-}
-
-
-void mpc_ADDK(uint32_t x[3], uint32_t y, uint32_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint32_t c[3] = { 0 };
-	uint32_t r[3] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount), getRandom32(randomness[2], *randCount)};
-	*randCount += 4;
-
-	uint8_t a[3], b[3];
-
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0]^c[0],i);
-		a[1]=GETBIT(x[1]^c[1],i);
-		a[2]=GETBIT(x[2]^c[2],i);
-
-		b[0]=GETBIT(y^c[0],i);
-		b[1]=GETBIT(y^c[1],i);
-		b[2]=GETBIT(y^c[2],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		SETBIT(c[0],i+1, t ^ (a[0]&b[0]) ^ GETBIT(c[0],i) ^ GETBIT(r[0],i));
-
-		t = (a[1]&b[2]) ^ (a[2]&b[1]) ^ GETBIT(r[2],i);
-		SETBIT(c[1],i+1, t ^ (a[1]&b[1]) ^ GETBIT(c[1],i) ^ GETBIT(r[1],i));
-
-		t = (a[2]&b[0]) ^ (a[0]&b[2]) ^ GETBIT(r[0],i);
-		SETBIT(c[2],i+1, t ^ (a[2]&b[2]) ^ GETBIT(c[2],i) ^ GETBIT(r[2],i));
-
-
-	}
-
-	z[0]=x[0]^y^c[0];
-	z[1]=x[1]^y^c[1];
-	z[2]=x[2]^y^c[2];
-
-
-	views[0].y[*countY] = c[0];
-	views[1].y[*countY] = c[1];
-	views[2].y[*countY] = c[2];
-	*countY += 1;
-
-}
-
-
 int sha256(unsigned char* result, unsigned char* input, int numBits) {
 	uint32_t hA[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
 			0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
@@ -261,48 +136,6 @@ int sha256(unsigned char* result, unsigned char* input, int numBits) {
 	return 0;
 }
 
-void mpc_RIGHTROTATE(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = RIGHTROTATE(x[0], i);
-	z[1] = RIGHTROTATE(x[1], i);
-	z[2] = RIGHTROTATE(x[2], i);
-}
-
-
-
-
-void mpc_RIGHTSHIFT(uint32_t x[3], int i, uint32_t z[3]) {
-	z[0] = x[0] >> i;
-	z[1] = x[1] >> i;
-	z[2] = x[2] >> i;
-}
-
-
-
-
-
-void mpc_MAJ(uint32_t a[], uint32_t b[3], uint32_t c[3], uint32_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint32_t t0[3];
-	uint32_t t1[3];
-
-	mpc_XOR(a, b, t0);
-	mpc_XOR(a, c, t1);
-	mpc_AND(t0, t1, z, randomness, randCount, views, countY);
-	mpc_XOR(z, a, z);
-}
-
-
-void mpc_CH(uint32_t e[], uint32_t f[3], uint32_t g[3], uint32_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint32_t t0[3];
-
-	//e & (f^g) ^ g
-	mpc_XOR(f,g,t0);
-	mpc_AND(e,t0,t0, randomness, randCount, views, countY);
-	mpc_XOR(t0,g,z);
-
-}
-
-
-
 int mpc_sha256(unsigned char* results[3], unsigned char* inputs[3], int numBits, unsigned char *randomness[3], View views[3], int* countY) {
 
 
@@ -312,151 +145,42 @@ int mpc_sha256(unsigned char* results[3], unsigned char* inputs[3], int numBits,
 		return -1;
 	}
 
-	int* randCount = calloc(1, sizeof(int));
-
+	int randCount = 0;
 	int chars = numBits >> 3;
-	unsigned char* chunks[3];
-	uint32_t w[64][3];
+	uint32_t* w = malloc(3 * sizeof(uint32_t) * sha256Circuit.numWires);
+	uint32_t* y[3] = { views[0].y, views[1].y, views[2].y };
 
 	for (int i = 0; i < 3; i++) {
-		chunks[i] = calloc(64, 1); //512 bits
-		memcpy(chunks[i], inputs[i], chars);
-		chunks[i][chars] = 0x80;
+		unsigned char* chunk = views[i].x; //512 bits
+		memset(chunk, 0, 64);
+		memcpy(chunk, inputs[i], chars);
+		chunk[chars] = 0x80;
 		//Last 8 chars used for storing length of input without padding, in big-endian.
 		//Since we only care for one block, we are safe with just using last 9 bits and 0'ing the rest
 
 		//chunk[60] = numBits >> 24;
 		//chunk[61] = numBits >> 16;
-		chunks[i][62] = numBits >> 8;
-		chunks[i][63] = numBits;
-		memcpy(views[i].x, chunks[i], 64);
+		chunk[62] = numBits >> 8;
+		chunk[63] = numBits;
 
 		for (int j = 0; j < 16; j++) {
-			w[j][i] = (chunks[i][j * 4] << 24) | (chunks[i][j * 4 + 1] << 16)
-							| (chunks[i][j * 4 + 2] << 8) | chunks[i][j * 4 + 3];
+			w[3 * j + i] = (chunk[j * 4] << 24) | (chunk[j * 4 + 1] << 16)
+							| (chunk[j * 4 + 2] << 8) | chunk[j * 4 + 3];
 		}
-		free(chunks[i]);
-	}
-
-	uint32_t s0[3], s1[3];
-	uint32_t t0[3], t1[3];
-	for (int j = 16; j < 64; j++) {
-		//s0[i] = RIGHTROTATE(w[i][j-15],7) ^ RIGHTROTATE(w[i][j-15],18) ^ (w[i][j-15] >> 3);
-		mpc_RIGHTROTATE(w[j-15], 7, t0);
-
-		mpc_RIGHTROTATE(w[j-15], 18, t1);
-		mpc_XOR(t0, t1, t0);
-		mpc_RIGHTSHIFT(w[j-15], 3, t1);
-		mpc_XOR(t0, t1, s0);
-
-		//s1[i] = RIGHTROTATE(w[i][j-2],17) ^ RIGHTROTATE(w[i][j-2],19) ^ (w[i][j-2] >> 10);
-		mpc_RIGHTROTATE(w[j-2], 17, t0);
-		mpc_RIGHTROTATE(w[j-2], 19, t1);
-
-		mpc_XOR(t0, t1, t0);
-		mpc_RIGHTSHIFT(w[j-2], 10, t1);
-		mpc_XOR(t0, t1, s1);
-
-		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
-
-		mpc_ADD(w[j-16], s0, t1, randomness, randCount, views, countY);
-		mpc_ADD(w[j-7], t1, t1, randomness, randCount, views, countY);
-		mpc_ADD(t1, s1, w[j], randomness, randCount, views, countY);
-
-	}
-
-	uint32_t a[3] = { hA[0],hA[0],hA[0] };
-	uint32_t b[3] = { hA[1],hA[1],hA[1] };
-	uint32_t c[3] = { hA[2],hA[2],hA[2] };
-	uint32_t d[3] = { hA[3],hA[3],hA[3] };
-	uint32_t e[3] = { hA[4],hA[4],hA[4] };
-	uint32_t f[3] = { hA[5],hA[5],hA[5] };
-	uint32_t g[3] = { hA[6],hA[6],hA[6] };
-	uint32_t h[3] = { hA[7],hA[7],hA[7] };
-	uint32_t temp1[3], temp2[3], maj[3];
-	for (int i = 0; i < 64; i++) {
-		//s1 = RIGHTROTATE(e,6) ^ RIGHTROTATE(e,11) ^ RIGHTROTATE(e,25);
-		mpc_RIGHTROTATE(e, 6, t0);
-		mpc_RIGHTROTATE(e, 11, t1);
-		mpc_XOR(t0, t1, t0);
-
-		mpc_RIGHTROTATE(e, 25, t1);
-		mpc_XOR(t0, t1, s1);
-
-
-		//ch = (e & f) ^ ((~e) & g);
-		//temp1 = h + s1 + CH(e,f,g) + k[i]+w[i];
-
-		//t0 = h + s1
-
-		mpc_ADD(h, s1, t0, randomness, randCount, views, countY);
-
-
-		mpc_CH(e, f, g, t1, randomness, randCount, views, countY);
-
-		//t1 = t0 + t1 (h+s1+ch)
-		mpc_ADD(t0, t1, t1, randomness, randCount, views, countY);
-
-		mpc_ADDK(t1, k[i], t1, randomness, randCount, views, countY);
-
-		mpc_ADD(t1, w[i], temp1, randomness, randCount, views, countY);
-
-		//s0 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22);
-		mpc_RIGHTROTATE(a, 2, t0);
-		mpc_RIGHTROTATE(a, 13, t1);
-		mpc_XOR(t0, t1, t0);
-		mpc_RIGHTROTATE(a, 22, t1);
-		mpc_XOR(t0, t1, s0);
-
-
-		mpc_MAJ(a, b, c, maj, randomness, randCount, views, countY);
-
-		//temp2 = s0+maj;
-		mpc_ADD(s0, maj, temp2, randomness, randCount, views, countY);
-
-		memcpy(h, g, sizeof(uint32_t) * 3);
-		memcpy(g, f, sizeof(uint32_t) * 3);
-		memcpy(f, e, sizeof(uint32_t) * 3);
-		//e = d+temp1;
-		mpc_ADD(d, temp1, e, randomness, randCount, views, countY);
-		memcpy(d, c, sizeof(uint32_t) * 3);
-		memcpy(c, b, sizeof(uint32_t) * 3);
-		memcpy(b, a, sizeof(uint32_t) * 3);
-		//a = temp1+temp2;
-
-		mpc_ADD(temp1, temp2, a, randomness, randCount, views, countY);
 	}
 
-	uint32_t hHa[8][3] = { { hA[0],hA[0],hA[0]  }, { hA[1],hA[1],hA[1] }, { hA[2],hA[2],hA[2] }, { hA[3],hA[3],hA[3] },
-			{ hA[4],hA[4],hA[4] }, { hA[5],hA[5],hA[5] }, { hA[6],hA[6],hA[6] }, { hA[7],hA[7],hA[7] } };
-	mpc_ADD(hHa[0], a, hHa[0], randomness, randCount, views, countY);
-	mpc_ADD(hHa[1], b, hHa[1], randomness, randCount, views, countY);
-	mpc_ADD(hHa[2], c, hHa[2], randomness, randCount, views, countY);
-	mpc_ADD(hHa[3], d, hHa[3], randomness, randCount, views, countY);
-	mpc_ADD(hHa[4], e, hHa[4], randomness, randCount, views, countY);
-	mpc_ADD(hHa[5], f, hHa[5], randomness, randCount, views, countY);
-	mpc_ADD(hHa[6], g, hHa[6], randomness, randCount, views, countY);
-	mpc_ADD(hHa[7], h, hHa[7], randomness, randCount, views, countY);
+	circ_prove(&sha256Circuit, w, randomness, &randCount, y, countY);
 
 	for (int i = 0; i < 8; i++) {
-		mpc_RIGHTSHIFT(hHa[i], 24, t0);
-		results[0][i * 4] = t0[0];
-		results[1][i * 4] = t0[1];
-		results[2][i * 4] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 16, t0);
-		results[0][i * 4 + 1] = t0[0];
-		results[1][i * 4 + 1] = t0[1];
-		results[2][i * 4 + 1] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 8, t0);
-		results[0][i * 4 + 2] = t0[0];
-		results[1][i * 4 + 2] = t0[1];
-		results[2][i * 4 + 2] = t0[2];
-
-		results[0][i * 4 + 3] = hHa[i][0];
-		results[1][i * 4 + 3] = hHa[i][1];
-		results[2][i * 4 + 3] = hHa[i][2];
-	}
-	free(randCount);
+		for (int j = 0; j < 3; j++) {
+			uint32_t h = w[3 * sha256Circuit.outputs[i] + j];
+			results[j][i * 4] = h >> 24;
+			results[j][i * 4 + 1] = h >> 16;
+			results[j][i * 4 + 2] = h >> 8;
+			results[j][i * 4 + 3] = h;
+		}
+	}
+	free(w);
 
 	return 0;
 }
@@ -479,10 +203,10 @@ int writeToFile(char filename[], void* data, int size, int numItems) {
 
 
 int secretShare(unsigned char* input, int numBytes, unsigned char output[3][numBytes]) {
-	if(RAND_bytes(output[0], numBytes) != 1) {
+	if(seed_bytes(output[0], numBytes) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
 	}
-	if(RAND_bytes(output[1], numBytes) != 1) {
+	if(seed_bytes(output[1], numBytes) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
 	}
 	for (int j = 0; j < numBytes; j++) {
@@ -507,6 +231,7 @@ a commit(int numBytes,unsigned char shares[3][numBytes], unsigned char *randomne
 
 	int* countY = calloc(1, sizeof(int));
 	mpc_sha256(hashes, inputs, numBytes * 8, randomness, views, countY);
+	stats_add(STATS_GATES, *countY);
 
 
 	//Explicitly add y to view
@@ -526,11 +251,11 @@ a commit(int numBytes,unsigned char shares[3][numBytes], unsigned char *randomne
 	free(hashes[2]);
 
 	uint32_t* result1 = malloc(32);
-	output(views[0], result1);
+	output(&views[0], result1);
 	uint32_t* result2 = malloc(32);
-	output(views[1], result2);
+	output(&views[1], result2);
 	uint32_t* result3 = malloc(32);
-	output(views[2], result3);
+	output(&views[2], result3);
 
 	a a;
 	memcpy(a.yp[0], result1, 32);
@@ -558,67 +283,65 @@ z prove(int e, unsigned char keys[3][16], unsigned char rs[3][4], View views[3])
 
 
 
-int main(void) {
-	setbuf(stdout, NULL);
-	srand((unsigned) time(NULL));
-	init_EVP();
-	openmp_thread_setup();
-
-	//
-	unsigned char garbage[4];
-	if(RAND_bytes(garbage, 4) != 1) {
-		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
-	}
-	
-	printf("Enter the string to be hashed (Max 55 characters): ");
-	char userInput[55]; //55 is max length as we only support 447 bits = 55.875 bytes
-	fgets(userInput, sizeof(userInput), stdin);
-	
-	int i = strlen(userInput)-1; 
-	printf("String length: %d\n", i);
-	
-	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
-
-
-
-	unsigned char input[i];
-	for(int j = 0; j<i; j++) {
-		input[j] = userInput[j];
+/*
+ * Proves one message of i bytes and writes the proof to file, as the raw a
+ * and z records or, with hexOut, as one line of hex.
+ */
+int proveInput(const unsigned char* input, int i, FILE* file, int hexOut) {
+	long totalCrypto, totalSS, totalRandom, totalSha, totalHash;
+	long inMilli, inMilliA, inMilliE, inMilliZ, inMilliWrite;
+	unsigned char (*rs)[3][4];
+	unsigned char (*keys)[3][16];
+	a* as;
+	View (*localViews)[3];
+	unsigned char (*shares)[3][i];
+	unsigned char (*randomness)[3][rSize];
+	int* es;
+	z* zs;
+
+	//All per round state of the proof lives in one arena
+	arena ar;
+	if (arena_init(&ar, ARENA_BYTES(NUM_ROUNDS * sizeof(*rs)) + ARENA_BYTES(NUM_ROUNDS * sizeof(*keys))
+			+ ARENA_BYTES(NUM_ROUNDS * sizeof(a)) + ARENA_BYTES(NUM_ROUNDS * sizeof(*localViews))
+			+ ARENA_BYTES(NUM_ROUNDS * sizeof(*shares)) + ARENA_BYTES(NUM_ROUNDS * sizeof(*randomness))
+			+ ARENA_BYTES(NUM_ROUNDS * sizeof(int)) + ARENA_BYTES(NUM_ROUNDS * sizeof(z))) != 0) {
+		printf("Unable to allocate memory for %d rounds!\n", NUM_ROUNDS);
+		return 1;
 	}
-
-	clock_t begin = clock(), delta, deltaA;
-	unsigned char rs[NUM_ROUNDS][3][4];
-	unsigned char keys[NUM_ROUNDS][3][16];
-	a as[NUM_ROUNDS];
-	View localViews[NUM_ROUNDS][3];
-	int totalCrypto = 0;
+	rs = arena_alloc(&ar, NUM_ROUNDS * sizeof(*rs));
+	keys = arena_alloc(&ar, NUM_ROUNDS * sizeof(*keys));
+	as = arena_alloc(&ar, NUM_ROUNDS * sizeof(a));
+	localViews = arena_alloc(&ar, NUM_ROUNDS * sizeof(*localViews));
+	shares = arena_alloc(&ar, NUM_ROUNDS * sizeof(*shares));
+	randomness = arena_alloc(&ar, NUM_ROUNDS * sizeof(*randomness));
+	es = arena_alloc(&ar, NUM_ROUNDS * sizeof(int));
+	zs = arena_alloc(&ar, NUM_ROUNDS * sizeof(z));
 	
 	//Generating keys
-	clock_t beginCrypto = clock(), deltaCrypto;
-	if(RAND_bytes(keys, NUM_ROUNDS*3*16) != 1) {
+	stats_reset();
+	stats_begin("keys");
+	if(seed_bytes((unsigned char *)keys, NUM_ROUNDS*3*16) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+		arena_free(&ar);
+		return 1;
 	}
-	if(RAND_bytes(rs, NUM_ROUNDS*3*4) != 1) {
+	if(seed_bytes((unsigned char *)rs, NUM_ROUNDS*3*4) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+		arena_free(&ar);
+		return 1;
 	}
-	deltaCrypto = clock() - beginCrypto;
-	int inMilliCrypto = deltaCrypto * 1000 / CLOCKS_PER_SEC;
-	totalCrypto = inMilliCrypto;
-	
+	totalCrypto = stats_end();
 
 
 
 
 
 	//Sharing secrets
-	clock_t beginSS = clock(), deltaSS;
-	unsigned char shares[NUM_ROUNDS][3][i];
-	if(RAND_bytes(shares, NUM_ROUNDS*3*i) != 1) {
+	stats_begin("sharing");
+	if(seed_bytes((unsigned char *)shares, NUM_ROUNDS*3*i) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+		arena_free(&ar);
+		return 1;
 	}
 	#pragma omp parallel for
 	for(int k=0; k<NUM_ROUNDS; k++) {
@@ -628,106 +351,79 @@ int main(void) {
 		}
 
 	}
-	deltaSS = clock() - beginSS;
-	int inMilli = deltaSS * 1000 / CLOCKS_PER_SEC;
-	totalSS = inMilli;
+	totalSS = stats_end();
 
 	//Generating randomness
-	clock_t beginRandom = clock(), deltaRandom;
-	unsigned char *randomness[NUM_ROUNDS][3];
+	stats_begin("randomness");
 	#pragma omp parallel for
 	for(int k=0; k<NUM_ROUNDS; k++) {
 		for(int j = 0; j<3; j++) {
-			randomness[k][j] = malloc(2912*sizeof(unsigned char));
 			getAllRandomness(keys[k][j], randomness[k][j]);
 		}
 	}
-
-	deltaRandom = clock() - beginRandom;
-	inMilli = deltaRandom * 1000 / CLOCKS_PER_SEC;
-	totalRandom = inMilli;
+	stats_add(STATS_TAPE_BYTES, (uint64_t)NUM_ROUNDS * 3 * rSize);
+	totalRandom = stats_end();
 
 	//Running MPC-SHA2
-	clock_t beginSha = clock(), deltaSha;
+	stats_begin("mpc");
 	#pragma omp parallel for
 	for(int k=0; k<NUM_ROUNDS; k++) {
-		as[k] = commit(i, shares[k], randomness[k], rs[k], localViews[k]);
-		for(int j=0; j<3; j++) {
-			free(randomness[k][j]);
-		}
+		unsigned char* tapes[3] = { randomness[k][0], randomness[k][1], randomness[k][2] };
+		as[k] = commit(i, shares[k], tapes, rs[k], localViews[k]);
 	}
-	deltaSha = clock() - beginSha;
-	inMilli = deltaSha * 1000 / CLOCKS_PER_SEC;
-	totalSha = inMilli;
+	totalSha = stats_end();
 	
 	//Committing
-	clock_t beginHash = clock(), deltaHash;
+	stats_begin("commit");
 	#pragma omp parallel for
-	for(int k=0; k<NUM_ROUNDS; k++) {
-		unsigned char hash1[SHA256_DIGEST_LENGTH];
-		H(keys[k][0], localViews[k][0], rs[k][0], hash1);
-		memcpy(as[k].h[0], &hash1, 32);
-		H(keys[k][1], localViews[k][1], rs[k][1], hash1);
-		memcpy(as[k].h[1], &hash1, 32);
-		H(keys[k][2], localViews[k][2], rs[k][2], hash1);
-		memcpy(as[k].h[2], hash1, 32);
-	}
-	deltaHash = clock() - beginHash;
-				inMilli = deltaHash * 1000 / CLOCKS_PER_SEC;
-				totalHash += inMilli;
-				
-	deltaA = clock() - begin;
-	int inMilliA = deltaA * 1000 / CLOCKS_PER_SEC;
+	for(int k=0; k<NUM_ROUNDS; k+=HASH_ROUNDS) {
+		int n = (NUM_ROUNDS - k < HASH_ROUNDS) ? NUM_ROUNDS - k : HASH_ROUNDS;
+		H_many(n, &keys[k], &localViews[k], &rs[k], &as[k]);
+	}
+	stats_add(STATS_HASH_BYTES, (uint64_t)NUM_ROUNDS * 3 * (16 + sizeof(View) + 4));
+	totalHash = stats_end();
+	inMilliA = stats_totalMs();
 
 	//Generating E
-	clock_t beginE = clock(), deltaE;
-	int es[NUM_ROUNDS];
+	stats_begin("challenge");
 	uint32_t finalHash[8];
 	for (int j = 0; j < 8; j++) {
 		finalHash[j] = as[0].yp[0][j]^as[0].yp[1][j]^as[0].yp[2][j];
 	}
 	H3(finalHash, as, NUM_ROUNDS, es);
-	deltaE = clock() - beginE;
-	int inMilliE = deltaE * 1000 / CLOCKS_PER_SEC;
+	stats_add(STATS_HASH_BYTES, sizeof(finalHash) + sizeof(a) * NUM_ROUNDS);
+	inMilliE = stats_end();
 
 
 	//Packing Z
-	clock_t beginZ = clock(), deltaZ;
-	z* zs = malloc(sizeof(z)*NUM_ROUNDS);
+	stats_begin("prove");
 
 	#pragma omp parallel for
 	for(int i = 0; i<NUM_ROUNDS; i++) {
 		zs[i] = prove(es[i],keys[i],rs[i], localViews[i]);
 	}
-	deltaZ = clock() - beginZ;
-	int inMilliZ = deltaZ * 1000 / CLOCKS_PER_SEC;
+	inMilliZ = stats_end();
 	
 	
 	//Writing to file
-	clock_t beginWrite = clock();
-	FILE *file;
-
-	char outputFile[3*sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "wb");
-	if (!file) {
-		printf("Unable to open file!");
-		return 1;
+	stats_begin("write");
+	if (hexOut) {
+		cli_hexWrite(file, as, sizeof(a) * NUM_ROUNDS);
+		cli_hexWrite(file, zs, sizeof(z) * NUM_ROUNDS);
+		fputc('\n', file);
+	}
+	else {
+		fwrite(as, sizeof(a), NUM_ROUNDS, file);
+		fwrite(zs, sizeof(z), NUM_ROUNDS, file);
 	}
-	fwrite(as, sizeof(a), NUM_ROUNDS, file);
-	fwrite(zs, sizeof(z), NUM_ROUNDS, file);
-
-	fclose(file);
-
-	clock_t deltaWrite = clock()-beginWrite;
-	free(zs);
-	int inMilliWrite = deltaWrite * 1000 / CLOCKS_PER_SEC;
 
+	inMilliWrite = stats_end();
+	arena_free(&ar);
 
-	delta = clock() - begin;
-	inMilli = delta * 1000 / CLOCKS_PER_SEC;
+	inMilli = stats_totalMs();
+	stats_report("MPC_SHA256", NUM_ROUNDS);
 
-	int sumOfParts = 0;
+	long sumOfParts = 0;
 
 	printf("Generating A: %ju\n", (uintmax_t)inMilliA);
 	printf("	Generating keys: %ju\n", (uintmax_t)totalCrypto);
@@ -744,13 +440,93 @@ int main(void) {
 	printf("Generating E: %ju\n", (uintmax_t)inMilliE);
 	printf("Packing Z: %ju\n", (uintmax_t)inMilliZ);
 	printf("Writing file: %ju\n", (uintmax_t)inMilliWrite);
-	printf("Total: %d\n",inMilli);
+	printf("Total: %ld\n",inMilli);
 	printf("\n");
-	printf("Proof output to file %s", outputFile);
 
+	return ferror(file) ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	char userInput[2 * 55 + 3];
+	unsigned char input[55]; //55 is max length as we only support 447 bits = 55.875 bytes
+	long i;
+
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_PROVER, &opt) != 0)
+		return 1;
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	seed_init(opt.seed);
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	srand((unsigned) time(NULL));
+	init_EVP();
+
+	unsigned char garbage[4];
+	if(seed_bytes(garbage, 4) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		return 0;
+	}
+
+	if (opt.batch) {
+		FILE* proofs = cli_batchOutput(&opt);
+		char* line = NULL;
+		size_t cap = 0;
+		long n;
+		int ret = 0;
 
+		if (!proofs) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			i = cli_message(&opt, line, n, input, sizeof(input));
+			if ((i < 0) || (proveInput(input, i, proofs, 1) != 0)) {
+				printf("Unable to prove: %s\n", line);
+				fputc('\n', proofs);
+				ret = 1;
+			}
+		}
+		free(line);
+		if (fclose(proofs) != 0)
+			ret = 1;
+		cleanup_EVP();
+		return ret;
+	}
+
+	if (opt.inputFile)
+		i = cli_readFile(&opt, opt.inputFile, input, sizeof(input));
+	else {
+		printf("Enter the string to be hashed (Max 55 characters): ");
+		if (!fgets(userInput, sizeof(userInput), stdin))
+			userInput[0] = 0;
+		i = cli_message(&opt, userInput, strcspn(userInput, "\r\n"), input, sizeof(input));
+	}
+	if (i < 0) {
+		printf("Input must be at most %d bytes!\n", (int)sizeof(input));
+		return 1;
+	}
+	printf("String length: %ld\n", i);
+	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+
+	char outputFile[FILENAME_MAX];
+	cli_proofName(opt.out, NUM_ROUNDS, outputFile, sizeof(outputFile));
+	FILE* file = fopen(outputFile, "wb");
+	if (!file) {
+		printf("Unable to open file!");
+		return 1;
+	}
+	int ret = proveInput(input, i, file, 0);
+	if ((fclose(file) != 0) || (ret != 0)) {
+		printf("Unable to write proof!\n");
+		return 1;
+	}
+	printf("Proof output to file %s", outputFile);
 
-	openmp_thread_cleanup();
 	cleanup_EVP();
 	return EXIT_SUCCESS;
 }
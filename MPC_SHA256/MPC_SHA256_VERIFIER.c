@@ -13,7 +13,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/resource.h>
 #include "shared.h"
+#include "../common/cli.h"
 
 int NUM_ROUNDS = 136;
 
@@ -27,28 +29,22 @@ void printbits(uint32_t n) {
 
 
 
-int main(void) {
-	setbuf(stdout, NULL);
-	init_EVP();
-	openmp_thread_setup();
-	
-	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
-
-	clock_t begin = clock(), delta, deltaFiles;
-	
-	a as[NUM_ROUNDS];
-	z zs[NUM_ROUNDS];
-	FILE *file;
-
-	char outputFile[3*sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "rb");
-	if (!file) {
-		printf("Unable to open file!");
+/*
+ * Checks a proof of NUM_ROUNDS a and z records. Returns 0 when every round
+ * verifies.
+ */
+int verifyProof(const unsigned char* proof, size_t proofSize) {
+	long inMilli;
+	int passed = 1;
+
+	stats_reset();
+	stats_begin("read");
+	if (proofSize != NUM_ROUNDS * (sizeof(a) + sizeof(z))) {
+		printf("Invalid proof file size\n");
+		return 1;
 	}
-	fread(&as, sizeof(a), NUM_ROUNDS, file);
-	fread(&zs, sizeof(z), NUM_ROUNDS, file);
-	fclose(file);
+	const a* as = (const a*)proof;
+	const z* zs = (const z*)(proof + NUM_ROUNDS * sizeof(a));
 
 
 	uint32_t y[8];
@@ -59,41 +55,102 @@ int main(void) {
 	}
 	printf("\n");
 
-	deltaFiles = clock() - begin;
-	int inMilliFiles = deltaFiles * 1000 / CLOCKS_PER_SEC;
-	printf("Loading files: %ju\n", (uintmax_t)inMilliFiles);
+	inMilli = stats_end();
+	printf("Loading files: %ld\n", inMilli);
 
 
-	clock_t beginE = clock(), deltaE;
+	stats_begin("challenge");
 	int es[NUM_ROUNDS];
 	H3(y, as, NUM_ROUNDS, es);
-	deltaE = clock() - beginE;
-	int inMilliE = deltaE * 1000 / CLOCKS_PER_SEC;
-	printf("Generating E: %ju\n", (uintmax_t)inMilliE);
+	stats_add(STATS_HASH_BYTES, sizeof(y) + sizeof(a) * NUM_ROUNDS);
+	inMilli = stats_end();
+	printf("Generating E: %ld\n", inMilli);
 
 
-	clock_t beginV = clock(), deltaV;
+	stats_begin("verify");
 	#pragma omp parallel for
 	for(int i = 0; i<NUM_ROUNDS; i++) {
-		int verifyResult = verify(as[i], es[i], zs[i]);
+		int verifyResult = verify(&as[i], es[i], &zs[i]);
 		if (verifyResult != 0) {
 			printf("Not Verified %d\n", i);
+			passed = 0;
 		}
 	}
-	deltaV = clock() - beginV;
-	int inMilliV = deltaV * 1000 / CLOCKS_PER_SEC;
-	printf("Verifying: %ju\n", (uintmax_t)inMilliV);
+	inMilli = stats_end();
+	printf("Verifying: %ld\n", inMilli);
 	
 	
-	delta = clock() - begin;
-	int inMilli = delta * 1000 / CLOCKS_PER_SEC;
+	inMilli = stats_totalMs();
+	stats_report("MPC_SHA256_VERIFIER", NUM_ROUNDS);
 
-	printf("Total time: %ju\n", (uintmax_t)inMilli);
-	
+	printf("Total time: %ld\n", inMilli);
+	printf("Time per round: %.2f\n", (double)inMilli / NUM_ROUNDS);
+
+	return passed ? 0 : 1;
+}
 
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	int ret = 0;
+
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_VERIFIER, &opt) != 0)
+		return 1;
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	init_EVP();
+
+	if (opt.batch) {
+		FILE* results = cli_batchOutput(&opt);
+		unsigned char* proof = NULL;
+		char* line = NULL;
+		size_t cap = 0;
+		long n;
+
+		if (!results) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			proof = realloc(proof, n / 2 + 1);
+			long proofSize = cli_hexDecode(line, n, proof, n / 2);
+			if ((proofSize >= 0) && (verifyProof(proof, proofSize) == 0))
+				fprintf(results, "Verified ok\n");
+			else {
+				fprintf(results, "Not Verified\n");
+				ret = 1;
+			}
+		}
+		free(proof);
+		free(line);
+		fclose(results);
+	}
+	else {
+		char outputFile[FILENAME_MAX];
+		size_t proofSize;
+
+		printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+		cli_proofName(opt.inputFile, NUM_ROUNDS, outputFile, sizeof(outputFile));
+		const unsigned char* proof = mapProof(outputFile, &proofSize);
+		if (!proof) {
+			printf("Unable to open file!");
+			return 1;
+		}
+		ret = verifyProof(proof, proofSize);
+		unmapProof(proof, proofSize);
+		if (ret == 0)
+			printf("Verified ok\n");
+	}
 
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("Peak RSS: %ld KB\n", usage.ru_maxrss);
 
-	openmp_thread_cleanup();
 	cleanup_EVP();
-	return EXIT_SUCCESS;
+	return ret;
 }
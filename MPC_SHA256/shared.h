@@ -17,7 +17,15 @@
 #include <openssl/applink.c>
 #endif
 #include <openssl/rand.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "omp.h"
+#include "../common/tapes.h"
+#include "../common/hashmany.h"
+#include "../common/mapproof.h"
+#include "../common/stats.h"
+#include "../common/circuit.h"
 
 #define VERBOSE FALSE
 
@@ -39,6 +47,7 @@ static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 		0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
 
 #define ySize 736
+#define rSize 2912
 
 typedef struct {
 	unsigned char x[64];
@@ -63,50 +72,109 @@ typedef struct {
 #define GETBIT(x, i) (((x) >> (i)) & 0x01)
 #define SETBIT(x, i, b)   x= (b)&1 ? (x)|(1 << (i)) : (x)&(~(1 << (i)))
 
+circuit sha256Circuit;
 
+/*
+ * SHA-256 of one block, from the 16 big endian words of the padded block to
+ * the 8 words of the hash. The gates are in the order of the original
+ * gadgets: message schedule, the 64 rounds, then the final additions.
+ */
+void sha256_circuit(circuit* c) {
+	int w[64];
+	int s0, s1, t0, t1, temp1, temp2, maj;
+	int v[8];
+
+	circ_init(c, 16);
+	for (int j = 0; j < 16; j++)
+		w[j] = j;
+	for (int j = 16; j < 64; j++) {
+		//s0 = RIGHTROTATE(w[j-15],7) ^ RIGHTROTATE(w[j-15],18) ^ (w[j-15] >> 3);
+		t0 = circ_rotr(c, w[j-15], 7);
+		t1 = circ_rotr(c, w[j-15], 18);
+		t0 = circ_xor(c, t0, t1);
+		t1 = circ_shr(c, w[j-15], 3);
+		s0 = circ_xor(c, t0, t1);
+
+		//s1 = RIGHTROTATE(w[j-2],17) ^ RIGHTROTATE(w[j-2],19) ^ (w[j-2] >> 10);
+		t0 = circ_rotr(c, w[j-2], 17);
+		t1 = circ_rotr(c, w[j-2], 19);
+		t0 = circ_xor(c, t0, t1);
+		t1 = circ_shr(c, w[j-2], 10);
+		s1 = circ_xor(c, t0, t1);
+
+		//w[j] = w[j-16]+s0+w[j-7]+s1;
+		t1 = circ_add(c, w[j-16], s0);
+		t1 = circ_add(c, w[j-7], t1);
+		w[j] = circ_add(c, t1, s1);
+	}
 
+	// a..h
+	for (int i = 0; i < 8; i++)
+		v[i] = circ_const(c, hA[i]);
+	for (int i = 0; i < 64; i++) {
+		//s1 = RIGHTROTATE(e,6) ^ RIGHTROTATE(e,11) ^ RIGHTROTATE(e,25);
+		t0 = circ_rotr(c, v[4], 6);
+		t1 = circ_rotr(c, v[4], 11);
+		t0 = circ_xor(c, t0, t1);
+		t1 = circ_rotr(c, v[4], 25);
+		s1 = circ_xor(c, t0, t1);
+
+		//temp1 = h + s1 + CH(e,f,g) + k[i]+w[i], with CH = e & (f^g) ^ g
+		t0 = circ_add(c, v[7], s1);
+		t1 = circ_xor(c, v[5], v[6]);
+		t1 = circ_and(c, v[4], t1);
+		t1 = circ_xor(c, t1, v[6]);
+		t1 = circ_add(c, t0, t1);
+		t1 = circ_addk(c, t1, k[i]);
+		temp1 = circ_add(c, t1, w[i]);
 
-void handleErrors(void)
-{
-	ERR_print_errors_fp(stderr);
-	abort();
-}
-
-
-EVP_CIPHER_CTX setupAES(unsigned char key[16]) {
-	EVP_CIPHER_CTX ctx;
-	EVP_CIPHER_CTX_init(&ctx);
-
+		//s0 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22);
+		t0 = circ_rotr(c, v[0], 2);
+		t1 = circ_rotr(c, v[0], 13);
+		t0 = circ_xor(c, t0, t1);
+		t1 = circ_rotr(c, v[0], 22);
+		s0 = circ_xor(c, t0, t1);
+
+		//maj = (a ^ b) & (a ^ c) ^ a;
+		t0 = circ_xor(c, v[0], v[1]);
+		t1 = circ_xor(c, v[0], v[2]);
+		maj = circ_and(c, t0, t1);
+		maj = circ_xor(c, maj, v[0]);
+
+		temp2 = circ_add(c, s0, maj);
+
+		v[7] = v[6];
+		v[6] = v[5];
+		v[5] = v[4];
+		v[4] = circ_add(c, v[3], temp1);
+		v[3] = v[2];
+		v[2] = v[1];
+		v[1] = v[0];
+		v[0] = circ_add(c, temp1, temp2);
+	}
 
-	/* A 128 bit IV */
-	unsigned char *iv = (unsigned char *)"01234567890123456";
+	for (int i = 0; i < 8; i++)
+		circ_output(c, circ_addk(c, v[i], hA[i]));
+}
 
-	if(1 != EVP_EncryptInit_ex(&ctx, EVP_aes_128_ctr(), NULL, key, iv))
-		handleErrors();
 
-	return ctx;
 
 
+void handleErrors(void)
+{
+	ERR_print_errors_fp(stderr);
+	abort();
 }
 
-void getAllRandomness(unsigned char key[16], unsigned char randomness[2912]) {
-	//Generate randomness: We use 728*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 728*32/128 = 182 iterations
 
-	EVP_CIPHER_CTX ctx;
-	ctx = setupAES(key);
-	unsigned char *plaintext =
-			(unsigned char *)"0000000000000000";
-	int len;
-	for(int j=0;j<182;j++) {
-		if(1 != EVP_EncryptUpdate(&ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
+#define TAPE_IV ((unsigned char *)"01234567890123456")
 
-	}
-	EVP_CIPHER_CTX_cleanup(&ctx);
+// AES-CTR keystream of the key, see common/tapes.h
+void getAllRandomness(const unsigned char key[16], unsigned char randomness[rSize]) {
+	tape_expand(key, TAPE_IV, randomness, rSize);
 }
 
-uint32_t getRandom32(unsigned char randomness[2912], int randCount) {
+uint32_t getRandom32(unsigned char randomness[rSize], int randCount) {
 	uint32_t ret;
 	memcpy(&ret, &randomness[randCount], 4);
 	return ret;
@@ -114,43 +182,65 @@ uint32_t getRandom32(unsigned char randomness[2912], int randCount) {
 
 
 void init_EVP() {
-	ERR_load_crypto_strings();
-	OpenSSL_add_all_algorithms();
-	OPENSSL_config(NULL);
+	tape_init();
+	hash_init();
+	sha256_circuit(&sha256Circuit);
 }
 
 void cleanup_EVP() {
-	EVP_cleanup();
-	ERR_free_strings();
+	circ_free(&sha256Circuit);
+	crypto_cleanup();
+}
+
+void H(const unsigned char k[16], const View* v, const unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, k, 16);
+	EVP_DigestUpdate(ctx, v, sizeof(View));
+	EVP_DigestUpdate(ctx, r, 4);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 }
 
-void H(unsigned char k[16], View v, unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, k, 16);
-	SHA256_Update(&ctx, &v, sizeof(v));
-	SHA256_Update(&ctx, r, 4);
-	SHA256_Final(hash, &ctx);
+/*
+ * H() of the three views of n rounds side by side (common/hashmany.h),
+ * as[k].h[j] gets the commitment of party j of round k.
+ */
+void H_many(int n, unsigned char keys[][3][16], View views[][3], unsigned char rs[][3][4], a* as) {
+	const void* in[3 * n];
+	unsigned char* out[3 * n];
+	hashMany h;
+
+	hash_begin(&h, crypto_sha256, 3 * n);
+	for (int i = 0; i < 3 * n; i++)
+		in[i] = keys[i / 3][i % 3];
+	hash_update(&h, in, 16);
+	for (int i = 0; i < 3 * n; i++)
+		in[i] = &views[i / 3][i % 3];
+	hash_update(&h, in, sizeof(View));
+	for (int i = 0; i < 3 * n; i++) {
+		in[i] = rs[i / 3][i % 3];
+		out[i] = as[i / 3].h[i % 3];
+	}
+	hash_update(&h, in, 4);
+	hash_final(&h, out);
 }
 
 
-void H3(uint32_t y[8], a* as, int s, int* es) {
+void H3(uint32_t y[8], const a* as, int s, int* es) {
 
 	unsigned char hash[SHA256_DIGEST_LENGTH];
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, y, 32);
-	SHA256_Update(&ctx, as, sizeof(a)*s);
-	SHA256_Final(hash, &ctx);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, y, 32);
+	EVP_DigestUpdate(ctx, as, sizeof(a)*s);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
 
 	//Pick bits from hash
 	int i = 0;
 	int bitTracker = 0;
 	while(i < s) {
 		if(bitTracker >= SHA256_DIGEST_LENGTH*8) { //Generate new hash as we have run out of bits in the previous hash
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, hash, sizeof(hash));
-			SHA256_Final(hash, &ctx);
+			ctx = crypto_digest(crypto_sha256);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
 			bitTracker = 0;
 		}
 
@@ -179,186 +269,48 @@ void H3(uint32_t y[8], a* as, int s, int* es) {
 
 }
 
-void output(View v, uint32_t* result) {
-	memcpy(result, &v.y[ySize - 8], 32);
+void output(const View* v, uint32_t* result) {
+	memcpy(result, &v->y[ySize - 8], 32);
 }
 
-void reconstruct(uint32_t* y0, uint32_t* y1, uint32_t* y2, uint32_t* result) {
+void reconstruct(const uint32_t* y0, const uint32_t* y1, const uint32_t* y2, uint32_t* result) {
 	for (int i = 0; i < 8; i++) {
 		result[i] = y0[i] ^ y1[i] ^ y2[i];
 	}
 }
 
-void mpc_XOR2(uint32_t x[2], uint32_t y[2], uint32_t z[2]) {
-	z[0] = x[0] ^ y[0];
-	z[1] = x[1] ^ y[1];
-}
-
-void mpc_NEGATE2(uint32_t x[2], uint32_t z[2]) {
-	z[0] = ~x[0];
-	z[1] = ~x[1];
-}
-
-omp_lock_t *locks;
-
-void openmp_locking_callback(int mode, int type, char *file, int line)
-{
-  if (mode & CRYPTO_LOCK)
-  {
-    omp_set_lock(&locks[type]);
-  }
-  else
-  {
-    omp_unset_lock(&locks[type]);
-  }
-}
-
-
-unsigned long openmp_thread_id(void)
-{
-  return (unsigned long)omp_get_thread_num();
-}
-
-void openmp_thread_setup(void)
-{
-  int i;
 
-  locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(omp_lock_t));
-  for (i=0; i<CRYPTO_num_locks(); i++)
-  {
-    omp_init_lock(&locks[i]);
-  }
-
-  CRYPTO_set_id_callback((unsigned long (*)())openmp_thread_id);
-  CRYPTO_set_locking_callback((void (*)())openmp_locking_callback);
-}
-
-void openmp_thread_cleanup(void)
-{
-  int i;
-
-  CRYPTO_set_id_callback(NULL);
-  CRYPTO_set_locking_callback(NULL);
-  for (i=0; i<CRYPTO_num_locks(); i++)
-    omp_destroy_lock(&locks[i]);
-  OPENSSL_free(locks);
-}
-
-
-int mpc_AND_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][2912], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint32_t t = 0;
-
-	t = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	if(ve.y[*countY] != t) {
-		return 1;
-	}
-	z[0] = t;
-	z[1] = ve1.y[*countY];
-
-	(*countY)++;
-	return 0;
-}
-
-
-int mpc_ADD_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][2912], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint8_t a[2], b[2];
-
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0]^ve.y[*countY],i);
-		a[1]=GETBIT(x[1]^ve1.y[*countY],i);
-
-		b[0]=GETBIT(y[0]^ve.y[*countY],i);
-		b[1]=GETBIT(y[1]^ve1.y[*countY],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		if(GETBIT(ve.y[*countY],i+1) != (t ^ (a[0]&b[0]) ^ GETBIT(ve.y[*countY],i) ^ GETBIT(r[0],i))) {
-			return 1;
-		}
-	}
-
-	z[0]=x[0]^y[0]^ve.y[*countY];
-	z[1]=x[1]^y[1]^ve1.y[*countY];
-	(*countY)++;
-	return 0;
-}
-
-void mpc_RIGHTROTATE2(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = RIGHTROTATE(x[0], i);
-	z[1] = RIGHTROTATE(x[1], i);
-}
-
-void mpc_RIGHTSHIFT2(uint32_t x[2], int i, uint32_t z[2]) {
-	z[0] = x[0] >> i;
-	z[1] = x[1] >> i;
-}
-
-
-int mpc_MAJ_verify(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t z[3], View ve, View ve1, unsigned char randomness[2][2912], int* randCount, int* countY) {
-	uint32_t t0[3];
-	uint32_t t1[3];
-
-	mpc_XOR2(a, b, t0);
-	mpc_XOR2(a, c, t1);
-	if(mpc_AND_verify(t0, t1, z, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
-	}
-	mpc_XOR2(z, a, z);
-	return 0;
-}
-
-int mpc_CH_verify(uint32_t e[2], uint32_t f[2], uint32_t g[2], uint32_t z[2], View ve, View ve1, unsigned char randomness[2][2912], int* randCount, int* countY) {
-
-	uint32_t t0[3];
-	mpc_XOR2(f,g,t0);
-	if(mpc_AND_verify(e, t0, t0, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
-	}
-	mpc_XOR2(t0,g,z);
-
-
-	return 0;
-}
-
-
-int verify(a a, int e, z z) {
+int verify(const a* a, int e, const z* z) {
 	unsigned char* hash = malloc(SHA256_DIGEST_LENGTH);
-	H(z.ke, z.ve, z.re, hash);
+	H(z->ke, &z->ve, z->re, hash);
 
-	if (memcmp(a.h[e], hash, 32) != 0) {
+	if (memcmp(a->h[e], hash, 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
-	H(z.ke1, z.ve1, z.re1, hash);
-	if (memcmp(a.h[(e + 1) % 3], hash, 32) != 0) {
+	H(z->ke1, &z->ve1, z->re1, hash);
+	if (memcmp(a->h[(e + 1) % 3], hash, 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 	free(hash);
+	stats_add(STATS_HASH_BYTES, 2 * (16 + sizeof(View) + 4));
 
 	uint32_t* result = malloc(32);
-	output(z.ve, result);
-	if (memcmp(a.yp[e], result, 32) != 0) {
+	output(&z->ve, result);
+	if (memcmp(a->yp[e], result, 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 
-	output(z.ve1, result);
-	if (memcmp(a.yp[(e + 1) % 3], result, 32) != 0) {
+	output(&z->ve1, result);
+	if (memcmp(a->yp[(e + 1) % 3], result, 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
@@ -367,238 +319,30 @@ int verify(a a, int e, z z) {
 
 	free(result);
 
-	unsigned char randomness[2][2912];
-	getAllRandomness(z.ke, randomness[0]);
-	getAllRandomness(z.ke1, randomness[1]);
+	unsigned char randomness[2][rSize];
+	getAllRandomness(z->ke, randomness[0]);
+	getAllRandomness(z->ke1, randomness[1]);
+	stats_add(STATS_TAPE_BYTES, 2 * rSize);
 
-	int* randCount = calloc(1, sizeof(int));
-	int* countY = calloc(1, sizeof(int));
+	const unsigned char* tapes[2] = { randomness[0], randomness[1] };
+	uint32_t* w = malloc(2 * sizeof(uint32_t) * sha256Circuit.numWires);
+	int randCount = 0, countY = 0;
 
-	uint32_t w[64][2];
 	for (int j = 0; j < 16; j++) {
-		w[j][0] = (z.ve.x[j * 4] << 24) | (z.ve.x[j * 4 + 1] << 16)
-								| (z.ve.x[j * 4 + 2] << 8) | z.ve.x[j * 4 + 3];
-		w[j][1] = (z.ve1.x[j * 4] << 24) | (z.ve1.x[j * 4 + 1] << 16)
-								| (z.ve1.x[j * 4 + 2] << 8) | z.ve1.x[j * 4 + 3];
-	}
-
-	uint32_t s0[2], s1[2];
-	uint32_t t0[2], t1[2];
-	for (int j = 16; j < 64; j++) {
-		//s0[i] = RIGHTROTATE(w[i][j-15],7) ^ RIGHTROTATE(w[i][j-15],18) ^ (w[i][j-15] >> 3);
-		mpc_RIGHTROTATE2(w[j-15], 7, t0);
-		mpc_RIGHTROTATE2(w[j-15], 18, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTSHIFT2(w[j-15], 3, t1);
-		mpc_XOR2(t0, t1, s0);
-
-		//s1[i] = RIGHTROTATE(w[i][j-2],17) ^ RIGHTROTATE(w[i][j-2],19) ^ (w[i][j-2] >> 10);
-		mpc_RIGHTROTATE2(w[j-2], 17, t0);
-		mpc_RIGHTROTATE2(w[j-2], 19, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTSHIFT2(w[j-2],10,t1);
-		mpc_XOR2(t0, t1, s1);
-
-		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
-
-		if(mpc_ADD_verify(w[j-16], s0, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, j);
-#endif
-			return 1;
-		}
-
-
-		if(mpc_ADD_verify(w[j-7], t1, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, j);
-#endif
-			return 1;
-		}
-		if(mpc_ADD_verify(t1, s1, w[j], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, j);
-#endif
-			return 1;
-		}
-
+		w[2 * j] = (z->ve.x[j * 4] << 24) | (z->ve.x[j * 4 + 1] << 16)
+								| (z->ve.x[j * 4 + 2] << 8) | z->ve.x[j * 4 + 3];
+		w[2 * j + 1] = (z->ve1.x[j * 4] << 24) | (z->ve1.x[j * 4 + 1] << 16)
+								| (z->ve1.x[j * 4 + 2] << 8) | z->ve1.x[j * 4 + 3];
 	}
-
-
-
-	uint32_t va[2] = { hA[0],hA[0] };
-	uint32_t vb[2] = { hA[1],hA[1] };
-	uint32_t vc[2] = { hA[2],hA[2] };
-	uint32_t vd[2] = { hA[3],hA[3] };
-	uint32_t ve[2] = { hA[4],hA[4] };
-	uint32_t vf[2] = { hA[5],hA[5] };
-	uint32_t vg[2] = { hA[6],hA[6] };
-	uint32_t vh[2] = { hA[7],hA[7] };
-	uint32_t temp1[3], temp2[3], maj[3];
-	for (int i = 0; i < 64; i++) {
-		//s1 = RIGHTROTATE(e,6) ^ RIGHTROTATE(e,11) ^ RIGHTROTATE(e,25);
-		mpc_RIGHTROTATE2(ve, 6, t0);
-		mpc_RIGHTROTATE2(ve, 11, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTROTATE2(ve, 25, t1);
-		mpc_XOR2(t0, t1, s1);
-
-
-
-
-		//ch = (e & f) ^ ((~e) & g);
-		//temp1 = h + s1 + CH(e,f,g) + k[i]+w[i];
-
-		//t0 = h + s1
-
-		if(mpc_ADD_verify(vh, s1, t0, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-
-
-		if(mpc_CH_verify(ve, vf, vg, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-		//t1 = t0 + t1 (h+s1+ch)
-		if(mpc_ADD_verify(t0, t1, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-
-
-		t0[0] = k[i];
-		t0[1] = k[i];
-		if(mpc_ADD_verify(t1, t0, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+	if (circ_verify(&sha256Circuit, w, tapes, &randCount, z->ve.y, z->ve1.y, &countY) != 0) {
 #if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-
-
-		if(mpc_ADD_verify(t1, w[i], temp1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-		//s0 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22);
-		mpc_RIGHTROTATE2(va, 2, t0);
-		mpc_RIGHTROTATE2(va, 13, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTROTATE2(va, 22, t1);
-		mpc_XOR2(t0, t1, s0);
-
-		//maj = (a & (b ^ c)) ^ (b & c);
-		//(a & b) ^ (a & c) ^ (b & c)
-
-		if(mpc_MAJ_verify(va, vb, vc, maj, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-		//temp2 = s0+maj;
-		if(mpc_ADD_verify(s0, maj, temp2, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-
-
-		memcpy(vh, vg, sizeof(uint32_t) * 2);
-		memcpy(vg, vf, sizeof(uint32_t) * 2);
-		memcpy(vf, ve, sizeof(uint32_t) * 2);
-		//e = d+temp1;
-		if(mpc_ADD_verify(vd, temp1, ve, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-
-		memcpy(vd, vc, sizeof(uint32_t) * 2);
-		memcpy(vc, vb, sizeof(uint32_t) * 2);
-		memcpy(vb, va, sizeof(uint32_t) * 2);
-		//a = temp1+temp2;
-
-		if(mpc_ADD_verify(temp1, temp2, va, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
-	}
-
-	uint32_t hHa[8][3] = { { hA[0],hA[0],hA[0]  }, { hA[1],hA[1],hA[1] }, { hA[2],hA[2],hA[2] }, { hA[3],hA[3],hA[3] },
-			{ hA[4],hA[4],hA[4] }, { hA[5],hA[5],hA[5] }, { hA[6],hA[6],hA[6] }, { hA[7],hA[7],hA[7] } };
-	if(mpc_ADD_verify(hHa[0], va, hHa[0], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
+		printf("Failing at %d, view word %d", __LINE__, countY);
 #endif
+		free(w);
 		return 1;
 	}
-	if(mpc_ADD_verify(hHa[1], vb, hHa[1], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[2], vc, hHa[2], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[3], vd, hHa[3], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[4], ve, hHa[4], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[5], vf, hHa[5], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[6], vg, hHa[6], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[7], vh, hHa[7], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-
-	free(randCount);
-	free(countY);
+	free(w);
+	stats_add(STATS_GATES, countY);
 
 	return 0;
 }
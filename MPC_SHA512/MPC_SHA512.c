@@ -16,23 +16,41 @@
 
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "shared512.h"
+#include "slice512.h"
+#include "../common/arena.h"
+#include "../common/cli.h"
+#include "../common/seed.h"
 #include "omp.h"
 
 
 #define CH(e,f,g) ((e & f) | ((~e) & g))
 
-
-int totalRandom = 0;
-int totalSha = 0;
-int totalSS = 0;
-int totalHash = 0;
 int NUM_ROUNDS = 32;
+// Write ZKB++ proofs (zppHeader and zpp records) instead of ZKBoo ones
+int compactProof = 0;
+// Public prefix from --prefix, put in front of every message, and its header
+const unsigned char* prefix = NULL;
+uint64_t prefixLen = 0;
+int prefixProof = 0;
+prefixHeader publicPrefix;
+// HMAC message or PBKDF2 salt from --hmac, iterations from --pbkdf2, and their header
+const unsigned char* hmacMessage = NULL;
+uint64_t hmacMessageLen = 0;
+uint64_t hmacIterations = 0;
+int hmacProof = 0;
+hmacHeader hmacStatement;
+
+// Upper bound on views held in memory between commit() and prove()
+#define VIEW_CACHE_BYTES (64 * 1024 * 1024)
 
 
 uint32_t rand32() {
@@ -72,17 +90,12 @@ void mpc_XOR(uint64_t x[3], uint64_t y[3], uint64_t z[3]) {
 	z[2] = x[2] ^ y[2];
 }
 
-void mpc_AND(uint64_t x[3], uint64_t y[3], uint64_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint64_t r[3] = { getRandom64(randomness[0], *randCount), getRandom64(randomness[1], *randCount), getRandom64(randomness[2], *randCount)};
-	*randCount += 8;
-	uint64_t t[3] = { 0 };
+void mpc_AND(uint64_t x[3], uint64_t y[3], uint64_t z[3], tapeWindow* tw, View views[3], int* countY) {
+	uint64_t r[3];
+
+	tape_next64(tw, r);
 
-	t[0] = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	t[1] = (x[1] & y[2]) ^ (x[2] & y[1]) ^ (x[1] & y[1]) ^ r[1] ^ r[2];
-	t[2] = (x[2] & y[0]) ^ (x[0] & y[2]) ^ (x[2] & y[2]) ^ r[2] ^ r[0];
-	z[0] = t[0];
-	z[1] = t[1];
-	z[2] = t[2];
+	lanes_AND(x, y, r, z);
 	views[0].y[*countY] = z[0];
 	views[1].y[*countY] = z[1];
 	views[2].y[*countY] = z[2];
@@ -97,48 +110,25 @@ void mpc_NEGATE(uint64_t x[3], uint64_t z[3]) {
 
 
 
-void mpc_OR(uint64_t x[3], uint64_t y[3], uint64_t z[3], unsigned char * randomness[3], int * randCount, View views[3], int* countY) {
+void mpc_OR(uint64_t x[3], uint64_t y[3], uint64_t z[3], tapeWindow* tw, View views[3], int* countY) {
 	uint64_t t0[3] = { 0 };
 	uint64_t t1[3] = { 0 };
 	uint64_t t2[3] = { 0 };
 
 	mpc_NEGATE(x,t0);
 	mpc_NEGATE(y,t1);
-	mpc_AND(t0,t1,t2,randomness,randCount,views,countY);
+	mpc_AND(t0,t1,t2,tw,views,countY);
 	mpc_NEGATE(t2,z);
 
 }
 
-void mpc_ADD(uint64_t x[3], uint64_t y[3], uint64_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint64_t c[3] = { 0 };
-	uint64_t r[3] = { getRandom64(randomness[0], *randCount), getRandom64(randomness[1], *randCount), getRandom64(randomness[2], *randCount)};
-	*randCount += 8;
-
-	uint8_t a[3], b[3];
-
-	uint8_t t;
-
-	for(int i=0;i<63;i++)
-	{
-		a[0]=GETBIT(x[0]^c[0],i);
-		a[1]=GETBIT(x[1]^c[1],i);
-		a[2]=GETBIT(x[2]^c[2],i);
+void mpc_ADD(uint64_t x[3], uint64_t y[3], uint64_t z[3], tapeWindow* tw, View views[3], int* countY) {
+	uint64_t c[3];
+	uint64_t r[3];
 
-		b[0]=GETBIT(y[0]^c[0],i);
-		b[1]=GETBIT(y[1]^c[1],i);
-		b[2]=GETBIT(y[2]^c[2],i);
+	tape_next64(tw, r);
 
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		SETBIT(c[0],i+1, t ^ (a[0]&b[0]) ^ GETBIT(c[0],i) ^ GETBIT(r[0],i));
-
-		t = (a[1]&b[2]) ^ (a[2]&b[1]) ^ GETBIT(r[2],i);
-		SETBIT(c[1],i+1, t ^ (a[1]&b[1]) ^ GETBIT(c[1],i) ^ GETBIT(r[1],i));
-
-		t = (a[2]&b[0]) ^ (a[0]&b[2]) ^ GETBIT(r[0],i);
-		SETBIT(c[2],i+1, t ^ (a[2]&b[2]) ^ GETBIT(c[2],i) ^ GETBIT(r[2],i));
-
-
-	}
+	lanes_ADD(x, y, r, c);
 
 	z[0]=x[0]^y[0]^c[0];
 	z[1]=x[1]^y[1]^c[1];
@@ -148,52 +138,22 @@ void mpc_ADD(uint64_t x[3], uint64_t y[3], uint64_t z[3], unsigned char *randomn
 	views[1].y[*countY] = c[1];
 	views[2].y[*countY] = c[2];
 	*countY += 1;
-
-
 }
 
 
-void mpc_ADDK(uint64_t x[3], uint64_t y, uint64_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
-	uint64_t c[3] = { 0 };
-	uint64_t r[3] = { getRandom64(randomness[0], *randCount), getRandom64(randomness[1], *randCount), getRandom64(randomness[2], *randCount)};
-	*randCount += 8;
-
-	uint8_t a[3], b[3];
-
-	uint8_t t;
-
-	for(int i=0;i<63;i++)
-	{
-		a[0]=GETBIT(x[0]^c[0],i);
-		a[1]=GETBIT(x[1]^c[1],i);
-		a[2]=GETBIT(x[2]^c[2],i);
-
-		b[0]=GETBIT(y^c[0],i);
-		b[1]=GETBIT(y^c[1],i);
-		b[2]=GETBIT(y^c[2],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		SETBIT(c[0],i+1, t ^ (a[0]&b[0]) ^ GETBIT(c[0],i) ^ GETBIT(r[0],i));
-
-		t = (a[1]&b[2]) ^ (a[2]&b[1]) ^ GETBIT(r[2],i);
-		SETBIT(c[1],i+1, t ^ (a[1]&b[1]) ^ GETBIT(c[1],i) ^ GETBIT(r[1],i));
-
-		t = (a[2]&b[0]) ^ (a[0]&b[2]) ^ GETBIT(r[0],i);
-		SETBIT(c[2],i+1, t ^ (a[2]&b[2]) ^ GETBIT(c[2],i) ^ GETBIT(r[2],i));
+void mpc_ADDK(uint64_t x[3], uint64_t y, uint64_t z[3], tapeWindow* tw, View views[3], int* countY) {
+	uint64_t k[3] = { y, y, y };
 
+	mpc_ADD(x, k, z, tw, views, countY);
+}
 
+// Output word that is not kept: no gate, a zero in every view
+void mpc_DROP(uint64_t x[3], View views[3], int* countY) {
+	for (int j = 0; j < 3; j++) {
+		x[j] = 0;
+		views[j].y[*countY] = 0;
 	}
-
-	z[0]=x[0]^y^c[0];
-	z[1]=x[1]^y^c[1];
-	z[2]=x[2]^y^c[2];
-
-
-	views[0].y[*countY] = c[0];
-	views[1].y[*countY] = c[1];
-	views[2].y[*countY] = c[2];
-	*countY += 1;
-
+	(*countY)++;
 }
 
 void mpc_RIGHTROTATE(uint64_t x[], int i, uint64_t z[]) {
@@ -213,82 +173,65 @@ void mpc_RIGHTSHIFT(uint64_t x[3], int i, uint64_t z[3]) {
 
 
 
-void mpc_MAJ(uint64_t a[], uint64_t b[3], uint64_t c[3], uint64_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
+void mpc_MAJ(uint64_t a[], uint64_t b[3], uint64_t c[3], uint64_t z[3], tapeWindow* tw, View views[3], int* countY) {
 	uint64_t t0[3];
 	uint64_t t1[3];
 	uint64_t t2[3];
 
-	mpc_AND(a, b, t0, randomness, randCount, views, countY);
-	mpc_AND(b, c, t1, randomness, randCount, views, countY);
-	mpc_AND(c, a, t2, randomness, randCount, views, countY);
-	mpc_OR(t0, t1, z, randomness, randCount, views, countY);
-	mpc_OR(t2, z, z, randomness, randCount, views, countY);
+	mpc_AND(a, b, t0, tw, views, countY);
+	mpc_AND(b, c, t1, tw, views, countY);
+	mpc_AND(c, a, t2, tw, views, countY);
+	mpc_OR(t0, t1, z, tw, views, countY);
+	mpc_OR(t2, z, z, tw, views, countY);
 }
 
 
-void mpc_CH(uint64_t e[], uint64_t f[3], uint64_t g[3], uint64_t z[3], unsigned char *randomness[3], int* randCount, View views[3], int* countY) {
+void mpc_CH(uint64_t e[], uint64_t f[3], uint64_t g[3], uint64_t z[3], tapeWindow* tw, View views[3], int* countY) {
 	uint64_t t0[3];
 	uint64_t t1[3];
 	uint64_t t2[3];
 
-	mpc_AND(e,f,t0, randomness, randCount, views, countY);
+	mpc_AND(e,f,t0, tw, views, countY);
 	mpc_NEGATE(e,t1);
-	mpc_AND(t1,g,t2, randomness, randCount, views, countY);
-	mpc_OR(t0,t2,z, randomness, randCount, views, countY);
+	mpc_AND(t1,g,t2, tw, views, countY);
+	mpc_OR(t0,t2,z, tw, views, countY);
 
 }
 
 
 
-int mpc_sha512(unsigned char* results[3], unsigned char* inputs[3], int numBits, unsigned char *randomness[3], View views[3], int* countY) {
-
-
-
-	if (numBits > 1000) {
-		printf("Input too long, aborting!");
-		return -1;
-	}
-
-	int* randCount = calloc(1, sizeof(int));
-	*randCount = 0;
-
-	int chars = numBits >> 3;
-	unsigned char* chunks[3];
+/*
+ * One SHA-512 compression in MPC. state holds the three parties' shares of the
+ * chaining value on entry and of the updated chaining value on return. The
+ * message block shares are taken from views[i].x, and the output shares are
+ * appended to the views so the next block (or the verifier) can pick them up.
+ * Tape words come from tw, which carries on into the next block. Only the
+ * first outWords words of the chaining value are updated, the others are
+ * dropped to zero (see sha512Variant).
+ */
+int mpc_sha512(uint64_t state[8][3], tapeWindow* tw, View views[3], int* countY, int outWords) {
 	uint64_t w[16][3];
 
 	for (int i = 0; i < 3; i++) {
-		chunks[i] = calloc(128, 1); //1024 bits
-		memset(chunks[i],0,128);
-		memcpy(chunks[i], inputs[i], chars);
-		chunks[i][chars] = 0x80;
-		//Last 8 chars used for storing length of input without padding, in big-endian.
-		//Since we only care for one block, we are safe with just using last 9 bits and 0'ing the rest
-
-		chunks[i][124] = numBits >> 24;
-		chunks[i][125] = numBits >> 16;
-		chunks[i][126] = numBits >> 8;
-		chunks[i][127] = numBits;
-		memcpy(views[i].x, chunks[i], 128);
-
 		for (int j = 0; j < 16; j++) {
-			w[j][i] = ((uint64_t)chunks[i][j * 8] << 56) | ((uint64_t)chunks[i][j * 8 + 1] << 48)
-				| ((uint64_t)chunks[i][j * 8 + 2] << 40) | ((uint64_t)chunks[i][j * 8 + 3] << 32)
-				| ((uint64_t)chunks[i][j * 8 + 4] << 24) | ((uint64_t)chunks[i][j * 8 + 5] << 16)
-				| ((uint64_t)chunks[i][j * 8 + 6] << 8) | (uint64_t)chunks[i][j * 8 + 7];
+			w[j][i] = ((uint64_t)views[i].x[j * 8] << 56) | ((uint64_t)views[i].x[j * 8 + 1] << 48)
+				| ((uint64_t)views[i].x[j * 8 + 2] << 40) | ((uint64_t)views[i].x[j * 8 + 3] << 32)
+				| ((uint64_t)views[i].x[j * 8 + 4] << 24) | ((uint64_t)views[i].x[j * 8 + 5] << 16)
+				| ((uint64_t)views[i].x[j * 8 + 6] << 8) | (uint64_t)views[i].x[j * 8 + 7];
 		}
-		free(chunks[i]);
 	}
 
 	uint64_t s0[3], s1[3];
 	uint64_t t0[3], t1[3];
-	uint64_t a[3] = { hA[0],hA[0],hA[0] };
-	uint64_t b[3] = { hA[1],hA[1],hA[1] };
-	uint64_t c[3] = { hA[2],hA[2],hA[2] };
-	uint64_t d[3] = { hA[3],hA[3],hA[3] };
-	uint64_t e[3] = { hA[4],hA[4],hA[4] };
-	uint64_t f[3] = { hA[5],hA[5],hA[5] };
-	uint64_t g[3] = { hA[6],hA[6],hA[6] };
-	uint64_t h[3] = { hA[7],hA[7],hA[7] };
+	uint64_t a[3], b[3], c[3], d[3], e[3], f[3], g[3], h[3];
+	memcpy(a, state[0], sizeof(uint64_t) * 3);
+	memcpy(b, state[1], sizeof(uint64_t) * 3);
+	memcpy(c, state[2], sizeof(uint64_t) * 3);
+	memcpy(d, state[3], sizeof(uint64_t) * 3);
+	memcpy(e, state[4], sizeof(uint64_t) * 3);
+	memcpy(f, state[5], sizeof(uint64_t) * 3);
+	memcpy(g, state[6], sizeof(uint64_t) * 3);
+	memcpy(h, state[7], sizeof(uint64_t) * 3);
 	uint64_t temp1[3], temp2[3], maj[3];
 	for (int i = 0; i < 80; i++) {
 		if (i >= 16)
@@ -307,9 +250,9 @@ int mpc_sha512(unsigned char* results[3], unsigned char* inputs[3], int numBits,
 
 		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
 
-			mpc_ADD(W(i+9), s0, t1, randomness, randCount, views, countY);
-			mpc_ADD(s1, t1, t1, randomness, randCount, views, countY);
-			mpc_ADD(W(i), t1, W(i), randomness, randCount, views, countY);
+			mpc_ADD(W(i+9), s0, t1, tw, views, countY);
+			mpc_ADD(s1, t1, t1, tw, views, countY);
+			mpc_ADD(W(i), t1, W(i), tw, views, countY);
 
 		}
 
@@ -326,18 +269,18 @@ int mpc_sha512(unsigned char* results[3], unsigned char* inputs[3], int numBits,
 		//temp1 = h + s1 + CH(e,f,g) + k[i]+w[i];
 
 		//t0 = h + s1
-		mpc_ADD(h, s1, t0, randomness, randCount, views, countY);
+		mpc_ADD(h, s1, t0, tw, views, countY);
 
 
 
-		mpc_CH(e, f, g, t1, randomness, randCount, views, countY);
+		mpc_CH(e, f, g, t1, tw, views, countY);
 
 		//t1 = t0 + t1 (h+s1+ch)
-		mpc_ADD(t0, t1, t1, randomness, randCount, views, countY);
+		mpc_ADD(t0, t1, t1, tw, views, countY);
 
-		mpc_ADDK(t1, k[i], t1, randomness, randCount, views, countY);
+		mpc_ADDK(t1, k[i], t1, tw, views, countY);
 
-		mpc_ADD(t1, W(i), temp1, randomness, randCount, views, countY);
+		mpc_ADD(t1, W(i), temp1, tw, views, countY);
 
 		//s0 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22);
 		mpc_RIGHTROTATE(a, 28, t0);
@@ -347,76 +290,272 @@ int mpc_sha512(unsigned char* results[3], unsigned char* inputs[3], int numBits,
 		mpc_XOR(t0, t1, s0);
 
 
-		mpc_MAJ(a, b, c, maj, randomness, randCount, views, countY);
+		mpc_MAJ(a, b, c, maj, tw, views, countY);
 
 		//temp2 = s0+maj;
-		mpc_ADD(s0, maj, temp2, randomness, randCount, views, countY);
+		mpc_ADD(s0, maj, temp2, tw, views, countY);
 
 		memcpy(h, g, sizeof(uint64_t) * 3);
 		memcpy(g, f, sizeof(uint64_t) * 3);
 		memcpy(f, e, sizeof(uint64_t) * 3);
 		//e = d+temp1;
-		mpc_ADD(d, temp1, e, randomness, randCount, views, countY);
+		mpc_ADD(d, temp1, e, tw, views, countY);
 		memcpy(d, c, sizeof(uint64_t) * 3);
 		memcpy(c, b, sizeof(uint64_t) * 3);
 		memcpy(b, a, sizeof(uint64_t) * 3);
 		//a = temp1+temp2;
 
-		mpc_ADD(temp1, temp2, a, randomness, randCount, views, countY);
+		mpc_ADD(temp1, temp2, a, tw, views, countY);
 	}
 
-	uint64_t hHa[8][3] = { { hA[0],hA[0],hA[0]  }, { hA[1],hA[1],hA[1] }, { hA[2],hA[2],hA[2] }, { hA[3],hA[3],hA[3] },
-			{ hA[4],hA[4],hA[4] }, { hA[5],hA[5],hA[5] }, { hA[6],hA[6],hA[6] }, { hA[7],hA[7],hA[7] } };
-	mpc_ADD(hHa[0], a, hHa[0], randomness, randCount, views, countY);
-	mpc_ADD(hHa[1], b, hHa[1], randomness, randCount, views, countY);
-	mpc_ADD(hHa[2], c, hHa[2], randomness, randCount, views, countY);
-	mpc_ADD(hHa[3], d, hHa[3], randomness, randCount, views, countY);
-	mpc_ADD(hHa[4], e, hHa[4], randomness, randCount, views, countY);
-	mpc_ADD(hHa[5], f, hHa[5], randomness, randCount, views, countY);
-	mpc_ADD(hHa[6], g, hHa[6], randomness, randCount, views, countY);
-	mpc_ADD(hHa[7], h, hHa[7], randomness, randCount, views, countY);
+	uint64_t* vars[8] = { a, b, c, d, e, f, g, h };
+	for (int i = 0; i < 8; i++) {
+		if (i < outWords)
+			mpc_ADD(state[i], vars[i], state[i], tw, views, countY);
+		else
+			mpc_DROP(state[i], views, countY);
+	}
 
+	//Explicitly add y to view
 	for (int i = 0; i < 8; i++) {
-		mpc_RIGHTSHIFT(hHa[i], 56, t0);
-		results[0][i * 8] = t0[0];
-		results[1][i * 8] = t0[1];
-		results[2][i * 8] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 48, t0);
-		results[0][i * 8 + 1] = t0[0];
-		results[1][i * 8 + 1] = t0[1];
-		results[2][i * 8 + 1] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 40, t0);
-		results[0][i * 8 + 2] = t0[0];
-		results[1][i * 8 + 2] = t0[1];
-		results[2][i * 8 + 2] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 32, t0);
-		results[0][i * 8 + 3] = t0[0];
-		results[1][i * 8 + 3] = t0[1];
-		results[2][i * 8 + 3] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 24, t0);
-		results[0][i * 8 + 4] = t0[0];
-		results[1][i * 8 + 4] = t0[1];
-		results[2][i * 8 + 4] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 16, t0);
-		results[0][i * 8 + 5] = t0[0];
-		results[1][i * 8 + 5] = t0[1];
-		results[2][i * 8 + 5] = t0[2];
-		mpc_RIGHTSHIFT(hHa[i], 8, t0);
-		results[0][i * 8 + 6] = t0[0];
-		results[1][i * 8 + 6] = t0[1];
-		results[2][i * 8 + 6] = t0[2];
-
-		results[0][i * 8 + 7] = hHa[i][0];
-		results[1][i * 8 + 7] = hHa[i][1];
-		results[2][i * 8 + 7] = hHa[i][2];
-	}
-//printf("randCount %d\n",*randCount);
-	free(randCount);
+		views[0].y[*countY] = state[i][0];
+		views[1].y[*countY] = state[i][1];
+		views[2].y[*countY] = state[i][2];
+		*countY += 1;
+	}
 
 	return 0;
 }
 
 
+/*
+ * Message source for the prover. Input is either held in memory or read
+ * straight from a file descriptor a block at a time, so the message never has
+ * to fit in memory. Blocks are fetched with pread so rounds can share one fd.
+ *
+ * The message hashed is the public prefix followed by the input. len counts
+ * both, numBlocks only the blocks run in MPC: block b of the circuit is block
+ * firstBlock + b of the padded message, and the circuit starts from iv.
+ *
+ * For HMAC and PBKDF2 the input is the key, and block b is step b of the
+ * plan in hmac.
+ */
+typedef struct {
+	int fd;
+	unsigned char* buf;
+	uint64_t len;
+	int firstBlock;
+	int numBlocks;
+	const uint64_t* iv;
+	hmacPlan plan;
+	const hmacPlan* hmac;
+} inputStream;
+
+int numBlocksFor(uint64_t len) {
+	// message, 0x80 and the 128-bit length, rounded up to whole blocks
+	return (len + 17 + SHA512_CBLOCK - 1) / SHA512_CBLOCK;
+}
+
+// Input from fd, or from buf when fd is -1, of len bytes after the prefix
+void setInput(inputStream* in, int fd, unsigned char* buf, uint64_t len) {
+	in->fd = fd;
+	in->buf = buf;
+	in->len = prefixLen + len;
+	in->firstBlock = prefixProof ? publicPrefix.publicBytes / SHA512_CBLOCK : 0;
+	in->numBlocks = numBlocksFor(in->len) - in->firstBlock;
+	in->iv = prefixProof ? publicPrefix.iv : variant->iv;
+	in->hmac = NULL;
+	if (hmacProof) {
+		hmac_plan(&in->plan, hmacMessage, hmacMessageLen, hmacIterations, (len > SHA512_CBLOCK) ? numBlocksFor(len) : 0);
+		in->hmac = &in->plan;
+		in->numBlocks = in->plan.numSteps;
+	}
+}
+
+/*
+ * Pipes and terminals cannot be read with pread, so their contents are
+ * spooled block by block into an unlinked temporary file first. With --hex
+ * every input is spooled, decoded by cli_message() as a line would be.
+ * Returns a seekable fd for the input and its length, or -1 when it cannot
+ * be read or is not valid hex.
+ */
+int spoolInput(int fd, const cliOptions* opt, uint64_t* len) {
+	char buf[SHA512_CBLOCK * 64];
+	size_t have = 0;
+	struct stat st;
+	FILE* spool;
+	ssize_t n;
+
+	if (fstat(fd, &st) != 0)
+		return -1;
+	if (S_ISREG(st.st_mode) && !opt->hex) {
+		*len = st.st_size;
+		return fd;
+	}
+	spool = tmpfile();
+	if (!spool)
+		return -1;
+	*len = 0;
+	do {
+		n = read(fd, buf + have, sizeof(buf) - have);
+		have += (n > 0) ? n : 0;
+		//hex digits are decoded in pairs, the line endings the file ends in are left out
+		size_t use = have;
+		if (opt->hex) {
+			while ((use > 0) && ((buf[use - 1] == '\n') || (buf[use - 1] == '\r')))
+				use--;
+			if (n > 0)
+				use -= use % 2;
+		}
+		long m = (n < 0) ? -1 : cli_message(opt, buf, use, (unsigned char*)buf, use);
+		if ((m < 0) || (fwrite(buf, 1, m, spool) != (size_t)m) || ((n > 0) && (use == 0) && (have == sizeof(buf)))) {
+			fclose(spool);
+			return -1;
+		}
+		*len += m;
+		memmove(buf, buf + use, have - use);
+		have -= use;
+	} while (n != 0);
+	close(fd);
+	if (fflush(spool) != 0) {
+		fclose(spool);
+		return -1;
+	}
+	return fileno(spool);
+}
+
+// Copies n bytes of prefix || input from pos
+int readMessage(inputStream* in, uint64_t pos, unsigned char* dst, uint64_t n) {
+	if (pos < prefixLen) {
+		uint64_t m = (prefixLen - pos < n) ? prefixLen - pos : n;
+		memcpy(dst, &prefix[pos], m);
+		pos += m;
+		dst += m;
+		n -= m;
+	}
+	if (n == 0)
+		return 0;
+	pos -= prefixLen;
+	if (in->fd >= 0)
+		return pread(in->fd, dst, n, pos) != n;
+	memcpy(dst, &in->buf[pos], n);
+	return 0;
+}
+
+int getPaddedBlock(inputStream* in, int b, unsigned char block[SHA512_CBLOCK]) {
+	uint64_t start = (uint64_t)(in->firstBlock + b) * SHA512_CBLOCK;
+	uint64_t avail = 0;
+
+	memset(block, 0, SHA512_CBLOCK);
+	if (start < in->len) {
+		avail = in->len - start;
+		if (avail > SHA512_CBLOCK)
+			avail = SHA512_CBLOCK;
+		if (readMessage(in, start, block, avail) != 0)
+			return 1;
+	}
+	if ((in->len >= start) && (in->len - start < SHA512_CBLOCK))
+		block[in->len - start] = 0x80;
+	if (in->firstBlock + b == numBlocksFor(in->len) - 1) {
+		uint64_t numBits = in->len << 3;
+		for (int i = 0; i < 8; i++)
+			block[SHA512_CBLOCK - 1 - i] = numBits >> (i * 8);
+		block[SHA512_CBLOCK - 9] = in->len >> 61;
+	}
+	return 0;
+}
+
+/*
+ * Block of a step that takes fresh input shares: a message block, a block of
+ * an HMAC key longer than a block, or the key ^ ipad block of a shorter one
+ */
+int getSecretBlock(inputStream* in, int b, unsigned char block[SHA512_CBLOCK]) {
+	if (!in->hmac || (hmac_step(in->hmac, b) == HMAC_KEY))
+		return getPaddedBlock(in, b, block);
+	memset(block, 0, SHA512_CBLOCK);
+	if (readMessage(in, 0, block, in->len) != 0)
+		return 1;
+	for (int j = 0; j < SHA512_CBLOCK; j++)
+		block[j] ^= 0x36;
+	return 0;
+}
+
+
+/*
+ * Per round prover state that is carried from one block to the next: the AES
+ * tapes of the three parties with the window the gates read them through, the
+ * share streams of parties 0 and 1, the shared chaining value, and what an
+ * HMAC proof keeps from one step to a later one.
+ */
+typedef struct {
+	tapeStream tapes[3];
+	tapeStream shareTapes[2];
+	tapeWindow window;
+	uint64_t state[8][3];
+	hmacShares hs[3];
+} roundState;
+
+void initRound(roundState* rst, unsigned char keys[3][16], const uint64_t iv[8]) {
+	tapeStream* tapes[3] = { &rst->tapes[0], &rst->tapes[1], &rst->tapes[2] };
+
+	for (int j = 0; j < 3; j++) {
+		tape_open(&rst->tapes[j], keys[j], TAPE_IV);
+	}
+	tape_window(&rst->window, 3, tapes);
+	tape_open(&rst->shareTapes[0], keys[0], SHARE_IV);
+	tape_open(&rst->shareTapes[1], keys[1], SHARE_IV);
+	memset(rst->hs, 0, sizeof(rst->hs));
+	for (int i = 0; i < 8; i++) {
+		rst->state[i][0] = iv[i];
+		rst->state[i][1] = iv[i];
+		rst->state[i][2] = iv[i];
+	}
+}
+
+void freeRound(roundState* rst) {
+	for (int j = 0; j < 3; j++) {
+		tape_close(&rst->tapes[j]);
+	}
+	tape_close(&rst->shareTapes[0]);
+	tape_close(&rst->shareTapes[1]);
+}
+
+/*
+ * Derives the block shares of one round into views[i].x. The block's tapes
+ * are generated by rst->window as the circuit runs.
+ */
+void loadBlock(roundState* rst, unsigned char block[SHA512_CBLOCK], View views[3]) {
+	tapeStream* shareTapes[2] = { &rst->shareTapes[0], &rst->shareTapes[1] };
+	unsigned char* shares[2] = { views[0].x, views[1].x };
+
+	//Sharing secrets: parties 0 and 1 derive their shares from their keys
+	tape_readMany(2, shareTapes, shares, SHA512_CBLOCK);
+	for (int j = 0; j < SHA512_CBLOCK; j++) {
+		views[2].x[j] = block[j] ^ views[0].x[j] ^ views[1].x[j];
+	}
+}
+
+int runBlock(roundState* rst, inputStream* in, int b, View views[3]) {
+	unsigned char block[SHA512_CBLOCK];
+	unsigned char* xs[3] = { views[0].x, views[1].x, views[2].x };
+	int countY = 0;
+
+	if (!in->hmac || hmac_secret(in->hmac, b)) {
+		if (getSecretBlock(in, b, block) != 0)
+			return 1;
+		loadBlock(rst, block, views);
+	}
+	if (in->hmac)
+		hmac_enter(in->hmac, b, rst->hs, 3, rst->state, xs);
+	mpc_sha512(rst->state, &rst->window, views, &countY, blockOutWords(b, in->numBlocks));
+	if (in->hmac)
+		hmac_leave(in->hmac, b, rst->hs, 3, rst->state, (const unsigned char**)xs);
+	stats_add(STATS_GATES, countY);
+	stats_add(STATS_TAPE_BYTES, 3 * rSize);
+	return 0;
+}
+
+
 int writeToFile(char filename[], void* data, int size, int numItems) {
 	FILE *file;
 
@@ -434,10 +573,10 @@ int writeToFile(char filename[], void* data, int size, int numItems) {
 
 
 int secretShare(unsigned char* input, int numBytes, unsigned char output[3][numBytes]) {
-	if(RAND_bytes(output[0], numBytes) != 1) {
+	if(seed_bytes(output[0], numBytes) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
 	}
-	if(RAND_bytes(output[1], numBytes) != 1) {
+	if(seed_bytes(output[1], numBytes) != 1) {
 		printf("RAND_bytes failed crypto, aborting\n");
 	}
 	for (int j = 0; j < numBytes; j++) {
@@ -447,228 +586,664 @@ int secretShare(unsigned char* input, int numBytes, unsigned char output[3][numB
 }
 
 
+/*
+ * Runs all blocks of one round and absorbs each party's view into its
+ * commitment as soon as the block is done. If cache is not NULL it receives
+ * the views of every block (numBlocks x 3) for prove() to reuse.
+ */
+a commit(inputStream* in, unsigned char keys[3][16], unsigned char rs[3][4], View* cache, int* failed) {
+	View* blockViews = malloc(3 * sizeof(View));
+	roundState rst;
+	EVP_MD_CTX** ctx = crypto_digests(crypto_sha512, 3);
+	a a;
 
-a commit(int numBytes,unsigned char shares[3][numBytes], unsigned char *randomness[3], unsigned char rs[3][4], View views[3]) {
-static int printonce=0;
-
-	unsigned char* inputs[3];
-	inputs[0] = shares[0];
-	inputs[1] = shares[1];
-	inputs[2] = shares[2];
-	unsigned char* hashes[3];
-	hashes[0] = malloc(64);
-	hashes[1] = malloc(64);
-	hashes[2] = malloc(64);
+	initRound(&rst, keys, in->iv);
+	for (int j = 0; j < 3; j++) {
+		EVP_DigestUpdate(ctx[j], keys[j], 16);
+	}
 
-	int* countY = calloc(1, sizeof(int));
-	mpc_sha512(hashes, inputs, numBytes * 8, randomness, views, countY);
+	for (int b = 0; b < in->numBlocks; b++) {
+		View* views = blockViews;
+		if (cache)
+			views = &cache[b * 3];
+		if (runBlock(&rst, in, b, views) != 0) {
+			*failed = 1;
+			break;
+		}
+		for (int j = 0; j < 3; j++) {
+			H_view(ctx[j], &views[j], blockOutWords(b, in->numBlocks));
+		}
+	}
 
-	if (!printonce) // just for debug
-	{
-		printonce=1;
-		printf("hash obtained is: ");
-		for (int i = 0; i < 64; i++)
-		{
-			printf("%02X",hashes[0][i]^hashes[1][i]^hashes[2][i]);
+	for (int j = 0; j < 3; j++) {
+		EVP_DigestUpdate(ctx[j], rs[j], 4);
+		EVP_DigestFinal_ex(ctx[j], a.h[j], NULL);
+		stats_add(STATS_HASH_BYTES, 16 + roundCommitBytes(in->numBlocks) + 4);
+		for (int i = 0; i < 8; i++) {
+			a.yp[j][i] = in->hmac ? rst.hs[j].sum[i] : rst.state[i][j];
 		}
-		printf("\n");
 	}
 
-	//Explicitly add y to view
-	for(int i = 0; i<8; i++) {
-		views[0].y[*countY] = 	((uint64_t)hashes[0][i * 8] << 56) | ((uint64_t)hashes[0][i * 8 + 1] << 48)
-					| ((uint64_t)hashes[0][i * 8 + 2] << 40) | ((uint64_t)hashes[0][i * 8 + 3] << 32)
-					| ((uint64_t)hashes[0][i * 8 + 4] << 24) | ((uint64_t)hashes[0][i * 8 + 5] << 16)
-					| ((uint64_t)hashes[0][i * 8 + 6] << 8) | (uint64_t)hashes[0][i * 8 + 7];
-		views[1].y[*countY] = 	((uint64_t)hashes[1][i * 8] << 56) | ((uint64_t)hashes[1][i * 8 + 1] << 48)
-					| ((uint64_t)hashes[1][i * 8 + 2] << 40) | ((uint64_t)hashes[1][i * 8 + 3] << 32)
-					| ((uint64_t)hashes[1][i * 8 + 4] << 24) | ((uint64_t)hashes[1][i * 8 + 5] << 16)
-					| ((uint64_t)hashes[1][i * 8 + 6] << 8) | (uint64_t)hashes[1][i * 8 + 7];
-		views[2].y[*countY] = 	((uint64_t)hashes[2][i * 8] << 56) | ((uint64_t)hashes[2][i * 8 + 1] << 48)
-					| ((uint64_t)hashes[2][i * 8 + 2] << 40) | ((uint64_t)hashes[2][i * 8 + 3] << 32)
-					| ((uint64_t)hashes[2][i * 8 + 4] << 24) | ((uint64_t)hashes[2][i * 8 + 5] << 16)
-					| ((uint64_t)hashes[2][i * 8 + 6] << 8) | (uint64_t)hashes[2][i * 8 + 7];
+	freeRound(&rst);
+	free(blockViews);
 
-		*countY += 1;
-	}
-//printf("countY %d\n",*countY);
-	free(countY);
-	free(hashes[0]);
-	free(hashes[1]);
-	free(hashes[2]);
+	return a;
+}
 
-	uint64_t* result1 = malloc(64);
-	output(views[0], result1);
-	uint64_t* result2 = malloc(64);
-	output(views[1], result2);
-	uint64_t* result3 = malloc(64);
-	output(views[2], result3);
+/*
+ * Bitsliced counterpart of roundState: n <= SLICE_LANES rounds that run their
+ * blocks together. Each round keeps its own tapes in rst[l].
+ */
+typedef struct {
+	int n;
+	roundState* rst;
+	View* blockViews;
+	uint64_t (*state)[3][64];
+	sliceCtx sc;
+} sliceBatch;
+
+void initBatch(sliceBatch* sb, int n, unsigned char keys[][3][16], const uint64_t iv[8]) {
+	sb->n = n;
+	sb->rst = malloc(n * sizeof(roundState));
+	sb->blockViews = malloc(n * 3 * sizeof(View));
+	sb->state = malloc(8 * sizeof(*sb->state));
+	sb->sc.lanes = n;
+	for (int l = 0; l < n; l++) {
+		initRound(&sb->rst[l], keys[l], iv);
+		sb->sc.tapes[l] = &sb->rst[l].window;
+	}
+	for (int i = 0; i < 8; i++)
+		slice_setWord(sb->state[i], iv[i]);
+}
 
-	a a;
-	memcpy(a.yp[0], result1, 64);
-	memcpy(a.yp[1], result2, 64);
-	memcpy(a.yp[2], result3, 64);
+void freeBatch(sliceBatch* sb) {
+	for (int l = 0; l < sb->n; l++)
+		freeRound(&sb->rst[l]);
+	free(sb->state);
+	free(sb->blockViews);
+	free(sb->rst);
+}
 
-	free(result1);
-	free(result2);
-	free(result3);
+// Slices the per round chaining values into sb->state
+void sliceStates(sliceBatch* sb) {
+	uint64_t t[64];
 
-	return a;
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 3; j++) {
+			memset(t, 0, sizeof(t));
+			for (int l = 0; l < sb->n; l++)
+				t[l] = sb->rst[l].state[i][j];
+			slice_transpose(t);
+			memcpy(sb->state[i][j], t, sizeof(t));
+		}
+	}
 }
 
-z prove(int e, unsigned char keys[3][16], unsigned char rs[3][4], View views[3]) {
-	z z;
-	memcpy(z.ke, keys[e], 16);
-	memcpy(z.ke1, keys[(e + 1) % 3], 16);
-	z.ve = views[e];
-	z.ve1 = views[(e + 1) % 3];
-	memcpy(z.re, rs[e],4);
-	memcpy(z.re1, rs[(e + 1) % 3],4);
+/*
+ * Runs block b for every round of the batch. Views of round l go to
+ * caches[l] when there is one, otherwise to the batch's scratch views.
+ * Either way sb->sc.views[l] points at them afterwards.
+ */
+int runBatchBlock(sliceBatch* sb, inputStream* in, int b, View** caches) {
+	unsigned char block[SHA512_CBLOCK];
+	int secret = !in->hmac || hmac_secret(in->hmac, b);
 
-	return z;
+	if (secret && (getSecretBlock(in, b, block) != 0))
+		return 1;
+	for (int l = 0; l < sb->n; l++) {
+		View* views = (caches && caches[l]) ? &caches[l][b * 3] : &sb->blockViews[l * 3];
+		unsigned char* xs[3] = { views[0].x, views[1].x, views[2].x };
+		sb->sc.views[l] = views;
+		if (secret)
+			loadBlock(&sb->rst[l], block, views);
+		if (in->hmac)
+			hmac_enter(in->hmac, b, sb->rst[l].hs, 3, sb->rst[l].state, xs);
+	}
+	//HMAC steps do not all carry on from the last one, so their chaining values are kept per round
+	if (in->hmac)
+		sliceStates(sb);
+	slice_sha512(&sb->sc, sb->state, blockOutWords(b, in->numBlocks));
+	for (int l = 0; (l < sb->n) && in->hmac; l++) {
+		View* views = sb->sc.views[l];
+		const unsigned char* xs[3] = { views[0].x, views[1].x, views[2].x };
+		for (int i = 0; i < 8; i++)
+			for (int j = 0; j < 3; j++)
+				sb->rst[l].state[i][j] = views[j].y[ySize - 8 + i];
+		hmac_leave(in->hmac, b, sb->rst[l].hs, 3, sb->rst[l].state, xs);
+	}
+	stats_add(STATS_GATES, (uint64_t)sb->sc.countY * sb->n);
+	stats_add(STATS_TAPE_BYTES, (uint64_t)3 * rSize * sb->n);
+	return 0;
 }
 
+/*
+ * commit() for n <= SLICE_LANES rounds at once on the bitsliced circuit.
+ * keys, rs, caches and as point at the first of the n rounds.
+ */
+void commitSliced(inputStream* in, int n, unsigned char keys[][3][16], unsigned char rs[][3][4], View** caches, a* as, int* failed) {
+	const void* views[3 * n];
+	unsigned char* hashes[3 * n];
+	hashMany h;
+	sliceBatch sb;
+
+	//The 3n views of the batch are hashed side by side (common/hashmany.h)
+	initBatch(&sb, n, keys, in->iv);
+	hash_begin(&h, crypto_sha512, 3 * n);
+	for (int i = 0; i < 3 * n; i++) {
+		views[i] = keys[i / 3][i % 3];
+	}
+	hash_update(&h, views, 16);
 
+	for (int b = 0; b < in->numBlocks; b++) {
+		if (runBatchBlock(&sb, in, b, caches) != 0) {
+			*failed = 1;
+			break;
+		}
+		for (int i = 0; i < 3 * n; i++) {
+			views[i] = &sb.sc.views[i / 3][i % 3];
+		}
+		//As H_view(): the words a variant drops are left out of the last block
+		int outWords = blockOutWords(b, in->numBlocks);
+		if (outWords == 8)
+			hash_update(&h, views, sizeof(View));
+		else {
+			hash_update(&h, views, viewCommitBytes(outWords) - outWords * sizeof(uint64_t));
+			for (int i = 0; i < 3 * n; i++) {
+				views[i] = &sb.sc.views[i / 3][i % 3].y[ySize - 8];
+			}
+			hash_update(&h, views, outWords * sizeof(uint64_t));
+		}
+	}
 
-int main(void) {
-	setbuf(stdout, NULL);
-	srand((unsigned) time(NULL));
-	init_EVP();
-	openmp_thread_setup();
-	struct timeval begin, delta;
-	//
-	unsigned char garbage[4];
-	if(RAND_bytes(garbage, 4) != 1) {
-		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+	for (int i = 0; i < 3 * n; i++) {
+		views[i] = rs[i / 3][i % 3];
+		hashes[i] = as[i / 3].h[i % 3];
+	}
+	hash_update(&h, views, 4);
+	hash_final(&h, hashes);
+	for (int l = 0; l < n; l++) {
+		for (int j = 0; j < 3; j++) {
+			stats_add(STATS_HASH_BYTES, 16 + roundCommitBytes(in->numBlocks) + 4);
+			for (int i = 0; i < 8; i++) {
+				as[l].yp[j][i] = in->hmac ? sb.rst[l].hs[j].sum[i] : slice_getWord(sb.state[i], j, l);
+			}
+		}
 	}
-	
-	printf("Enter the string to be hashed (Max 124 characters): ");
-	char userInput[125]; //125 is max length as we only support 1000 bits = 125 bytes
-	userInput[124] = 0x0;
-	fgets(userInput, sizeof(userInput)-1, stdin);
-	
-	int i = strlen(userInput)-1; 
-	printf("String length: %d\n", i);
-	
-	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
 
+	freeBatch(&sb);
+}
 
-	unsigned char input[i];
-	for(int j = 0; j<i; j++) {
-		input[j] = userInput[j];
+void packZ(z* zp, int e, unsigned char keys[3][16], unsigned char rs[3][4]) {
+	memcpy(zp->ke, keys[e], 16);
+	memcpy(zp->ke1, keys[(e + 1) % 3], 16);
+	memcpy(zp->re, rs[e],4);
+	memcpy(zp->re1, rs[(e + 1) % 3],4);
+}
+
+void packZpp(zpp* zp, int e, unsigned char keys[3][16], unsigned char rs[3][4], const a* ak) {
+	memset(zp, 0, sizeof(zpp));
+	memcpy(zp->ke, keys[e], 16);
+	memcpy(zp->ke1, keys[(e + 1) % 3], 16);
+	memcpy(zp->re, rs[e],4);
+	memcpy(zp->re1, rs[(e + 1) % 3],4);
+	memcpy(zp->h2, ak->h[(e + 2) % 3], 64);
+	zp->e = e;
+}
+
+/*
+ * Writes the opened views of block b into the round record at offset. Block 0
+ * goes out together with the rest of zp.
+ */
+int writeViews(int fd, off_t offset, int e, int b, View views[3], z* zp) {
+	if (b == 0) {
+		memcpy(&zp->ve, &views[e], sizeof(View));
+		memcpy(&zp->ve1, &views[(e + 1) % 3], sizeof(View));
+		if (pwrite(fd, zp, sizeof(z), offset) != sizeof(z))
+			return 1;
 	}
+	else {
+		off_t pos = offset + proofRoundSize(b);
+		if ((pwrite(fd, &views[e], sizeof(View), pos) != sizeof(View)) ||
+			(pwrite(fd, &views[(e + 1) % 3], sizeof(View), pos + sizeof(View)) != sizeof(View)))
+			return 1;
+	}
+	return 0;
+}
 
-	gettimeofday(&begin,NULL);
-	unsigned char rs[NUM_ROUNDS][3][4];
-	unsigned char keys[NUM_ROUNDS][3][16];
-	a as[NUM_ROUNDS];
-	View localViews[NUM_ROUNDS][3];
-	int totalCrypto = 0;
-	
-	//Generating keys
-	clock_t beginCrypto = clock(), deltaCrypto;
-	if(RAND_bytes((unsigned char *)keys, NUM_ROUNDS*3*16) != 1) {
-		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+/*
+ * ZKB++ counterpart of writeViews(): party e+1's gate outputs, and party 2's
+ * input share when party 2 is opened and block b takes fresh input shares.
+ */
+int writeCompactViews(int fd, off_t offset, int e, int b, int fresh, View views[3], zpp* zp) {
+	static const unsigned char noShare[SHA512_CBLOCK];
+	const unsigned char* x = ((e == 0) || !fresh) ? noShare : views[2].x;
+
+	if (b == 0) {
+		memcpy(zp->ve1.x, x, sizeof(zp->ve1.x));
+		memcpy(zp->ve1.y, views[(e + 1) % 3].y, sizeof(zp->ve1.y));
+		if (pwrite(fd, zp, sizeof(zpp), offset) != sizeof(zpp))
+			return 1;
 	}
-	if(RAND_bytes((unsigned char *)rs, NUM_ROUNDS*3*4) != 1) {
-		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+	else {
+		off_t pos = offset + compactRoundSize(b);
+		if ((pwrite(fd, x, sizeof(views->x), pos) != sizeof(views->x)) ||
+			(pwrite(fd, views[(e + 1) % 3].y, sizeof(views->y), pos + offsetof(View, y)) != sizeof(views->y)))
+			return 1;
 	}
-	
+	return 0;
+}
 
-	//Sharing secrets
-	unsigned char shares[NUM_ROUNDS][3][i];
-	if(RAND_bytes((unsigned char *)shares, NUM_ROUNDS*3*i) != 1) {
-		printf("RAND_bytes failed crypto, aborting\n");
-		return 0;
+// Round record being written, in the format selected by compactProof
+typedef union {
+	z full;
+	zpp compact;
+} record;
+
+void packRecord(record* rec, int e, unsigned char keys[3][16], unsigned char rs[3][4], const a* ak) {
+	if (compactProof)
+		packZpp(&rec->compact, e, keys, rs, ak);
+	else
+		packZ(&rec->full, e, keys, rs);
+}
+
+int writeRecord(int fd, off_t offset, int e, int b, inputStream* in, View views[3], record* rec) {
+	if (compactProof)
+		return writeCompactViews(fd, offset, e, b, !in->hmac || hmac_secret(in->hmac, b), views, &rec->compact);
+	return writeViews(fd, offset, e, b, views, &rec->full);
+}
+
+size_t recordSize(int numBlocks) {
+	return compactProof ? compactRoundSize(numBlocks) : proofRoundSize(numBlocks);
+}
+
+// Offsets of a[] or zppHeader and of the first round record, and the size of the whole proof
+off_t proofStart() {
+	if (hmacProof)
+		return sizeof(hmacHeader);
+	return prefixProof ? sizeof(prefixHeader) : 0;
+}
+
+off_t recordsStart() {
+	return proofStart() + (compactProof ? sizeof(zppHeader) : sizeof(a) * NUM_ROUNDS);
+}
+
+size_t proofSize(int numBlocks) {
+	return recordsStart() + (size_t)NUM_ROUNDS * recordSize(numBlocks);
+}
+
+/*
+ * Writes the round record for challenge e at offset. Views come from the
+ * commit() cache when there is one, otherwise the round is run again from its
+ * keys, which yields exactly the same views.
+ */
+int prove(int fd, off_t offset, int e, inputStream* in, unsigned char keys[3][16], unsigned char rs[3][4], View* cache, const a* ak) {
+	record* zp = malloc(sizeof(record));
+	View* blockViews = NULL;
+	roundState rst;
+	int ret = 0;
+
+	packRecord(zp, e, keys, rs, ak);
+	if (!cache) {
+		blockViews = malloc(3 * sizeof(View));
+		initRound(&rst, keys, in->iv);
 	}
-	#pragma omp parallel for
-	for(int k=0; k<NUM_ROUNDS; k++) {
 
-		for (int j = 0; j < i; j++) {
-			shares[k][2][j] = input[j] ^ shares[k][0][j] ^ shares[k][1][j];
+	for (int b = 0; (b < in->numBlocks) && !ret; b++) {
+		View* views = blockViews;
+		if (cache)
+			views = &cache[b * 3];
+		else if (runBlock(&rst, in, b, views) != 0) {
+			ret = 1;
+			break;
 		}
+		ret = writeRecord(fd, offset, e, b, in, views, zp);
+	}
 
+	if (!cache) {
+		freeRound(&rst);
+		free(blockViews);
 	}
+	free(zp);
 
-	//Generating randomness
-	unsigned char *randomness[NUM_ROUNDS][3];
-	//#pragma omp parallel for
-	for(int k=0; k<NUM_ROUNDS; k++) {
-		for(int j = 0; j<3; j++) {
-			randomness[k][j] = malloc(rSize*sizeof(unsigned char));
-			getAllRandomness(keys[k][j], randomness[k][j]);
+	return ret;
+}
+
+/*
+ * prove() for n rounds without cached views: the batch is run again on the
+ * bitsliced circuit. Round l's record is at offset + l * recordSize().
+ */
+int proveSliced(int fd, off_t offset, int n, int es[], inputStream* in, unsigned char keys[][3][16], unsigned char rs[][3][4], const a* as) {
+	record* zp = malloc(n * sizeof(record));
+	off_t stride = recordSize(in->numBlocks);
+	sliceBatch sb;
+	int ret = 0;
+
+	initBatch(&sb, n, keys, in->iv);
+	for (int l = 0; l < n; l++)
+		packRecord(&zp[l], es[l], keys[l], rs[l], &as[l]);
+
+	for (int b = 0; (b < in->numBlocks) && !ret; b++) {
+		if (runBatchBlock(&sb, in, b, NULL) != 0) {
+			ret = 1;
+			break;
 		}
+		for (int l = 0; (l < n) && !ret; l++)
+			ret = writeRecord(fd, offset + l * stride, es[l], b, in, sb.sc.views[l], &zp[l]);
+	}
+
+	freeBatch(&sb);
+	free(zp);
+
+	return ret;
+}
+
+
+
+/*
+ * Proves the message in and writes the proof to fd: a[] at offset 0, then one
+ * record per round. A ZKB++ proof has zppHeader in place of a[].
+ */
+int proveInput(inputStream* in, int fd) {
+	long inMilli;
+
+	printf("String length: %llu\n", (unsigned long long)in->len);
+	if (prefixProof)
+		printf("Public prefix: %llu bytes, %d blocks in the clear\n", (unsigned long long)prefixLen, in->firstBlock);
+	if (in->hmac) {
+		if (hmacIterations)
+			printf("PBKDF2: %llu iterations, %llu byte salt\n", (unsigned long long)hmacIterations, (unsigned long long)hmacMessageLen);
+		else
+			printf("HMAC: %llu byte message\n", (unsigned long long)hmacMessageLen);
+		printf("Number of compressions: %d, %d for the key\n", in->numBlocks, in->hmac->keyBlocks);
 	}
+	else
+		printf("Number of blocks: %d\n", in->numBlocks);
+	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+	printf("Proof format: %s\n", compactProof ? "ZKB++" : "ZKBoo");
+	//Rounds are spread over the threads in bitsliced batches of up to SLICE_LANES
+	char* env = getenv("ZKBOO_BITSLICE");
+	int bitslice = !(env && (strcmp(env, "0") == 0));
+	int batchSize = (NUM_ROUNDS + omp_get_max_threads() - 1) / omp_get_max_threads();
+	if (batchSize > SLICE_LANES)
+		batchSize = SLICE_LANES;
+	if (bitslice)
+		printf("Engine: bitsliced, %d rounds per batch\n", batchSize);
+	else
+		printf("Engine: per round, lane backend %s\n", lanes_name);
+
+	unsigned char (*rs)[3][4];
+	unsigned char (*keys)[3][16];
+	a* as;
+	int* es;
+	View** localViews;
+	View* viewCache = NULL;
+	int failed = 0;
+
+	//Views are kept between the two passes only while they fit in VIEW_CACHE_BYTES
+	size_t viewBytes = (size_t)in->numBlocks * 3 * sizeof(View);
+	int cacheViews = (viewBytes * NUM_ROUNDS <= VIEW_CACHE_BYTES);
+
+	//All per round state of the proof lives in one arena
+	arena ar;
+	if (arena_init(&ar, ARENA_BYTES(NUM_ROUNDS * sizeof(*rs)) + ARENA_BYTES(NUM_ROUNDS * sizeof(*keys))
+			+ ARENA_BYTES(NUM_ROUNDS * sizeof(a))
+			+ ARENA_BYTES(NUM_ROUNDS * sizeof(int)) + ARENA_BYTES(NUM_ROUNDS * sizeof(View*))
+			+ (cacheViews ? ARENA_BYTES(NUM_ROUNDS * viewBytes) : 0)) != 0) {
+		printf("Unable to allocate memory for %d rounds!\n", NUM_ROUNDS);
+		return 1;
+	}
+	rs = arena_alloc(&ar, NUM_ROUNDS * sizeof(*rs));
+	keys = arena_alloc(&ar, NUM_ROUNDS * sizeof(*keys));
+	as = arena_alloc(&ar, NUM_ROUNDS * sizeof(a));
+	es = arena_alloc(&ar, NUM_ROUNDS * sizeof(int));
+	localViews = arena_alloc(&ar, NUM_ROUNDS * sizeof(View*));
+	if (cacheViews)
+		viewCache = arena_alloc(&ar, NUM_ROUNDS * viewBytes);
 
-	#pragma omp parallel for
+	//Generating keys
+	stats_reset();
+	stats_begin("keys");
+	if(seed_bytes((unsigned char *)keys, NUM_ROUNDS*3*16) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		arena_free(&ar);
+		return 1;
+	}
+	if(seed_bytes((unsigned char *)rs, NUM_ROUNDS*3*4) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		arena_free(&ar);
+		return 1;
+	}
+
+	//Running MPC-SHA512 and committing
+	stats_begin("commit");
 	for(int k=0; k<NUM_ROUNDS; k++) {
-		as[k] = commit(i, shares[k], randomness[k], rs[k], localViews[k]);
-		for(int j=0; j<3; j++) {
-			free(randomness[k][j]);
+		localViews[k] = cacheViews ? &viewCache[(size_t)k * in->numBlocks * 3] : NULL;
+	}
+	if (bitslice) {
+		int numBatches = (NUM_ROUNDS + batchSize - 1) / batchSize;
+		#pragma omp parallel for
+		for(int s=0; s<numBatches; s++) {
+			int first = s * batchSize;
+			int n = (NUM_ROUNDS - first < batchSize) ? NUM_ROUNDS - first : batchSize;
+			commitSliced(in, n, &keys[first], &rs[first], &localViews[first], &as[first], &failed);
 		}
 	}
-	
-	//Committing
-	#pragma omp parallel for
-	for(int k=0; k<NUM_ROUNDS; k++) {
-		unsigned char hash1[SHA512_DIGEST_LENGTH];
-		H(keys[k][0], localViews[k][0], rs[k][0], hash1);
-		memcpy(as[k].h[0], &hash1, 64);
-		H(keys[k][1], localViews[k][1], rs[k][1], hash1);
-		memcpy(as[k].h[1], &hash1, 64);
-		H(keys[k][2], localViews[k][2], rs[k][2], hash1);
-		memcpy(as[k].h[2], hash1, 64);
+	else {
+		#pragma omp parallel for
+		for(int k=0; k<NUM_ROUNDS; k++) {
+			as[k] = commit(in, keys[k], rs[k], localViews[k], &failed);
+		}
+	}
+	if (failed) {
+		printf("Unable to read input!\n");
+		arena_free(&ar);
+		return 1;
 	}
 
 	//Generating E
-	int es[NUM_ROUNDS];
+	stats_begin("challenge");
 	uint64_t finalHash[8];
 	for (int j = 0; j < 8; j++) {
 		finalHash[j] = as[0].yp[0][j]^as[0].yp[1][j]^as[0].yp[2][j];
 	}
-	H3(finalHash, as, NUM_ROUNDS, es);
-
+	printf("%s obtained is: ", !in->hmac ? "hash" : hmacIterations ? "PBKDF2 key" : "HMAC");
+	for (int j = 0; j < variant->outWords; j++) {
+		printf("%016lX", finalHash[j]);
+	}
+	printf("\n");
+	if (hmacProof)
+		H3(finalHash, &hmacStatement, sizeof(hmacHeader), as, NUM_ROUNDS, es);
+	else
+		H3(finalHash, prefixProof ? &publicPrefix : NULL, sizeof(prefixHeader), as, NUM_ROUNDS, es);
+
+
+	//Packing Z and writing to file
+	stats_begin("prove");
+	if (prefixProof && (pwrite(fd, &publicPrefix, sizeof(publicPrefix), 0) != sizeof(publicPrefix)))
+		failed = 1;
+	if (hmacProof && (pwrite(fd, &hmacStatement, sizeof(hmacStatement), 0) != sizeof(hmacStatement)))
+		failed = 1;
+	if (compactProof) {
+		zppHeader hdr;
+		memcpy(hdr.magic, ZKBPP_MAGIC, sizeof(hdr.magic));
+		memcpy(hdr.y, finalHash, sizeof(hdr.y));
+		if (pwrite(fd, &hdr, sizeof(hdr), proofStart()) != sizeof(hdr))
+			failed = 1;
+	}
+	else if (pwrite(fd, as, sizeof(a) * NUM_ROUNDS, proofStart()) != sizeof(a) * NUM_ROUNDS)
+		failed = 1;
+
+	if (bitslice && !cacheViews) {
+		int numBatches = (NUM_ROUNDS + batchSize - 1) / batchSize;
+		#pragma omp parallel for
+		for(int s=0; s<numBatches; s++) {
+			int first = s * batchSize;
+			int n = (NUM_ROUNDS - first < batchSize) ? NUM_ROUNDS - first : batchSize;
+			off_t offset = recordsStart() + (off_t)first * recordSize(in->numBlocks);
+			if (proveSliced(fd, offset, n, &es[first], in, &keys[first], &rs[first], &as[first]) != 0)
+				failed = 1;
+		}
+	}
+	else {
+		#pragma omp parallel for
+		for(int k=0; k<NUM_ROUNDS; k++) {
+			off_t offset = recordsStart() + (off_t)k * recordSize(in->numBlocks);
+			if (prove(fd, offset, es[k], in, keys[k], rs[k], localViews[k], &as[k]) != 0)
+				failed = 1;
+		}
+	}
+	arena_free(&ar);
+	inMilli = stats_totalMs();
+	stats_report("MPC_SHA512", NUM_ROUNDS);
+	if (failed) {
+		printf("Unable to write proof!\n");
+		return 1;
+	}
 
-	//Packing Z
-	z* zs = malloc(sizeof(z)*NUM_ROUNDS);
+	printf("\n");
+	printf("time taken: %ld miliseconds\n",inMilli);
 
-	//#pragma omp parallel for
-	for(int i = 0; i<NUM_ROUNDS; i++) {
-		zs[i] = prove(es[i],keys[i],rs[i], localViews[i]);
-	}
-	
-	gettimeofday(&delta,NULL);
-	unsigned long inMilli = (delta.tv_sec - begin.tv_sec)*1000000 + (delta.tv_usec - begin.tv_usec);
-	inMilli /= 1000;
+	return 0;
+}
 
-	
-	//Writing to file
-	FILE *file;
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	inputStream in;
+	char userInput[2 * 1024 + 2];
+	unsigned char message[1024];
 
-	char outputFile[3*sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "wb");
-	if (!file) {
-		printf("Unable to open file!");
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_PROVER | CLI_COMPACT | CLI_PREFIX | CLI_HASH | CLI_HMAC, &opt) != 0)
+		return 1;
+	if (opt.hash && (variant_select(opt.hash) != 0)) {
+		printf("Unknown hash %s, use sha512, sha384 or sha512-256\n", opt.hash);
 		return 1;
 	}
-	fwrite(as, sizeof(a), NUM_ROUNDS, file);
-	fwrite(zs, sizeof(z), NUM_ROUNDS, file);
+	if (opt.hmac && (variant->outWords != 8)) {
+		printf("HMAC is only proven for sha512\n");
+		return 1;
+	}
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	seed_init(opt.seed);
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	compactProof = opt.compact;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	srand((unsigned) time(NULL));
+	init_EVP();
+	lanes_init();
+	//
+	unsigned char garbage[4];
+	if(seed_bytes(garbage, 4) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		return 0;
+	}
 
-	fclose(file);
+	if (opt.prefix) {
+		struct stat st;
+		size_t size = 0;
+		if ((stat(opt.prefix, &st) != 0) || ((st.st_size > 0) && !(prefix = mapProof(opt.prefix, &size)))) {
+			printf("Unable to open prefix file %s!\n", opt.prefix);
+			return 1;
+		}
+		prefixLen = size;
+		if (prefix_midstate(prefix, prefixLen, &publicPrefix) != 0) {
+			printf("Prefix file %s is %llu bytes, it must be a multiple of %d!\n", opt.prefix, (unsigned long long)prefixLen, SHA512_CBLOCK);
+			return 1;
+		}
+		prefixProof = 1;
+	}
 
-	free(zs);
+	if (opt.hmac) {
+		struct stat st;
+		size_t size = 0;
+		hmacPlan plan;
+		if ((stat(opt.hmac, &st) != 0) || ((st.st_size > 0) && !(hmacMessage = mapProof(opt.hmac, &size)))) {
+			printf("Unable to open HMAC message file %s!\n", opt.hmac);
+			return 1;
+		}
+		hmacMessageLen = size;
+		hmacIterations = opt.pbkdf2;
+		hmac_plan(&plan, hmacMessage, hmacMessageLen, hmacIterations, 0);
+		hmac_header(&plan, &hmacStatement);
+		hmacProof = 1;
+	}
 
+	if (opt.batch) {
+		//Each proof goes to a scratch file first, then out as one line of hex
+		FILE* proofs = cli_batchOutput(&opt);
+		FILE* scratch = tmpfile();
+		char* line = NULL;
+		size_t cap = 0;
+		long n;
+		int ret = 0;
+
+		if (!proofs || !scratch) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			long len = cli_message(&opt, line, n, (unsigned char *)line, n);
+			int failed = (len < 0);
+			if (!failed) {
+				setInput(&in, -1, (unsigned char *)line, len);
+				failed = (ftruncate(fileno(scratch), 0) != 0) || (proveInput(&in, fileno(scratch)) != 0) ||
+					(cli_hexWriteFile(proofs, fileno(scratch), proofSize(in.numBlocks)) != 0);
+			}
+			if (failed) {
+				printf("Unable to prove: %s\n", line);
+				fputc('\n', proofs);
+				ret = 1;
+			}
+		}
+		free(line);
+		fclose(scratch);
+		if (fclose(proofs) != 0)
+			ret = 1;
+		cleanup_EVP();
+		return ret;
+	}
 
+	if (opt.inputFile) {
+		uint64_t inLen;
+		int inFd = open(opt.inputFile, O_RDONLY);
+		if ((inFd < 0) || ((inFd = spoolInput(inFd, &opt, &inLen)) < 0)) {
+			printf("Unable to read input file %s%s!\n", opt.inputFile, opt.hex ? " as hex" : "");
+			return 1;
+		}
+		setInput(&in, inFd, NULL, inLen);
+		printf("Input file: %s\n", opt.inputFile);
+	}
+	else {
+		printf("Enter the string to be hashed (Max 1024 characters): ");
+		if (!fgets(userInput, sizeof(userInput), stdin))
+			userInput[0] = 0;
+		long len = cli_message(&opt, userInput, strcspn(userInput, "\r\n"), message, sizeof(message));
+		if (len < 0) {
+			printf("Input must be at most %d bytes!\n", (int)sizeof(message));
+			return 1;
+		}
+		setInput(&in, -1, message, len);
+	}
 
-	printf("\n");
+	char outputFile[FILENAME_MAX];
+	cli_proofName(opt.out, NUM_ROUNDS, outputFile, sizeof(outputFile));
+	int fd = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		printf("Unable to open file!");
+		return 1;
+	}
+	int ret = proveInput(&in, fd);
+	if (close(fd) != 0)
+		ret = 1;
+	if (in.fd >= 0)
+		close(in.fd);
+	if (ret != 0)
+		return 1;
 	printf("Proof output to file %s\n", outputFile);
-	printf("time taken: %ld miliseconds\n",inMilli);
 
-	openmp_thread_cleanup();
 	cleanup_EVP();
 	return EXIT_SUCCESS;
 }
@@ -19,10 +19,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <sys/resource.h>
 #include "shared512.h"
+#include "../common/cli.h"
 
 int NUM_ROUNDS = 32;
+// Header a proof must carry when --prefix is given
+int checkPrefix = 0;
+prefixHeader expectedPrefix;
+// Header and step plan a proof must have when --hmac is given
+int checkHmac = 0;
+hmacHeader expectedHmac;
+hmacPlan hmacSteps;
 
 void printbits(uint64_t n) {
 	if (n) {
@@ -34,67 +42,378 @@ void printbits(uint64_t n) {
 
 
 
-int main(void) {
-	setbuf(stdout, NULL);
-	init_EVP();
-	openmp_thread_setup();
-	struct timeval begin, delta;
-	
-	int passed = 1;
+/*
+ * Round checks are run by all threads over all rounds. As soon as one round
+ * fails, stop is set and the other threads give up their current round and
+ * skip the rest. failedRound gets the first failing round any thread saw.
+ */
+typedef struct {
+	int stop;
+	int failedRound;
+} verifyPool;
+
+void failRound(verifyPool* pool, int round) {
+	#pragma omp critical(verifyPool)
+	{
+		if (!pool->stop || (round < pool->failedRound))
+			pool->failedRound = round;
+		#pragma omp atomic write
+		pool->stop = 1;
+	}
+}
 
-	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+int stopped(verifyPool* pool) {
+	int s;
+	#pragma omp atomic read
+	s = pool->stop;
+	return s;
+}
 
-	
-	a as[NUM_ROUNDS];
-	z zs[NUM_ROUNDS];
-	FILE *file;
+// The output words a variant does not keep must be zero, see sha512Variant
+int droppedZero(const uint64_t y[8]) {
+	for (int i = variant->outWords; i < 8; i++)
+		if (y[i] != 0)
+			return 0;
+	return 1;
+}
 
-	char outputFile[3*sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "rb");
-	if (!file) {
-		printf("Unable to open file!");
+/*
+ * Runs check (VERIFY_OUTPUT, VERIFY_COMMITMENT or VERIFY_CIRCUIT) on every
+ * round of a ZKBoo proof whose circuit starts from iv, or follows hmac.
+ * Returns VERIFY_OK or check.
+ */
+int checkRounds(int check, const unsigned char* records, const a* as, const int* es, int numBlocks, const uint64_t iv[8], const hmacPlan* hmac, verifyPool* pool) {
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i<NUM_ROUNDS; i++) {
+		const unsigned char* record = records + (size_t)i * proofRoundSize(numBlocks);
+		int failed;
+		if (stopped(pool))
+			continue;
+		if (check == VERIFY_OUTPUT)
+			failed = verifyOutputs(&as[i], es[i], record, numBlocks, hmac);
+		else if (check == VERIFY_COMMITMENT)
+			failed = verifyCommitments(&as[i], es[i], record, numBlocks);
+		else
+			failed = verifyCircuit(record, numBlocks, iv, hmac, &pool->stop) && !stopped(pool);
+		if (failed)
+			failRound(pool, i);
 	}
-	fread(&as, sizeof(a), NUM_ROUNDS, file);
-	fread(&zs, sizeof(z), NUM_ROUNDS, file);
-	fclose(file);
+	return pool->stop ? check : VERIFY_OK;
+}
+
+/*
+ * Fits the HMAC plan to a proof of numBlocks steps, the ones not accounted for
+ * being key blocks. Returns 1 when no key gives that many.
+ */
+int fitPlan(hmacPlan* hmac, int numBlocks) {
+	int keyBlocks = numBlocks - hmac_fixedSteps(hmac);
+
+	if ((keyBlocks < 0) || (keyBlocks == 1))
+		return 1;
+	hmac_plan(hmac, hmac->msg, hmac->msgLen, hmac->iterations, keyBlocks);
+	return 0;
+}
+
+// H3() over the header the proof started with
+void challenges(uint64_t y[8], const prefixHeader* pub, const hmacPlan* hmac, const a* as, int* es) {
+	if (hmac)
+		H3(y, &expectedHmac, sizeof(hmacHeader), as, NUM_ROUNDS, es);
+	else
+		H3(y, pub, sizeof(prefixHeader), as, NUM_ROUNDS, es);
+}
 
-	gettimeofday(&begin,NULL);
+/*
+ * Checks a ZKB++ proof of NUM_ROUNDS rounds: a[] is rebuilt from the round
+ * records and must hash to the challenges the records were opened for. Only
+ * malformed records can be caught before every round has been rebuilt.
+ */
+int verifyCompactProof(const unsigned char* proof, size_t proofSize, const prefixHeader* pub, hmacPlan* hmac, verifyPool* pool) {
+	const uint64_t* iv = pub ? pub->iv : variant->iv;
+	size_t fixedSize = sizeof(zppHeader) + NUM_ROUNDS * sizeof(zpp);
+	size_t blockSize = NUM_ROUNDS * sizeof(View);
+	if ((proofSize < fixedSize) || ((proofSize - fixedSize) % blockSize != 0))
+		return VERIFY_MALFORMED;
+	int numBlocks = 1 + (proofSize - fixedSize) / blockSize;
+	if (hmac && (fitPlan(hmac, numBlocks) != 0))
+		return VERIFY_MALFORMED;
+	const unsigned char* records = proof + sizeof(zppHeader);
+	printf("Number of blocks: %d\n", numBlocks);
+	printf("Proof format: ZKB++\n");
 
 	uint64_t y[8];
-	reconstruct(as[0].yp[0],as[0].yp[1],as[0].yp[2],y);
+	memcpy(y, ((const zppHeader*)proof)->y, sizeof(y));
 	printf("Proof for hash: ");
-	for(int i=0;i<8;i++) {
-		printf("%02lX", y[i]);
+	for(int i=0;i<variant->outWords;i++) {
+		printf("%016lX", y[i]);
 	}
 	printf("\n");
+	if (!droppedZero(y))
+		return VERIFY_MALFORMED;
+
+	for(int i = 0; i<NUM_ROUNDS; i++) {
+		if (((const zpp*)(records + (size_t)i * compactRoundSize(numBlocks)))->e > 2) {
+			pool->failedRound = i;
+			return VERIFY_MALFORMED;
+		}
+	}
 
+	a* as = malloc(NUM_ROUNDS * sizeof(a));
+	int* es = malloc(NUM_ROUNDS * sizeof(int));
+	int ret = VERIFY_OK;
 
+	stats_begin("rebuild");
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i<NUM_ROUNDS; i++) {
+		if (stopped(pool))
+			continue;
+		if ((verifyCompact(y, records + (size_t)i * compactRoundSize(numBlocks), numBlocks, iv, hmac, &as[i], &pool->stop) != 0) && !stopped(pool))
+			failRound(pool, i);
+	}
+	if (pool->stop)
+		ret = VERIFY_CIRCUIT;
+	else {
+		stats_begin("challenge");
+		challenges(y, pub, hmac, as, es);
+		for(int i = 0; (i<NUM_ROUNDS) && (ret == VERIFY_OK); i++) {
+			if (((const zpp*)(records + (size_t)i * compactRoundSize(numBlocks)))->e != es[i]) {
+				pool->failedRound = i;
+				ret = VERIFY_CHALLENGE;
+			}
+		}
+	}
+	free(as);
+	free(es);
 
-	int es[NUM_ROUNDS];
-	H3(y, as, NUM_ROUNDS, es);
+	return ret;
+}
 
+/*
+ * Checks a ZKBoo proof of NUM_ROUNDS rounds: first that every round's output
+ * shares give the same hash and match the opened views, then the commitments
+ * of all rounds, and only then the circuits. Pages of the proof are released
+ * as the circuits are checked.
+ */
+int verifyFullProof(const unsigned char* proof, size_t proofSize, const prefixHeader* pub, hmacPlan* hmac, verifyPool* pool) {
+	const uint64_t* iv = pub ? pub->iv : variant->iv;
+	//a[] and the round records are used in place, the block count follows from the size
+	size_t fixedSize = NUM_ROUNDS * (sizeof(a) + sizeof(z));
+	size_t blockSize = NUM_ROUNDS * 2 * sizeof(View);
+	if ((proofSize < fixedSize) || ((proofSize - fixedSize) % blockSize != 0))
+		return VERIFY_MALFORMED;
+	int numBlocks = 1 + (proofSize - fixedSize) / blockSize;
+	if (hmac && (fitPlan(hmac, numBlocks) != 0))
+		return VERIFY_MALFORMED;
+	const a* as = (const a*)proof;
+	const unsigned char* records = proof + sizeof(a) * NUM_ROUNDS;
+	printf("Number of blocks: %d\n", numBlocks);
 
-	#pragma omp parallel for
-	for(int i = 0; i<NUM_ROUNDS; i++) {
-		int verifyResult = verify(as[i], es[i], zs[i]);
-		if (verifyResult != 0) {
-			printf("Not Verified %d\n", i);
-			passed = 0;
+	uint64_t y[8];
+	reconstruct(as[0].yp[0],as[0].yp[1],as[0].yp[2],y);
+	printf("Proof for hash: ");
+	for(int i=0;i<variant->outWords;i++) {
+		printf("%016lX", y[i]);
+	}
+	printf("\n");
+	if (!droppedZero(y))
+		return VERIFY_OUTPUT;
+
+	for(int i = 1; i<NUM_ROUNDS; i++) {
+		uint64_t yi[8];
+		reconstruct(as[i].yp[0],as[i].yp[1],as[i].yp[2],yi);
+		if (memcmp(y, yi, sizeof(y)) != 0) {
+			pool->failedRound = i;
+			return VERIFY_OUTPUT;
 		}
 	}
-	if (passed)
+
+	int* es = malloc(NUM_ROUNDS * sizeof(int));
+	int ret;
+
+	stats_begin("challenge");
+	challenges(y, pub, hmac, as, es);
+	stats_begin("outputs");
+	ret = checkRounds(VERIFY_OUTPUT, records, as, es, numBlocks, iv, hmac, pool);
+	if (ret == VERIFY_OK) {
+		stats_begin("commitments");
+		ret = checkRounds(VERIFY_COMMITMENT, records, as, es, numBlocks, iv, hmac, pool);
+	}
+	if (ret == VERIFY_OK) {
+		stats_begin("circuits");
+		ret = checkRounds(VERIFY_CIRCUIT, records, as, es, numBlocks, iv, hmac, pool);
+	}
+	free(es);
+
+	return ret;
+}
+
+/*
+ * Checks a proof of NUM_ROUNDS rounds, telling ZKB++ proofs and proofs with a
+ * public prefix or an HMAC statement apart by their headers. Returns VERIFY_OK or the VERIFY_ code of the first check that
+ * failed; *failedRound is the round it failed in, or -1.
+ */
+int verifyProof(const unsigned char* proof, size_t proofSize, int* failedRound) {
+	verifyPool pool = { 0, -1 };
+	long inMilli;
+	int ret;
+
+	const prefixHeader* pub = NULL;
+	const hmacHeader* hh = NULL;
+	hmacPlan plan = hmacSteps;
+
+	stats_reset();
+	stats_begin("read");
+	if ((proofSize >= sizeof(prefixHeader)) && (memcmp(proof, PREFIX_MAGIC, 8) == 0)) {
+		pub = (const prefixHeader*)proof;
+		proof += sizeof(prefixHeader);
+		proofSize -= sizeof(prefixHeader);
+		printf("Public prefix: %llu bytes in the clear\n", (unsigned long long)pub->publicBytes);
+	}
+	else if ((proofSize >= sizeof(hmacHeader)) && (memcmp(proof, HMAC_MAGIC, 8) == 0)) {
+		hh = (const hmacHeader*)proof;
+		proof += sizeof(hmacHeader);
+		proofSize -= sizeof(hmacHeader);
+		if (hh->iterations)
+			printf("PBKDF2: %llu iterations, %llu byte salt\n", (unsigned long long)hh->iterations, (unsigned long long)hh->messageBytes);
+		else
+			printf("HMAC: %llu byte message\n", (unsigned long long)hh->messageBytes);
+	}
+	if ((checkPrefix != (pub != NULL)) || (pub && (memcmp(pub, &expectedPrefix, sizeof(prefixHeader)) != 0)))
+		ret = VERIFY_PREFIX;
+	else if ((checkHmac != (hh != NULL)) || (hh && (memcmp(hh, &expectedHmac, sizeof(hmacHeader)) != 0)))
+		ret = VERIFY_HMAC;
+	else if (pub && (pub->publicBytes % SHA512_CBLOCK != 0))
+		ret = VERIFY_MALFORMED;
+	else if ((proofSize >= sizeof(zppHeader)) && (memcmp(proof, ZKBPP_MAGIC, 8) == 0))
+		ret = verifyCompactProof(proof, proofSize, pub, hh ? &plan : NULL, &pool);
+	else
+		ret = verifyFullProof(proof, proofSize, pub, hh ? &plan : NULL, &pool);
+	*failedRound = pool.failedRound;
+	if (ret == VERIFY_OK)
 		printf("Verified ok\n");
-	
-	gettimeofday(&delta,NULL);
-        unsigned long inMilli = (delta.tv_sec - begin.tv_sec)*1000000 + (delta.tv_usec - begin.tv_usec);
-        inMilli /= 1000;	
+	else {
+		printf("Not Verified: %s check failed", verifyResultName(ret));
+		if (pool.failedRound >= 0)
+			printf(" at round %d", pool.failedRound);
+		printf("\n");
+	}
+
+	inMilli = stats_totalMs();
+	stats_report("MPC_SHA512_VERIFIER", NUM_ROUNDS);
 
 	printf("Total time: %ld miliseconds\n", inMilli);
-	
+	printf("Time per round: %.2f miliseconds\n", (double)inMilli / NUM_ROUNDS);
+
+	return ret;
+}
+
+int main(int argc, char* argv[]) {
+	cliOptions opt;
+	int ret = 0;
+
+	setbuf(stdout, NULL);
+	if (cli_parse(argc, argv, CLI_VERIFIER | CLI_PREFIX | CLI_HASH | CLI_HMAC, &opt) != 0)
+		return 1;
+	if (opt.hash && (variant_select(opt.hash) != 0)) {
+		printf("Unknown hash %s, use sha512, sha384 or sha512-256\n", opt.hash);
+		return 1;
+	}
+	if (opt.hmac && (variant->outWords != 8)) {
+		printf("HMAC is only proven for sha512\n");
+		return 1;
+	}
+	if (stats_init(opt.stats) != 0)
+		return 1;
+	if (opt.rounds)
+		NUM_ROUNDS = opt.rounds;
+	if (opt.threads)
+		omp_set_num_threads(opt.threads);
+	init_EVP();
+
+	if (opt.prefix) {
+		struct stat st;
+		const unsigned char* prefix = NULL;
+		size_t size = 0;
+		if ((stat(opt.prefix, &st) != 0) || ((st.st_size > 0) && !(prefix = mapProof(opt.prefix, &size)))) {
+			printf("Unable to open prefix file %s!\n", opt.prefix);
+			return 1;
+		}
+		checkPrefix = 1;
+		ret = prefix_midstate(prefix, size, &expectedPrefix);
+		if (prefix)
+			unmapProof(prefix, size);
+		if (ret != 0) {
+			printf("Prefix file %s is %llu bytes, it must be a multiple of %d!\n", opt.prefix, (unsigned long long)size, SHA512_CBLOCK);
+			return 1;
+		}
+	}
+
+	//The message stays mapped, the circuit needs it to derive the message blocks
+	if (opt.hmac) {
+		struct stat st;
+		const unsigned char* message = NULL;
+		size_t size = 0;
+		if ((stat(opt.hmac, &st) != 0) || ((st.st_size > 0) && !(message = mapProof(opt.hmac, &size)))) {
+			printf("Unable to open HMAC message file %s!\n", opt.hmac);
+			return 1;
+		}
+		hmac_plan(&hmacSteps, message, size, opt.pbkdf2, 0);
+		hmac_header(&hmacSteps, &expectedHmac);
+		checkHmac = 1;
+	}
+
+	if (opt.batch) {
+		FILE* results = cli_batchOutput(&opt);
+		unsigned char* proof = NULL;
+		char* line = NULL;
+		size_t cap = 0;
+		long n;
+
+		if (!results) {
+			printf("Unable to open file!\n");
+			return 1;
+		}
+		printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+		while ((n = cli_readLine(stdin, &line, &cap)) >= 0) {
+			int code = VERIFY_MALFORMED, round = -1;
+			proof = realloc(proof, n / 2 + 1);
+			long proofSize = cli_hexDecode(line, n, proof, n / 2);
+			if (proofSize >= 0)
+				code = verifyProof(proof, proofSize, &round);
+			if (code == VERIFY_OK)
+				fprintf(results, "Verified ok\n");
+			else {
+				fprintf(results, "Not Verified: %s check failed", verifyResultName(code));
+				if (round >= 0)
+					fprintf(results, " at round %d", round);
+				fputc('\n', results);
+				if (ret == 0)
+					ret = code;
+			}
+		}
+		free(proof);
+		free(line);
+		fclose(results);
+	}
+	else {
+		char outputFile[FILENAME_MAX];
+		size_t proofSize;
+
+		printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+		cli_proofName(opt.inputFile, NUM_ROUNDS, outputFile, sizeof(outputFile));
+		const unsigned char* proof = mapProof(outputFile, &proofSize);
+		if (!proof) {
+			printf("Unable to open file!");
+			return 1;
+		}
+		int round;
+		ret = verifyProof(proof, proofSize, &round);
+		unmapProof(proof, proofSize);
+	}
 
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("Peak RSS: %ld KB\n", usage.ru_maxrss);
 
-	openmp_thread_cleanup();
 	cleanup_EVP();
-	return EXIT_SUCCESS;
+	return ret;
 }
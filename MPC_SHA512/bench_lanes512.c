@@ -0,0 +1,208 @@
+/*
+ * Author: Tan Teik Guan
+ * Description : Benchmark of the lane backends for the SHA-512 gates
+ *
+ * Copyright 2022 pQCee
+ *
+ */
+
+/*
+ * Times the AND and ADD gates with every lane backend on the same random
+ * operands, checks that all backends give the same output as the bitwise
+ * reference, and scales the gate times by the gate count of one SHA-512
+ * compression (760 ADD, 640 AND per party view). The bitsliced gates of
+ * slice512.h are timed the same way, per round, with all SLICE_LANES lanes
+ * in use and tape and view transposes included.
+ *
+ * Usage: bench_lanes512.exe [number of gates]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <openssl/rand.h>
+#include "shared512.h"
+#include "slice512.h"
+
+#define ADD_PER_BLOCK 760
+#define AND_PER_BLOCK 640
+
+static double nowMicro() {
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+/*
+ * Opens the tapes of SLICE_LANES rounds from keys and points sc at their
+ * windows.
+ */
+static void openTapes(sliceCtx* sc, unsigned char keys[SLICE_LANES][3][16], tapeStream streams[SLICE_LANES][3], tapeWindow windows[SLICE_LANES]) {
+	for (int l = 0; l < SLICE_LANES; l++) {
+		tapeStream* sp[3] = { &streams[l][0], &streams[l][1], &streams[l][2] };
+		for (int j = 0; j < 3; j++)
+			tape_open(&streams[l][j], keys[l][j], TAPE_IV);
+		tape_window(&windows[l], 3, sp);
+		sc->tapes[l] = &windows[l];
+	}
+}
+
+static void closeTapes(tapeStream streams[SLICE_LANES][3]) {
+	for (int l = 0; l < SLICE_LANES; l++)
+		for (int j = 0; j < 3; j++)
+			tape_close(&streams[l][j]);
+}
+
+/*
+ * Runs numGates sliced ADD or AND gates over SLICE_LANES rounds and returns
+ * ns per gate per round, tape generation included. The last view's worth of
+ * outputs is checked against the bitwise lane backend, on tapes read again
+ * from the same keys.
+ */
+static double benchSliced(int isAdd, int numGates, int* mismatch) {
+	static uint64_t x[3][64], y[3][64], z[3][64];
+	static unsigned char keys[SLICE_LANES][3][16];
+	static tapeStream streams[SLICE_LANES][3];
+	static tapeWindow windows[SLICE_LANES];
+	View* views = malloc(SLICE_LANES * 3 * sizeof(View));
+	int perView = rSize / 8;
+	int lastView;
+	sliceCtx sc;
+	double start, ns;
+
+	RAND_bytes((unsigned char *)keys, sizeof(keys));
+	RAND_bytes((unsigned char *)x, sizeof(x));
+	RAND_bytes((unsigned char *)y, sizeof(y));
+	sc.lanes = SLICE_LANES;
+	for (int l = 0; l < SLICE_LANES; l++)
+		sc.views[l] = &views[l * 3];
+	openTapes(&sc, keys, streams, windows);
+
+	start = nowMicro();
+	for (int g = 0; g < numGates; g++) {
+		if (g % perView == 0)
+			sc.countY = 0;
+		if (isAdd)
+			slice_ADD(&sc, x, y, z);
+		else
+			slice_AND(&sc, x, y, z);
+	}
+	ns = (nowMicro() - start) * 1000.0 / ((double)numGates * SLICE_LANES);
+	closeTapes(streams);
+
+	lanes_select("bitwise");
+	*mismatch = 0;
+	lastView = numGates - sc.countY;
+	openTapes(&sc, keys, streams, windows);
+	for (int l = 0; l < SLICE_LANES; l++) {
+		uint64_t xl[3], yl[3], rl[3], out[3];
+		for (int j = 0; j < 3; j++) {
+			xl[j] = slice_getWord(x, j, l);
+			yl[j] = slice_getWord(y, j, l);
+		}
+		for (int g = 0; g < lastView; g++)
+			tape_next64(&windows[l], rl);
+		for (int g = 0; g < sc.countY; g++) {
+			tape_next64(&windows[l], rl);
+			if (isAdd)
+				lanes_ADD(xl, yl, rl, out);
+			else
+				lanes_AND(xl, yl, rl, out);
+			for (int j = 0; j < 3; j++)
+				if (views[l * 3 + j].y[g] != out[j])
+					*mismatch = 1;
+		}
+	}
+
+	closeTapes(streams);
+	free(views);
+	return ns;
+}
+
+int main(int argc, char * argv[]) {
+	const char * backends[] = { "bitwise", "scalar", "avx2" };
+	int numGates = 100000;
+	uint64_t * ops;
+	uint64_t * ref;
+	uint64_t * out;
+	uint64_t sink = 0;
+	double refBlock = 0;
+
+	setbuf(stdout, NULL);
+	tape_init();
+	if (argc > 1)
+		numGates = atoi(argv[1]);
+	if (numGates <= 0) {
+		printf("Usage: %s [number of gates]\n", argv[0]);
+		return -1;
+	}
+
+	// x, y, r for each gate, three parties each
+	ops = malloc(sizeof(uint64_t) * 9 * numGates);
+	ref = malloc(sizeof(uint64_t) * 6 * numGates);
+	out = malloc(sizeof(uint64_t) * 6 * numGates);
+	if (!ops || !ref || !out) {
+		printf("Unable to allocate %d gates\n", numGates);
+		return -1;
+	}
+	if (RAND_bytes((unsigned char *)ops, sizeof(uint64_t) * 9 * numGates) != 1) {
+		printf("RAND_bytes failed crypto, aborting\n");
+		return -1;
+	}
+
+	printf("Gates per run: %d\n", numGates);
+	printf("%-8s %12s %12s %14s %9s\n", "backend", "ADD ns", "AND ns", "block us", "speedup");
+	for (int k = 0; k < (int)(sizeof(backends) / sizeof(backends[0])); k++) {
+		double start, addNs, andNs, blockUs;
+		uint64_t * dst = k == 0 ? ref : out;
+
+		if (lanes_select(backends[k]) != 0) {
+			printf("%-8s not available on this CPU\n", backends[k]);
+			continue;
+		}
+
+		start = nowMicro();
+		for (int i = 0; i < numGates; i++)
+			lanes_ADD(ops + 9*i, ops + 9*i + 3, ops + 9*i + 6, dst + 6*i);
+		addNs = (nowMicro() - start) * 1000.0 / numGates;
+
+		start = nowMicro();
+		for (int i = 0; i < numGates; i++)
+			lanes_AND(ops + 9*i, ops + 9*i + 3, ops + 9*i + 6, dst + 6*i + 3);
+		andNs = (nowMicro() - start) * 1000.0 / numGates;
+
+		for (int i = 0; i < 6 * numGates; i++)
+			sink ^= dst[i];
+		if (k > 0 && memcmp(ref, out, sizeof(uint64_t) * 6 * numGates) != 0) {
+			printf("%-8s output differs from bitwise reference!\n", backends[k]);
+			return 1;
+		}
+
+		blockUs = (ADD_PER_BLOCK * addNs + AND_PER_BLOCK * andNs) / 1000.0;
+		if (k == 0)
+			refBlock = blockUs;
+		printf("%-8s %12.1f %12.1f %14.1f %8.1fx\n", backends[k], addNs, andNs, blockUs, refBlock / blockUs);
+	}
+
+	{
+		int badAdd, badAnd;
+		double addNs = benchSliced(1, numGates, &badAdd);
+		double andNs = benchSliced(0, numGates, &badAnd);
+		double blockUs = (ADD_PER_BLOCK * addNs + AND_PER_BLOCK * andNs) / 1000.0;
+
+		if (badAdd || badAnd) {
+			printf("%-8s output differs from bitwise reference!\n", "sliced");
+			return 1;
+		}
+		printf("%-8s %12.1f %12.1f %14.1f %8.1fx\n", "sliced", addNs, andNs, blockUs, refBlock / blockUs);
+	}
+	printf("checksum %016lX\n", sink);
+
+	free(ops);
+	free(ref);
+	free(out);
+	return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * Name: hmac512.h
+ * Author: Tan Teik Guan
+ * Description: HMAC-SHA512 and PBKDF2-HMAC-SHA512 over the SHA-512 circuit
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * HMAC-SHA512(K, m) = H((K ^ opad) || H((K ^ ipad) || m)) with a secret key
+ * and a public message, and PBKDF2-HMAC-SHA512(P, S, c) for one 64 byte
+ * output block, which is U1 ^ ... ^ Uc with U1 = HMAC(P, S || INT(1)) and
+ * Uj = HMAC(P, Uj-1), are run as a chain of SHA-512 compressions ("steps").
+ * Every step is a block of the proof, with its own pair of views, so the
+ * commitments, tapes and proof records are those of a multi-block SHA-512
+ * proof. Steps are, in order:
+ *
+ *   HMAC_KEY    blocks of a key longer than a block, hashed down to 64 bytes
+ *   HMAC_IPAD   the K ^ ipad block, from hA
+ *   HMAC_OPAD   the K ^ opad block, from hA
+ *   HMAC_MSG    the public message blocks of the first inner hash, from the
+ *               ipad chaining value
+ *   HMAC_OUTER  the inner digest, from the opad chaining value
+ *   HMAC_INNER  Uj-1, from the ipad chaining value (PBKDF2 only), each
+ *               followed by another HMAC_OUTER
+ *
+ * The ipad and opad chaining values are computed once and kept, so every
+ * PBKDF2 iteration costs two compressions. Only the key blocks, or the ipad
+ * block of a key that fits in one block, take fresh input shares. Every other
+ * block is a function of a party's own earlier shares and public constants,
+ * which each party applies to its share (XOR with a constant three times is
+ * XOR with it once), so the verifier derives those blocks itself and checks
+ * them against the opened views. The output shares are those of the last
+ * HMAC_OUTER for HMAC, and the XOR of all HMAC_OUTER outputs for PBKDF2.
+ *
+ * Proofs start with an hmacHeader, which is hashed into the challenges and
+ * names the message by its SHA-512 hash.
+ *
+ * Included by shared512.h.
+ */
+
+#ifndef HMAC512_H_
+#define HMAC512_H_
+
+#define HMAC_MAGIC "HMAC-512"
+
+typedef struct {
+	char magic[8];
+	uint64_t iterations;	// 0 for HMAC, PBKDF2 iteration count otherwise
+	uint64_t messageBytes;
+	unsigned char messageHash[64];
+} hmacHeader;
+
+#define HMAC_KEY 0
+#define HMAC_IPAD 1
+#define HMAC_OPAD 2
+#define HMAC_MSG 3
+#define HMAC_OUTER 4
+#define HMAC_INNER 5
+
+typedef struct {
+	const unsigned char* msg;
+	uint64_t msgLen;
+	uint64_t iterations;
+	int keyBlocks;
+	int msgBlocks;
+	int numSteps;
+} hmacPlan;
+
+// One party's shares of the values kept from one step to a later one
+typedef struct {
+	unsigned char key[128];	// the key padded to a block
+	uint64_t inner[8];	// chaining value after K ^ ipad
+	uint64_t outer[8];	// chaining value after K ^ opad
+	uint64_t sum[8];	// output: last U for HMAC, XOR of all U for PBKDF2
+} hmacShares;
+
+// Steps that do not depend on the key length
+int hmac_fixedSteps(const hmacPlan* plan) {
+	uint64_t c = plan->iterations ? plan->iterations : 1;
+	return 2 + plan->msgBlocks + 1 + 2 * (int)(c - 1);
+}
+
+/*
+ * msg is the public message, or the salt for PBKDF2 when iterations is not
+ * 0. keyBlocks is the number of blocks of the key hashed in MPC, 0 when the
+ * key fits in one block.
+ */
+void hmac_plan(hmacPlan* plan, const unsigned char* msg, uint64_t msgLen, uint64_t iterations, int keyBlocks) {
+	// ipad block, message, INT(1), 0x80 and the 128-bit length
+	uint64_t innerLen = SHA512_CBLOCK + msgLen + (iterations ? 4 : 0);
+
+	plan->msg = msg;
+	plan->msgLen = msgLen;
+	plan->iterations = iterations;
+	plan->keyBlocks = keyBlocks;
+	plan->msgBlocks = (innerLen + 17 + SHA512_CBLOCK - 1) / SHA512_CBLOCK - 1;
+	plan->numSteps = keyBlocks + hmac_fixedSteps(plan);
+}
+
+void hmac_header(const hmacPlan* plan, hmacHeader* hdr) {
+	memset(hdr, 0, sizeof(hmacHeader));
+	memcpy(hdr->magic, HMAC_MAGIC, sizeof(hdr->magic));
+	hdr->iterations = plan->iterations;
+	hdr->messageBytes = plan->msgLen;
+	SHA512(plan->msg, plan->msgLen, hdr->messageHash);
+}
+
+int hmac_step(const hmacPlan* plan, int s) {
+	s -= plan->keyBlocks;
+	if (s < 0)
+		return HMAC_KEY;
+	if (s < 2)
+		return s ? HMAC_OPAD : HMAC_IPAD;
+	s -= 2 + plan->msgBlocks;
+	if (s < 0)
+		return HMAC_MSG;
+	return (s % 2) ? HMAC_INNER : HMAC_OUTER;
+}
+
+// Steps whose block is a fresh secret input, shared from the tapes like a message block
+int hmac_secret(const hmacPlan* plan, int s) {
+	int kind = hmac_step(plan, s);
+
+	return (kind == HMAC_KEY) || ((kind == HMAC_IPAD) && (plan->keyBlocks == 0));
+}
+
+// Chaining value step s starts from, NULL when it carries on from step s-1
+const uint64_t* hmac_chain(const hmacPlan* plan, int s, const hmacShares* hs) {
+	switch (hmac_step(plan, s)) {
+	case HMAC_KEY:
+		return s ? NULL : hA;
+	case HMAC_IPAD:
+	case HMAC_OPAD:
+		return hA;
+	case HMAC_MSG:
+		return (s == plan->keyBlocks + 2) ? hs->inner : NULL;
+	case HMAC_INNER:
+		return hs->inner;
+	default:
+		return hs->outer;
+	}
+}
+
+static void hmac_putWords(const uint64_t w[8], unsigned char x[64]) {
+	for (int i = 0; i < 8; i++)
+		for (int j = 0; j < 8; j++)
+			x[i * 8 + j] = w[i] >> (56 - 8 * j);
+}
+
+// Public block m of the first inner hash, after the ipad block
+static void hmac_msgBlock(const hmacPlan* plan, int m, unsigned char x[128]) {
+	uint64_t dataLen = plan->msgLen + (plan->iterations ? 4 : 0);
+	uint64_t totalBits = (SHA512_CBLOCK + dataLen) << 3;
+
+	memset(x, 0, SHA512_CBLOCK);
+	for (int j = 0; j < SHA512_CBLOCK; j++) {
+		uint64_t pos = (uint64_t)m * SHA512_CBLOCK + j;
+		if (pos < plan->msgLen)
+			x[j] = plan->msg[pos];
+		else if (pos < dataLen)
+			x[j] = (pos == dataLen - 1) ? 1 : 0;	// INT(1), big endian
+		else if (pos == dataLen)
+			x[j] = 0x80;
+	}
+	if (m == plan->msgBlocks - 1) {
+		for (int i = 0; i < 8; i++)
+			x[SHA512_CBLOCK - 1 - i] = totalBits >> (i * 8);
+	}
+}
+
+/*
+ * One party's share of the block of a step that is not secret. prev is the
+ * party's output of step s-1.
+ */
+void hmac_block(const hmacPlan* plan, int s, const hmacShares* hs, const uint64_t prev[8], unsigned char x[128]) {
+	int kind = hmac_step(plan, s);
+
+	if ((kind == HMAC_IPAD) || (kind == HMAC_OPAD)) {
+		for (int j = 0; j < SHA512_CBLOCK; j++)
+			x[j] = hs->key[j] ^ ((kind == HMAC_IPAD) ? 0x36 : 0x5c);
+	}
+	else if (kind == HMAC_MSG)
+		hmac_msgBlock(plan, s - plan->keyBlocks - 2, x);
+	else {
+		// a 64 byte digest after one block: 1536 bits
+		memset(x, 0, SHA512_CBLOCK);
+		hmac_putWords(prev, x);
+		x[64] = 0x80;
+		x[SHA512_CBLOCK - 2] = 0x06;
+	}
+}
+
+// Keeps what later steps need from step s, which ran on block x to output out
+void hmac_save(const hmacPlan* plan, int s, hmacShares* hs, const unsigned char x[128], const uint64_t out[8]) {
+	switch (hmac_step(plan, s)) {
+	case HMAC_KEY:
+		if (s == plan->keyBlocks - 1) {
+			memset(hs->key, 0, sizeof(hs->key));
+			hmac_putWords(out, hs->key);
+		}
+		break;
+	case HMAC_IPAD:
+		if (plan->keyBlocks == 0) {
+			for (int j = 0; j < SHA512_CBLOCK; j++)
+				hs->key[j] = x[j] ^ 0x36;
+		}
+		memcpy(hs->inner, out, sizeof(hs->inner));
+		break;
+	case HMAC_OPAD:
+		memcpy(hs->outer, out, sizeof(hs->outer));
+		break;
+	case HMAC_OUTER:
+		for (int i = 0; i < 8; i++)
+			hs->sum[i] ^= out[i];
+		break;
+	}
+}
+
+/*
+ * Starts step s for n parties. state[i][j] is party j's share of word i
+ * of the chaining value: on entry the output of step s-1, on return the input
+ * of step s. x[j] gets party j's block unless the step is secret.
+ */
+void hmac_enter(const hmacPlan* plan, int s, const hmacShares* hs, int n, uint64_t state[][n], unsigned char* x[]) {
+	for (int j = 0; j < n; j++) {
+		const uint64_t* chain = hmac_chain(plan, s, &hs[j]);
+		uint64_t prev[8];
+
+		for (int i = 0; i < 8; i++)
+			prev[i] = state[i][j];
+		if (!hmac_secret(plan, s))
+			hmac_block(plan, s, &hs[j], prev, x[j]);
+		if (chain)
+			for (int i = 0; i < 8; i++)
+				state[i][j] = chain[i];
+	}
+}
+
+// Ends step s for n parties, state holding its output as for hmac_enter()
+void hmac_leave(const hmacPlan* plan, int s, hmacShares* hs, int n, uint64_t state[][n], const unsigned char* x[]) {
+	for (int j = 0; j < n; j++) {
+		uint64_t out[8];
+
+		for (int i = 0; i < 8; i++)
+			out[i] = state[i][j];
+		hmac_save(plan, s, &hs[j], x[j], out);
+	}
+}
+
+#endif /* HMAC512_H_ */
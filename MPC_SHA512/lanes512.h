@@ -0,0 +1,224 @@
+/*
+ * Name: lanes512.h
+ * Author: Tan Teik Guan
+ * Description: Lane engine for the 64-bit ZKBoo gates of SHA-512
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * The AND and ADD gates of the prover work on the three party shares
+ * together.  Instead of walking the carry chain one bit and one party at a
+ * time, each backend keeps all three shares in one register set and derives
+ * carry bit i+1 of every party in one step:
+ *
+ *   a = x ^ c, b = y ^ c
+ *   c_j[i+1] = bit i of (a_j & b_j+1) ^ (a_j+1 & b_j) ^ (a_j & b_j) ^ c_j ^ r_j ^ r_j+1
+ *
+ * which is exactly what the original GETBIT/SETBIT loop computed, so the
+ * views are identical whichever backend runs.
+ *
+ *   bitwise - the original bit serial loop, kept as the reference
+ *   scalar  - whole-word version of the loop, portable C
+ *   avx2    - the three shares in lanes 0..2 of a 256-bit register
+ *
+ * lanes_init() picks avx2 when CPUID reports it and scalar otherwise.
+ * ZKBOO_LANES=bitwise|scalar|avx2 in the environment overrides the choice.
+ *
+ * The verifier knows both carry words from the views, so all 63 carry bits
+ * are checked at once by lanes_ADD_check() with plain word operations. A
+ * ZKB++ proof carries only the carry word of party e+1, and
+ * lanes_ADD_rebuild() derives the one of party e.
+ */
+
+#ifndef LANES512_H_
+#define LANES512_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LANES_HAVE_AVX2 1
+#endif
+
+#define LANES_GETBIT(x, i) (((x) >> (i)) & 0x01)
+
+typedef void (*lanesAND_fn)(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t z[3]);
+typedef void (*lanesADD_fn)(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t c[3]);
+
+void lanes_AND_scalar(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t z[3]) {
+	z[0] = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
+	z[1] = (x[1] & y[2]) ^ (x[2] & y[1]) ^ (x[1] & y[1]) ^ r[1] ^ r[2];
+	z[2] = (x[2] & y[0]) ^ (x[0] & y[2]) ^ (x[2] & y[2]) ^ r[2] ^ r[0];
+}
+
+void lanes_ADD_bitwise(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t c[3]) {
+	uint64_t a[3], b[3];
+	uint64_t t[3];
+
+	c[0] = c[1] = c[2] = 0;
+	for(int i=0;i<63;i++)
+	{
+		for (int j = 0; j < 3; j++) {
+			a[j] = LANES_GETBIT(x[j]^c[j],i);
+			b[j] = LANES_GETBIT(y[j]^c[j],i);
+		}
+		for (int j = 0; j < 3; j++) {
+			int j1 = (j + 1) % 3;
+			t[j] = (a[j]&b[j1]) ^ (a[j1]&b[j]) ^ (a[j]&b[j]) ^ LANES_GETBIT(c[j],i) ^ LANES_GETBIT(r[j],i) ^ LANES_GETBIT(r[j1],i);
+		}
+		for (int j = 0; j < 3; j++)
+			c[j] |= t[j] << (i+1);
+	}
+}
+
+void lanes_ADD_scalar(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t c[3]) {
+	uint64_t c0 = 0, c1 = 0, c2 = 0;
+	const uint64_t r0 = r[0] ^ r[1], r1 = r[1] ^ r[2], r2 = r[2] ^ r[0];
+
+	for(int i=0;i<63;i++)
+	{
+		uint64_t a0 = x[0] ^ c0, a1 = x[1] ^ c1, a2 = x[2] ^ c2;
+		uint64_t b0 = y[0] ^ c0, b1 = y[1] ^ c1, b2 = y[2] ^ c2;
+		uint64_t m = (uint64_t)1 << i;
+
+		uint64_t t0 = (a0 & (b0 ^ b1)) ^ (a1 & b0) ^ c0 ^ r0;
+		uint64_t t1 = (a1 & (b1 ^ b2)) ^ (a2 & b1) ^ c1 ^ r1;
+		uint64_t t2 = (a2 & (b2 ^ b0)) ^ (a0 & b2) ^ c2 ^ r2;
+
+		c0 |= (t0 & m) << 1;
+		c1 |= (t1 & m) << 1;
+		c2 |= (t2 & m) << 1;
+	}
+	c[0] = c0;
+	c[1] = c1;
+	c[2] = c2;
+}
+
+#ifdef LANES_HAVE_AVX2
+// lane j of the result holds lane j+1 of v (mod 3), lane 3 is unused
+#define LANES_NEXT(v) _mm256_permute4x64_epi64((v), _MM_SHUFFLE(3,0,2,1))
+
+__attribute__((target("avx2")))
+void lanes_AND_avx2(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t z[3]) {
+	__m256i X = _mm256_set_epi64x(0, x[2], x[1], x[0]);
+	__m256i Y = _mm256_set_epi64x(0, y[2], y[1], y[0]);
+	__m256i R = _mm256_set_epi64x(0, r[2], r[1], r[0]);
+	__m256i T;
+
+	T = _mm256_and_si256(X, _mm256_xor_si256(Y, LANES_NEXT(Y)));
+	T = _mm256_xor_si256(T, _mm256_and_si256(LANES_NEXT(X), Y));
+	T = _mm256_xor_si256(T, _mm256_xor_si256(R, LANES_NEXT(R)));
+
+	uint64_t out[4] __attribute__((aligned(32)));
+	_mm256_store_si256((__m256i *)out, T);
+	z[0] = out[0];
+	z[1] = out[1];
+	z[2] = out[2];
+}
+
+__attribute__((target("avx2")))
+void lanes_ADD_avx2(const uint64_t x[3], const uint64_t y[3], const uint64_t r[3], uint64_t c[3]) {
+	__m256i X = _mm256_set_epi64x(0, x[2], x[1], x[0]);
+	__m256i Y = _mm256_set_epi64x(0, y[2], y[1], y[0]);
+	__m256i R = _mm256_set_epi64x(0, r[2], r[1], r[0]);
+	__m256i C = _mm256_setzero_si256();
+	__m256i M = _mm256_set1_epi64x(1);
+
+	R = _mm256_xor_si256(R, LANES_NEXT(R));
+	for(int i=0;i<63;i++)
+	{
+		__m256i A = _mm256_xor_si256(X, C);
+		__m256i B = _mm256_xor_si256(Y, C);
+		__m256i T;
+
+		T = _mm256_and_si256(A, _mm256_xor_si256(B, LANES_NEXT(B)));
+		T = _mm256_xor_si256(T, _mm256_and_si256(LANES_NEXT(A), B));
+		T = _mm256_xor_si256(T, _mm256_xor_si256(C, R));
+		C = _mm256_or_si256(C, _mm256_slli_epi64(_mm256_and_si256(T, M), 1));
+		M = _mm256_slli_epi64(M, 1);
+	}
+
+	uint64_t out[4] __attribute__((aligned(32)));
+	_mm256_store_si256((__m256i *)out, C);
+	c[0] = out[0];
+	c[1] = out[1];
+	c[2] = out[2];
+}
+#endif
+
+lanesAND_fn lanes_AND = lanes_AND_scalar;
+lanesADD_fn lanes_ADD = lanes_ADD_scalar;
+const char * lanes_name = "scalar";
+
+int lanes_select(const char * name) {
+	if (strcmp(name, "bitwise") == 0) {
+		lanes_AND = lanes_AND_scalar;
+		lanes_ADD = lanes_ADD_bitwise;
+	}
+	else if (strcmp(name, "scalar") == 0) {
+		lanes_AND = lanes_AND_scalar;
+		lanes_ADD = lanes_ADD_scalar;
+	}
+#ifdef LANES_HAVE_AVX2
+	else if (strcmp(name, "avx2") == 0) {
+		if (!__builtin_cpu_supports("avx2"))
+			return 1;
+		lanes_AND = lanes_AND_avx2;
+		lanes_ADD = lanes_ADD_avx2;
+	}
+#endif
+	else
+		return 1;
+	lanes_name = name;
+	return 0;
+}
+
+void lanes_init() {
+	const char * force = getenv("ZKBOO_LANES");
+
+#ifdef LANES_HAVE_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		lanes_select("avx2");
+#endif
+	if (force && lanes_select(force) != 0)
+		printf("Lane backend %s not available, using %s\n", force, lanes_name);
+}
+
+/*
+ * Verifier side of ADD: c0, c1 are the carry words of the two opened
+ * parties.  Returns 0 when every carry bit of party e is consistent.
+ */
+int lanes_ADD_check(const uint64_t x[2], const uint64_t y[2], const uint64_t r[2], uint64_t c0, uint64_t c1) {
+	uint64_t a0 = x[0] ^ c0, a1 = x[1] ^ c1;
+	uint64_t b0 = y[0] ^ c0, b1 = y[1] ^ c1;
+	uint64_t t = (a0 & (b0 ^ b1)) ^ (a1 & b0) ^ c0 ^ r[0] ^ r[1];
+
+	return ((t << 1) ^ c0) & ~(uint64_t)1 ? 1 : 0;
+}
+
+/*
+ * Verifier side of ADD for ZKB++ proofs, where only the carry word c1 of
+ * party e+1 is in the proof. With c1 fixed, carry bit i+1 of party e is
+ *
+ *   c0[i+1] = g[i] ^ (p[i] & c0[i])
+ *   g = (x0 & (y0 ^ b1)) ^ (a1 & y0) ^ r0 ^ r1,  p = x0 ^ y0 ^ a1 ^ b1
+ *
+ * which is linear in c0, so the chain is resolved in six prefix steps instead
+ * of 63. The result passes lanes_ADD_check() by construction.
+ */
+uint64_t lanes_ADD_rebuild(const uint64_t x[2], const uint64_t y[2], const uint64_t r[2], uint64_t c1) {
+	const uint64_t a1 = x[1] ^ c1, b1 = y[1] ^ c1;
+	uint64_t g = (x[0] & (y[0] ^ b1)) ^ (a1 & y[0]) ^ r[0] ^ r[1];
+	uint64_t p = x[0] ^ y[0] ^ a1 ^ b1;
+
+	for (int d = 1; d < 64; d <<= 1) {
+		g ^= p & (g << d);
+		p &= p << d;
+	}
+	return g << 1;
+}
+
+#endif /* LANES512_H_ */
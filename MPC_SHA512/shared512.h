@@ -25,9 +25,20 @@
 #include <openssl/applink.c>
 #endif
 #include <openssl/rand.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "omp.h"
-
-#define VERBOSE 1 
+#include "lanes512.h"
+#include "../common/tapes.h"
+#include "../common/hashmany.h"
+#include "../common/mapproof.h"
+#include "../common/stats.h"
+
+// Set to 1 to print the line where a round fails to verify
+#ifndef VERBOSE
+#define VERBOSE 0
+#endif
 #define W(t) w[(t) & 0x0F]
 
 static const uint64_t hA[8] = { 0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
@@ -57,6 +68,50 @@ static const uint64_t k[80] =
 	0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817
 };
 
+/*
+ * SHA-384 and SHA-512/256 are the SHA-512 circuit with another initial
+ * chaining value, keeping only the first outWords words of the last block's
+ * output. The final additions of the other words are left out, so the
+ * opened views never show them: their gate outputs, output shares and output
+ * view words are all zero. The proof still carries them as zeros, which the
+ * verifier checks, so the layout stays that of SHA-512, but they are not
+ * committed to: H_view() leaves them out of the view commitments and H3()
+ * out of the challenge. The variant is picked with --hash and must match
+ * between prover and verifier.
+ */
+typedef struct {
+	const char* name;
+	uint64_t iv[8];
+	int outWords;
+} sha512Variant;
+
+static const sha512Variant sha512Variants[] = {
+	{ "sha512", { 0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+		0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179 }, 8 },
+	{ "sha384", { 0xCBBB9D5DC1059ED8, 0x629A292A367CD507, 0x9159015A3070DD17, 0x152FECD8F70E5939,
+		0x67332667FFC00B31, 0x8EB44A8768581511, 0xDB0C2E0D64F98FA7, 0x47B5481DBEFA4FA4 }, 6 },
+	{ "sha512-256", { 0x22312194FC2BF72C, 0x9F555FA3C84C64C2, 0x2393B86B6F53B151, 0x963877195940EABD,
+		0x96283EE2A88EFFE3, 0xBE5E1E2553863992, 0x2B0199FC2C85B8AA, 0x0EB72DDC81C52CA2 }, 4 },
+};
+
+const sha512Variant* variant = &sha512Variants[0];
+
+// Returns 0 when name is one of the variants above
+int variant_select(const char* name) {
+	for (int i = 0; i < (int)(sizeof(sha512Variants) / sizeof(sha512Variants[0])); i++) {
+		if (strcmp(name, sha512Variants[i].name) == 0) {
+			variant = &sha512Variants[i];
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Output words the circuit keeps for block b: all of them except in the last block
+int blockOutWords(int b, int numBlocks) {
+	return (b == numBlocks - 1) ? variant->outWords : 8;
+}
+
 //#define ySize 736
 #define ySize 1408 
 #define rSize 11200 
@@ -66,6 +121,31 @@ typedef struct {
 	uint64_t y[ySize];
 } View;
 
+/*
+ * Committed bytes of a view with outWords output words kept: all of it but
+ * the dropped words, that is the y words of the left out final additions
+ * (ySize - 16 + outWords up to ySize - 8) and the dropped output words (from
+ * ySize - 8 + outWords). The kept words are the view up to the first dropped
+ * addition, then the first outWords output words.
+ */
+size_t viewCommitBytes(int outWords) {
+	return sizeof(View) - 2 * (8 - outWords) * sizeof(uint64_t);
+}
+
+// Committed view bytes of one party over all blocks of a round
+size_t roundCommitBytes(int numBlocks) {
+	return (size_t)(numBlocks - 1) * sizeof(View) + viewCommitBytes(variant->outWords);
+}
+
+void H_view(EVP_MD_CTX* ctx, const View* v, int outWords) {
+	if (outWords == 8) {
+		EVP_DigestUpdate(ctx, v, sizeof(View));
+		return;
+	}
+	EVP_DigestUpdate(ctx, v, viewCommitBytes(outWords) - outWords * sizeof(uint64_t));
+	EVP_DigestUpdate(ctx, &v->y[ySize - 8], outWords * sizeof(uint64_t));
+}
+
 typedef struct {
 	uint64_t yp[3][8];
 	unsigned char h[3][64];
@@ -80,56 +160,137 @@ typedef struct {
 	unsigned char re1[4];
 } z;
 
-#define RIGHTROTATE(x,n) (((x) >> (n)) | ((x) << (64-(n))))
-#define GETBIT(x, i) (((x) >> (i)) & 0x01)
-#define SETBIT(x, i, b)   x= (b)&1 ? (x)|((uint64_t)1 << (i)) : (x)&(~((uint64_t)1 << (i)))
+/*
+ * Proof file layout: a[NUM_ROUNDS] followed by one record per round. A record
+ * is the z above, carrying the views of the first block, followed by the
+ * (ve, ve1) view pairs of each further 1024-bit block. Single block proofs are
+ * therefore unchanged.
+ */
+size_t proofRoundSize(int numBlocks) {
+	return sizeof(z) + (size_t)(numBlocks - 1) * 2 * sizeof(View);
+}
 
+/*
+ * ZKB++ proof layout: zppHeader followed by one record per round. Of the two
+ * opened parties only party e+1's gate outputs are sent, since the verifier
+ * can recompute party e's from them. Parties 0 and 1 derive their input
+ * shares from their keys, so x carries party 2's input share when party 2 is
+ * opened (e = 1 or 2) and is zero otherwise, as it is for the HMAC and
+ * PBKDF2 steps whose block the verifier derives itself. The output shares and the
+ * commitments of parties e and e+1 are rebuilt by the verifier as well, so
+ * only the commitment of party e+2 is sent, and the challenge e is sent for
+ * the verifier to check against H3 of the rebuilt a[].
+ *
+ * A record is the zpp below, carrying block 0, followed by one View per
+ * further block.
+ */
+#define ZKBPP_MAGIC "ZKB++512"
 
+typedef struct {
+	char magic[8];
+	uint64_t y[8];
+} zppHeader;
 
+typedef struct {
+	unsigned char ke[16];
+	unsigned char ke1[16];
+	unsigned char re[4];
+	unsigned char re1[4];
+	unsigned char h2[64];
+	unsigned char e;
+	unsigned char pad[7];
+	View ve1;
+} zpp;
 
-void handleErrors(void)
-{
-	ERR_print_errors_fp(stderr);
-	abort();
+size_t compactRoundSize(int numBlocks) {
+	return sizeof(zpp) + (size_t)(numBlocks - 1) * sizeof(View);
 }
 
 /*
-EVP_CIPHER_CTX setupAES(unsigned char key[16]) {
-	EVP_CIPHER_CTX ctx;
-	EVP_CIPHER_CTX_init(&ctx);
+ * Proofs for SHA-512(prefix || s) with a public prefix start with a
+ * prefixHeader, followed by a ZKBoo or ZKB++ proof as above. The prefix is a
+ * whole number of 1024-bit blocks, compressed in the clear to the chaining
+ * value iv, and the circuit starts from iv instead of hA, so only the blocks
+ * from publicBytes on are run in MPC. The header is hashed into the
+ * challenges. A partial last block is refused: its bytes would have to be
+ * shared with the secret, and nothing in the proof would tie those shares to
+ * the public bytes.
+ */
+#define PREFIX_MAGIC "SHA512IV"
 
+typedef struct {
+	char magic[8];
+	uint64_t publicBytes;
+	uint64_t iv[8];
+} prefixHeader;
 
-	unsigned char *iv = (unsigned char *)"01234567890123456";
+#include "hmac512.h"
 
-	if(1 != EVP_EncryptInit_ex(&ctx, EVP_aes_128_ctr(), NULL, key, iv))
-		handleErrors();
+#define RIGHTROTATE(x,n) (((x) >> (n)) | ((x) << (64-(n))))
+#define GETBIT(x, i) (((x) >> (i)) & 0x01)
+#define SETBIT(x, i, b)   x= (b)&1 ? (x)|((uint64_t)1 << (i)) : (x)&(~((uint64_t)1 << (i)))
 
-	return ctx;
+// One SHA-512 compression of a public block into state, the circuit of mpc_sha512() in the clear
+void sha512_compress(uint64_t state[8], const unsigned char block[SHA512_CBLOCK]) {
+	uint64_t w[16], v[8];
 
+	for (int i = 0; i < 16; i++) {
+		w[i] = 0;
+		for (int j = 0; j < 8; j++)
+			w[i] = (w[i] << 8) | block[8 * i + j];
+	}
+	memcpy(v, state, sizeof(v));
+	for (int i = 0; i < 80; i++) {
+		if (i >= 16) {
+			uint64_t s0 = RIGHTROTATE(W(i + 1), 1) ^ RIGHTROTATE(W(i + 1), 8) ^ (W(i + 1) >> 7);
+			uint64_t s1 = RIGHTROTATE(W(i + 14), 19) ^ RIGHTROTATE(W(i + 14), 61) ^ (W(i + 14) >> 6);
+			W(i) += s0 + W(i + 9) + s1;
+		}
+		uint64_t S1 = RIGHTROTATE(v[4], 14) ^ RIGHTROTATE(v[4], 18) ^ RIGHTROTATE(v[4], 41);
+		uint64_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+		uint64_t t1 = v[7] + S1 + ch + k[i] + W(i);
+		uint64_t S0 = RIGHTROTATE(v[0], 28) ^ RIGHTROTATE(v[0], 34) ^ RIGHTROTATE(v[0], 39);
+		uint64_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+		memmove(&v[1], &v[0], 7 * sizeof(uint64_t));
+		v[4] += t1;
+		v[0] = t1 + S0 + maj;
+	}
+	for (int i = 0; i < 8; i++)
+		state[i] += v[i];
+}
 
+// Compresses prefix into hdr. Returns 1 when len is not a whole number of blocks
+int prefix_midstate(const unsigned char* prefix, uint64_t len, prefixHeader* hdr) {
+	if (len % SHA512_CBLOCK != 0)
+		return 1;
+	memset(hdr, 0, sizeof(prefixHeader));
+	memcpy(hdr->magic, PREFIX_MAGIC, sizeof(hdr->magic));
+	hdr->publicBytes = len - len % SHA512_CBLOCK;
+	memcpy(hdr->iv, variant->iv, sizeof(hdr->iv));
+	for (uint64_t pos = 0; pos < hdr->publicBytes; pos += SHA512_CBLOCK)
+		sha512_compress(hdr->iv, prefix + pos);
+	return 0;
 }
-*/
 
-void getAllRandomness(unsigned char key[16], unsigned char randomness[rSize]) {
-	//Generate randomness: We use 728*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 728*32/128 = 182 iterations
 
-	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-	unsigned char * iv = (unsigned char *) "01234567890123456";
-	EVP_CIPHER_CTX_init(ctx);
- 	//ctx = setupAES(key);
-	unsigned char *plaintext =
-			(unsigned char *)"0000000000000000";
-	int len;
-	if (1 != EVP_EncryptInit_ex(ctx,EVP_aes_128_ctr(),NULL,key,iv))
-		handleErrors();
-	for(int j=0;j<(rSize/16);j++) {
-		if(1 != EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
 
-	}
-	EVP_CIPHER_CTX_cleanup(ctx);
-	EVP_CIPHER_CTX_free(ctx);
+
+void handleErrors(void)
+{
+	ERR_print_errors_fp(stderr);
+	abort();
+}
+
+#define TAPE_IV ((unsigned char *)"01234567890123456")
+#define SHARE_IV ((unsigned char *)"ZKBoo-SHA512-inp")
+
+/*
+ * Tapes are AES-CTR keystreams (common/tapes.h) consumed block after block, so
+ * block b of a multi-block proof uses bytes b*rSize .. (b+1)*rSize-1 of the
+ * party's keystream.
+ */
+void getAllRandomness(const unsigned char key[16], unsigned char randomness[rSize]) {
+	tape_expand(key, TAPE_IV, randomness, rSize);
 }
 
 uint32_t getRandom32(unsigned char randomness[rSize], int randCount) {
@@ -148,43 +309,44 @@ uint64_t getRandom64(unsigned char randomness[rSize], int randCount) {
 
 
 void init_EVP() {
-	ERR_load_crypto_strings();
-	OpenSSL_add_all_algorithms();
-	//OPENSSL_config(NULL);
+	tape_init();
+	hash_init();
 }
 
 void cleanup_EVP() {
-	EVP_cleanup();
-	ERR_free_strings();
-}
-
-void H(unsigned char k[16], View v, unsigned char r[4], unsigned char hash[SHA512_DIGEST_LENGTH]) {
-	SHA512_CTX ctx;
-	SHA512_Init(&ctx);
-	SHA512_Update(&ctx, k, 16);
-	SHA512_Update(&ctx, &v, sizeof(v));
-	SHA512_Update(&ctx, r, 4);
-	SHA512_Final(hash, &ctx);
+	crypto_cleanup();
 }
 
-
-void H3(uint64_t y[8], a* as, int s, int* es) {
+// pub is the prefixHeader or hmacHeader the proof starts with, otherwise NULL
+void H3(uint64_t y[8], const void* pub, size_t pubSize, const a* as, int s, int* es) {
 
 	unsigned char hash[SHA512_DIGEST_LENGTH];
-	SHA512_CTX ctx;
-	SHA512_Init(&ctx);
-	SHA512_Update(&ctx, y, 64);
-	SHA512_Update(&ctx, as, sizeof(a)*s);
-	SHA512_Final(hash, &ctx);
+	size_t ypBytes = variant->outWords * sizeof(uint64_t);
+	EVP_MD_CTX* ctx = crypto_digest(crypto_sha512);
+	EVP_DigestUpdate(ctx, y, ypBytes);
+	if (pub)
+		EVP_DigestUpdate(ctx, pub, pubSize);
+	//The output shares of the words a variant drops are zero and left out
+	if (variant->outWords == 8)
+		EVP_DigestUpdate(ctx, as, sizeof(a)*s);
+	else {
+		for (int k = 0; k < s; k++) {
+			for (int j = 0; j < 3; j++)
+				EVP_DigestUpdate(ctx, as[k].yp[j], ypBytes);
+			EVP_DigestUpdate(ctx, as[k].h, sizeof(as[k].h));
+		}
+	}
+	EVP_DigestFinal_ex(ctx, hash, NULL);
+	stats_add(STATS_HASH_BYTES, ypBytes + (pub ? pubSize : 0) + (3 * ypBytes + sizeof(as[0].h)) * s);
 
 	//Pick bits from hash
 	int i = 0;
 	int bitTracker = 0;
 	while(i < s) {
 		if(bitTracker >= SHA512_DIGEST_LENGTH*8) { //Generate new hash as we have run out of bits in the previous hash
-			SHA512_Init(&ctx);
-			SHA512_Update(&ctx, hash, sizeof(hash));
-			SHA512_Final(hash, &ctx);
+			ctx = crypto_digest(crypto_sha512);
+			EVP_DigestUpdate(ctx, hash, sizeof(hash));
+			EVP_DigestFinal_ex(ctx, hash, NULL);
 			bitTracker = 0;
 		}
 
@@ -213,11 +375,11 @@ void H3(uint64_t y[8], a* as, int s, int* es) {
 
 }
 
-void output(View v, uint64_t* result) {
-	memcpy(result, &v.y[ySize - 8], 64);
+void output(const View* v, uint64_t* result) {
+	memcpy(result, &v->y[ySize - 8], 64);
 }
 
-void reconstruct(uint64_t* y0, uint64_t* y1, uint64_t* y2, uint64_t* result) {
+void reconstruct(const uint64_t* y0, const uint64_t* y1, const uint64_t* y2, uint64_t* result) {
 	for (int i = 0; i < 8; i++) {
 		result[i] = y0[i] ^ y1[i] ^ y2[i];
 	}
@@ -233,94 +395,44 @@ void mpc_NEGATE2(uint64_t x[2], uint64_t z[2]) {
 	z[1] = ~x[1];
 }
 
-omp_lock_t *locks;
-
-void openmp_locking_callback(int mode, int type, char *file, int line)
-{
-  if (mode & CRYPTO_LOCK)
-  {
-    omp_set_lock(&locks[type]);
-  }
-  else
-  {
-    omp_unset_lock(&locks[type]);
-  }
-}
-
-
-unsigned long openmp_thread_id(void)
-{
-  return (unsigned long)omp_get_thread_num();
-}
-
-void openmp_thread_setup(void)
-{
-  int i;
 
-  locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(omp_lock_t));
-  for (i=0; i<CRYPTO_num_locks(); i++)
-  {
-    omp_init_lock(&locks[i]);
-  }
+int mpc_AND_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], const View* ve, const View* ve1, tapeWindow* tw, int* countY, uint64_t* rebuild) {
+	uint64_t r[2];
 
-  CRYPTO_set_id_callback((unsigned long (*)())openmp_thread_id);
-  CRYPTO_set_locking_callback((void (*)())openmp_locking_callback);
-}
-
-void openmp_thread_cleanup(void)
-{
-  int i;
-
-  CRYPTO_set_id_callback(NULL);
-  CRYPTO_set_locking_callback(NULL);
-  for (i=0; i<CRYPTO_num_locks(); i++)
-    omp_destroy_lock(&locks[i]);
-  OPENSSL_free(locks);
-}
-
-
-int mpc_AND_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) {
-	uint64_t r[2] = { getRandom64(randomness[0], *randCount), getRandom64(randomness[1], *randCount) };
-	*randCount += 8;
+	tape_next64(tw, r);
 
 	uint64_t t = 0;
 
 	t = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	if(ve.y[*countY] != t) {
+	if (rebuild)
+		rebuild[*countY] = t;
+	else if(ve->y[*countY] != t) {
 		return 1;
 	}
 	z[0] = t;
-	z[1] = ve1.y[*countY];
+	z[1] = ve1->y[*countY];
 
 	(*countY)++;
 	return 0;
 }
 
 
-int mpc_ADD_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) {
-	uint64_t r[2] = { getRandom64(randomness[0], *randCount), getRandom64(randomness[1], *randCount) };
-	*randCount += 8;
-
-	uint8_t a[2], b[2];
-
-	uint8_t t;
+int mpc_ADD_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], const View* ve, const View* ve1, tapeWindow* tw, int* countY, uint64_t* rebuild) {
+	uint64_t r[2];
 
-	for(int i=0;i<63;i++)
-	{
-		a[0]=GETBIT(x[0]^ve.y[*countY],i);
-		a[1]=GETBIT(x[1]^ve1.y[*countY],i);
-
-		b[0]=GETBIT(y[0]^ve.y[*countY],i);
-		b[1]=GETBIT(y[1]^ve1.y[*countY],i);
+	tape_next64(tw, r);
 
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		if(GETBIT(ve.y[*countY],i+1) != (t ^ (a[0]&b[0]) ^ GETBIT(ve.y[*countY],i) ^ GETBIT(r[0],i))) {
-			return 1;
-		}
+	uint64_t c;
+	if (rebuild)
+		c = rebuild[*countY] = lanes_ADD_rebuild(x, y, r, ve1->y[*countY]);
+	else if (lanes_ADD_check(x, y, r, ve->y[*countY], ve1->y[*countY]) != 0) {
+		return 1;
 	}
+	else
+		c = ve->y[*countY];
 
-	z[0]=x[0]^y[0]^ve.y[*countY];
-	z[1]=x[1]^y[1]^ve1.y[*countY];
+	z[0]=x[0]^y[0]^c;
+	z[1]=x[1]^y[1]^ve1->y[*countY];
 	(*countY)++;
 	return 0;
 }
@@ -335,7 +447,20 @@ void mpc_RIGHTSHIFT2(uint64_t x[2], int i, uint64_t z[2]) {
 	z[1] = x[1] >> i;
 }
 
-int mpc_OR_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) 
+// Output word that is not kept: no gate, zero in both views
+int mpc_DROP_verify(uint64_t x[2], const View* ve, const View* ve1, int* countY, uint64_t* rebuild) {
+	if (rebuild)
+		rebuild[*countY] = 0;
+	else if (ve->y[*countY] != 0)
+		return 1;
+	if (ve1->y[*countY] != 0)
+		return 1;
+	x[0] = x[1] = 0;
+	(*countY)++;
+	return 0;
+}
+
+int mpc_OR_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], const View* ve, const View* ve1, tapeWindow* tw, int* countY, uint64_t* rebuild) 
 {
 	uint64_t t0[3];
 	uint64_t t1[3];
@@ -343,51 +468,52 @@ int mpc_OR_verify(uint64_t x[2], uint64_t y[2], uint64_t z[2], View ve, View ve1
 
 	mpc_NEGATE2(x,t0);
 	mpc_NEGATE2(y,t1);
-	if (mpc_AND_verify(t0,t1,t2,ve,ve1,randomness,randCount,countY) == 1)
+	if (mpc_AND_verify(t0,t1,t2,ve,ve1,tw,countY,rebuild) == 1)
 	{
 		return 1;
 	}
 	mpc_NEGATE2(t2,z);
+	return 0;
 }
 
 
-int mpc_MAJ_verify(uint64_t a[2], uint64_t b[2], uint64_t c[2], uint64_t z[3], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) {
+int mpc_MAJ_verify(uint64_t a[2], uint64_t b[2], uint64_t c[2], uint64_t z[3], const View* ve, const View* ve1, tapeWindow* tw, int* countY, uint64_t* rebuild) {
 	uint64_t t0[3];
 	uint64_t t1[3];
 	uint64_t t2[3];
 
-	if(mpc_AND_verify(a, b, t0, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_AND_verify(a, b, t0, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
-	if(mpc_AND_verify(b, c, t1, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_AND_verify(b, c, t1, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
-	if(mpc_AND_verify(c, a, t2, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_AND_verify(c, a, t2, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
-	if(mpc_OR_verify(t0, t1, z, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_OR_verify(t0, t1, z, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
-	if(mpc_OR_verify(t2, z, z, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_OR_verify(t2, z, z, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
 	return 0;
 }
 
-int mpc_CH_verify(uint64_t e[2], uint64_t f[2], uint64_t g[2], uint64_t z[2], View ve, View ve1, unsigned char randomness[2][rSize], int* randCount, int* countY) {
+int mpc_CH_verify(uint64_t e[2], uint64_t f[2], uint64_t g[2], uint64_t z[2], const View* ve, const View* ve1, tapeWindow* tw, int* countY, uint64_t* rebuild) {
 
 	uint64_t t0[3];
 	uint64_t t1[3];
 	uint64_t t2[3];
 
-	if(mpc_AND_verify(e, f, t0, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_AND_verify(e, f, t0, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
 	mpc_NEGATE2(e,t1);
-	if(mpc_AND_verify(t1, g, t2, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_AND_verify(t1, g, t2, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
-	if(mpc_OR_verify(t0, t2, z, ve, ve1, randomness, randCount, countY) == 1) {
+	if(mpc_OR_verify(t0, t2, z, ve, ve1, tw, countY, rebuild) == 1) {
 		return 1;
 	}
 
@@ -396,72 +522,42 @@ int mpc_CH_verify(uint64_t e[2], uint64_t f[2], uint64_t g[2], uint64_t z[2], Vi
 }
 
 
-int verify(a a, int e, z z) {
-	unsigned char* hash = malloc(SHA512_DIGEST_LENGTH);
-	H(z.ke, z.ve, z.re, hash);
-
-	if (memcmp(a.h[e], hash, 64) != 0) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	H(z.ke1, z.ve1, z.re1, hash);
-	if (memcmp(a.h[(e + 1) % 3], hash, 64) != 0) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-	free(hash);
-
-	uint64_t* result = malloc(64);
-	output(z.ve, result);
-	if (memcmp(a.yp[e], result, 64) != 0) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-
-	output(z.ve1, result);
-	if (memcmp(a.yp[(e + 1) % 3], result, 64) != 0) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
-	}
-
-	free(result);
-	unsigned char randomness[2][rSize];
-	getAllRandomness(z.ke, randomness[0]);
-	getAllRandomness(z.ke1, randomness[1]);
-
-	int* randCount = calloc(1, sizeof(int));
-	int* countY = calloc(1, sizeof(int));
+/*
+ * Verifies one block of a round. state holds the two opened parties' shares of
+ * the chaining value and is advanced to the block output, which must match the
+ * output words recorded at the end of both views.
+ *
+ * tw gives the tapes of the two parties and carries on into the next block.
+ * Only the first outWords words of the output are added up, see sha512Variant.
+ * rebuild is NULL for ZKBoo proofs. For ZKB++ proofs it points at zve->y,
+ * which is then filled in instead of checked.
+ */
+int verifyBlock(uint64_t state[8][2], const View* zve, const View* zve1, tapeWindow* tw, int outWords, uint64_t* rebuild) {
+	int count = 0;
+	int* countY = &count;
 
 	uint64_t w[16][2];
 	for (int j = 0; j < 16; j++) {
-		w[j][0] = ((uint64_t)z.ve.x[j * 8] << 56) | ((uint64_t)z.ve.x[j * 8 + 1] << 48)
-			| ((uint64_t)z.ve.x[j * 8 + 2] << 40) | ((uint64_t)z.ve.x[j * 8 + 3] << 32)
-			| ((uint64_t)z.ve.x[j * 8 + 4] << 24) | ((uint64_t)z.ve.x[j * 8 + 5] << 16)
-			| ((uint64_t)z.ve.x[j * 8 + 6] << 8) | (uint64_t)z.ve.x[j * 8 + 7];
-		w[j][1] = ((uint64_t)z.ve1.x[j * 8] << 56) | ((uint64_t)z.ve1.x[j * 8 + 1] << 48)
-			| ((uint64_t)z.ve1.x[j * 8 + 2] << 40) | ((uint64_t)z.ve1.x[j * 8 + 3] << 32)
-			| ((uint64_t)z.ve1.x[j * 8 + 4] << 24) | ((uint64_t)z.ve1.x[j * 8 + 5] << 16)
-			| ((uint64_t)z.ve1.x[j * 8 + 6] << 8) | (uint64_t)z.ve1.x[j * 8 + 7];
+		w[j][0] = ((uint64_t)zve->x[j * 8] << 56) | ((uint64_t)zve->x[j * 8 + 1] << 48)
+			| ((uint64_t)zve->x[j * 8 + 2] << 40) | ((uint64_t)zve->x[j * 8 + 3] << 32)
+			| ((uint64_t)zve->x[j * 8 + 4] << 24) | ((uint64_t)zve->x[j * 8 + 5] << 16)
+			| ((uint64_t)zve->x[j * 8 + 6] << 8) | (uint64_t)zve->x[j * 8 + 7];
+		w[j][1] = ((uint64_t)zve1->x[j * 8] << 56) | ((uint64_t)zve1->x[j * 8 + 1] << 48)
+			| ((uint64_t)zve1->x[j * 8 + 2] << 40) | ((uint64_t)zve1->x[j * 8 + 3] << 32)
+			| ((uint64_t)zve1->x[j * 8 + 4] << 24) | ((uint64_t)zve1->x[j * 8 + 5] << 16)
+			| ((uint64_t)zve1->x[j * 8 + 6] << 8) | (uint64_t)zve1->x[j * 8 + 7];
 	}
 
 	uint64_t s0[2], s1[2];
 	uint64_t t0[2], t1[2];
-	uint64_t va[2] = { hA[0],hA[0] };
-	uint64_t vb[2] = { hA[1],hA[1] };
-	uint64_t vc[2] = { hA[2],hA[2] };
-	uint64_t vd[2] = { hA[3],hA[3] };
-	uint64_t ve[2] = { hA[4],hA[4] };
-	uint64_t vf[2] = { hA[5],hA[5] };
-	uint64_t vg[2] = { hA[6],hA[6] };
-	uint64_t vh[2] = { hA[7],hA[7] };
+	uint64_t va[2] = { state[0][0],state[0][1] };
+	uint64_t vb[2] = { state[1][0],state[1][1] };
+	uint64_t vc[2] = { state[2][0],state[2][1] };
+	uint64_t vd[2] = { state[3][0],state[3][1] };
+	uint64_t ve[2] = { state[4][0],state[4][1] };
+	uint64_t vf[2] = { state[5][0],state[5][1] };
+	uint64_t vg[2] = { state[6][0],state[6][1] };
+	uint64_t vh[2] = { state[7][0],state[7][1] };
 	uint64_t temp1[3], temp2[3], maj[3];
 	for (int i = 0; i < 80; i++) 
 	{
@@ -481,7 +577,7 @@ int verify(a a, int e, z z) {
 
 		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
 
-			if(mpc_ADD_verify(W(i+9), s0, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+			if(mpc_ADD_verify(W(i+9), s0, t1, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -489,13 +585,13 @@ int verify(a a, int e, z z) {
 			}
 
 
-			if(mpc_ADD_verify(s1, t1, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+			if(mpc_ADD_verify(s1, t1, t1, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
 				return 1;
 			}
-			if(mpc_ADD_verify(W(i), t1, W(i), z.ve, z.ve1, randomness, randCount, countY) == 1) {
+			if(mpc_ADD_verify(W(i), t1, W(i), zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -519,14 +615,14 @@ int verify(a a, int e, z z) {
 
 		//t0 = h + s1
 
-		if(mpc_ADD_verify(vh, s1, t0, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(vh, s1, t0, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
 			return 1;
 		}
 
-		if(mpc_CH_verify(ve, vf, vg, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_CH_verify(ve, vf, vg, t1, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -534,7 +630,7 @@ int verify(a a, int e, z z) {
 		}
 
 		//t1 = t0 + t1 (h+s1+ch)
-		if(mpc_ADD_verify(t0, t1, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(t0, t1, t1, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -545,7 +641,7 @@ int verify(a a, int e, z z) {
 
 		t0[0] = k[i];
 		t0[1] = k[i];
-		if(mpc_ADD_verify(t1, t0, t1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(t1, t0, t1, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -553,7 +649,7 @@ int verify(a a, int e, z z) {
 		}
 
 
-		if(mpc_ADD_verify(t1, W(i), temp1, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(t1, W(i), temp1, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -570,7 +666,7 @@ int verify(a a, int e, z z) {
 		//maj = (a & (b ^ c)) ^ (b & c);
 		//(a & b) ^ (a & c) ^ (b & c)
 
-		if(mpc_MAJ_verify(va, vb, vc, maj, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_MAJ_verify(va, vb, vc, maj, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -578,7 +674,7 @@ int verify(a a, int e, z z) {
 		}
 
 		//temp2 = s0+maj;
-		if(mpc_ADD_verify(s0, maj, temp2, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(s0, maj, temp2, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -591,7 +687,7 @@ int verify(a a, int e, z z) {
 		memcpy(vg, vf, sizeof(uint64_t) * 2);
 		memcpy(vf, ve, sizeof(uint64_t) * 2);
 		//e = d+temp1;
-		if(mpc_ADD_verify(vd, temp1, ve, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(vd, temp1, ve, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -603,7 +699,7 @@ int verify(a a, int e, z z) {
 		memcpy(vb, va, sizeof(uint64_t) * 2);
 		//a = temp1+temp2;
 
-		if(mpc_ADD_verify(temp1, temp2, va, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+		if(mpc_ADD_verify(temp1, temp2, va, zve, zve1, tw, countY, rebuild) == 1) {
 #if VERBOSE
 		printf("Failing at %d, iteration %d", __LINE__, i);
 #endif
@@ -611,62 +707,286 @@ int verify(a a, int e, z z) {
 		}
 	}
 
-	uint64_t hHa[8][3] = { { hA[0],hA[0],hA[0]  }, { hA[1],hA[1],hA[1] }, { hA[2],hA[2],hA[2] }, { hA[3],hA[3],hA[3] },
-			{ hA[4],hA[4],hA[4] }, { hA[5],hA[5],hA[5] }, { hA[6],hA[6],hA[6] }, { hA[7],hA[7],hA[7] } };
-	if(mpc_ADD_verify(hHa[0], va, hHa[0], z.ve, z.ve1, randomness, randCount, countY) == 1) {
+	uint64_t* vars[8] = { va, vb, vc, vd, ve, vf, vg, vh };
+	for (int i = 0; i < 8; i++) {
+		int failed;
+		if (i < outWords)
+			failed = mpc_ADD_verify(state[i], vars[i], state[i], zve, zve1, tw, countY, rebuild);
+		else
+			failed = mpc_DROP_verify(state[i], zve, zve1, countY, rebuild);
+		if (failed) {
 #if VERBOSE
-		printf("Failing at %d", __LINE__);
+			printf("Failing at %d", __LINE__);
 #endif
-		return 1;
+			return 1;
+		}
 	}
-	if(mpc_ADD_verify(hHa[1], vb, hHa[1], z.ve, z.ve1, randomness, randCount, countY) == 1) {
+
+	for (int i = 0; i < 8; i++) {
+		if (rebuild)
+			rebuild[ySize - 8 + i] = state[i][0];
+		else if (zve->y[ySize - 8 + i] != state[i][0]) {
 #if VERBOSE
-		printf("Failing at %d", __LINE__);
+			printf("Failing at %d", __LINE__);
 #endif
-		return 1;
-	}
-	if(mpc_ADD_verify(hHa[2], vc, hHa[2], z.ve, z.ve1, randomness, randCount, countY) == 1) {
+			return 1;
+		}
+		if (zve1->y[ySize - 8 + i] != state[i][1]) {
 #if VERBOSE
-		printf("Failing at %d", __LINE__);
+			printf("Failing at %d", __LINE__);
 #endif
-		return 1;
+			return 1;
+		}
 	}
-	if(mpc_ADD_verify(hHa[3], vd, hHa[3], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+
+	return 0;
+}
+
+
+/*
+ * Verifier result codes, in the order the checks are run. Each check is done
+ * for every round before the next, more expensive one starts, so most bad
+ * proofs are rejected without running the circuit.
+ */
+#define VERIFY_OK 0
+#define VERIFY_MALFORMED 1	// proof size or header
+#define VERIFY_OUTPUT 2		// output shares do not give the hash
+#define VERIFY_COMMITMENT 3	// opened views do not match the commitments
+#define VERIFY_CIRCUIT 4	// opened views are not consistent with the circuit
+#define VERIFY_CHALLENGE 5	// ZKB++: rebuilt commitments give other challenges
+#define VERIFY_PREFIX 6		// proof is not for the public prefix given
+#define VERIFY_HMAC 7		// proof is not for the HMAC message or PBKDF2 iterations given
+
+const char* verifyResultName(int code) {
+	static const char* names[] = { "ok", "format", "output", "commitment", "circuit", "challenge", "prefix", "hmac" };
+
+	if ((code < 0) || (code > VERIFY_HMAC))
+		return "unknown";
+	return names[code];
+}
+
+/*
+ * The checks below take one round. record points at the round's record inside
+ * the mapped proof file: the z with block 0 followed by (ve, ve1) for every
+ * further block. Views are read in place. Each returns 0 when the round passes.
+ */
+const View* roundView(const unsigned char* record, int b, int j) {
+	const z* zp = (const z*)record;
+
+	if (b == 0)
+		return j ? &zp->ve1 : &zp->ve;
+	return (const View*)(record + proofRoundSize(b)) + j;
+}
+
+/*
+ * Output shares of the opened parties against the last words of their views,
+ * or for an HMAC proof against the XOR of the outputs of its HMAC_OUTER steps
+ */
+int verifyOutputs(const a* a, int e, const unsigned char* record, int numBlocks, const hmacPlan* hmac) {
+	uint64_t out[2][8];
+	releaseMark mark;
+
+	memset(out, 0, sizeof(out));
+	releaseFrom(&mark, record);
+	for (int b = hmac ? 0 : numBlocks - 1; b < numBlocks; b++) {
+		if (!hmac || (hmac_step(hmac, b) == HMAC_OUTER)) {
+			for (int j = 0; j < 2; j++)
+				for (int i = 0; i < 8; i++)
+					out[j][i] ^= roundView(record, b, j)->y[ySize - 8 + i];
+		}
+		releaseUpTo(&mark, roundView(record, b, 1) + 1);
 	}
-	if(mpc_ADD_verify(hHa[4], ve, hHa[4], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	for (int i = 0; i < 8; i++) {
+		if ((a->yp[e][i] != out[0][i]) || (a->yp[(e + 1) % 3][i] != out[1][i]))
+			return 1;
 	}
-	if(mpc_ADD_verify(hHa[5], vf, hHa[5], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	return 0;
+}
+
+int verifyCommitments(const a* a, int e, const unsigned char* record, int numBlocks) {
+	const z* zp = (const z*)record;
+	unsigned char hash[2][SHA512_DIGEST_LENGTH];
+	EVP_MD_CTX** ctx = crypto_digests(crypto_sha512, 2);
+	releaseMark mark;
+
+	EVP_DigestUpdate(ctx[0], zp->ke, 16);
+	EVP_DigestUpdate(ctx[1], zp->ke1, 16);
+	releaseFrom(&mark, record);
+	for (int b = 0; b < numBlocks; b++) {
+		H_view(ctx[0], roundView(record, b, 0), blockOutWords(b, numBlocks));
+		H_view(ctx[1], roundView(record, b, 1), blockOutWords(b, numBlocks));
+		// the circuits are checked from the page cache, long proofs need not stay mapped in between
+		releaseUpTo(&mark, roundView(record, b, 1) + 1);
 	}
-	if(mpc_ADD_verify(hHa[6], vg, hHa[6], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	EVP_DigestUpdate(ctx[0], zp->re, 4);
+	EVP_DigestFinal_ex(ctx[0], hash[0], NULL);
+	EVP_DigestUpdate(ctx[1], zp->re1, 4);
+	EVP_DigestFinal_ex(ctx[1], hash[1], NULL);
+	stats_add(STATS_HASH_BYTES, 2 * (16 + roundCommitBytes(numBlocks) + 4));
+
+	return (memcmp(a->h[e], hash[0], 64) != 0) || (memcmp(a->h[(e + 1) % 3], hash[1], 64) != 0);
+}
+
+/*
+ * Runs the circuit of the two opened parties over every block, starting from
+ * the chaining value iv. For an HMAC proof the blocks that are not secret are
+ * derived and must match the views. Gives up between blocks once *stop is set
+ * by another thread.
+ */
+int verifyCircuit(const unsigned char* record, int numBlocks, const uint64_t iv[8], const hmacPlan* hmac, const int* stop) {
+	const z* zp = (const z*)record;
+	hmacShares hs[2];
+	unsigned char derived[2][SHA512_CBLOCK];
+	unsigned char* xs[2] = { derived[0], derived[1] };
+	uint64_t state[8][2];
+	tapeStream tapes[2];
+	tapeStream* tp[2] = { &tapes[0], &tapes[1] };
+	tapeWindow tw;
+	releaseMark mark;
+	int ret = 0;
+
+	tape_open(&tapes[0], zp->ke, TAPE_IV);
+	tape_open(&tapes[1], zp->ke1, TAPE_IV);
+	tape_window(&tw, 2, tp);
+	releaseFrom(&mark, record);
+	memset(hs, 0, sizeof(hs));
+	for (int i = 0; i < 8; i++) {
+		state[i][0] = iv[i];
+		state[i][1] = iv[i];
 	}
-	if(mpc_ADD_verify(hHa[7], vh, hHa[7], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+
+	for (int b = 0; (b < numBlocks) && !ret; b++) {
+		const View* zv[2] = { roundView(record, b, 0), roundView(record, b, 1) };
+		int stopped;
+		#pragma omp atomic read
+		stopped = *stop;
+		if (stopped) {
+			ret = 1;
+			break;
+		}
+		if (hmac) {
+			hmac_enter(hmac, b, hs, 2, state, xs);
+			if (!hmac_secret(hmac, b) && ((memcmp(derived[0], zv[0]->x, SHA512_CBLOCK) != 0) ||
+					(memcmp(derived[1], zv[1]->x, SHA512_CBLOCK) != 0))) {
+				ret = 1;
+				break;
+			}
+		}
+		ret = verifyBlock(state, zv[0], zv[1], &tw, blockOutWords(b, numBlocks), NULL);
+		if (hmac) {
+			const unsigned char* xv[2] = { zv[0]->x, zv[1]->x };
+			hmac_leave(hmac, b, hs, 2, state, xv);
+		}
+		stats_add(STATS_GATES, ySize);
+		stats_add(STATS_TAPE_BYTES, 2 * rSize);
+		releaseUpTo(&mark, zv[1] + 1);
 	}
 
-	free(randCount);
-	free(countY);
+	tape_close(&tapes[0]);
+	tape_close(&tapes[1]);
 
-	return 0;
+	return ret;
 }
 
+/*
+ * Rebuilds a[] of one round of a ZKB++ proof from its record inside the mapped
+ * proof file. y is the hash the proof is for, which gives the output share of
+ * the unopened party, and iv is the chaining value the circuit starts from.
+ * hmac is the step plan of an HMAC proof, otherwise NULL. Returns 1 when the record is malformed, or when *stop is set by another
+ * thread; whether the rebuilt a[] is right is only known once the challenges
+ * are checked.
+ */
+int verifyCompact(const uint64_t y[8], const unsigned char* record, int numBlocks, const uint64_t iv[8], const hmacPlan* hmac, a* ar, const int* stop) {
+	const zpp* zp = (const zpp*)record;
+	const unsigned char* keys[2] = { zp->ke, zp->ke1 };
+	const unsigned char* rs[2] = { zp->re, zp->re1 };
+	int parties[2] = { zp->e, (zp->e + 1) % 3 };
+	uint64_t state[8][2];
+	hmacShares hs[2];
+	EVP_MD_CTX** ctx = crypto_digests(crypto_sha512, 2);
+	tapeStream tapes[2], shareTapes[2];
+	tapeStream* tp[2] = { &tapes[0], &tapes[1] };
+	tapeWindow tw;
+	View* views;
+	releaseMark mark;
+	static const unsigned char zeros[SHA512_CBLOCK];
+	int ret = 0;
+
+	//x and the padding are zero when unused, so a proof has one encoding
+	if ((zp->e > 2) || memcmp(zp->pad, zeros, sizeof(zp->pad)))
+		return 1;
+	//views[0] is rebuilt for party e, views[1] is party e+1's view with its input share filled in
+	views = malloc(2 * sizeof(View));
+	for (int j = 0; j < 2; j++) {
+		tape_open(&tapes[j], keys[j], TAPE_IV);
+		if (parties[j] < 2)
+			tape_open(&shareTapes[j], keys[j], SHARE_IV);
+		EVP_DigestUpdate(ctx[j], keys[j], 16);
+	}
+	tape_window(&tw, 2, tp);
+	releaseFrom(&mark, record);
+	memset(hs, 0, sizeof(hs));
+	for (int i = 0; i < 8; i++) {
+		state[i][0] = iv[i];
+		state[i][1] = iv[i];
+	}
+
+	for (int b = 0; (b < numBlocks) && !ret; b++) {
+		const View* zve1 = &zp->ve1;
+		unsigned char* xs[2] = { views[0].x, views[1].x };
+		int stopped, fresh;
+		#pragma omp atomic read
+		stopped = *stop;
+		if (stopped) {
+			ret = 1;
+			break;
+		}
+		if (b > 0)
+			zve1 = (const View*)(record + compactRoundSize(b));
+		fresh = !hmac || hmac_secret(hmac, b);
+		if (((zp->e == 0) || !fresh) && memcmp(zve1->x, zeros, sizeof(zve1->x))) {
+			ret = 1;
+			break;
+		}
+		for (int j = 0; (j < 2) && fresh; j++) {
+			if (parties[j] < 2)
+				tape_read(&shareTapes[j], views[j].x, sizeof(views[j].x));
+			else
+				memcpy(views[j].x, zve1->x, sizeof(views[j].x));
+		}
+		if (hmac)
+			hmac_enter(hmac, b, hs, 2, state, xs);
+		memcpy(views[1].y, zve1->y, sizeof(views[1].y));
+		ret = verifyBlock(state, &views[0], &views[1], &tw, blockOutWords(b, numBlocks), views[0].y);
+		if (hmac) {
+			const unsigned char* xv[2] = { views[0].x, views[1].x };
+			hmac_leave(hmac, b, hs, 2, state, xv);
+		}
+		H_view(ctx[0], &views[0], blockOutWords(b, numBlocks));
+		H_view(ctx[1], &views[1], blockOutWords(b, numBlocks));
+		stats_add(STATS_GATES, ySize);
+		stats_add(STATS_TAPE_BYTES, 2 * rSize);
+		stats_add(STATS_HASH_BYTES, 2 * viewCommitBytes(blockOutWords(b, numBlocks)));
+		releaseUpTo(&mark, zve1 + 1);
+	}
+
+	for (int j = 0; j < 2; j++) {
+		EVP_DigestUpdate(ctx[j], rs[j], 4);
+		EVP_DigestFinal_ex(ctx[j], ar->h[parties[j]], NULL);
+		stats_add(STATS_HASH_BYTES, 16 + 4);
+		tape_close(&tapes[j]);
+		if (parties[j] < 2)
+			tape_close(&shareTapes[j]);
+	}
+	memcpy(ar->h[(zp->e + 2) % 3], zp->h2, 64);
+	for (int i = 0; i < 8; i++) {
+		ar->yp[parties[0]][i] = hmac ? hs[0].sum[i] : state[i][0];
+		ar->yp[parties[1]][i] = hmac ? hs[1].sum[i] : state[i][1];
+		ar->yp[(zp->e + 2) % 3][i] = y[i] ^ ar->yp[parties[0]][i] ^ ar->yp[parties[1]][i];
+	}
+	free(views);
+
+	return ret;
+}
 
 #endif /* SHARED_H_ */
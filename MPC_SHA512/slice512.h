@@ -0,0 +1,316 @@
+/*
+ * Name: slice512.h
+ * Author: Tan Teik Guan
+ * Description: Bitsliced SHA-512 prover circuit over many rounds
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * Every round of the proof runs the same SHA-512 circuit, only on different
+ * shares. Here up to SLICE_LANES rounds are evaluated together. A sliced word
+ * x[p][i] holds bit i of party p's share for all rounds, one round per bit
+ * (lane). XOR and AND become a plain word operation per bit plane, rotations
+ * are plane renumbering, and the ADD carry chain costs 63 steps for all rounds
+ * instead of 63 steps per round.
+ *
+ * Tape words are transposed into planes as each gate consumes them, and the
+ * gate outputs are transposed back into each round's View, so the views are
+ * identical to the ones mpc_sha512() writes.
+ *
+ * Include after shared512.h.
+ */
+
+#ifndef SLICE512_H_
+#define SLICE512_H_
+
+#define SLICE_LANES 64
+
+typedef struct {
+	int lanes;
+	tapeWindow* tapes[SLICE_LANES];
+	View* views[SLICE_LANES];
+	int countY;
+} sliceCtx;
+
+// Hot loops get an AVX2 clone next to the generic one, picked at load time
+#ifdef LANES_HAVE_AVX2
+#define SLICE_CLONES __attribute__((target_clones("avx2","default")))
+#else
+#define SLICE_CLONES
+#endif
+
+static inline void slice_swapStage(uint64_t a[64], int j, uint64_t m) {
+	for (int base = 0; base < 64; base += 2 * j) {
+		for (int k = base; k < base + j; k++) {
+			uint64_t t = ((a[k] >> j) ^ a[k + j]) & m;
+			a[k] ^= t << j;
+			a[k + j] ^= t;
+		}
+	}
+}
+
+// In place 64x64 bit transpose: bit j of a[i] <-> bit i of a[j]
+SLICE_CLONES
+void slice_transpose(uint64_t a[64]) {
+	slice_swapStage(a, 32, 0x00000000FFFFFFFF);
+	slice_swapStage(a, 16, 0x0000FFFF0000FFFF);
+	slice_swapStage(a, 8, 0x00FF00FF00FF00FF);
+	slice_swapStage(a, 4, 0x0F0F0F0F0F0F0F0F);
+	slice_swapStage(a, 2, 0x3333333333333333);
+	slice_swapStage(a, 1, 0x5555555555555555);
+}
+
+// Next tape word of every lane as bit planes, one set per party
+void slice_getRandom(sliceCtx* sc, uint64_t r[3][64]) {
+	for (int l = 0; l < SLICE_LANES; l++) {
+		uint64_t w[3] = { 0, 0, 0 };
+		if (l < sc->lanes)
+			tape_next64(sc->tapes[l], w);
+		for (int j = 0; j < 3; j++)
+			r[j][l] = w[j];
+	}
+	for (int j = 0; j < 3; j++)
+		slice_transpose(r[j]);
+}
+
+// Appends a sliced word to every lane's views
+void slice_emit(sliceCtx* sc, uint64_t x[3][64]) {
+	uint64_t t[64];
+
+	for (int j = 0; j < 3; j++) {
+		memcpy(t, x[j], sizeof(t));
+		slice_transpose(t);
+		for (int l = 0; l < sc->lanes; l++)
+			sc->views[l][j].y[sc->countY] = t[l];
+	}
+	sc->countY++;
+}
+
+// Output word that is not kept: no gate, a zero in every lane's views
+void slice_DROP(sliceCtx* sc, uint64_t x[3][64]) {
+	memset(x, 0, 3 * 64 * sizeof(uint64_t));
+	slice_emit(sc, x);
+}
+
+SLICE_CLONES
+void slice_XOR(uint64_t x[3][64], uint64_t y[3][64], uint64_t z[3][64]) {
+	for (int j = 0; j < 3; j++)
+		for (int i = 0; i < 64; i++)
+			z[j][i] = x[j][i] ^ y[j][i];
+}
+
+void slice_NEGATE(uint64_t x[3][64], uint64_t z[3][64]) {
+	for (int j = 0; j < 3; j++)
+		for (int i = 0; i < 64; i++)
+			z[j][i] = ~x[j][i];
+}
+
+void slice_RIGHTROTATE(uint64_t x[3][64], int n, uint64_t z[3][64]) {
+	uint64_t t[64];
+
+	for (int j = 0; j < 3; j++) {
+		for (int i = 0; i < 64; i++)
+			t[i] = x[j][(i + n) & 63];
+		memcpy(z[j], t, sizeof(t));
+	}
+}
+
+void slice_RIGHTSHIFT(uint64_t x[3][64], int n, uint64_t z[3][64]) {
+	uint64_t t[64];
+
+	for (int j = 0; j < 3; j++) {
+		for (int i = 0; i < 64; i++)
+			t[i] = (i + n < 64) ? x[j][i + n] : 0;
+		memcpy(z[j], t, sizeof(t));
+	}
+}
+
+SLICE_CLONES
+void slice_AND(sliceCtx* sc, uint64_t x[3][64], uint64_t y[3][64], uint64_t z[3][64]) {
+	uint64_t r[3][64];
+
+	slice_getRandom(sc, r);
+	for (int i = 0; i < 64; i++) {
+		uint64_t x0 = x[0][i], x1 = x[1][i], x2 = x[2][i];
+		uint64_t y0 = y[0][i], y1 = y[1][i], y2 = y[2][i];
+
+		z[0][i] = (x0 & y1) ^ (x1 & y0) ^ (x0 & y0) ^ r[0][i] ^ r[1][i];
+		z[1][i] = (x1 & y2) ^ (x2 & y1) ^ (x1 & y1) ^ r[1][i] ^ r[2][i];
+		z[2][i] = (x2 & y0) ^ (x0 & y2) ^ (x2 & y2) ^ r[2][i] ^ r[0][i];
+	}
+	slice_emit(sc, z);
+}
+
+void slice_OR(sliceCtx* sc, uint64_t x[3][64], uint64_t y[3][64], uint64_t z[3][64]) {
+	uint64_t t0[3][64], t1[3][64], t2[3][64];
+
+	slice_NEGATE(x, t0);
+	slice_NEGATE(y, t1);
+	slice_AND(sc, t0, t1, t2);
+	slice_NEGATE(t2, z);
+}
+
+SLICE_CLONES
+void slice_ADD(sliceCtx* sc, uint64_t x[3][64], uint64_t y[3][64], uint64_t z[3][64]) {
+	uint64_t r[3][64];
+	uint64_t c[3][64];
+
+	slice_getRandom(sc, r);
+	c[0][0] = c[1][0] = c[2][0] = 0;
+	for (int i = 0; i < 63; i++) {
+		uint64_t a0 = x[0][i] ^ c[0][i], a1 = x[1][i] ^ c[1][i], a2 = x[2][i] ^ c[2][i];
+		uint64_t b0 = y[0][i] ^ c[0][i], b1 = y[1][i] ^ c[1][i], b2 = y[2][i] ^ c[2][i];
+
+		c[0][i+1] = (a0 & (b0 ^ b1)) ^ (a1 & b0) ^ c[0][i] ^ r[0][i] ^ r[1][i];
+		c[1][i+1] = (a1 & (b1 ^ b2)) ^ (a2 & b1) ^ c[1][i] ^ r[1][i] ^ r[2][i];
+		c[2][i+1] = (a2 & (b2 ^ b0)) ^ (a0 & b2) ^ c[2][i] ^ r[2][i] ^ r[0][i];
+	}
+	for (int j = 0; j < 3; j++)
+		for (int i = 0; i < 64; i++)
+			z[j][i] = x[j][i] ^ y[j][i] ^ c[j][i];
+	slice_emit(sc, c);
+}
+
+void slice_ADDK(sliceCtx* sc, uint64_t x[3][64], uint64_t k, uint64_t z[3][64]) {
+	uint64_t y[3][64];
+
+	for (int i = 0; i < 64; i++)
+		y[0][i] = y[1][i] = y[2][i] = GETBIT(k, i) ? ~(uint64_t)0 : 0;
+	slice_ADD(sc, x, y, z);
+}
+
+void slice_MAJ(sliceCtx* sc, uint64_t a[3][64], uint64_t b[3][64], uint64_t c[3][64], uint64_t z[3][64]) {
+	uint64_t t0[3][64], t1[3][64], t2[3][64];
+
+	slice_AND(sc, a, b, t0);
+	slice_AND(sc, b, c, t1);
+	slice_AND(sc, c, a, t2);
+	slice_OR(sc, t0, t1, z);
+	slice_OR(sc, t2, z, z);
+}
+
+void slice_CH(sliceCtx* sc, uint64_t e[3][64], uint64_t f[3][64], uint64_t g[3][64], uint64_t z[3][64]) {
+	uint64_t t0[3][64], t1[3][64], t2[3][64];
+
+	slice_AND(sc, e, f, t0);
+	slice_NEGATE(e, t1);
+	slice_AND(sc, t1, g, t2);
+	slice_OR(sc, t0, t2, z);
+}
+
+// Sliced word holding the same public value in every lane of every party
+void slice_setWord(uint64_t x[3][64], uint64_t v) {
+	for (int i = 0; i < 64; i++)
+		x[0][i] = x[1][i] = x[2][i] = GETBIT(v, i) ? ~(uint64_t)0 : 0;
+}
+
+// Lane l of party p of a sliced word
+uint64_t slice_getWord(uint64_t x[3][64], int p, int l) {
+	uint64_t t[64];
+
+	memcpy(t, x[p], sizeof(t));
+	slice_transpose(t);
+	return t[l];
+}
+
+/*
+ * Same circuit as mpc_sha512() for every lane of sc. The block shares are
+ * taken from views[l][p].x and the gate outputs are written to the views.
+ */
+int slice_sha512(sliceCtx* sc, uint64_t state[8][3][64], int outWords) {
+	uint64_t w[16][3][64];
+	uint64_t s0[3][64], s1[3][64];
+	uint64_t t0[3][64], t1[3][64];
+	uint64_t a[3][64], b[3][64], c[3][64], d[3][64], e[3][64], f[3][64], g[3][64], h[3][64];
+	uint64_t temp1[3][64], temp2[3][64], maj[3][64];
+
+	sc->countY = 0;
+
+	for (int j = 0; j < 16; j++) {
+		for (int p = 0; p < 3; p++) {
+			for (int l = 0; l < SLICE_LANES; l++) {
+				unsigned char* x = sc->views[l < sc->lanes ? l : 0][p].x + j * 8;
+				w[j][p][l] = ((uint64_t)x[0] << 56) | ((uint64_t)x[1] << 48)
+					| ((uint64_t)x[2] << 40) | ((uint64_t)x[3] << 32)
+					| ((uint64_t)x[4] << 24) | ((uint64_t)x[5] << 16)
+					| ((uint64_t)x[6] << 8) | (uint64_t)x[7];
+			}
+			slice_transpose(w[j][p]);
+		}
+	}
+
+	memcpy(a, state[0], sizeof(a));
+	memcpy(b, state[1], sizeof(b));
+	memcpy(c, state[2], sizeof(c));
+	memcpy(d, state[3], sizeof(d));
+	memcpy(e, state[4], sizeof(e));
+	memcpy(f, state[5], sizeof(f));
+	memcpy(g, state[6], sizeof(g));
+	memcpy(h, state[7], sizeof(h));
+	for (int i = 0; i < 80; i++) {
+		if (i >= 16)
+		{
+			slice_RIGHTROTATE(W(i+14), 19, t0);
+			slice_RIGHTROTATE(W(i+14), 61, t1);
+			slice_XOR(t0, t1, t0);
+			slice_RIGHTSHIFT(W(i+14), 6, t1);
+			slice_XOR(t0, t1, s0);
+
+			slice_RIGHTROTATE(W(i+1), 1, t0);
+			slice_RIGHTROTATE(W(i+1), 8, t1);
+			slice_XOR(t0, t1, t0);
+			slice_RIGHTSHIFT(W(i+1), 7, t1);
+			slice_XOR(t0, t1, s1);
+
+			slice_ADD(sc, W(i+9), s0, t1);
+			slice_ADD(sc, s1, t1, t1);
+			slice_ADD(sc, W(i), t1, W(i));
+		}
+
+		slice_RIGHTROTATE(e, 14, t0);
+		slice_RIGHTROTATE(e, 18, t1);
+		slice_XOR(t0, t1, t0);
+		slice_RIGHTROTATE(e, 41, t1);
+		slice_XOR(t0, t1, s1);
+
+		slice_ADD(sc, h, s1, t0);
+		slice_CH(sc, e, f, g, t1);
+		slice_ADD(sc, t0, t1, t1);
+		slice_ADDK(sc, t1, k[i], t1);
+		slice_ADD(sc, t1, W(i), temp1);
+
+		slice_RIGHTROTATE(a, 28, t0);
+		slice_RIGHTROTATE(a, 34, t1);
+		slice_XOR(t0, t1, t0);
+		slice_RIGHTROTATE(a, 39, t1);
+		slice_XOR(t0, t1, s0);
+
+		slice_MAJ(sc, a, b, c, maj);
+		slice_ADD(sc, s0, maj, temp2);
+
+		memcpy(h, g, sizeof(h));
+		memcpy(g, f, sizeof(g));
+		memcpy(f, e, sizeof(f));
+		slice_ADD(sc, d, temp1, e);
+		memcpy(d, c, sizeof(d));
+		memcpy(c, b, sizeof(c));
+		memcpy(b, a, sizeof(b));
+		slice_ADD(sc, temp1, temp2, a);
+	}
+
+	uint64_t (*vars[8])[64] = { a, b, c, d, e, f, g, h };
+	for (int i = 0; i < 8; i++) {
+		if (i < outWords)
+			slice_ADD(sc, state[i], vars[i], state[i]);
+		else
+			slice_DROP(sc, state[i]);
+	}
+
+	for (int i = 0; i < 8; i++)
+		slice_emit(sc, state[i]);
+
+	return 0;
+}
+
+#endif /* SLICE512_H_ */
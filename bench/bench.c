@@ -0,0 +1,576 @@
+/*
+ * Author: Tan Teik Guan
+ * Description : Benchmark of every prover and verifier
+ *
+ * Copyright 2022 pQCee
+ *
+ */
+
+/*
+ * Runs the provers and verifiers over a matrix of message sizes, round
+ * counts and thread counts. Every configuration is proved reps times and the
+ * last proof is verified reps times. Each run is its own process, so its peak
+ * RSS comes from wait4() and no run warms the caches of the next one. Every
+ * prover but KKW_SHA256, which needs no randomness, is given --seed
+ * (common/seed.h), so a configuration gives the same proof every time and the SHA-256 of the proof shows whether a change to the
+ * code changed what it proves.
+ *
+ * One JSON object per line goes to the results file:
+ *
+ *   {"bench":"MPC_SHA256","role":"prove","input_bytes":55,"rounds":136,
+ *    "threads":1,"reps":5,"ok":1,"median_ms":..,"p99_ms":..,
+ *    "rounds_per_s":..,"proof_bytes":..,"peak_rss_kb":..,"proof_sha256":".."}
+ *
+ * With --baseline the medians and proofs are compared against an earlier
+ * results file, and the exit code is 1 when a median is slower by more than
+ * --tolerance percent, when a proof is not the same, or when a run fails.
+ *
+ * The KKW, KKW_ECC and PoAO binaries have their rounds compiled in, so they
+ * run once per thread count with those rounds. KKW_SHA256 prints its proof
+ * file and rounds, which depend on the KKW_PARTIES it was built with, and
+ * they are taken from its output. KKW_ECC proves a fixed seed and PoAO a
+ * fixed public key, so they also ignore the message sizes. MPC_BRISTOL
+ * proves the message as the input of a generated circuit of chi layers, as
+ * in Keccak, over the message bits.
+ *
+ * Usage: bench.exe [--root DIR] [--out FILE] [--reps N] [--sizes 3,55]
+ *                  [--rounds 32,136] [--threads 1,4] [--only NAME]
+ *                  [--baseline FILE] [--tolerance PCT]
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <openssl/sha.h>
+#include "../common/crypto.h"
+
+#define BENCH_CLI 0   // common/cli.h options
+#define BENCH_KKW 1   // message on stdin, proof out<parties>-<rounds>-<online>.bin
+#define BENCH_ECC 2   // seed as argument, proof out<rounds>-<online>.bin
+#define BENCH_POAO 3  // public key as argument, proof on stdout
+#define BENCH_BRISTOL 4  // common/cli.h options and a circuit for the message size
+
+#define BENCH_MAX_LIST 16
+#define BENCH_MAX_REPS 1000
+#define BENCH_MAX_RESULTS 1024
+
+#define BENCH_SEED "zkboo-bench"
+#define ECC_SEED "zkboo-bench"
+#define BRISTOL_LAYERS 24
+#define POAO_PUBKEY "0279BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+
+typedef struct {
+	const char* name;
+	const char* dir;
+	const char* prover;
+	const char* verifier;
+	int kind;
+	int maxInput;		// longest message in bytes, 0 when the input is fixed
+	int rounds;		// rounds compiled in, 0 when --rounds is taken, -1 when the prover prints them
+	const char* proofName;	// proof file the prover writes in its working directory, NULL when it prints it
+} benchTarget;
+
+static const benchTarget targets[] = {
+	{ "MPC_SHA1", "MPC_SHA1", "MPC_SHA1.exe", "MPC_SHA1_VERIFIER.exe", BENCH_CLI, 55, 0, "proof.bin" },
+	{ "MPC_SHA256", "MPC_SHA256", "MPC_SHA256.exe", "MPC_SHA256_VERIFIER.exe", BENCH_CLI, 55, 0, "proof.bin" },
+	{ "MPC_SHA512", "MPC_SHA512", "MPC_SHA512.exe", "MPC_SHA512_VERIFIER.exe", BENCH_CLI, 1024, 0, "proof.bin" },
+	{ "MPC_RIPEMD160", "MPC_RIPEMD160", "MPC_RIPEMD160.exe", "MPC_RIPEMD160_VERIFIER.exe", BENCH_CLI, 55, 0, "proof.bin" },
+	{ "MPC_BRISTOL", "MPC_BRISTOL", "MPC_BRISTOL.exe", "MPC_BRISTOL_VERIFIER.exe", BENCH_BRISTOL, 1024, 0, "proof.bin" },
+	{ "KKW_SHA256", "MPC_SHA256", "KKW_SHA256", "KKW_SHA256_VERIFIER", BENCH_KKW, 55, -1, NULL },
+	{ "KKW_ECC", "MPC_ECC", "KKW_ECC", "KKW_ECC_VERIFIER", BENCH_ECC, 0, 10, "out10-4.bin" },
+	{ "PoAO", "MPC_ADDRESS", "PoAO.exe", "PoAO.exe", BENCH_POAO, 0, 32, "proof.json" },
+};
+
+#define NUM_TARGETS (int)(sizeof(targets) / sizeof(targets[0]))
+
+typedef struct {
+	char bench[64];
+	char role[16];
+	int inputBytes;
+	int rounds;
+	int threads;
+	int reps;
+	int ok;
+	double medianMs;
+	double p99Ms;
+	double roundsPerSec;
+	long proofBytes;
+	long peakRssKb;
+	char proofHash[2 * SHA256_DIGEST_LENGTH + 1];
+} benchResult;
+
+char root[PATH_MAX];
+char startDir[PATH_MAX];
+char workDir[] = "/tmp/zkboo-bench-XXXXXX";
+int keepWorkDir = 0;
+
+static double nowMs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/*
+ * Parses a comma separated list of positive numbers into list, returns the
+ * count or -1 when it is invalid.
+ */
+static int parseList(const char* s, int list[BENCH_MAX_LIST]) {
+	int n = 0;
+	char* end;
+
+	while (*s) {
+		long v = strtol(s, &end, 10);
+		if ((end == s) || (v <= 0) || (v > INT_MAX) || (n == BENCH_MAX_LIST))
+			return -1;
+		list[n++] = (int)v;
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return -1;
+		s = end;
+	}
+	return n;
+}
+
+/*
+ * Runs argv in the work directory with stdin from inFile and stdout from
+ * outFile (log.txt when NULL), OMP_NUM_THREADS set to threads. Returns the
+ * exit code, -1 when it did not exit normally, and the wall ms and peak RSS.
+ */
+static int runChild(char* const argv[], const char* inFile, const char* outFile, int threads, double* ms, long* rssKb) {
+	char threadStr[16];
+	struct rusage usage;
+	int status;
+
+	sprintf(threadStr, "%d", threads);
+	double start = nowMs();
+	pid_t pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0) {
+		int in = open(inFile ? inFile : "/dev/null", O_RDONLY);
+		int out = open(outFile ? outFile : "log.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		int log = open("log.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if ((in < 0) || (out < 0) || (log < 0))
+			_exit(126);
+		dup2(in, 0);
+		dup2(out, 1);
+		dup2(log, 2);
+		setenv("OMP_NUM_THREADS", threadStr, 1);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+	if (wait4(pid, &status, 0, &usage) != pid)
+		return -1;
+	*ms = nowMs() - start;
+	*rssKb = usage.ru_maxrss;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static int compareMs(const void* a, const void* b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Fills the median, p99 (nearest rank) and throughput of the reps run times.
+ */
+static void summarise(benchResult* r, double* ms) {
+	qsort(ms, r->reps, sizeof(double), compareMs);
+	r->medianMs = (r->reps & 1) ? ms[r->reps / 2] : (ms[r->reps / 2 - 1] + ms[r->reps / 2]) / 2;
+	int rank = (99 * r->reps + 99) / 100;
+	r->p99Ms = ms[rank - 1];
+	r->roundsPerSec = (r->medianMs > 0) ? r->rounds * 1000.0 / r->medianMs : 0;
+}
+
+// Hex SHA-256 of the file, empty when it can't be read
+static void hashFile(const char* name, char hex[2 * SHA256_DIGEST_LENGTH + 1]) {
+	FILE* f = fopen(name, "rb");
+	unsigned char buf[65536];
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	EVP_MD_CTX* ctx;
+	size_t n;
+
+	hex[0] = 0;
+	if (!f)
+		return;
+	ctx = crypto_digest(crypto_sha256);
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		EVP_DigestUpdate(ctx, buf, n);
+	EVP_DigestFinal_ex(ctx, hash, NULL);
+	fclose(f);
+	for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
+		sprintf(hex + 2 * i, "%02x", hash[i]);
+}
+
+static void writeMessage(int size, int newline) {
+	FILE* f = fopen("message.txt", "wb");
+
+	for (int i = 0; i < size; i++)
+		fputc('a' + i % 26, f);
+	if (newline)
+		fputc('\n', f);
+	fclose(f);
+}
+
+/*
+ * Writes a Bristol Fashion circuit over size secret bytes to circuit.txt:
+ * BRISTOL_LAYERS layers of x[i] ^= ~x[i+1] & x[i+2] over the bits, as the chi
+ * step of Keccak, each layer a run of INV, then AND, then XOR gates so the
+ * last layer's outputs are the last wires.
+ */
+static void writeCircuit(int size) {
+	FILE* f = fopen("circuit.txt", "w");
+	int n = 8 * size;
+	int first = 0, next = n;
+
+	fprintf(f, "%d %d\n1 %d\n1 %d\n\n", 3 * n * BRISTOL_LAYERS, n + 3 * n * BRISTOL_LAYERS, n, n);
+	for (int l = 0; l < BRISTOL_LAYERS; l++) {
+		for (int i = 0; i < n; i++)
+			fprintf(f, "1 1 %d %d INV\n", first + (i + 1) % n, next + i);
+		for (int i = 0; i < n; i++)
+			fprintf(f, "2 1 %d %d %d AND\n", next + i, first + (i + 2) % n, next + n + i);
+		for (int i = 0; i < n; i++)
+			fprintf(f, "2 1 %d %d %d XOR\n", first + i, next + n + i, next + 2 * n + i);
+		first = next + 2 * n;
+		next += 3 * n;
+	}
+	fclose(f);
+}
+
+/*
+ * Takes the proof file and rounds from the output of a prover that prints
+ * them, "Proof output to file NAME" and "P parties, R rounds, ...". Returns 0
+ * when both were found.
+ */
+static int proverOutput(char name[PATH_MAX], int* rounds) {
+	FILE* f = fopen("log.txt", "r");
+	char line[PATH_MAX + 64];
+	int found = 0;
+
+	if (!f)
+		return 1;
+	while (fgets(line, sizeof(line), f)) {
+		const char* file = strstr(line, "Proof output to file ");
+		int parties;
+		if (file && (sscanf(file + 21, "%4095s", name) == 1))
+			found |= 1;
+		if (sscanf(line, "%d parties, %d rounds", &parties, rounds) == 2)
+			found |= 2;
+	}
+	fclose(f);
+	return found != 3;
+}
+
+/*
+ * Proves and verifies one configuration reps times each, fills prove and
+ * verify. Returns 0 when every run exited with 0.
+ */
+static int benchOne(const benchTarget* t, int size, int rounds, int threads, int reps, benchResult* prove, benchResult* verify) {
+	char prover[PATH_MAX], verifier[PATH_MAX];
+	char proofName[PATH_MAX];
+	char roundStr[16], threadStr[16];
+	char* pargv[16];
+	char* vargv[16];
+	const char* in = NULL;
+	const char* out = NULL;
+	double ms[BENCH_MAX_REPS];
+	struct stat st;
+	int ok = 1;
+
+	snprintf(prover, sizeof(prover), "%s/%s/%s", root, t->dir, t->prover);
+	snprintf(verifier, sizeof(verifier), "%s/%s/%s", root, t->dir, t->verifier);
+	sprintf(roundStr, "%d", rounds);
+	sprintf(threadStr, "%d", threads);
+	snprintf(proofName, sizeof(proofName), "%s", t->proofName ? t->proofName : "");
+	if (t->proofName)
+		unlink(t->proofName);
+
+	switch (t->kind) {
+	case BENCH_CLI:
+		writeMessage(size, 0);
+		pargv[0] = prover; pargv[1] = "--rounds"; pargv[2] = roundStr; pargv[3] = "--threads"; pargv[4] = threadStr;
+		pargv[5] = "--input-file"; pargv[6] = "message.txt"; pargv[7] = "--out"; pargv[8] = proofName;
+		pargv[9] = "--seed"; pargv[10] = BENCH_SEED; pargv[11] = NULL;
+		vargv[0] = verifier; vargv[1] = "--rounds"; vargv[2] = roundStr; vargv[3] = "--threads"; vargv[4] = threadStr;
+		vargv[5] = "--input-file"; vargv[6] = proofName; vargv[7] = NULL;
+		break;
+	case BENCH_BRISTOL:
+		writeMessage(size, 0);
+		writeCircuit(size);
+		pargv[0] = prover; pargv[1] = "--rounds"; pargv[2] = roundStr; pargv[3] = "--threads"; pargv[4] = threadStr;
+		pargv[5] = "--circuit"; pargv[6] = "circuit.txt"; pargv[7] = "--input-file"; pargv[8] = "message.txt";
+		pargv[9] = "--out"; pargv[10] = proofName; pargv[11] = "--seed"; pargv[12] = BENCH_SEED; pargv[13] = NULL;
+		vargv[0] = verifier; vargv[1] = "--rounds"; vargv[2] = roundStr; vargv[3] = "--threads"; vargv[4] = threadStr;
+		vargv[5] = "--circuit"; vargv[6] = "circuit.txt"; vargv[7] = proofName; vargv[8] = NULL;
+		break;
+	case BENCH_KKW:
+		writeMessage(size, 1);
+		in = "message.txt";
+		pargv[0] = prover; pargv[1] = NULL;
+		vargv[0] = verifier; vargv[1] = proofName; vargv[2] = NULL;
+		break;
+	case BENCH_ECC:
+		pargv[0] = prover; pargv[1] = "--seed"; pargv[2] = BENCH_SEED; pargv[3] = ECC_SEED; pargv[4] = NULL;
+		vargv[0] = verifier; vargv[1] = proofName; vargv[2] = NULL;
+		break;
+	case BENCH_POAO:
+		out = proofName;
+		pargv[0] = prover; pargv[1] = "--seed"; pargv[2] = BENCH_SEED; pargv[3] = "1"; pargv[4] = "bench";
+		pargv[5] = POAO_PUBKEY; pargv[6] = "00"; pargv[7] = NULL;
+		vargv[0] = verifier; vargv[1] = "2"; vargv[2] = proofName; vargv[3] = NULL;
+		break;
+	}
+
+	benchResult* results[2] = { prove, verify };
+	char** argvs[2] = { pargv, vargv };
+	for (int role = 0; role < 2; role++) {
+		benchResult* r = results[role];
+		memset(r, 0, sizeof(benchResult));
+		snprintf(r->bench, sizeof(r->bench), "%s", t->name);
+		strcpy(r->role, role ? "verify" : "prove");
+		r->inputBytes = size;
+		r->rounds = rounds;
+		r->threads = threads;
+		r->reps = reps;
+		r->ok = ok;
+		for (int i = 0; (i < reps) && r->ok; i++) {
+			long rss = 0;
+			if (runChild(argvs[role], in, role ? NULL : out, threads, &ms[i], &rss) != 0)
+				r->ok = 0;
+			if (rss > r->peakRssKb)
+				r->peakRssKb = rss;
+		}
+		if (!t->proofName && !role && r->ok) {
+			if (proverOutput(proofName, &rounds) != 0)
+				r->ok = 0;
+			r->rounds = rounds;
+		}
+		if (stat(proofName, &st) == 0)
+			r->proofBytes = st.st_size;
+		if (r->ok)
+			hashFile(proofName, r->proofHash);
+		if (r->ok)
+			summarise(r, ms);
+		ok = r->ok;
+	}
+	return ok ? 0 : 1;
+}
+
+static void writeResult(FILE* f, const benchResult* r) {
+	fprintf(f, "{\"bench\":\"%s\",\"role\":\"%s\",\"input_bytes\":%d,\"rounds\":%d,\"threads\":%d,\"reps\":%d,\"ok\":%d,"
+		"\"median_ms\":%.3f,\"p99_ms\":%.3f,\"rounds_per_s\":%.1f,\"proof_bytes\":%ld,\"peak_rss_kb\":%ld,\"proof_sha256\":\"%s\"}\n",
+		r->bench, r->role, r->inputBytes, r->rounds, r->threads, r->reps, r->ok,
+		r->medianMs, r->p99Ms, r->roundsPerSec, r->proofBytes, r->peakRssKb, r->proofHash);
+}
+
+static int readResult(const char* line, benchResult* r) {
+	const char* hash = strstr(line, "\"proof_sha256\":\"");
+
+	memset(r, 0, sizeof(benchResult));
+	if (hash)
+		sscanf(hash + 16, "%64[0-9a-f]", r->proofHash);
+	return sscanf(line, "{\"bench\":\"%63[^\"]\",\"role\":\"%15[^\"]\",\"input_bytes\":%d,\"rounds\":%d,\"threads\":%d,\"reps\":%d,\"ok\":%d,"
+		"\"median_ms\":%lf,\"p99_ms\":%lf", r->bench, r->role, &r->inputBytes, &r->rounds, &r->threads, &r->reps, &r->ok,
+		&r->medianMs, &r->p99Ms) == 9;
+}
+
+/*
+ * Compares the medians and proofs of results against the baseline file,
+ * prints every regression and returns how many there are, or -1 when the file
+ * can't be read.
+ */
+static int compareBaseline(const char* baseline, const benchResult* results, int numResults, double tolerance) {
+	FILE* f = fopen(baseline, "r");
+	char line[1024];
+	benchResult b;
+	int regressions = 0;
+
+	if (!f) {
+		printf("Unable to open baseline %s\n", baseline);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		if (!readResult(line, &b) || !b.ok)
+			continue;
+		for (int i = 0; i < numResults; i++) {
+			const benchResult* r = &results[i];
+			if (strcmp(r->bench, b.bench) || strcmp(r->role, b.role) || (r->inputBytes != b.inputBytes) ||
+				(r->rounds != b.rounds) || (r->threads != b.threads) || !r->ok)
+				continue;
+			if (b.proofHash[0] && strcmp(r->proofHash, b.proofHash)) {
+				printf("Proof changed: %s %s %d bytes %d rounds %d threads\n", r->bench, r->role, r->inputBytes, r->rounds, r->threads);
+				regressions++;
+			}
+			double change = (r->medianMs - b.medianMs) * 100.0 / b.medianMs;
+			if (change > tolerance) {
+				printf("Regression: %s %s %d bytes %d rounds %d threads: %.1f ms against %.1f ms (%+.1f%%)\n",
+					r->bench, r->role, r->inputBytes, r->rounds, r->threads, r->medianMs, b.medianMs, change);
+				regressions++;
+			}
+		}
+	}
+	fclose(f);
+	return regressions;
+}
+
+// Removes the work directory with the messages, circuits and proofs in it
+static void removeWorkDir() {
+	DIR* dir = opendir(workDir);
+	struct dirent* ent;
+
+	while (dir && (ent = readdir(dir))) {
+		char path[PATH_MAX];
+		if (ent->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", workDir, ent->d_name);
+		unlink(path);
+	}
+	if (dir)
+		closedir(dir);
+	rmdir(workDir);
+}
+
+static void usage(const char* prog) {
+	printf("Usage: %s [options]\n", prog);
+	printf("  --root DIR         repository with the built binaries, default ..\n");
+	printf("  --out FILE         results, one JSON object per line, default bench.json\n");
+	printf("  --reps N           runs of each prover and verifier, default 5\n");
+	printf("  --sizes LIST       message sizes in bytes, default 3,55\n");
+	printf("  --rounds LIST      rounds of the binaries that take --rounds, default 32,136\n");
+	printf("  --threads LIST     OpenMP threads, default 1,4\n");
+	printf("  --only NAME        only this benchmark, e.g. MPC_SHA256\n");
+	printf("  --baseline FILE    earlier results to compare the medians and proofs against\n");
+	printf("  --tolerance PCT    slowdown allowed against the baseline, default 10\n");
+}
+
+int main(int argc, char* argv[]) {
+	const char* rootArg = "..";
+	const char* outFile = "bench.json";
+	const char* only = NULL;
+	const char* baseline = NULL;
+	double tolerance = 10;
+	int reps = 5;
+	int sizes[BENCH_MAX_LIST] = { 3, 55 };
+	int rounds[BENCH_MAX_LIST] = { 32, 136 };
+	int threads[BENCH_MAX_LIST] = { 1, 4 };
+	int numSizes = 2, numRounds = 2, numThreads = 2;
+	static benchResult results[BENCH_MAX_RESULTS];
+	int numResults = 0;
+	int failed = 0;
+
+	setbuf(stdout, NULL);
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (!val || (strncmp(arg, "--", 2) != 0)) {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+		if (strcmp(arg, "--root") == 0)
+			rootArg = val;
+		else if (strcmp(arg, "--out") == 0)
+			outFile = val;
+		else if (strcmp(arg, "--only") == 0)
+			only = val;
+		else if (strcmp(arg, "--baseline") == 0)
+			baseline = val;
+		else if (strcmp(arg, "--tolerance") == 0)
+			tolerance = atof(val);
+		else if (strcmp(arg, "--reps") == 0)
+			reps = atoi(val);
+		else if (strcmp(arg, "--sizes") == 0)
+			numSizes = parseList(val, sizes);
+		else if (strcmp(arg, "--rounds") == 0)
+			numRounds = parseList(val, rounds);
+		else if (strcmp(arg, "--threads") == 0)
+			numThreads = parseList(val, threads);
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if ((reps < 1) || (reps > BENCH_MAX_REPS) || (numSizes < 1) || (numRounds < 1) || (numThreads < 1)) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (crypto_init() != 0)
+		return 1;
+	if (!realpath(rootArg, root)) {
+		printf("Unable to find %s\n", rootArg);
+		return 1;
+	}
+	FILE* out = fopen(outFile, "w");
+	if (!out) {
+		printf("Unable to open %s\n", outFile);
+		return 1;
+	}
+	if (!getcwd(startDir, sizeof(startDir)) || !mkdtemp(workDir) || (chdir(workDir) != 0)) {
+		printf("Unable to create %s\n", workDir);
+		return 1;
+	}
+
+	printf("%-14s %-6s %5s %6s %7s %10s %10s %10s %10s\n", "bench", "role", "bytes", "rounds", "threads", "median ms", "p99 ms", "proof", "RSS KB");
+	for (int t = 0; t < NUM_TARGETS; t++) {
+		const benchTarget* bt = &targets[t];
+		if (only && strcmp(only, bt->name))
+			continue;
+		int ns = bt->maxInput ? numSizes : 1;
+		int nr = bt->rounds ? 1 : numRounds;
+		for (int s = 0; s < ns; s++) {
+			int size = bt->maxInput ? sizes[s] : 0;
+			if (size > bt->maxInput)
+				continue;
+			for (int r = 0; r < nr; r++) {
+				for (int th = 0; th < numThreads; th++) {
+					if (numResults + 2 > BENCH_MAX_RESULTS)
+						break;
+					benchResult* res = &results[numResults];
+					if (benchOne(bt, size, bt->rounds ? bt->rounds : rounds[r], threads[th], reps, &res[0], &res[1]) != 0) {
+						printf("%s failed, see %s/log.txt\n", bt->name, workDir);
+						keepWorkDir = failed = 1;
+					}
+					for (int k = 0; k < 2; k++) {
+						printf("%-14s %-6s %5d %6d %7d %10.1f %10.1f %10ld %10ld%s\n", res[k].bench, res[k].role, res[k].inputBytes,
+							res[k].rounds, res[k].threads, res[k].medianMs, res[k].p99Ms, res[k].proofBytes, res[k].peakRssKb,
+							res[k].ok ? "" : " FAILED");
+						writeResult(out, &res[k]);
+					}
+					numResults += 2;
+					if (keepWorkDir)
+						goto done;
+				}
+			}
+		}
+	}
+done:
+	fclose(out);
+	crypto_cleanup();
+	if (chdir(startDir) != 0)
+		return 1;
+	if (!keepWorkDir)
+		removeWorkDir();
+	if (baseline) {
+		int regressions = compareBaseline(baseline, results, numResults, tolerance);
+		if (regressions != 0)
+			failed = 1;
+		if (regressions == 0)
+			printf("No regressions against %s\n", baseline);
+	}
+	return failed;
+}
@@ -0,0 +1,84 @@
+/*
+ * Name: arena.h
+ * Author: Tan Teik Guan
+ * Description: Per proof memory arena shared by the ZKBoo provers
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * The provers keep keys, commitments, tapes and views for every round until
+ * the challenge is known. With NUM_ROUNDS in the hundreds these no longer fit
+ * on the stack, so each proof takes them from one arena instead:
+ *
+ *   arena ar;
+ *   arena_init(&ar, ARENA_BYTES(n1) + ARENA_BYTES(n2));
+ *   p1 = arena_alloc(&ar, n1);
+ *   p2 = arena_alloc(&ar, n2);
+ *   ...
+ *   arena_free(&ar);
+ *
+ * Every allocation starts on a cache line, so arrays indexed by round never
+ * share a line across arrays. Arenas of 2 MB and up are aligned to 2 MB and
+ * marked for transparent huge pages, which keeps TLB misses down when the
+ * threads walk the per round views.
+ *
+ * The memory is not cleared; callers fill everything they hand out.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGN 64
+#define ARENA_PAGE ((size_t)4096)
+#define ARENA_HUGEPAGE ((size_t)2 << 20)
+
+// Space one arena_alloc(n) takes up in the arena
+#define ARENA_BYTES(n) (((size_t)(n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct {
+	unsigned char* base;
+	size_t size;
+	size_t used;
+} arena;
+
+int arena_init(arena* ar, size_t size) {
+	size_t align = (size >= ARENA_HUGEPAGE) ? ARENA_HUGEPAGE : ARENA_PAGE;
+	void* p;
+
+	ar->base = NULL;
+	ar->size = ar->used = 0;
+	size = (size + align - 1) & ~(align - 1);
+	if ((size == 0) || (posix_memalign(&p, align, size) != 0))
+		return 1;
+#ifdef MADV_HUGEPAGE
+	if (align == ARENA_HUGEPAGE)
+		madvise(p, size, MADV_HUGEPAGE);
+#endif
+	ar->base = p;
+	ar->size = size;
+	return 0;
+}
+
+// Returns NULL when the arena was sized too small
+void* arena_alloc(arena* ar, size_t size) {
+	size_t n = ARENA_BYTES(size);
+	void* p;
+
+	if (n > ar->size - ar->used)
+		return NULL;
+	p = ar->base + ar->used;
+	ar->used += n;
+	return p;
+}
+
+void arena_free(arena* ar) {
+	free(ar->base);
+	ar->base = NULL;
+	ar->size = ar->used = 0;
+}
+
+#endif /* ARENA_H_ */
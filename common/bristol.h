@@ -0,0 +1,654 @@
+/*
+ * Name: bristol.h
+ * Author: Tan Teik Guan
+ * Description: Bristol Fashion circuit loader and its bitsliced ZKBoo evaluation
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * Loads a boolean circuit in Bristol Fashion, the format of the circuits at
+ * https://nigelsmart.github.io/MPC-Circuits/ (AES, SHA-256, SHA-512, Keccak
+ * and others):
+ *
+ *   numGates numWires
+ *   niv w1 ... wniv          input values and their widths in bits
+ *   nov w1 ... wnov          output values
+ *
+ *   2 1 a b out XOR
+ *   2 1 a b out AND
+ *   1 1 a out INV
+ *   1 1 a out EQW            copy of wire a
+ *   1 1 c out EQ             the constant c, 0 or 1
+ *   2k k a1..ak b1..bk o1..ok MAND
+ *
+ * The input values take wires 0, 1, ... in order and the output values are
+ * the last wires. Input and output bytes map to wires least significant bit
+ * first: wire j is bit j % 8 of byte j / 8.
+ *
+ *   bristolCircuit c;
+ *   if (bris_load(&c, "aes_128.txt") != 0) ...
+ *   bris_prove(&c, &lanes, w);               // up to 64 rounds, 3 parties
+ *   bad = bris_verify(&c, &lanes, w);        // up to 64 rounds, 2 parties
+ *   bris_free(&c);
+ *
+ * Loading compiles the gates into a layered program. Gates no output depends
+ * on are dropped. Each AND gets its AND depth, one more than the deepest AND
+ * below it, and the gates run layer by layer: the ANDs of depth d, then the
+ * XOR, INV and copy gates whose deepest AND has depth d, each in file order.
+ * The ANDs take the bits of the tapes and views in that order, 64 to a word:
+ * each run of 64 uses one 64-bit tape word per party, bit i for its i-th AND,
+ * and writes one 64-bit view word per party. A run may span layers, which
+ * keeps the views dense when layers are narrow, as in the adders of SHA-256.
+ * Wires are given slots, reused once a wire is dead, so the working set stays
+ * small whatever the size of the file.
+ *
+ * Evaluation is bitsliced over rounds, as in MPC_SHA512/slice512.h: a slot
+ * holds one 64-bit word per party, bit l for round (lane) l. XOR, INV and
+ * copy gates are one word operation for 64 rounds. A run's tape words are
+ * transposed so word i carries the random bits of its i-th AND in every
+ * lane, and the AND outputs are transposed back into each round's view
+ * word. Public constants and public inputs are set in every share, which is
+ * XOR with them once as there are three shares.
+ */
+
+#ifndef BRISTOL_H_
+#define BRISTOL_H_
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BRIS_LANES 64
+
+#define BRIS_XOR 0
+#define BRIS_INV 1
+#define BRIS_COPY 2
+#define BRIS_CONST 3	// a is the constant, 0 or 1
+#define BRIS_AND 4
+#define BRIS_TAPE 5	// loads tape word a for the ANDs that follow
+#define BRIS_VIEW 6	// stores view word a of the ANDs since the last BRIS_TAPE
+
+typedef struct {
+	int op, a, b, out;	// a, b and out are slots
+} brisOp;
+
+typedef struct {
+	int numWires;
+	int numInputs;		// input values
+	int numOutputs;		// output values
+	int* inputWidth;
+	int* outputWidth;
+	int inputWires;		// wires 0..inputWires-1, input wire j in slot j
+	int outputWires;	// the last outputWires wires
+	int numGates;		// gates evaluated, a MAND of k ANDs counting k
+	int numAnds;
+	int depth;		// AND depth
+	int numGroups;		// tape and view words per party, 64 ANDs each
+	int numSlots;
+	int numOps;
+	brisOp* ops;
+	int* outputSlot;
+} bristolCircuit;
+
+/*
+ * Up to BRIS_LANES rounds of one evaluation. The prover fills x, tape, y and
+ * out for parties 0, 1 and 2, the verifier x, tape, yv and out for parties e
+ * and e+1 of each round. Secret input wires come from x, the rest of the
+ * input wires from pub.
+ */
+typedef struct {
+	int lanes;
+	int secretWires;
+	const unsigned char* pub;
+	const unsigned char* x[BRIS_LANES][3];		// input shares
+	const unsigned char* tape[BRIS_LANES][3];	// 8 bytes per 64 ANDs
+	unsigned char* y[BRIS_LANES][3];		// prover: view words written
+	const unsigned char* yv[BRIS_LANES][2];		// verifier: view words read
+	unsigned char* out[BRIS_LANES][3];		// output shares
+} brisLanes;
+
+// Reads a whole file, NULL when it cannot be read. The buffer ends with a 0
+unsigned char* bris_readFile(const char* filename, long* len) {
+	FILE* f = fopen(filename, "rb");
+	unsigned char* buf = NULL;
+	long size = 0, cap = 0;
+	size_t n;
+
+	if (!f)
+		return NULL;
+	do {
+		if (size + 65536 + 1 > cap) {
+			unsigned char* more;
+			cap = 2 * cap + 65536 + 1;
+			more = realloc(buf, cap);
+			if (!more) {
+				free(buf);
+				fclose(f);
+				return NULL;
+			}
+			buf = more;
+		}
+		n = fread(buf + size, 1, 65536, f);
+		size += n;
+	} while (n > 0);
+	if (ferror(f)) {
+		free(buf);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	buf[size] = 0;
+	*len = size;
+	return buf;
+}
+
+typedef struct {
+	const char* p;
+	int line;
+} brisReader;
+
+// Next whitespace separated token, 1 when there is none or it is too long
+static int bris_token(brisReader* r, char* tok, int size) {
+	int n = 0;
+
+	while (isspace((unsigned char)*r->p)) {
+		if (*r->p == '\n')
+			r->line++;
+		r->p++;
+	}
+	while (*r->p && !isspace((unsigned char)*r->p)) {
+		if (n == size - 1)
+			return 1;
+		tok[n++] = *r->p++;
+	}
+	tok[n] = 0;
+	return n == 0;
+}
+
+static int bris_int(brisReader* r, int* v) {
+	char tok[16];
+	char* end;
+	long l;
+
+	if (bris_token(r, tok, sizeof(tok)) != 0)
+		return 1;
+	l = strtol(tok, &end, 10);
+	if ((*end != 0) || (l < 0) || (l > INT_MAX))
+		return 1;
+	*v = (int)l;
+	return 0;
+}
+
+// Reads a value count and the widths, 1 on a bad line
+static int bris_values(brisReader* r, int* count, int** width, int* wires) {
+	if ((bris_int(r, count) != 0) || (*count == 0))
+		return 1;
+	*width = malloc(*count * sizeof(int));
+	*wires = 0;
+	for (int i = 0; i < *count; i++) {
+		if ((bris_int(r, &(*width)[i]) != 0) || ((*width)[i] == 0) || ((*width)[i] > INT_MAX - *wires))
+			return 1;
+		*wires += (*width)[i];
+	}
+	return 0;
+}
+
+// BRIS_ op of a gate line, -1 when the type or the wire counts are not known
+static int bris_gateType(const char* type, int nin, int nout) {
+	if (strcmp(type, "MAND") == 0)
+		return (nin == 2 * nout) ? BRIS_AND : -1;
+	if ((strcmp(type, "XOR") == 0) && (nin == 2) && (nout == 1))
+		return BRIS_XOR;
+	if ((strcmp(type, "AND") == 0) && (nin == 2) && (nout == 1))
+		return BRIS_AND;
+	if ((nin != 1) || (nout != 1))
+		return -1;
+	if (strcmp(type, "INV") == 0)
+		return BRIS_INV;
+	if (strcmp(type, "EQW") == 0)
+		return BRIS_COPY;
+	if (strcmp(type, "EQ") == 0)
+		return BRIS_CONST;
+	return -1;
+}
+
+void bris_free(bristolCircuit* c) {
+	free(c->inputWidth);
+	free(c->outputWidth);
+	free(c->ops);
+	free(c->outputSlot);
+	memset(c, 0, sizeof(bristolCircuit));
+}
+
+/*
+ * Schedules and allocates the n gates parsed from the file: gate g is type
+ * gt[g] (a BRIS_ op) from wires ga[g] and gb[g] to wire go[g].
+ */
+static void bris_compile(bristolCircuit* c, int n, const int* gt, const int* ga, const int* gb, const int* go) {
+	int numWires = c->numWires;
+	char* live = calloc(numWires, 1);
+	char* keep = calloc(n ? n : 1, 1);
+	int* depth = calloc(numWires, sizeof(int));
+	int* lastUse = malloc(numWires * sizeof(int));
+	int* slot = malloc(numWires * sizeof(int));
+	int* freeSlots = malloc(numWires * sizeof(int));
+	int* order = malloc((n ? n : 1) * sizeof(int));
+	int* key = malloc((n ? n : 1) * sizeof(int));
+	int* start;
+	int numFree = 0, maxKey = 0, kept = 0, numAnds = 0;
+
+	for (int j = numWires - c->outputWires; j < numWires; j++)
+		live[j] = 1;
+	for (int g = n - 1; g >= 0; g--) {
+		if (!live[go[g]])
+			continue;
+		keep[g] = 1;
+		if (gt[g] != BRIS_CONST)
+			live[ga[g]] = 1;
+		if ((gt[g] == BRIS_XOR) || (gt[g] == BRIS_AND))
+			live[gb[g]] = 1;
+	}
+
+	// ANDs of depth d get key 2d - 1, the linear gates after them 2d
+	c->depth = 0;
+	for (int g = 0; g < n; g++) {
+		int d = 0;
+		if (!keep[g])
+			continue;
+		if (gt[g] != BRIS_CONST)
+			d = depth[ga[g]];
+		if (((gt[g] == BRIS_XOR) || (gt[g] == BRIS_AND)) && (depth[gb[g]] > d))
+			d = depth[gb[g]];
+		if (gt[g] == BRIS_AND)
+			d++;
+		depth[go[g]] = d;
+		if (d > c->depth)
+			c->depth = d;
+		key[g] = (gt[g] == BRIS_AND) ? 2 * d - 1 : 2 * d;
+		numAnds += (gt[g] == BRIS_AND);
+		if (key[g] > maxKey)
+			maxKey = key[g];
+		kept++;
+	}
+
+	// Stable counting sort of the kept gates by key
+	start = calloc(maxKey + 2, sizeof(int));
+	for (int g = 0; g < n; g++)
+		if (keep[g])
+			start[key[g] + 1]++;
+	for (int k = 0; k < maxKey; k++)
+		start[k + 1] += start[k];
+	for (int g = 0; g < n; g++)
+		if (keep[g])
+			order[start[key[g]]++] = g;
+
+	for (int j = 0; j < numWires; j++)
+		lastUse[j] = -1;
+	for (int i = 0; i < kept; i++) {
+		int g = order[i];
+		if (gt[g] != BRIS_CONST)
+			lastUse[ga[g]] = i;
+		if ((gt[g] == BRIS_XOR) || (gt[g] == BRIS_AND))
+			lastUse[gb[g]] = i;
+	}
+	for (int j = numWires - c->outputWires; j < numWires; j++)
+		lastUse[j] = INT_MAX;
+
+	c->numSlots = c->inputWires;
+	for (int j = 0; j < c->inputWires; j++) {
+		slot[j] = j;
+		if (lastUse[j] < 0)
+			freeSlots[numFree++] = j;
+	}
+
+	c->numAnds = 0;
+	c->numGroups = 0;
+	c->ops = malloc((2 * kept + 2) * sizeof(brisOp));
+	c->numOps = 0;
+	for (int i = 0; i < kept; i++) {
+		int g = order[i];
+		brisOp* op;
+
+		if ((gt[g] == BRIS_AND) && (c->numAnds % BRIS_LANES == 0)) {
+			op = &c->ops[c->numOps++];
+			memset(op, 0, sizeof(brisOp));
+			op->op = BRIS_TAPE;
+			op->a = c->numGroups++;
+		}
+		op = &c->ops[c->numOps++];
+		op->op = gt[g];
+		op->a = (gt[g] == BRIS_CONST) ? ga[g] : slot[ga[g]];
+		op->b = ((gt[g] == BRIS_XOR) || (gt[g] == BRIS_AND)) ? slot[gb[g]] : op->a;
+		if ((gt[g] != BRIS_CONST) && (lastUse[ga[g]] == i))
+			freeSlots[numFree++] = slot[ga[g]];
+		if (((gt[g] == BRIS_XOR) || (gt[g] == BRIS_AND)) && (gb[g] != ga[g]) && (lastUse[gb[g]] == i))
+			freeSlots[numFree++] = slot[gb[g]];
+		slot[go[g]] = numFree ? freeSlots[--numFree] : c->numSlots++;
+		op->out = slot[go[g]];
+
+		if ((gt[g] == BRIS_AND) && ((++c->numAnds % BRIS_LANES == 0) || (c->numAnds == numAnds))) {
+			op = &c->ops[c->numOps++];
+			memset(op, 0, sizeof(brisOp));
+			op->op = BRIS_VIEW;
+			op->a = c->numGroups - 1;
+		}
+	}
+	c->numGates = kept;
+
+	c->outputSlot = malloc(c->outputWires * sizeof(int));
+	for (int j = 0; j < c->outputWires; j++)
+		c->outputSlot[j] = slot[numWires - c->outputWires + j];
+
+	free(live);
+	free(keep);
+	free(depth);
+	free(lastUse);
+	free(slot);
+	free(freeSlots);
+	free(order);
+	free(key);
+	free(start);
+}
+
+/*
+ * Loads and compiles a Bristol Fashion file. Returns 0 on success, otherwise
+ * prints what is wrong and returns 1.
+ */
+int bris_load(bristolCircuit* c, const char* filename) {
+	brisReader r;
+	long len;
+	unsigned char* text = bris_readFile(filename, &len);
+	int numGates, n = 0, cap = 0, nin, nout, bad = 0;
+	int *gt = NULL, *ga = NULL, *gb = NULL, *go = NULL, *wires = NULL;
+	char* defined = NULL;
+	char type[8];
+
+	memset(c, 0, sizeof(bristolCircuit));
+	if (!text) {
+		printf("Unable to read circuit %s\n", filename);
+		return 1;
+	}
+	r.p = (const char*)text;
+	r.line = 1;
+	if ((bris_int(&r, &numGates) != 0) || (bris_int(&r, &c->numWires) != 0) || (c->numWires == 0) ||
+		(bris_values(&r, &c->numInputs, &c->inputWidth, &c->inputWires) != 0) ||
+		(bris_values(&r, &c->numOutputs, &c->outputWidth, &c->outputWires) != 0) ||
+		(c->inputWires > c->numWires) || (c->outputWires > c->numWires)) {
+		printf("%s: bad header at line %d\n", filename, r.line);
+		free(text);
+		bris_free(c);
+		return 1;
+	}
+	defined = calloc(c->numWires, 1);
+	memset(defined, 1, c->inputWires);
+
+	for (int i = 0; (i < numGates) && !bad; i++) {
+		if ((bris_int(&r, &nin) != 0) || (bris_int(&r, &nout) != 0) || (nin == 0) || (nout == 0) ||
+			(nin > c->numWires) || (nout > c->numWires)) {
+			bad = 1;
+			break;
+		}
+		wires = realloc(wires, (nin + nout) * sizeof(int));
+		for (int j = 0; (j < nin + nout) && !bad; j++)
+			bad = (bris_int(&r, &wires[j]) != 0);
+		if (bad || (bris_token(&r, type, sizeof(type)) != 0)) {
+			bad = 1;
+			break;
+		}
+
+		int k = nout;
+		int op = bris_gateType(type, nin, nout);
+		if ((op < 0) || ((op == BRIS_CONST) && (wires[0] > 1))) {
+			bad = 1;
+			break;
+		}
+
+		if (n + k > cap) {
+			cap = 2 * cap + k + 1024;
+			gt = realloc(gt, cap * sizeof(int));
+			ga = realloc(ga, cap * sizeof(int));
+			gb = realloc(gb, cap * sizeof(int));
+			go = realloc(go, cap * sizeof(int));
+		}
+		for (int j = 0; j < k; j++) {
+			int a = wires[j];
+			int b = (nin == 2 * k) ? wires[k + j] : a;
+			int out = wires[nin + j];
+
+			if ((op != BRIS_CONST) && ((a >= c->numWires) || !defined[a] || (b >= c->numWires) || !defined[b]))
+				bad = 1;
+			if ((out >= c->numWires) || defined[out])
+				bad = 1;
+			if (bad)
+				break;
+			defined[out] = 1;
+			gt[n] = op;
+			ga[n] = a;
+			gb[n] = b;
+			go[n] = out;
+			n++;
+		}
+	}
+	if (bad) {
+		printf("%s: bad gate at line %d\n", filename, r.line);
+	}
+	else {
+		for (int j = c->numWires - c->outputWires; j < c->numWires; j++)
+			if (!defined[j]) {
+				printf("%s: output wire %d is never set\n", filename, j);
+				bad = 1;
+				break;
+			}
+	}
+	if (!bad)
+		bris_compile(c, n, gt, ga, gb, go);
+
+	free(text);
+	free(defined);
+	free(wires);
+	free(gt);
+	free(ga);
+	free(gb);
+	free(go);
+	if (bad) {
+		bris_free(c);
+		return 1;
+	}
+	return 0;
+}
+
+static inline void bris_swapStage(uint64_t a[64], int j, uint64_t m) {
+	for (int base = 0; base < 64; base += 2 * j) {
+		for (int k = base; k < base + j; k++) {
+			uint64_t t = ((a[k] >> j) ^ a[k + j]) & m;
+			a[k] ^= t << j;
+			a[k + j] ^= t;
+		}
+	}
+}
+
+// In place 64x64 bit transpose: bit j of a[i] <-> bit i of a[j]
+void bris_transpose(uint64_t a[64]) {
+	bris_swapStage(a, 32, 0x00000000FFFFFFFF);
+	bris_swapStage(a, 16, 0x0000FFFF0000FFFF);
+	bris_swapStage(a, 8, 0x00FF00FF00FF00FF);
+	bris_swapStage(a, 4, 0x0F0F0F0F0F0F0F0F);
+	bris_swapStage(a, 2, 0x3333333333333333);
+	bris_swapStage(a, 1, 0x5555555555555555);
+}
+
+// Input wires of every lane for n parties, into slots 0..inputWires-1
+static void bris_loadInputs(const bristolCircuit* c, const brisLanes* bl, int n, uint64_t* w) {
+	int inBytes = (bl->secretWires + 7) / 8;
+	uint64_t t[64];
+
+	for (int q = 0; q < bl->secretWires; q += 64) {
+		int len = (inBytes - q / 8 < 8) ? inBytes - q / 8 : 8;
+		for (int p = 0; p < n; p++) {
+			memset(t, 0, sizeof(t));
+			for (int l = 0; l < bl->lanes; l++)
+				memcpy(&t[l], bl->x[l][p] + q / 8, len);
+			bris_transpose(t);
+			for (int i = 0; (i < 64) && (q + i < bl->secretWires); i++)
+				w[(q + i) * n + p] = t[i];
+		}
+	}
+	for (int j = bl->secretWires; j < c->inputWires; j++) {
+		int k = j - bl->secretWires;
+		uint64_t v = ((bl->pub[k / 8] >> (k % 8)) & 1) ? ~(uint64_t)0 : 0;
+		for (int p = 0; p < n; p++)
+			w[j * n + p] = v;
+	}
+}
+
+// Output shares of every lane for n parties
+static void bris_storeOutputs(const bristolCircuit* c, const brisLanes* bl, int n, const uint64_t* w) {
+	int outBytes = (c->outputWires + 7) / 8;
+	uint64_t t[64];
+
+	for (int q = 0; q < c->outputWires; q += 64) {
+		int len = (outBytes - q / 8 < 8) ? outBytes - q / 8 : 8;
+		for (int p = 0; p < n; p++) {
+			for (int i = 0; i < 64; i++)
+				t[i] = (q + i < c->outputWires) ? w[c->outputSlot[q + i] * n + p] : 0;
+			bris_transpose(t);
+			for (int l = 0; l < bl->lanes; l++)
+				memcpy(bl->out[l][p] + q / 8, &t[l], len);
+		}
+	}
+}
+
+static inline void bris_linear(const brisOp* op, uint64_t* w, int n) {
+	uint64_t* z = &w[op->out * n];
+	const uint64_t* x = &w[op->a * n];
+	const uint64_t* y = &w[op->b * n];
+
+	switch (op->op) {
+	case BRIS_XOR:
+		for (int p = 0; p < n; p++)
+			z[p] = x[p] ^ y[p];
+		break;
+	case BRIS_INV:
+		for (int p = 0; p < n; p++)
+			z[p] = ~x[p];
+		break;
+	case BRIS_COPY:
+		for (int p = 0; p < n; p++)
+			z[p] = x[p];
+		break;
+	case BRIS_CONST:
+		for (int p = 0; p < n; p++)
+			z[p] = op->a ? ~(uint64_t)0 : 0;
+		break;
+	}
+}
+
+// Word g of every lane's tape or view of party p, transposed
+static void bris_loadWords(int lanes, const unsigned char* const src[][3], int p, int g, uint64_t t[64]) {
+	memset(t, 0, 64 * sizeof(uint64_t));
+	for (int l = 0; l < lanes; l++)
+		memcpy(&t[l], src[l][p] + 8 * g, 8);
+	bris_transpose(t);
+}
+
+/*
+ * Runs the circuit for bl->lanes rounds and three parties, writing each
+ * round's view words and output shares. w holds 3 * numSlots words.
+ */
+void bris_prove(const bristolCircuit* c, const brisLanes* bl, uint64_t* w) {
+	uint64_t r[3][64], z[3][64];
+	int i = 0;
+
+	bris_loadInputs(c, bl, 3, w);
+	for (int k = 0; k < c->numOps; k++) {
+		const brisOp* op = &c->ops[k];
+
+		switch (op->op) {
+		case BRIS_TAPE:
+			for (int p = 0; p < 3; p++)
+				bris_loadWords(bl->lanes, bl->tape, p, op->a, r[p]);
+			i = 0;
+			break;
+		case BRIS_AND: {
+			const uint64_t* x = &w[op->a * 3];
+			const uint64_t* y = &w[op->b * 3];
+			uint64_t* out = &w[op->out * 3];
+
+			z[0][i] = (x[0] & (y[0] ^ y[1])) ^ (x[1] & y[0]) ^ r[0][i] ^ r[1][i];
+			z[1][i] = (x[1] & (y[1] ^ y[2])) ^ (x[2] & y[1]) ^ r[1][i] ^ r[2][i];
+			z[2][i] = (x[2] & (y[2] ^ y[0])) ^ (x[0] & y[2]) ^ r[2][i] ^ r[0][i];
+			out[0] = z[0][i];
+			out[1] = z[1][i];
+			out[2] = z[2][i];
+			i++;
+			break;
+		}
+		case BRIS_VIEW:
+			for (int p = 0; p < 3; p++) {
+				memset(&z[p][i], 0, (64 - i) * sizeof(uint64_t));
+				bris_transpose(z[p]);
+				for (int l = 0; l < bl->lanes; l++)
+					memcpy(bl->y[l][p] + 8 * op->a, &z[p][l], 8);
+			}
+			break;
+		default:
+			bris_linear(op, w, 3);
+		}
+	}
+	bris_storeOutputs(c, bl, 3, w);
+}
+
+/*
+ * Reruns the circuit for parties e and e+1 of bl->lanes rounds and writes
+ * their output shares. Returns the lanes whose view of party e does not
+ * follow from the two views, 0 when all of them do. w holds 2 * numSlots
+ * words.
+ */
+uint64_t bris_verify(const bristolCircuit* c, const brisLanes* bl, uint64_t* w) {
+	uint64_t r[2][64], v[2][64];
+	uint64_t bad = 0;
+	int i = 0;
+
+	bris_loadInputs(c, bl, 2, w);
+	for (int k = 0; k < c->numOps; k++) {
+		const brisOp* op = &c->ops[k];
+
+		switch (op->op) {
+		case BRIS_TAPE:
+			for (int p = 0; p < 2; p++) {
+				bris_loadWords(bl->lanes, bl->tape, p, op->a, r[p]);
+				memset(v[p], 0, sizeof(v[p]));
+				for (int l = 0; l < bl->lanes; l++)
+					memcpy(&v[p][l], bl->yv[l][p] + 8 * op->a, 8);
+				bris_transpose(v[p]);
+			}
+			i = 0;
+			break;
+		case BRIS_AND: {
+			const uint64_t* x = &w[op->a * 2];
+			const uint64_t* y = &w[op->b * 2];
+			uint64_t* out = &w[op->out * 2];
+
+			// party e recomputed from both views, party e+1 as its view says
+			bad |= (x[0] & (y[0] ^ y[1])) ^ (x[1] & y[0]) ^ r[0][i] ^ r[1][i] ^ v[0][i];
+			out[0] = v[0][i];
+			out[1] = v[1][i];
+			i++;
+			break;
+		}
+		case BRIS_VIEW:
+			break;
+		default:
+			bris_linear(op, w, 2);
+		}
+	}
+	bris_storeOutputs(c, bl, 2, w);
+	if (bl->lanes < BRIS_LANES)
+		bad &= ((uint64_t)1 << bl->lanes) - 1;
+	return bad;
+}
+
+#endif /* BRISTOL_H_ */
@@ -0,0 +1,375 @@
+/*
+ * Name: circuit.h
+ * Author: Tan Teik Guan
+ * Description: Gate list circuits and the ZKBoo interpreters that run them
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * A hash is described once, as a list of gates over words of CIRC_WIDTH
+ * bits, and the same list is run by the prover for all three parties and by
+ * the verifier for the two opened ones:
+ *
+ *   circuit c;
+ *   circ_init(&c, 16);                // wires 0..15 are the input words
+ *   t = circ_rotr(&c, 0, 7);          // every gate makes a new wire
+ *   t = circ_add(&c, t, 1);
+ *   circ_output(&c, t);
+ *   ...
+ *   circ_prove(&c, w, randomness, &randCount, y, &countY);
+ *   if (circ_verify(&c, w, randomness, &randCount, ye, ye1, &countY)) ...
+ *   circ_free(&c);
+ *
+ * Gates:
+ *
+ *   XOR, XORK  share wise, XORK applies a public constant to every share,
+ *              which is XOR with it once as there are three shares. NOT is
+ *              XORK with all ones
+ *   ROTR, ROTL, SHR, SHL  share wise by k bits
+ *   CONST      the public constant k in every share
+ *   AND        one tape word per party, one view word
+ *   ADD, ADDK  one tape word per party, one view word holding the carries.
+ *              ADDK adds a public constant
+ *
+ * The AND, ADD and ADDK gates take their tape words and write their view
+ * words in gate order, exactly as the hand written gadgets they replace did,
+ * so proofs do not change. A tape word is the next CIRC_WIDTH / 8 bytes of
+ * the party's randomness at *randCount.
+ *
+ * The ADD carries of all three parties are derived together, one whole word
+ * step per bit, and the verifier checks every carry bit of party e at once.
+ *
+ * Define CIRC_WIDTH as 32 or 64 before including this file, the default is
+ * 32.
+ */
+
+#ifndef CIRCUIT_H_
+#define CIRCUIT_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef CIRC_WIDTH
+#define CIRC_WIDTH 32
+#endif
+
+#if CIRC_WIDTH == 32
+typedef uint32_t circWord;
+#elif CIRC_WIDTH == 64
+typedef uint64_t circWord;
+#else
+#error CIRC_WIDTH must be 32 or 64
+#endif
+
+#define CIRC_XOR 0
+#define CIRC_XORK 1
+#define CIRC_AND 2
+#define CIRC_ADD 3
+#define CIRC_ADDK 4
+#define CIRC_ROTR 5
+#define CIRC_ROTL 6
+#define CIRC_SHR 7
+#define CIRC_SHL 8
+#define CIRC_CONST 9
+
+#define CIRC_MAX_OUTPUTS 16
+
+typedef struct {
+	int op;
+	int a;
+	int b;
+	int out;
+	circWord k;	// constant, or number of bits to rotate or shift by
+} circGate;
+
+typedef struct {
+	int numInputs;	// wires 0 .. numInputs-1
+	int numWires;
+	int numGates;
+	int maxGates;
+	circGate* gates;
+	int numOutputs;
+	int outputs[CIRC_MAX_OUTPUTS];
+	int numY;	// view words written, one per AND, ADD and ADDK
+} circuit;
+
+#define CIRC_ROTR_WORD(x, n) (((x) >> (n)) | ((x) << (CIRC_WIDTH - (n))))
+#define CIRC_ROTL_WORD(x, n) (((x) << (n)) | ((x) >> (CIRC_WIDTH - (n))))
+
+void circ_init(circuit* c, int numInputs) {
+	memset(c, 0, sizeof(circuit));
+	c->numInputs = numInputs;
+	c->numWires = numInputs;
+}
+
+void circ_free(circuit* c) {
+	free(c->gates);
+	memset(c, 0, sizeof(circuit));
+}
+
+// Appends a gate and returns its output wire
+int circ_gate(circuit* c, int op, int a, int b, circWord k) {
+	circGate* g;
+
+	if (c->numGates == c->maxGates) {
+		int max = c->maxGates ? 2 * c->maxGates : 1024;
+		circGate* gates = realloc(c->gates, max * sizeof(circGate));
+		if (!gates) {
+			printf("Unable to allocate %d gates\n", max);
+			exit(EXIT_FAILURE);
+		}
+		c->gates = gates;
+		c->maxGates = max;
+	}
+	g = &c->gates[c->numGates++];
+	g->op = op;
+	g->a = a;
+	g->b = b;
+	g->out = c->numWires++;
+	g->k = k;
+	if ((op == CIRC_AND) || (op == CIRC_ADD) || (op == CIRC_ADDK))
+		c->numY++;
+	return g->out;
+}
+
+int circ_xor(circuit* c, int a, int b) {
+	return circ_gate(c, CIRC_XOR, a, b, 0);
+}
+
+int circ_xork(circuit* c, int a, circWord k) {
+	return circ_gate(c, CIRC_XORK, a, a, k);
+}
+
+int circ_not(circuit* c, int a) {
+	return circ_gate(c, CIRC_XORK, a, a, ~(circWord)0);
+}
+
+int circ_and(circuit* c, int a, int b) {
+	return circ_gate(c, CIRC_AND, a, b, 0);
+}
+
+// ~(~a & ~b), one AND gate
+int circ_or(circuit* c, int a, int b) {
+	int na = circ_not(c, a);
+	int nb = circ_not(c, b);
+
+	return circ_not(c, circ_and(c, na, nb));
+}
+
+int circ_add(circuit* c, int a, int b) {
+	return circ_gate(c, CIRC_ADD, a, b, 0);
+}
+
+int circ_addk(circuit* c, int a, circWord k) {
+	return circ_gate(c, CIRC_ADDK, a, a, k);
+}
+
+int circ_rotr(circuit* c, int a, int n) {
+	return circ_gate(c, CIRC_ROTR, a, a, n);
+}
+
+int circ_rotl(circuit* c, int a, int n) {
+	return circ_gate(c, CIRC_ROTL, a, a, n);
+}
+
+int circ_shr(circuit* c, int a, int n) {
+	return circ_gate(c, CIRC_SHR, a, a, n);
+}
+
+int circ_shl(circuit* c, int a, int n) {
+	return circ_gate(c, CIRC_SHL, a, a, n);
+}
+
+int circ_const(circuit* c, circWord k) {
+	return circ_gate(c, CIRC_CONST, 0, 0, k);
+}
+
+void circ_output(circuit* c, int wire) {
+	if (c->numOutputs == CIRC_MAX_OUTPUTS) {
+		printf("More than %d circuit outputs\n", CIRC_MAX_OUTPUTS);
+		exit(EXIT_FAILURE);
+	}
+	c->outputs[c->numOutputs++] = wire;
+}
+
+static inline circWord circ_tapeWord(const unsigned char* randomness, int randCount) {
+	circWord r;
+
+	memcpy(&r, &randomness[randCount], sizeof(circWord));
+	return r;
+}
+
+// Carry words of x + y for the three parties, the word form of the GETBIT/SETBIT loop
+static inline void circ_carries(const circWord x[3], const circWord y[3], const circWord r[3], circWord c[3]) {
+	circWord c0 = 0, c1 = 0, c2 = 0;
+	const circWord r0 = r[0] ^ r[1], r1 = r[1] ^ r[2], r2 = r[2] ^ r[0];
+
+	for (int i = 0; i < CIRC_WIDTH - 1; i++) {
+		circWord a0 = x[0] ^ c0, a1 = x[1] ^ c1, a2 = x[2] ^ c2;
+		circWord b0 = y[0] ^ c0, b1 = y[1] ^ c1, b2 = y[2] ^ c2;
+		circWord m = (circWord)1 << i;
+
+		c0 |= (((a0 & (b0 ^ b1)) ^ (a1 & b0) ^ c0 ^ r0) & m) << 1;
+		c1 |= (((a1 & (b1 ^ b2)) ^ (a2 & b1) ^ c1 ^ r1) & m) << 1;
+		c2 |= (((a2 & (b2 ^ b0)) ^ (a0 & b2) ^ c2 ^ r2) & m) << 1;
+	}
+	c[0] = c0;
+	c[1] = c1;
+	c[2] = c2;
+}
+
+/*
+ * Runs c for the three parties. w has 3 words per wire, w[3 * i + j] being
+ * party j's share of wire i, and the caller fills in the input wires. y[j] is
+ * party j's view, written from *countY on, and randomness[j] its tape, read
+ * from *randCount on.
+ */
+void circ_prove(const circuit* c, circWord* w, unsigned char* randomness[3], int* randCount, circWord* y[3], int* countY) {
+	for (int i = 0; i < c->numGates; i++) {
+		const circGate* g = &c->gates[i];
+		const circWord* x = &w[3 * g->a];
+		const circWord* v = &w[3 * g->b];
+		circWord* z = &w[3 * g->out];
+		circWord r[3], k[3], t[3];
+
+		switch (g->op) {
+		case CIRC_XOR:
+			for (int j = 0; j < 3; j++)
+				z[j] = x[j] ^ v[j];
+			break;
+		case CIRC_XORK:
+			for (int j = 0; j < 3; j++)
+				z[j] = x[j] ^ g->k;
+			break;
+		case CIRC_ROTR:
+			for (int j = 0; j < 3; j++)
+				z[j] = CIRC_ROTR_WORD(x[j], g->k);
+			break;
+		case CIRC_ROTL:
+			for (int j = 0; j < 3; j++)
+				z[j] = CIRC_ROTL_WORD(x[j], g->k);
+			break;
+		case CIRC_SHR:
+			for (int j = 0; j < 3; j++)
+				z[j] = x[j] >> g->k;
+			break;
+		case CIRC_SHL:
+			for (int j = 0; j < 3; j++)
+				z[j] = x[j] << g->k;
+			break;
+		case CIRC_CONST:
+			z[0] = z[1] = z[2] = g->k;
+			break;
+		case CIRC_AND:
+			for (int j = 0; j < 3; j++)
+				r[j] = circ_tapeWord(randomness[j], *randCount);
+			*randCount += sizeof(circWord);
+			t[0] = (x[0] & (v[0] ^ v[1])) ^ (x[1] & v[0]) ^ r[0] ^ r[1];
+			t[1] = (x[1] & (v[1] ^ v[2])) ^ (x[2] & v[1]) ^ r[1] ^ r[2];
+			t[2] = (x[2] & (v[2] ^ v[0])) ^ (x[0] & v[2]) ^ r[2] ^ r[0];
+			for (int j = 0; j < 3; j++)
+				z[j] = y[j][*countY] = t[j];
+			(*countY)++;
+			break;
+		case CIRC_ADDK:
+			k[0] = k[1] = k[2] = g->k;
+			v = k;
+			// fall through
+		case CIRC_ADD:
+			for (int j = 0; j < 3; j++)
+				r[j] = circ_tapeWord(randomness[j], *randCount);
+			*randCount += sizeof(circWord);
+			circ_carries(x, v, r, t);
+			for (int j = 0; j < 3; j++) {
+				z[j] = x[j] ^ v[j] ^ t[j];
+				y[j][*countY] = t[j];
+			}
+			(*countY)++;
+			break;
+		}
+	}
+}
+
+/*
+ * Runs c for parties e and e+1 of an opened round. w has 2 words per wire,
+ * party e's share first, with the input wires filled in by the caller. ye and
+ * ye1 are the two views, randomness[0] and [1] the two tapes. Party e's AND
+ * and ADD outputs are recomputed and checked against ye, party e+1's are
+ * taken from ye1. Returns 1 at the first gate that does not match.
+ */
+int circ_verify(const circuit* c, circWord* w, const unsigned char* randomness[2], int* randCount, const circWord* ye, const circWord* ye1, int* countY) {
+	for (int i = 0; i < c->numGates; i++) {
+		const circGate* g = &c->gates[i];
+		const circWord* x = &w[2 * g->a];
+		const circWord* v = &w[2 * g->b];
+		circWord* z = &w[2 * g->out];
+		circWord r0, r1, k[2], t;
+
+		switch (g->op) {
+		case CIRC_XOR:
+			z[0] = x[0] ^ v[0];
+			z[1] = x[1] ^ v[1];
+			break;
+		case CIRC_XORK:
+			z[0] = x[0] ^ g->k;
+			z[1] = x[1] ^ g->k;
+			break;
+		case CIRC_ROTR:
+			z[0] = CIRC_ROTR_WORD(x[0], g->k);
+			z[1] = CIRC_ROTR_WORD(x[1], g->k);
+			break;
+		case CIRC_ROTL:
+			z[0] = CIRC_ROTL_WORD(x[0], g->k);
+			z[1] = CIRC_ROTL_WORD(x[1], g->k);
+			break;
+		case CIRC_SHR:
+			z[0] = x[0] >> g->k;
+			z[1] = x[1] >> g->k;
+			break;
+		case CIRC_SHL:
+			z[0] = x[0] << g->k;
+			z[1] = x[1] << g->k;
+			break;
+		case CIRC_CONST:
+			z[0] = z[1] = g->k;
+			break;
+		case CIRC_AND:
+			r0 = circ_tapeWord(randomness[0], *randCount);
+			r1 = circ_tapeWord(randomness[1], *randCount);
+			*randCount += sizeof(circWord);
+			t = (x[0] & (v[0] ^ v[1])) ^ (x[1] & v[0]) ^ r0 ^ r1;
+			if (ye[*countY] != t)
+				return 1;
+			z[0] = t;
+			z[1] = ye1[*countY];
+			(*countY)++;
+			break;
+		case CIRC_ADDK:
+			k[0] = k[1] = g->k;
+			v = k;
+			// fall through
+		case CIRC_ADD: {
+			circWord c0 = ye[*countY], c1 = ye1[*countY];
+			circWord a0 = x[0] ^ c0, a1 = x[1] ^ c1;
+			circWord b0 = v[0] ^ c0, b1 = v[1] ^ c1;
+
+			r0 = circ_tapeWord(randomness[0], *randCount);
+			r1 = circ_tapeWord(randomness[1], *randCount);
+			*randCount += sizeof(circWord);
+			// carry bit i+1 of party e from bit i, bit 0 is not checked
+			t = (a0 & (b0 ^ b1)) ^ (a1 & b0) ^ c0 ^ r0 ^ r1;
+			if (((t << 1) ^ c0) & ~(circWord)1)
+				return 1;
+			z[0] = x[0] ^ v[0] ^ c0;
+			z[1] = x[1] ^ v[1] ^ c1;
+			(*countY)++;
+			break;
+		}
+		}
+	}
+	return 0;
+}
+
+#endif /* CIRCUIT_H_ */
@@ -0,0 +1,377 @@
+/*
+ * Name: cli.h
+ * Author: Tan Teik Guan
+ * Description: Command line options shared by the ZKBoo provers and verifiers
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * Every prover and verifier takes the same options:
+ *
+ *   --rounds N         number of ZKBoo rounds (default set in each binary)
+ *   --input-file FILE  prover: message to hash, verifier: proof to check
+ *   --hex              message lines and --input-file are hex encoded (prover)
+ *   --out FILE         prover: proof file, default out<rounds>.bin
+ *   --threads N        OpenMP threads
+ *   --batch            read one input per line from stdin and write one
+ *                      result per line
+ *   --compact          prover: write a ZKB++ proof (SHA-512 only)
+ *   --prefix FILE      public prefix of the message, a multiple of 128 bytes
+ *                      hashed in the clear (SHA-512 only). The prover proves
+ *                      SHA-512(prefix || message), the verifier checks that
+ *                      the proof is for this prefix
+ *   --hash NAME        sha512, sha384 or sha512-256 (SHA-512 only), default
+ *                      sha512. Prover and verifier must use the same one
+ *   --hmac FILE        prove HMAC-SHA512 keyed with the input over the public
+ *                      message in FILE (SHA-512 only)
+ *   --pbkdf2 N         with --hmac, prove PBKDF2-HMAC-SHA512 of the input
+ *                      with FILE as the salt, N iterations and a 64 byte key
+ *   --stats FORMAT     write per phase timings and counters to stderr as
+ *                      json or csv (common/stats.h), default ZKBOO_STATS
+ *   --seed STRING      prover: draw all randomness from a DRBG seeded with
+ *                      STRING (common/seed.h), so the same input gives the
+ *                      same proof. Never for real proofs, the seed gives the
+ *                      input away
+ *   --circuit FILE     Bristol Fashion circuit to prove (MPC_BRISTOL only)
+ *   --public FILE      bytes of the last input values of the circuit, which
+ *                      are public (MPC_BRISTOL only)
+ *
+ * A single argument without an option is taken as --input-file.
+ *
+ * In batch mode a prover reads one message per line and writes the hex
+ * encoded proof of each line as one line, to --out or to stdout. A verifier
+ * reads one hex encoded proof per line and writes "Verified ok" or
+ * "Not Verified" for each. Everything else the binaries print goes to stderr
+ * so stdout carries only the results. An input that cannot be read gives an
+ * empty line, and the process exits with 1.
+ */
+
+#ifndef CLI_H_
+#define CLI_H_
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#define CLI_PROVER 0
+#define CLI_VERIFIER 1
+// or'ed into the mode by provers that can write ZKB++ proofs
+#define CLI_COMPACT 2
+// or'ed into the mode by binaries that take a public prefix
+#define CLI_PREFIX 4
+// or'ed into the mode by binaries that prove one of several hash variants
+#define CLI_HASH 8
+// or'ed into the mode by binaries that prove HMAC and PBKDF2
+#define CLI_HMAC 16
+// or'ed into the mode by binaries that prove a circuit read from a file
+#define CLI_CIRCUIT 32
+
+typedef struct {
+	int rounds;
+	int threads;
+	int hex;
+	int batch;
+	int compact;
+	const char* stats;
+	const char* seed;
+	const char* prefix;
+	const char* hash;
+	const char* hmac;
+	long pbkdf2;
+	const char* circuit;
+	const char* publicInput;
+	const char* inputFile;
+	const char* out;
+} cliOptions;
+
+void cli_usage(const char* prog, int mode) {
+	int verifier = mode & CLI_VERIFIER;
+
+	printf("Usage: %s [options] [%s]\n", prog, verifier ? "proof file" : "input file");
+	printf("  --rounds N         number of rounds\n");
+	printf("  --input-file FILE  %s\n", verifier ? "proof to verify, default out<rounds>.bin" : "message to hash, default is to prompt for it");
+	if (!verifier) {
+		printf("  --hex              message is hex encoded\n");
+		printf("  --out FILE         proof file, default out<rounds>.bin\n");
+	}
+	printf("  --threads N        number of OpenMP threads\n");
+	printf("  --batch            %s\n", verifier ? "verify one hex encoded proof per stdin line" : "prove one message per stdin line, one hex encoded proof per line out");
+	if (mode & CLI_COMPACT)
+		printf("  --compact          write a ZKB++ proof, about half the size\n");
+	if (mode & CLI_PREFIX)
+		printf("  --prefix FILE      public prefix of the message, %s\n", verifier ? "the proof must be for it" : "a multiple of 128 bytes, hashed in the clear");
+	if (mode & CLI_HASH)
+		printf("  --hash NAME        sha512, sha384 or sha512-256, default sha512\n");
+	if (mode & CLI_HMAC) {
+		printf("  --hmac FILE        HMAC-SHA512 keyed with the %s over the message in FILE\n", verifier ? "secret" : "input");
+		printf("  --pbkdf2 N         with --hmac, PBKDF2-HMAC-SHA512 with FILE as salt and N iterations\n");
+	}
+	if (mode & CLI_CIRCUIT) {
+		printf("  --circuit FILE     Bristol Fashion circuit, required\n");
+		printf("  --public FILE      bytes of the last input values, which are public\n");
+	}
+	printf("  --stats FORMAT     per phase timings and counters to stderr, json or csv\n");
+	if (!verifier)
+		printf("  --seed STRING      deterministic randomness for reproducible proofs, never for real ones\n");
+}
+
+/*
+ * mode is CLI_PROVER or CLI_VERIFIER, or'ed with CLI_COMPACT, CLI_PREFIX,
+ * CLI_HASH, CLI_HMAC and CLI_CIRCUIT when the binary takes --compact,
+ * --prefix, --hash, --hmac and --circuit. Returns 0 when the options are
+ * usable, otherwise prints the usage and returns 1.
+ */
+int cli_parse(int argc, char* argv[], int mode, cliOptions* opt) {
+	static const struct option longOptions[] = {
+		{ "rounds", required_argument, NULL, 'r' },
+		{ "input-file", required_argument, NULL, 'i' },
+		{ "hex", no_argument, NULL, 'x' },
+		{ "out", required_argument, NULL, 'o' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "batch", no_argument, NULL, 'b' },
+		{ "compact", no_argument, NULL, 'c' },
+		{ "stats", required_argument, NULL, 's' },
+		{ "seed", required_argument, NULL, 'S' },
+		{ "prefix", required_argument, NULL, 'p' },
+		{ "hash", required_argument, NULL, 'H' },
+		{ "hmac", required_argument, NULL, 'm' },
+		{ "pbkdf2", required_argument, NULL, 'k' },
+		{ "circuit", required_argument, NULL, 'C' },
+		{ "public", required_argument, NULL, 'P' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	int verifier = mode & CLI_VERIFIER;
+	int c;
+
+	memset(opt, 0, sizeof(cliOptions));
+	while ((c = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+		switch (c) {
+		case 'r':
+			opt->rounds = atoi(optarg);
+			if (opt->rounds <= 0) {
+				printf("Invalid number of rounds %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'i':
+			opt->inputFile = optarg;
+			break;
+		case 'x':
+			opt->hex = 1;
+			break;
+		case 'o':
+			opt->out = optarg;
+			break;
+		case 't':
+			opt->threads = atoi(optarg);
+			if (opt->threads <= 0) {
+				printf("Invalid number of threads %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'b':
+			opt->batch = 1;
+			break;
+		case 'c':
+			opt->compact = 1;
+			break;
+		case 's':
+			if ((strcmp(optarg, "json") != 0) && (strcmp(optarg, "csv") != 0)) {
+				printf("Invalid stats format %s, use json or csv\n", optarg);
+				return 1;
+			}
+			opt->stats = optarg;
+			break;
+		case 'S':
+			opt->seed = optarg;
+			break;
+		case 'p':
+			opt->prefix = optarg;
+			break;
+		case 'H':
+			opt->hash = optarg;
+			break;
+		case 'm':
+			opt->hmac = optarg;
+			break;
+		case 'k':
+			opt->pbkdf2 = atol(optarg);
+			if (opt->pbkdf2 <= 0) {
+				printf("Invalid number of iterations %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'C':
+			opt->circuit = optarg;
+			break;
+		case 'P':
+			opt->publicInput = optarg;
+			break;
+		default:
+			cli_usage(argv[0], mode);
+			return 1;
+		}
+	}
+	if ((optind < argc) && !opt->inputFile)
+		opt->inputFile = argv[optind++];
+	if (optind < argc) {
+		cli_usage(argv[0], mode);
+		return 1;
+	}
+	if ((verifier && (opt->hex || opt->out || opt->seed)) || (opt->batch && opt->inputFile) ||
+		(opt->compact && (verifier || !(mode & CLI_COMPACT))) || (opt->prefix && !(mode & CLI_PREFIX)) ||
+		(opt->hash && !(mode & CLI_HASH)) || (opt->hmac && !(mode & CLI_HMAC)) ||
+		(opt->pbkdf2 && !opt->hmac) || (opt->hmac && opt->prefix) ||
+		((mode & CLI_CIRCUIT) && !opt->circuit) || (opt->circuit && !(mode & CLI_CIRCUIT)) ||
+		(opt->publicInput && !(mode & CLI_CIRCUIT))) {
+		cli_usage(argv[0], mode);
+		return 1;
+	}
+	return 0;
+}
+
+// Proof file name: the one given, or out<rounds>.bin when none was given
+void cli_proofName(const char* given, int rounds, char name[], size_t size) {
+	if (given)
+		snprintf(name, size, "%s", given);
+	else
+		snprintf(name, size, "out%i.bin", rounds);
+}
+
+int cli_hexValue(char c) {
+	if ((c >= '0') && (c <= '9'))
+		return c - '0';
+	if ((c >= 'a') && (c <= 'f'))
+		return c - 'a' + 10;
+	if ((c >= 'A') && (c <= 'F'))
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Returns the number of bytes, or -1 when hex is not valid or longer than max bytes
+long cli_hexDecode(const char* hex, size_t len, unsigned char* out, size_t max) {
+	if ((len % 2 != 0) || (len / 2 > max))
+		return -1;
+	for (size_t j = 0; j < len / 2; j++) {
+		int hi = cli_hexValue(hex[2 * j]);
+		int lo = cli_hexValue(hex[2 * j + 1]);
+		if ((hi < 0) || (lo < 0))
+			return -1;
+		out[j] = (hi << 4) | lo;
+	}
+	return len / 2;
+}
+
+void cli_hexWrite(FILE* f, const void* data, size_t len) {
+	static const char digits[] = "0123456789ABCDEF";
+	const unsigned char* p = data;
+	char buf[4096];
+	size_t n = 0;
+
+	for (size_t j = 0; j < len; j++) {
+		buf[n++] = digits[p[j] >> 4];
+		buf[n++] = digits[p[j] & 0xF];
+		if (n == sizeof(buf)) {
+			fwrite(buf, 1, n, f);
+			n = 0;
+		}
+	}
+	fwrite(buf, 1, n, f);
+}
+
+// Writes the size bytes of file fd as one line of hex. Returns 0 on success
+int cli_hexWriteFile(FILE* f, int fd, size_t size) {
+	unsigned char buf[65536];
+	size_t done = 0;
+
+	while (done < size) {
+		size_t want = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+		ssize_t n = pread(fd, buf, want, done);
+		if (n <= 0)
+			return 1;
+		cli_hexWrite(f, buf, n);
+		done += n;
+	}
+	fputc('\n', f);
+	return ferror(f) ? 1 : 0;
+}
+
+/*
+ * Turns one line of user input into message bytes, hex decoding it with
+ * --hex. Returns the length, or -1 when it is invalid or longer than max.
+ * out may be line itself, each byte is decoded from characters at or after it.
+ */
+long cli_message(const cliOptions* opt, const char* line, size_t len, unsigned char* out, size_t max) {
+	if (opt->hex)
+		return cli_hexDecode(line, len, out, max);
+	if (len > max)
+		return -1;
+	memcpy(out, line, len);
+	return len;
+}
+
+// getline() without the line ending. Returns the length, or -1 at end of input
+long cli_readLine(FILE* f, char** line, size_t* cap) {
+	ssize_t n = getline(line, cap, f);
+
+	if (n < 0)
+		return -1;
+	while ((n > 0) && (((*line)[n - 1] == '\n') || ((*line)[n - 1] == '\r')))
+		(*line)[--n] = 0;
+	return n;
+}
+
+/*
+ * Reads a whole --input-file of at most max message bytes. With --hex it is
+ * decoded by cli_message() like a line, after the line endings it ends in.
+ * Returns the length or -1.
+ */
+long cli_readFile(const cliOptions* opt, const char* filename, unsigned char* out, size_t max) {
+	FILE* f = fopen(filename, "rb");
+	size_t cap = opt->hex ? 2 * max + 2 : max;
+	unsigned char* buf = opt->hex ? malloc(cap) : out;
+	long n = -1;
+
+	if (f && buf) {
+		size_t got = fread(buf, 1, cap, f);
+		if ((got < cap) || (fgetc(f) == EOF))
+			n = got;
+	}
+	if (opt->hex && (n >= 0)) {
+		while ((n > 0) && ((buf[n - 1] == '\n') || (buf[n - 1] == '\r')))
+			n--;
+		n = cli_message(opt, (const char*)buf, n, out, max);
+	}
+	if (opt->hex)
+		free(buf);
+	if (f)
+		fclose(f);
+	return n;
+}
+
+/*
+ * Stream for the batch results: --out when given, otherwise the original
+ * stdout. stdout itself is pointed at stderr so the progress output of the
+ * binaries does not mix with the results.
+ */
+FILE* cli_batchOutput(const cliOptions* opt) {
+	FILE* f;
+	int fd;
+
+	if (opt->out)
+		f = fopen(opt->out, "w");
+	else {
+		fflush(stdout);
+		fd = dup(STDOUT_FILENO);
+		f = (fd < 0) ? NULL : fdopen(fd, "w");
+	}
+	if (f)
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+	return f;
+}
+
+#endif /* CLI_H_ */
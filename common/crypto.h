@@ -0,0 +1,167 @@
+/*
+ * Name: crypto.h
+ * Author: Tan Teik Guan
+ * Description: OpenSSL 3 digests and cipher fetched once, with per thread contexts
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * OpenSSL 3 looks an algorithm up in its providers every time EVP_sha256()
+ * style objects are used to initialise a context, and EVP_MD_CTX_new() or
+ * EVP_CIPHER_CTX_new() per hash allocates each time. Here the algorithms are
+ * fetched once and every thread keeps its digest contexts and one cipher
+ * context, and initialises them again for each use:
+ *
+ *   crypto_init();                          // once, before any thread uses it
+ *   EVP_MD_CTX* ctx = crypto_digest(crypto_sha256);
+ *   EVP_DigestUpdate(ctx, data, len);
+ *   EVP_DigestFinal_ex(ctx, hash, NULL);
+ *   EVP_MD_CTX** ctxs = crypto_digests(crypto_sha512, n);  // n at once
+ *   EVP_CIPHER_CTX* c = crypto_cipher(key, iv);  // AES-128-CTR
+ *   EVP_CIPHER_CTX* e = crypto_ecb(key);         // AES-128-ECB, no padding
+ *   crypto_cleanup();                       // at exit, after the last parallel region
+ *
+ * crypto_digest() is the first context of crypto_digests(), so the digests a
+ * thread has open must be finished before it asks for contexts again. The
+ * contexts are made on first use and kept on a list that crypto_cleanup()
+ * frees; libgomp keeps its threads from one parallel region to the next, so
+ * each thread makes them once. crypto_cipher() and crypto_ecb() share the one
+ * cipher context.
+ *
+ * OpenSSL 3 needs no locking callbacks, its internal locks are set up by the
+ * library itself. crypto_ripemd160 is NULL when the default provider has no
+ * RIPEMD-160 (before OpenSSL 3.0.7 it is in the legacy provider only).
+ */
+
+#ifndef CRYPTO_H_
+#define CRYPTO_H_
+#include <stdio.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+
+typedef struct cryptoThread {
+	EVP_MD_CTX** md;
+	int numMd;
+	EVP_CIPHER_CTX* cipher;
+	struct cryptoThread* next;
+} cryptoThread;
+
+EVP_MD* crypto_sha256 = NULL;
+EVP_MD* crypto_sha512 = NULL;
+EVP_MD* crypto_ripemd160 = NULL;
+EVP_CIPHER* crypto_aes128ctr = NULL;
+EVP_CIPHER* crypto_aes128ecb = NULL;
+cryptoThread* crypto_threads = NULL;
+static __thread cryptoThread* crypto_self = NULL;
+
+// Fetches the algorithms, returns 1 when SHA-256, SHA-512 or AES-128 is missing
+int crypto_init() {
+	if (crypto_sha256)
+		return 0;
+	crypto_sha256 = EVP_MD_fetch(NULL, "SHA256", NULL);
+	crypto_sha512 = EVP_MD_fetch(NULL, "SHA512", NULL);
+	crypto_ripemd160 = EVP_MD_fetch(NULL, "RIPEMD160", NULL);
+	crypto_aes128ctr = EVP_CIPHER_fetch(NULL, "AES-128-CTR", NULL);
+	crypto_aes128ecb = EVP_CIPHER_fetch(NULL, "AES-128-ECB", NULL);
+	if (!crypto_sha256 || !crypto_sha512 || !crypto_aes128ctr || !crypto_aes128ecb) {
+		printf("Unable to fetch SHA-256, SHA-512, AES-128-CTR and AES-128-ECB from OpenSSL\n");
+		return 1;
+	}
+	return 0;
+}
+
+// The calling thread's contexts, made on its first call
+cryptoThread* crypto_local() {
+	if (!crypto_self) {
+		cryptoThread* t = malloc(sizeof(cryptoThread));
+		t->md = NULL;
+		t->numMd = 0;
+		t->cipher = EVP_CIPHER_CTX_new();
+		if (!t->cipher) {
+			printf("Unable to allocate OpenSSL contexts\n");
+			abort();
+		}
+		#pragma omp critical(crypto)
+		{
+			t->next = crypto_threads;
+			crypto_threads = t;
+		}
+		crypto_self = t;
+	}
+	return crypto_self;
+}
+
+// n of the calling thread's digest contexts, each initialised for md
+EVP_MD_CTX** crypto_digests(const EVP_MD* md, int n) {
+	cryptoThread* t = crypto_local();
+
+	if (n > t->numMd) {
+		t->md = realloc(t->md, n * sizeof(EVP_MD_CTX*));
+		for (int i = t->numMd; i < n; i++) {
+			t->md[i] = EVP_MD_CTX_new();
+			if (!t->md[i]) {
+				printf("Unable to allocate OpenSSL contexts\n");
+				abort();
+			}
+		}
+		t->numMd = n;
+	}
+	for (int i = 0; i < n; i++) {
+		if (EVP_DigestInit_ex(t->md[i], md, NULL) != 1) {
+			printf("Unable to initialise digest\n");
+			abort();
+		}
+	}
+	return t->md;
+}
+
+// The calling thread's first digest context, initialised for md
+EVP_MD_CTX* crypto_digest(const EVP_MD* md) {
+	return crypto_digests(md, 1)[0];
+}
+
+// The calling thread's cipher context, set up for AES-128-CTR under key and iv
+EVP_CIPHER_CTX* crypto_cipher(const unsigned char key[16], const unsigned char* iv) {
+	EVP_CIPHER_CTX* ctx = crypto_local()->cipher;
+
+	if (EVP_EncryptInit_ex(ctx, crypto_aes128ctr, NULL, key, iv) != 1) {
+		printf("Unable to set up AES-128-CTR\n");
+		abort();
+	}
+	return ctx;
+}
+
+// The calling thread's cipher context, set up for AES-128-ECB under key without padding
+EVP_CIPHER_CTX* crypto_ecb(const unsigned char key[16]) {
+	EVP_CIPHER_CTX* ctx = crypto_local()->cipher;
+
+	if (EVP_EncryptInit_ex(ctx, crypto_aes128ecb, NULL, key, NULL) != 1) {
+		printf("Unable to set up AES-128-ECB\n");
+		abort();
+	}
+	EVP_CIPHER_CTX_set_padding(ctx, 0);
+	return ctx;
+}
+
+void crypto_cleanup() {
+	while (crypto_threads) {
+		cryptoThread* t = crypto_threads;
+		crypto_threads = t->next;
+		for (int i = 0; i < t->numMd; i++)
+			EVP_MD_CTX_free(t->md[i]);
+		free(t->md);
+		EVP_CIPHER_CTX_free(t->cipher);
+		free(t);
+	}
+	crypto_self = NULL;
+	EVP_MD_free(crypto_sha256);
+	EVP_MD_free(crypto_sha512);
+	EVP_MD_free(crypto_ripemd160);
+	EVP_CIPHER_free(crypto_aes128ctr);
+	EVP_CIPHER_free(crypto_aes128ecb);
+	crypto_sha256 = crypto_sha512 = crypto_ripemd160 = NULL;
+	crypto_aes128ctr = crypto_aes128ecb = NULL;
+}
+
+#endif /* CRYPTO_H_ */
@@ -0,0 +1,527 @@
+/*
+ * Name: hashmany.h
+ * Author: Tan Teik Guan
+ * Description: SHA-256 and SHA-512 of many equal length messages at once
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * The view commitments of a batch of rounds are independent hashes of
+ * messages of the same length, so they can go through the compression
+ * function side by side, one message per SIMD lane:
+ *
+ *   hashMany h;
+ *   hash_begin(&h, crypto_sha512, n);  // n streams, crypto_sha256 or crypto_sha512
+ *   hash_update(&h, data, len);        // len bytes from data[i] into stream i
+ *   hash_final(&h, out);               // digest of stream i to out[i]
+ *
+ * Every stream takes the same number of bytes in each hash_update(), so the
+ * streams always sit at the same offset of their block and are padded alike.
+ *
+ * Backends:
+ *
+ *   avx512 - SHA-512 eight streams at a time, SHA-256 as avx2
+ *   avx2   - SHA-512 four streams and SHA-256 eight streams at a time
+ *   evp    - one OpenSSL context per stream (common/crypto.h)
+ *
+ * hash_init() picks the widest one CPUID reports. SHA-256 stays on evp when
+ * the CPU has the SHA extensions, which OpenSSL uses for one stream faster
+ * than eight AVX2 lanes go. ZKBOO_HASH=avx512|avx2|evp in the environment
+ * overrides the choice.
+ */
+
+#ifndef HASHMANY_H_
+#define HASHMANY_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "crypto.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HASH_HAVE_SIMD 1
+#endif
+
+#define HASH_MAXLANES 8
+// Rounds the provers commit to per H_many() call, 24 views fill whole groups
+#define HASH_ROUNDS 8
+
+typedef struct {
+	int n;				// streams
+	int wide;			// 1 for SHA-512, 0 for SHA-256
+	int block;			// compression block, 64 or 128 bytes
+	int lanes;			// streams per kernel call, 0 for evp
+	uint64_t len;			// bytes each stream has taken
+	uint32_t (*s32)[8];		// SHA-256 chaining values
+	uint64_t (*s64)[8];		// SHA-512 chaining values
+	unsigned char* buf;		// partial block of each stream
+	const unsigned char** ptr;	// scratch, one per stream
+	EVP_MD_CTX** evp;		// evp
+} hashMany;
+
+int hash_lanes256 = 0;
+int hash_lanes512 = 0;
+const char * hash_name = "evp";
+
+static const uint32_t hash_iv256[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint64_t hash_iv512[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint32_t hash_k256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint64_t hash_k512[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+#ifdef HASH_HAVE_SIMD
+/*
+ * The kernels compress blocks consecutive blocks of each of their lanes:
+ * state[i] is the chaining value of lane i and data[i] its input. Words are
+ * held one lane per vector element, the message blocks are turned into that
+ * layout with transposes. Like the tape kernels they ask for optimisation
+ * themselves, for the Makefiles that build without it.
+ */
+#define HASH_ROR32(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define HASH_ROR64(x, n) _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+
+__attribute__((target("avx2"), optimize("O2")))
+void hash_sha256x8_avx2(uint32_t * const state[8], const unsigned char * const data[8], size_t blocks) {
+	const __m256i swap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+			12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	__m256i s[8], w[16];
+
+	for (int i = 0; i < 8; i++)
+		s[i] = _mm256_set_epi32(state[7][i], state[6][i], state[5][i], state[4][i],
+				state[3][i], state[2][i], state[1][i], state[0][i]);
+	for (size_t b = 0; b < blocks; b++) {
+		for (int half = 0; half < 2; half++) {
+			__m256i r[8], t[8], u[8];
+			for (int l = 0; l < 8; l++)
+				r[l] = _mm256_loadu_si256((const __m256i *)(data[l] + b * 64 + half * 32));
+			for (int l = 0; l < 8; l += 2) {
+				t[l] = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+				t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+			}
+			for (int l = 0; l < 8; l += 4) {
+				u[l] = _mm256_unpacklo_epi64(t[l], t[l + 2]);
+				u[l + 1] = _mm256_unpackhi_epi64(t[l], t[l + 2]);
+				u[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+				u[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+			}
+			for (int l = 0; l < 4; l++) {
+				w[half * 8 + l] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[l], u[l + 4], 0x20), swap);
+				w[half * 8 + l + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[l], u[l + 4], 0x31), swap);
+			}
+		}
+
+		__m256i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+		for (int i = 0; i < 64; i++) {
+			__m256i wi;
+			if (i < 16)
+				wi = w[i];
+			else {
+				__m256i w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+				__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR32(w15, 7), HASH_ROR32(w15, 18)), _mm256_srli_epi32(w15, 3));
+				__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR32(w2, 17), HASH_ROR32(w2, 19)), _mm256_srli_epi32(w2, 10));
+				wi = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0), _mm256_add_epi32(w[(i - 7) & 15], s1));
+				w[i & 15] = wi;
+			}
+			__m256i S1 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR32(e, 6), HASH_ROR32(e, 11)), HASH_ROR32(e, 25));
+			__m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+			__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, _mm256_add_epi32(wi, _mm256_set1_epi32(hash_k256[i]))));
+			__m256i S0 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR32(a, 2), HASH_ROR32(a, 13)), HASH_ROR32(a, 22));
+			__m256i maj = _mm256_or_si256(_mm256_and_si256(a, bb), _mm256_and_si256(c, _mm256_or_si256(a, bb)));
+			h = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi32(d, t1);
+			d = c;
+			c = bb;
+			bb = a;
+			a = _mm256_add_epi32(t1, _mm256_add_epi32(S0, maj));
+		}
+		s[0] = _mm256_add_epi32(s[0], a);
+		s[1] = _mm256_add_epi32(s[1], bb);
+		s[2] = _mm256_add_epi32(s[2], c);
+		s[3] = _mm256_add_epi32(s[3], d);
+		s[4] = _mm256_add_epi32(s[4], e);
+		s[5] = _mm256_add_epi32(s[5], f);
+		s[6] = _mm256_add_epi32(s[6], g);
+		s[7] = _mm256_add_epi32(s[7], h);
+	}
+	for (int i = 0; i < 8; i++) {
+		uint32_t v[8];
+		_mm256_storeu_si256((__m256i *)v, s[i]);
+		for (int l = 0; l < 8; l++)
+			state[l][i] = v[l];
+	}
+}
+
+__attribute__((target("avx2"), optimize("O2")))
+void hash_sha512x4_avx2(uint64_t * const state[4], const unsigned char * const data[4], size_t blocks) {
+	const __m256i swap = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+			8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i s[8], w[16];
+
+	for (int i = 0; i < 8; i++)
+		s[i] = _mm256_set_epi64x(state[3][i], state[2][i], state[1][i], state[0][i]);
+	for (size_t b = 0; b < blocks; b++) {
+		for (int q = 0; q < 4; q++) {
+			__m256i r[4], t[4];
+			for (int l = 0; l < 4; l++)
+				r[l] = _mm256_loadu_si256((const __m256i *)(data[l] + b * 128 + q * 32));
+			t[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+			t[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+			t[2] = _mm256_unpacklo_epi64(r[2], r[3]);
+			t[3] = _mm256_unpackhi_epi64(r[2], r[3]);
+			w[q * 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[0], t[2], 0x20), swap);
+			w[q * 4 + 1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[1], t[3], 0x20), swap);
+			w[q * 4 + 2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[0], t[2], 0x31), swap);
+			w[q * 4 + 3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[1], t[3], 0x31), swap);
+		}
+
+		__m256i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+		for (int i = 0; i < 80; i++) {
+			__m256i wi;
+			if (i < 16)
+				wi = w[i];
+			else {
+				__m256i w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+				__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR64(w15, 1), HASH_ROR64(w15, 8)), _mm256_srli_epi64(w15, 7));
+				__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR64(w2, 19), HASH_ROR64(w2, 61)), _mm256_srli_epi64(w2, 6));
+				wi = _mm256_add_epi64(_mm256_add_epi64(w[i & 15], s0), _mm256_add_epi64(w[(i - 7) & 15], s1));
+				w[i & 15] = wi;
+			}
+			__m256i S1 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR64(e, 14), HASH_ROR64(e, 18)), HASH_ROR64(e, 41));
+			__m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+			__m256i t1 = _mm256_add_epi64(_mm256_add_epi64(h, S1), _mm256_add_epi64(ch, _mm256_add_epi64(wi, _mm256_set1_epi64x(hash_k512[i]))));
+			__m256i S0 = _mm256_xor_si256(_mm256_xor_si256(HASH_ROR64(a, 28), HASH_ROR64(a, 34)), HASH_ROR64(a, 39));
+			__m256i maj = _mm256_or_si256(_mm256_and_si256(a, bb), _mm256_and_si256(c, _mm256_or_si256(a, bb)));
+			h = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi64(d, t1);
+			d = c;
+			c = bb;
+			bb = a;
+			a = _mm256_add_epi64(t1, _mm256_add_epi64(S0, maj));
+		}
+		s[0] = _mm256_add_epi64(s[0], a);
+		s[1] = _mm256_add_epi64(s[1], bb);
+		s[2] = _mm256_add_epi64(s[2], c);
+		s[3] = _mm256_add_epi64(s[3], d);
+		s[4] = _mm256_add_epi64(s[4], e);
+		s[5] = _mm256_add_epi64(s[5], f);
+		s[6] = _mm256_add_epi64(s[6], g);
+		s[7] = _mm256_add_epi64(s[7], h);
+	}
+	for (int i = 0; i < 8; i++) {
+		uint64_t v[4];
+		_mm256_storeu_si256((__m256i *)v, s[i]);
+		for (int l = 0; l < 4; l++)
+			state[l][i] = v[l];
+	}
+}
+
+// AVX-512 has rotates and three input logic, 0x96 is x^y^z, 0xca x?y:z and 0xe8 majority
+#define HASH_XOR3(x, y, z) _mm512_ternarylogic_epi64((x), (y), (z), 0x96)
+
+__attribute__((target("avx512f,avx512bw"), optimize("O2")))
+void hash_sha512x8_avx512(uint64_t * const state[8], const unsigned char * const data[8], size_t blocks) {
+	const __m512i swap = _mm512_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+			8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+			8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+			8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+	__m512i s[8], w[16];
+
+	for (int i = 0; i < 8; i++)
+		s[i] = _mm512_set_epi64(state[7][i], state[6][i], state[5][i], state[4][i],
+				state[3][i], state[2][i], state[1][i], state[0][i]);
+	for (size_t b = 0; b < blocks; b++) {
+		for (int half = 0; half < 2; half++) {
+			__m512i r[8], t[8], u[8];
+			for (int l = 0; l < 8; l++)
+				r[l] = _mm512_loadu_si512((const void *)(data[l] + b * 128 + half * 64));
+			for (int l = 0; l < 8; l += 2) {
+				t[l] = _mm512_unpacklo_epi64(r[l], r[l + 1]);
+				t[l + 1] = _mm512_unpackhi_epi64(r[l], r[l + 1]);
+			}
+			//u[0..3] hold words 0/4, 2/6, 1/5 and 3/7 of lanes 0-3, u[4..7] of lanes 4-7
+			for (int l = 0; l < 8; l += 4) {
+				u[l] = _mm512_shuffle_i64x2(t[l], t[l + 2], 0x88);
+				u[l + 1] = _mm512_shuffle_i64x2(t[l], t[l + 2], 0xdd);
+				u[l + 2] = _mm512_shuffle_i64x2(t[l + 1], t[l + 3], 0x88);
+				u[l + 3] = _mm512_shuffle_i64x2(t[l + 1], t[l + 3], 0xdd);
+			}
+			__m512i* o = &w[half * 8];
+			o[0] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[0], u[4], 0x88), swap);
+			o[4] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[0], u[4], 0xdd), swap);
+			o[2] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[1], u[5], 0x88), swap);
+			o[6] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[1], u[5], 0xdd), swap);
+			o[1] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[2], u[6], 0x88), swap);
+			o[5] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[2], u[6], 0xdd), swap);
+			o[3] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[3], u[7], 0x88), swap);
+			o[7] = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(u[3], u[7], 0xdd), swap);
+		}
+
+		__m512i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+		for (int i = 0; i < 80; i++) {
+			__m512i wi;
+			if (i < 16)
+				wi = w[i];
+			else {
+				__m512i w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+				__m512i s0 = HASH_XOR3(_mm512_ror_epi64(w15, 1), _mm512_ror_epi64(w15, 8), _mm512_srli_epi64(w15, 7));
+				__m512i s1 = HASH_XOR3(_mm512_ror_epi64(w2, 19), _mm512_ror_epi64(w2, 61), _mm512_srli_epi64(w2, 6));
+				wi = _mm512_add_epi64(_mm512_add_epi64(w[i & 15], s0), _mm512_add_epi64(w[(i - 7) & 15], s1));
+				w[i & 15] = wi;
+			}
+			__m512i S1 = HASH_XOR3(_mm512_ror_epi64(e, 14), _mm512_ror_epi64(e, 18), _mm512_ror_epi64(e, 41));
+			__m512i ch = _mm512_ternarylogic_epi64(e, f, g, 0xca);
+			__m512i t1 = _mm512_add_epi64(_mm512_add_epi64(h, S1), _mm512_add_epi64(ch, _mm512_add_epi64(wi, _mm512_set1_epi64(hash_k512[i]))));
+			__m512i S0 = HASH_XOR3(_mm512_ror_epi64(a, 28), _mm512_ror_epi64(a, 34), _mm512_ror_epi64(a, 39));
+			__m512i maj = _mm512_ternarylogic_epi64(a, bb, c, 0xe8);
+			h = g;
+			g = f;
+			f = e;
+			e = _mm512_add_epi64(d, t1);
+			d = c;
+			c = bb;
+			bb = a;
+			a = _mm512_add_epi64(t1, _mm512_add_epi64(S0, maj));
+		}
+		s[0] = _mm512_add_epi64(s[0], a);
+		s[1] = _mm512_add_epi64(s[1], bb);
+		s[2] = _mm512_add_epi64(s[2], c);
+		s[3] = _mm512_add_epi64(s[3], d);
+		s[4] = _mm512_add_epi64(s[4], e);
+		s[5] = _mm512_add_epi64(s[5], f);
+		s[6] = _mm512_add_epi64(s[6], g);
+		s[7] = _mm512_add_epi64(s[7], h);
+	}
+	for (int i = 0; i < 8; i++) {
+		uint64_t v[8];
+		_mm512_storeu_si512((void *)v, s[i]);
+		for (int l = 0; l < 8; l++)
+			state[l][i] = v[l];
+	}
+}
+#endif
+
+int hash_select(const char * name) {
+	if (strcmp(name, "evp") == 0)
+		hash_lanes256 = hash_lanes512 = 0;
+#ifdef HASH_HAVE_SIMD
+	else if (strcmp(name, "avx2") == 0) {
+		if (!__builtin_cpu_supports("avx2"))
+			return 1;
+		hash_lanes256 = 8;
+		hash_lanes512 = 4;
+	}
+	else if (strcmp(name, "avx512") == 0) {
+		if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512bw"))
+			return 1;
+		hash_lanes256 = 8;
+		hash_lanes512 = 8;
+	}
+#endif
+	else
+		return 1;
+	hash_name = name;
+	return 0;
+}
+
+void hash_init() {
+	const char * force = getenv("ZKBOO_HASH");
+
+	if (crypto_init() != 0)
+		abort();
+#ifdef HASH_HAVE_SIMD
+	__builtin_cpu_init();
+	if (hash_select("avx512") != 0)
+		hash_select("avx2");
+	if (__builtin_cpu_supports("sha"))
+		hash_lanes256 = 0;
+#endif
+	if (force && hash_select(force) != 0)
+		printf("Hash backend %s not available, using %s\n", force, hash_name);
+}
+
+// Runs the kernel over all streams, ptr[i] the input of stream i
+void hash_compress(hashMany * h, const unsigned char * const * ptr, size_t blocks) {
+#ifdef HASH_HAVE_SIMD
+	for (int g = 0; g < h->n; g += h->lanes) {
+		const unsigned char * in[HASH_MAXLANES];
+		uint32_t spare32[HASH_MAXLANES][8], * s32[HASH_MAXLANES];
+		uint64_t spare64[HASH_MAXLANES][8], * s64[HASH_MAXLANES];
+
+		//A short last group repeats its first stream into spare states
+		for (int l = 0; l < h->lanes; l++) {
+			int i = (g + l < h->n) ? g + l : g;
+			in[l] = ptr[i];
+			if (h->wide) {
+				s64[l] = (i == g + l) ? h->s64[i] : memcpy(spare64[l], h->s64[i], sizeof(spare64[l]));
+			}
+			else {
+				s32[l] = (i == g + l) ? h->s32[i] : memcpy(spare32[l], h->s32[i], sizeof(spare32[l]));
+			}
+		}
+		if (!h->wide)
+			hash_sha256x8_avx2(s32, in, blocks);
+		else if (h->lanes == 8)
+			hash_sha512x8_avx512(s64, in, blocks);
+		else
+			hash_sha512x4_avx2(s64, in, blocks);
+	}
+#endif
+}
+
+// md is crypto_sha256 or crypto_sha512
+void hash_begin(hashMany * h, const EVP_MD * md, int n) {
+	h->n = n;
+	h->wide = (md == crypto_sha512);
+	h->block = h->wide ? 128 : 64;
+	h->lanes = h->wide ? hash_lanes512 : hash_lanes256;
+	h->len = 0;
+	if (!h->lanes) {
+		h->evp = crypto_digests(md, n);
+		return;
+	}
+	h->s32 = NULL;
+	h->s64 = NULL;
+	if (h->wide) {
+		h->s64 = malloc(n * sizeof(*h->s64));
+		for (int i = 0; i < n; i++)
+			memcpy(h->s64[i], hash_iv512, sizeof(hash_iv512));
+	}
+	else {
+		h->s32 = malloc(n * sizeof(*h->s32));
+		for (int i = 0; i < n; i++)
+			memcpy(h->s32[i], hash_iv256, sizeof(hash_iv256));
+	}
+	h->buf = malloc((size_t)n * h->block);
+	h->ptr = malloc(n * sizeof(*h->ptr));
+	if (!h->buf || !h->ptr || (!h->s32 && !h->s64)) {
+		printf("Unable to allocate memory for %d hashes\n", n);
+		abort();
+	}
+}
+
+void hash_update(hashMany * h, const void * const * data, size_t len) {
+	size_t used = h->len % h->block;
+	size_t done = 0;
+
+	h->len += len;
+	if (!h->lanes) {
+		for (int i = 0; i < h->n; i++)
+			EVP_DigestUpdate(h->evp[i], data[i], len);
+		return;
+	}
+	if (used) {
+		done = (len < h->block - used) ? len : h->block - used;
+		for (int i = 0; i < h->n; i++)
+			memcpy(h->buf + (size_t)i * h->block + used, data[i], done);
+		if (used + done < (size_t)h->block)
+			return;
+		for (int i = 0; i < h->n; i++)
+			h->ptr[i] = h->buf + (size_t)i * h->block;
+		hash_compress(h, h->ptr, 1);
+	}
+	size_t blocks = (len - done) / h->block;
+	if (blocks) {
+		for (int i = 0; i < h->n; i++)
+			h->ptr[i] = (const unsigned char *)data[i] + done;
+		hash_compress(h, h->ptr, blocks);
+		done += blocks * h->block;
+	}
+	for (int i = 0; i < h->n; i++)
+		memcpy(h->buf + (size_t)i * h->block, (const unsigned char *)data[i] + done, len - done);
+}
+
+// Writes the 32 or 64 byte digests and frees the streams
+void hash_final(hashMany * h, unsigned char * const * out) {
+	if (!h->lanes) {
+		for (int i = 0; i < h->n; i++)
+			EVP_DigestFinal_ex(h->evp[i], out[i], NULL);
+		return;
+	}
+	size_t used = h->len % h->block;
+	size_t lenAt = h->block - (h->wide ? 16 : 8);
+	unsigned char pad[128];
+
+	//All streams have the same length, so they share their padding
+	memset(pad, 0, sizeof(pad));
+	pad[0] = 0x80;
+	for (int i = 0; i < h->n; i++)
+		h->ptr[i] = h->buf + (size_t)i * h->block;
+	if (used >= lenAt) {
+		for (int i = 0; i < h->n; i++)
+			memcpy(h->buf + (size_t)i * h->block + used, pad, h->block - used);
+		hash_compress(h, h->ptr, 1);
+		used = 0;
+		pad[0] = 0;
+	}
+	for (int j = 0; j < 8; j++)
+		pad[lenAt - used + (h->wide ? 8 : 0) + j] = (h->len << 3) >> (56 - 8 * j);
+	if (h->wide) {
+		for (int j = 0; j < 8; j++)
+			pad[lenAt - used + j] = (j == 7) ? h->len >> 61 : 0;
+	}
+	for (int i = 0; i < h->n; i++)
+		memcpy(h->buf + (size_t)i * h->block + used, pad, h->block - used);
+	hash_compress(h, h->ptr, 1);
+
+	for (int i = 0; i < h->n; i++) {
+		for (int j = 0; j < 8; j++) {
+			if (h->wide) {
+				for (int k = 0; k < 8; k++)
+					out[i][j * 8 + k] = h->s64[i][j] >> (56 - 8 * k);
+			}
+			else {
+				for (int k = 0; k < 4; k++)
+					out[i][j * 4 + k] = h->s32[i][j] >> (24 - 8 * k);
+			}
+		}
+	}
+	free(h->s32);
+	free(h->s64);
+	free(h->buf);
+	free(h->ptr);
+}
+
+#endif /* HASHMANY_H_ */
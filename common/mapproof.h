@@ -0,0 +1,85 @@
+/*
+ * Name: mapproof.h
+ * Author: Tan Teik Guan
+ * Description: Read-only file mappings for the ZKBoo verifiers
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * Proofs, and the prefix and HMAC message files of MPC_SHA512, are mapped
+ * instead of read, so the verifiers work on the a and z records in place and
+ * only the pages being checked are resident:
+ *
+ *   proof = mapProof(filename, &size);
+ *   releaseFrom(&mark, record);        // optional, a record read front to back
+ *   releaseUpTo(&mark, end);           // everything before end is done
+ *   unmapProof(proof, size);
+ *
+ * The mark only moves forward, so each page is dropped once. Its pages are
+ * read again from the page cache if they are touched later, by the record's
+ * own trailing fields or by the record next to it sharing a page.
+ */
+
+#ifndef MAPPROOF_H_
+#define MAPPROOF_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Maps a file read-only, NULL if it cannot be opened or is empty
+const unsigned char * mapProof(const char * filename, size_t * size) {
+	struct stat st;
+	void * proof;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0)
+		return NULL;
+	if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+		close(fd);
+		return NULL;
+	}
+	proof = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (proof == MAP_FAILED)
+		return NULL;
+	*size = st.st_size;
+	return proof;
+}
+
+void unmapProof(const unsigned char * proof, size_t size) {
+	munmap((void *)proof, size);
+}
+
+// Start of the pages of a record that have not been dropped yet
+typedef struct {
+	uintptr_t done;
+} releaseMark;
+
+uintptr_t releasePageMask() {
+	return ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+}
+
+// Starts a mark at the page holding p, shared with the record before it or not
+void releaseFrom(releaseMark * mark, const void * p) {
+	mark->done = (uintptr_t)p & releasePageMask();
+}
+
+/*
+ * Drops the pages from the mark up to the page holding end, so resident
+ * memory stays at a few blocks however long the proof is. The page holding
+ * end is kept until a later call passes it.
+ */
+void releaseUpTo(releaseMark * mark, const void * end) {
+	uintptr_t to = (uintptr_t)end & releasePageMask();
+
+	if (to > mark->done) {
+		madvise((void *)mark->done, to - mark->done, MADV_DONTNEED);
+		mark->done = to;
+	}
+}
+
+#endif /* MAPPROOF_H_ */
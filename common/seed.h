@@ -0,0 +1,117 @@
+/*
+ * Name: seed.h
+ * Author: Tan Teik Guan
+ * Description: Deterministic random bytes for reproducible proofs
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * The provers take their keys, commitment randomness and input shares from
+ * seed_bytes(), which is RAND_bytes() unless a seed is given with --seed:
+ *
+ *   seed_init(opt.seed);              // NULL or "" for RAND_bytes()
+ *   seed_bytes(buf, len);             // 1 on success, like RAND_bytes()
+ *
+ * With a seed the bytes come from SHA-256 in counter mode,
+ *
+ *   key     = SHA-256("ZKBoo seed" || seed)
+ *   block i = SHA-256(key || i), i a 64 bit big endian counter from 0
+ *
+ * read as one stream, so the same seed, input and options give a byte
+ * identical proof. That is for benchmarks and golden proofs only: anyone who
+ * knows the seed can recompute the shares and recover the input. Only the
+ * --seed option turns it on, never the environment, and seed_init() warns on
+ * stderr every time it does.
+ *
+ * The hashes are the fetched SHA-256 of common/crypto.h; seed_init() fetches
+ * it when the prover has not set up OpenSSL yet. A binary built without
+ * OpenSSL, as PoAO.c is, defines SEED_OWN_SHA256 and its own seed_sha256()
+ * and seed_system() before including this file.
+ */
+
+#ifndef SEED_H_
+#define SEED_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEED_BLOCK 32
+
+#ifndef SEED_OWN_SHA256
+#include <openssl/rand.h>
+#include "crypto.h"
+
+// SHA-256(a || b) into out. Returns 0, or 1 when SHA-256 is not available
+int seed_sha256(const void* a, size_t aLen, const void* b, size_t bLen, unsigned char out[SEED_BLOCK]) {
+	EVP_MD_CTX* ctx;
+
+	if (crypto_init() != 0)
+		return 1;
+	ctx = crypto_digest(crypto_sha256);
+	EVP_DigestUpdate(ctx, a, aLen);
+	EVP_DigestUpdate(ctx, b, bLen);
+	EVP_DigestFinal_ex(ctx, out, NULL);
+	return 0;
+}
+
+// Bytes when no seed is given
+int seed_system(unsigned char* buf, int len) {
+	return RAND_bytes(buf, len);
+}
+#endif
+
+int seed_fixed = 0;
+unsigned char seed_key[SEED_BLOCK];
+uint64_t seed_counter = 0;
+unsigned char seed_block[SEED_BLOCK];
+int seed_used = SEED_BLOCK;
+
+/*
+ * seed is the --seed string, NULL or "" when none was given. Without one the
+ * bytes come from seed_system(). Returns 0, or 1 when SHA-256 is not
+ * available.
+ */
+int seed_init(const char* seed) {
+	seed_fixed = 0;
+	seed_counter = 0;
+	seed_used = SEED_BLOCK;
+	if (!seed || (strcmp(seed, "") == 0))
+		return 0;
+	if (seed_sha256("ZKBoo seed", 10, seed, strlen(seed), seed_key) != 0)
+		return 1;
+	fprintf(stderr, "WARNING: --seed makes this proof reproducible, and anyone who knows the seed can recover the secret input from it. Use it for benchmarks and test vectors only.\n");
+	seed_fixed = 1;
+	return 0;
+}
+
+int seed_bytes(unsigned char* buf, int len) {
+	int ok = 1;
+
+	if (!seed_fixed)
+		return seed_system(buf, len);
+	#pragma omp critical(seed)
+	{
+		while (ok && (len > 0)) {
+			if (seed_used == SEED_BLOCK) {
+				unsigned char counter[8];
+				for (int j = 0; j < 8; j++)
+					counter[j] = seed_counter >> (56 - 8 * j);
+				ok = (seed_sha256(seed_key, sizeof(seed_key), counter, sizeof(counter), seed_block) == 0);
+				seed_counter++;
+				seed_used = 0;
+			}
+			int n = SEED_BLOCK - seed_used;
+			if (n > len)
+				n = len;
+			memcpy(buf, seed_block + seed_used, n);
+			seed_used += n;
+			buf += n;
+			len -= n;
+		}
+	}
+	return ok;
+}
+
+#endif /* SEED_H_ */
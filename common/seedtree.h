@@ -0,0 +1,197 @@
+/*
+ * Name: seedtree.h
+ * Author: Tan Teik Guan
+ * Description: GGM seed trees for the KKW party keys and master keys
+ *
+ * Copyright 2023 pQCee.
+*/
+
+/*
+ * A binary tree of 16 byte seeds with 2^depth leaves. Node i has the
+ * children 2i+1 and 2i+2, and leaf l is node 2^depth - 1 + l. Child c of a
+ * node with seed s is
+ *
+ *   x = s ^ c, c a 32 bit little endian number in the first 4 bytes
+ *   child = AES-128(SEEDTREE_KEY, x) ^ x
+ *
+ * a fixed key AES PRG: the key schedule is done once per level instead of
+ * once per node, and the children of a level, which sit next to each other
+ * in the node array, are encrypted together, eight blocks in flight with
+ * AES-NI or one AES-128-ECB call (common/crypto.h) on the evp tape backend
+ * (common/tapes.h). Putting the child's node number in keeps the two halves
+ * and every node of a tree apart.
+ *
+ *   unsigned char tree[SEEDTREE_NODES(depth)][16];
+ *   memcpy(tree[0], root, 16);
+ *   seedtree_expand(tree, depth, NULL);              // every node
+ *   n = seedtree_reveal(tree, depth, leaves, hidden, out);  // prover
+ *   n = seedtree_fill(tree, depth, leaves, hidden, in);     // verifier
+ *
+ * hidden[l] is nonzero for the leaves that stay secret. The revealed nodes
+ * are the fewest that give every other leaf below leaves: depth nodes, the
+ * co-path, for one hidden leaf out of a power of two. Nodes that only hold
+ * leaves past leaves are left out, so a tree over a count that is not a
+ * power of two reveals nothing for its padding. Both sides list the nodes in
+ * node order, and the verifier expands what it is given with the same
+ * batched calls.
+ */
+
+#ifndef SEEDTREE_H_
+#define SEEDTREE_H_
+#include <stdint.h>
+#include <string.h>
+#include "tapes.h"
+
+#define SEEDTREE_KEY ((const unsigned char *)"pQCee seed tree.")
+#define SEEDTREE_NODES(depth) ((2 << (depth)) - 1)
+
+// Levels below the root for leaves leaves
+int seedtree_depth(int leaves) {
+	int depth = 0;
+
+	while ((1 << depth) < leaves)
+		depth++;
+	return depth;
+}
+
+#ifdef TAPES_HAVE_AESNI
+__attribute__((target("aes,sse4.1"), optimize("O2")))
+void seedtree_prg_aesni(unsigned char tree[][16], int first, int n) {
+	unsigned char rkBytes[11][16];
+	__m128i rk[11], x[TAPE_LANES], b[TAPE_LANES];
+	int children = 2 * n;
+
+	tape_expandKey_aesni(SEEDTREE_KEY, rkBytes);
+	for (int r = 0; r < 11; r++)
+		rk[r] = _mm_loadu_si128((const __m128i *)rkBytes[r]);
+	for (int c = 0; c < children; c += TAPE_LANES) {
+		int m = (children - c < TAPE_LANES) ? children - c : TAPE_LANES;
+		for (int i = 0; i < m; i++) {
+			x[i] = _mm_loadu_si128((const __m128i *)tree[first + (c + i) / 2]);
+			x[i] = _mm_xor_si128(x[i], _mm_cvtsi32_si128(2 * first + 1 + c + i));
+			b[i] = _mm_xor_si128(x[i], rk[0]);
+		}
+		for (int r = 1; r < 10; r++) {
+			for (int i = 0; i < m; i++)
+				b[i] = _mm_aesenc_si128(b[i], rk[r]);
+		}
+		for (int i = 0; i < m; i++) {
+			b[i] = _mm_xor_si128(_mm_aesenclast_si128(b[i], rk[10]), x[i]);
+			_mm_storeu_si128((__m128i *)tree[2 * first + 1 + c + i], b[i]);
+		}
+	}
+}
+#endif
+
+// Children of the n nodes from first on
+__attribute__((optimize("O2")))
+void seedtree_prg(unsigned char tree[][16], int first, int n) {
+	unsigned char * out = tree[2 * first + 1];
+	int outLen;
+
+#ifdef TAPES_HAVE_AESNI
+	if (tape_aesni) {
+		seedtree_prg_aesni(tree, first, n);
+		return;
+	}
+#endif
+	for (int c = 0; c < 2 * n; c++) {
+		uint32_t child = 2 * first + 1 + c;
+		memcpy(out + 16 * c, tree[first + c / 2], 16);
+		for (int b = 0; b < 4; b++)
+			out[16 * c + b] ^= (child >> (8 * b)) & 0xFF;
+	}
+	if (EVP_EncryptUpdate(crypto_ecb(SEEDTREE_KEY), out, &outLen, out, 32 * n) != 1) {
+		printf("Unable to expand seed tree\n");
+		abort();
+	}
+	for (int c = 0; c < 2 * n; c++) {
+		uint32_t child = 2 * first + 1 + c;
+		for (int b = 0; b < 16; b++)
+			out[16 * c + b] ^= tree[first + c / 2][b];
+		for (int b = 0; b < 4; b++)
+			out[16 * c + b] ^= (child >> (8 * b)) & 0xFF;
+	}
+}
+
+/*
+ * Expands the nodes marked in known, level by level, into their children and
+ * marks those. Consecutive known nodes of a level are expanded together.
+ * known NULL expands the whole tree from the root.
+ */
+void seedtree_expand(unsigned char tree[][16], int depth, unsigned char * known) {
+	for (int d = 0; d < depth; d++) {
+		int first = (1 << d) - 1, last = (2 << d) - 1;
+		if (!known) {
+			seedtree_prg(tree, first, 1 << d);
+			continue;
+		}
+		for (int i = first; i < last; ) {
+			int run = 0;
+			while ((i + run < last) && known[i + run])
+				run++;
+			if (run) {
+				seedtree_prg(tree, i, run);
+				memset(known + 2 * i + 1, 1, 2 * run);
+				i += run;
+			}
+			else
+				i++;
+		}
+	}
+}
+
+/*
+ * The nodes to reveal, in node order, for the given hidden leaves: those with
+ * a used leaf and no hidden leaf below them whose parent has a hidden leaf.
+ */
+int seedtree_cover(int depth, int leaves, const int hidden[], int nodes[]) {
+	int numNodes = SEEDTREE_NODES(depth);
+	int firstLeaf = (1 << depth) - 1;
+	unsigned char hid[numNodes], used[numNodes];
+	int n = 0;
+
+	for (int l = 0; l < (1 << depth); l++) {
+		used[firstLeaf + l] = (l < leaves);
+		hid[firstLeaf + l] = (l < leaves) && hidden[l];
+	}
+	for (int i = firstLeaf - 1; i >= 0; i--) {
+		used[i] = used[2 * i + 1] | used[2 * i + 2];
+		hid[i] = hid[2 * i + 1] | hid[2 * i + 2];
+	}
+	for (int i = 1; i < numNodes; i++) {
+		if (used[i] && !hid[i] && hid[(i - 1) / 2])
+			nodes[n++] = i;
+	}
+	return n;
+}
+
+// Copies the nodes that give every leaf but the hidden ones to out, returns their count
+int seedtree_reveal(unsigned char tree[][16], int depth, int leaves, const int hidden[], unsigned char out[][16]) {
+	int nodes[SEEDTREE_NODES(depth)];
+	int n = seedtree_cover(depth, leaves, hidden, nodes);
+
+	for (int i = 0; i < n; i++)
+		memcpy(out[i], tree[nodes[i]], 16);
+	return n;
+}
+
+/*
+ * Places the nodes from seedtree_reveal() and expands them, so tree holds
+ * every leaf but the hidden ones. Returns the number of nodes taken from in.
+ */
+int seedtree_fill(unsigned char tree[][16], int depth, int leaves, const int hidden[], const unsigned char in[][16]) {
+	int nodes[SEEDTREE_NODES(depth)];
+	unsigned char known[SEEDTREE_NODES(depth)];
+	int n = seedtree_cover(depth, leaves, hidden, nodes);
+
+	memset(known, 0, sizeof(known));
+	for (int i = 0; i < n; i++) {
+		memcpy(tree[nodes[i]], in[i], 16);
+		known[nodes[i]] = 1;
+	}
+	seedtree_expand(tree, depth, known);
+	return n;
+}
+
+#endif /* SEEDTREE_H_ */
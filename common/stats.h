@@ -0,0 +1,263 @@
+/*
+ * Name: stats.h
+ * Author: Tan Teik Guan
+ * Description: Per phase timers and counters shared by the provers and verifiers
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * A proof or a verification is split into phases that run one after the
+ * other. Each phase records
+ *
+ *   wall_ms        wall clock time
+ *   cpu_ms         CPU time of the whole process, all threads together, which
+ *                  is what clock() used to report
+ *   thread_cpu_ms  CPU time of each OpenMP thread
+ *   gates          MPC gates evaluated, one per gate per round
+ *   tape_bytes     random tape bytes generated
+ *   hash_bytes     bytes absorbed by the commitment and challenge hashes
+ *
+ *   stats_init(format);              // at start up
+ *   stats_reset();                   // drops phases left by a failed run
+ *   stats_begin("mpc");              // ends the open phase, if any
+ *   stats_add(STATS_GATES, n);       // counts for the open phase, thread safe
+ *   ms = stats_end();                // wall ms of the phase
+ *   ms = stats_totalMs();            // wall ms since the first phase
+ *   stats_report("MPC_SHA256", NUM_ROUNDS); // emits and clears the phases
+ *
+ * Timing is always on, the binaries print their phase times from it. Only
+ * when a format is set ("json" or "csv", from --stats or ZKBOO_STATS) does
+ * stats_report() write the record to stderr, and only then are the per
+ * thread clocks sampled. JSON gives one object per line, CSV one line per
+ * phase plus a "total" line, after a header line.
+ *
+ * The per thread clocks are sampled by every thread of the OpenMP team at
+ * the start and end of a phase. libgomp keeps the same threads from one
+ * parallel region to the next, so the difference is the CPU each thread
+ * spent in the phase.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define STATS_GATES 0
+#define STATS_TAPE_BYTES 1
+#define STATS_HASH_BYTES 2
+#define STATS_COUNTERS 3
+
+#define STATS_MAX_PHASES 16
+#define STATS_MAX_THREADS 64
+
+#define STATS_JSON 1
+#define STATS_CSV 2
+
+typedef struct {
+	const char* name;
+	double wallMs;
+	double cpuMs;
+	int threads;
+	double threadMs[STATS_MAX_THREADS];
+	uint64_t count[STATS_COUNTERS];
+} statsPhase;
+
+static const char* const statsCounterNames[STATS_COUNTERS] = { "gates", "tape_bytes", "hash_bytes" };
+
+int statsFormat = 0;
+int statsHeader = 0;
+int statsNumPhases = 0;
+int statsOpen = -1;
+double statsFirst = 0;
+double statsLast = 0;
+double statsWallStart, statsCpuStart;
+double statsThreadStart[STATS_MAX_THREADS];
+statsPhase statsPhases[STATS_MAX_PHASES];
+
+double stats_clockMs(clockid_t id) {
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Samples the CPU clock of every thread of the team into ms[], returns the team size
+int stats_threadClocks(double ms[STATS_MAX_THREADS]) {
+	int threads = 1;
+
+#ifdef _OPENMP
+	#pragma omp parallel
+	{
+		int t = omp_get_thread_num();
+		if (t < STATS_MAX_THREADS)
+			ms[t] = stats_clockMs(CLOCK_THREAD_CPUTIME_ID);
+		#pragma omp single
+		threads = omp_get_num_threads();
+	}
+#else
+	ms[0] = stats_clockMs(CLOCK_THREAD_CPUTIME_ID);
+#endif
+	return (threads < STATS_MAX_THREADS) ? threads : STATS_MAX_THREADS;
+}
+
+/*
+ * format is "json", "csv", or NULL to take it from ZKBOO_STATS. Returns 1
+ * when the format is not known.
+ */
+int stats_init(const char* format) {
+	if (!format)
+		format = getenv("ZKBOO_STATS");
+	statsFormat = 0;
+	if (!format || (strcmp(format, "") == 0) || (strcmp(format, "off") == 0))
+		return 0;
+	if (strcmp(format, "json") == 0)
+		statsFormat = STATS_JSON;
+	else if (strcmp(format, "csv") == 0)
+		statsFormat = STATS_CSV;
+	else {
+		printf("Unknown stats format %s, use json or csv\n", format);
+		return 1;
+	}
+	return 0;
+}
+
+long stats_end() {
+	statsPhase* p;
+	double now;
+
+	if (statsOpen < 0)
+		return 0;
+	p = &statsPhases[statsOpen];
+	now = stats_clockMs(CLOCK_MONOTONIC);
+	p->wallMs = now - statsWallStart;
+	p->cpuMs = stats_clockMs(CLOCK_PROCESS_CPUTIME_ID) - statsCpuStart;
+	if (statsFormat) {
+		double end[STATS_MAX_THREADS];
+		int threads = stats_threadClocks(end);
+		if (threads > p->threads)
+			threads = p->threads;
+		for (int t = 0; t < threads; t++)
+			p->threadMs[t] = end[t] - statsThreadStart[t];
+		p->threads = threads;
+	}
+	statsLast = now;
+	statsOpen = -1;
+	return (long)p->wallMs;
+}
+
+void stats_begin(const char* name) {
+	statsPhase* p;
+
+	stats_end();
+	if (statsNumPhases == STATS_MAX_PHASES)
+		return;
+	statsOpen = statsNumPhases++;
+	p = &statsPhases[statsOpen];
+	memset(p, 0, sizeof(statsPhase));
+	p->name = name;
+	p->threads = 1;
+	if (statsFormat)
+		p->threads = stats_threadClocks(statsThreadStart);
+	statsCpuStart = stats_clockMs(CLOCK_PROCESS_CPUTIME_ID);
+	statsWallStart = stats_clockMs(CLOCK_MONOTONIC);
+	if (statsOpen == 0)
+		statsFirst = statsWallStart;
+}
+
+void stats_reset() {
+	statsOpen = -1;
+	statsNumPhases = 0;
+}
+
+long stats_totalMs() {
+	stats_end();
+	return (statsNumPhases > 0) ? (long)(statsLast - statsFirst) : 0;
+}
+
+void stats_add(int counter, uint64_t n) {
+	if (statsOpen < 0)
+		return;
+	#pragma omp atomic
+	statsPhases[statsOpen].count[counter] += n;
+}
+
+void stats_emitPhaseJson(FILE* f, const statsPhase* p) {
+	fprintf(f, "{\"name\":\"%s\",\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"thread_cpu_ms\":[", p->name, p->wallMs, p->cpuMs);
+	for (int t = 0; t < p->threads; t++)
+		fprintf(f, "%s%.3f", t ? "," : "", p->threadMs[t]);
+	fprintf(f, "]");
+	for (int c = 0; c < STATS_COUNTERS; c++)
+		fprintf(f, ",\"%s\":%llu", statsCounterNames[c], (unsigned long long)p->count[c]);
+	fprintf(f, "}");
+}
+
+void stats_emitPhaseCsv(FILE* f, const char* binary, int rounds, const statsPhase* p) {
+	double maxMs = 0;
+
+	for (int t = 0; t < p->threads; t++)
+		if (p->threadMs[t] > maxMs)
+			maxMs = p->threadMs[t];
+	fprintf(f, "%s,%d,%s,%.3f,%.3f,%d,%.3f", binary, rounds, p->name, p->wallMs, p->cpuMs, p->threads, maxMs);
+	for (int c = 0; c < STATS_COUNTERS; c++)
+		fprintf(f, ",%llu", (unsigned long long)p->count[c]);
+	fprintf(f, "\n");
+}
+
+/*
+ * Ends the open phase, writes the phases since the last report to stderr in
+ * the chosen format, and starts over. The total is the wall time from the
+ * first phase to the last, with the CPU times and counters summed.
+ */
+void stats_report(const char* binary, int rounds) {
+	statsPhase total;
+
+	stats_end();
+	memset(&total, 0, sizeof(total));
+	total.name = "total";
+	total.wallMs = statsLast - statsFirst;
+	for (int i = 0; i < statsNumPhases; i++) {
+		const statsPhase* p = &statsPhases[i];
+		total.cpuMs += p->cpuMs;
+		if (p->threads > total.threads)
+			total.threads = p->threads;
+		for (int t = 0; t < p->threads; t++)
+			total.threadMs[t] += p->threadMs[t];
+		for (int c = 0; c < STATS_COUNTERS; c++)
+			total.count[c] += p->count[c];
+	}
+
+	if (statsFormat == STATS_JSON) {
+		fprintf(stderr, "{\"binary\":\"%s\",\"rounds\":%d,\"total\":", binary, rounds);
+		stats_emitPhaseJson(stderr, &total);
+		fprintf(stderr, ",\"phases\":[");
+		for (int i = 0; i < statsNumPhases; i++) {
+			if (i)
+				fputc(',', stderr);
+			stats_emitPhaseJson(stderr, &statsPhases[i]);
+		}
+		fprintf(stderr, "]}\n");
+	}
+	else if (statsFormat == STATS_CSV) {
+		if (!statsHeader) {
+			fprintf(stderr, "binary,rounds,phase,wall_ms,cpu_ms,threads,max_thread_cpu_ms");
+			for (int c = 0; c < STATS_COUNTERS; c++)
+				fprintf(stderr, ",%s", statsCounterNames[c]);
+			fprintf(stderr, "\n");
+			statsHeader = 1;
+		}
+		for (int i = 0; i < statsNumPhases; i++)
+			stats_emitPhaseCsv(stderr, binary, rounds, &statsPhases[i]);
+		stats_emitPhaseCsv(stderr, binary, rounds, &total);
+	}
+	fflush(stderr);
+	stats_reset();
+}
+
+#endif /* STATS_H_ */
@@ -0,0 +1,370 @@
+/*
+ * Name: tapes.h
+ * Author: Tan Teik Guan
+ * Description: Random tape generator shared by the ZKBoo and KKW binaries
+ *
+ * Copyright 2022 pQCee.
+*/
+
+/*
+ * A party's random tape is the AES-128-CTR encryption of ASCII '0' bytes
+ * under the party's key, exactly as the per block EVP_EncryptUpdate() loops
+ * produced it, so proofs do not change.
+ *
+ *   tapeStream s;
+ *   tape_open(&s, key, iv);
+ *   tape_read(&s, out, len);          // continues where the last read ended
+ *   tape_close(&s);
+ *
+ *   tape_expand(key, iv, out, len);   // one whole tape
+ *   tape_expandKeys(n, keys, iv, out, len); // n tapes, out + i*len for key i
+ *   tape_readMany(n, streams, outs, len);   // len bytes from each of n streams
+ *   tape_next64(&window, r);          // 8 bytes from each stream of a window
+ *
+ * Backends:
+ *
+ *   aesni - eight counter blocks in flight at once, from one stream or from
+ *           several, so the AES rounds of independent blocks overlap
+ *   evp   - one EVP_EncryptUpdate() per read, for CPUs without AES-NI. The
+ *           cipher is fetched once (common/crypto.h) and a whole tape from
+ *           tape_expand() reuses the thread's cipher context
+ *
+ * tape_init() picks aesni when CPUID reports it. ZKBOO_TAPES=aesni|evp in the
+ * environment overrides the choice. Streamed reads other than the last one
+ * must be a multiple of 16 bytes long.
+ */
+
+#ifndef TAPES_H_
+#define TAPES_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "crypto.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TAPES_HAVE_AESNI 1
+#endif
+
+#define TAPE_BLOCK 16
+#define TAPE_LANES 8
+// Tape plaintext byte, the ASCII "0000000000000000" of the original loops
+#define TAPE_PLAIN 0x30
+
+typedef struct {
+	unsigned char rk[11][16];	// aesni: expanded key
+	uint64_t ctrHi, ctrLo;		// aesni: next counter block, big endian halves
+	EVP_CIPHER_CTX* ctx;		// evp
+} tapeStream;
+
+int tape_aesni = 0;
+const char * tape_name = "evp";
+
+#ifdef TAPES_HAVE_AESNI
+#define TAPE_KEYSTEP(rk, i, rcon) do { \
+		__m128i t = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[i - 1], rcon), 0xff); \
+		__m128i k = rk[i - 1]; \
+		k = _mm_xor_si128(k, _mm_slli_si128(k, 4)); \
+		k = _mm_xor_si128(k, _mm_slli_si128(k, 4)); \
+		k = _mm_xor_si128(k, _mm_slli_si128(k, 4)); \
+		rk[i] = _mm_xor_si128(k, t); \
+	} while (0)
+
+__attribute__((target("aes"), optimize("O2")))
+void tape_expandKey_aesni(const unsigned char key[16], unsigned char out[11][16]) {
+	__m128i rk[11];
+
+	rk[0] = _mm_loadu_si128((const __m128i *)key);
+	TAPE_KEYSTEP(rk, 1, 0x01);
+	TAPE_KEYSTEP(rk, 2, 0x02);
+	TAPE_KEYSTEP(rk, 3, 0x04);
+	TAPE_KEYSTEP(rk, 4, 0x08);
+	TAPE_KEYSTEP(rk, 5, 0x10);
+	TAPE_KEYSTEP(rk, 6, 0x20);
+	TAPE_KEYSTEP(rk, 7, 0x40);
+	TAPE_KEYSTEP(rk, 8, 0x80);
+	TAPE_KEYSTEP(rk, 9, 0x1b);
+	TAPE_KEYSTEP(rk, 10, 0x36);
+	for (int i = 0; i < 11; i++)
+		_mm_storeu_si128((__m128i *)out[i], rk[i]);
+}
+
+// Counter block in big endian byte order from its two halves
+#define TAPE_CTR(hi, lo) _mm_set_epi64x(__builtin_bswap64(lo), __builtin_bswap64(hi))
+
+/*
+ * Writes blocks blocks of one stream to out, TAPE_LANES counter blocks per
+ * step with the round keys held in registers. The Makefiles of some binaries
+ * build without optimisation, so the kernels ask for it themselves.
+ */
+__attribute__((target("aes,ssse3"), optimize("O2")))
+void tape_ctr_aesni(tapeStream * s, unsigned char * out, size_t blocks) {
+	const __m128i plain = _mm_set1_epi8(TAPE_PLAIN);
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i rk[11], b[TAPE_LANES];
+	size_t done = 0;
+
+	for (int r = 0; r < 11; r++)
+		rk[r] = _mm_loadu_si128((const __m128i *)s->rk[r]);
+
+	//The low half must not wrap inside a step, a wrap is left to the one block loop
+	if (s->ctrLo <= UINT64_MAX - blocks) {
+		__m128i ctr = _mm_set_epi64x(s->ctrHi, s->ctrLo);
+		const __m128i one = _mm_set_epi64x(0, 1);
+		for (; done + TAPE_LANES <= blocks; done += TAPE_LANES) {
+			#pragma GCC unroll 8
+			for (int i = 0; i < TAPE_LANES; i++) {
+				b[i] = _mm_xor_si128(_mm_shuffle_epi8(ctr, reverse), rk[0]);
+				ctr = _mm_add_epi64(ctr, one);
+			}
+			#pragma GCC unroll 9
+			for (int r = 1; r < 10; r++) {
+				#pragma GCC unroll 8
+				for (int i = 0; i < TAPE_LANES; i++)
+					b[i] = _mm_aesenc_si128(b[i], rk[r]);
+			}
+			#pragma GCC unroll 8
+			for (int i = 0; i < TAPE_LANES; i++) {
+				b[i] = _mm_aesenclast_si128(b[i], rk[10]);
+				_mm_storeu_si128((__m128i *)(out + (done + i) * TAPE_BLOCK), _mm_xor_si128(b[i], plain));
+			}
+		}
+		s->ctrLo += done;
+	}
+	for (; done < blocks; done++) {
+		b[0] = _mm_xor_si128(TAPE_CTR(s->ctrHi, s->ctrLo), rk[0]);
+		for (int r = 1; r < 10; r++)
+			b[0] = _mm_aesenc_si128(b[0], rk[r]);
+		b[0] = _mm_aesenclast_si128(b[0], rk[10]);
+		_mm_storeu_si128((__m128i *)(out + done * TAPE_BLOCK), _mm_xor_si128(b[0], plain));
+		if (++s->ctrLo == 0)
+			s->ctrHi++;
+	}
+}
+
+/*
+ * One block from each of n <= TAPE_LANES streams, for tapes too short to fill
+ * the lanes of tape_ctr_aesni() on their own. Each lane has its own key.
+ */
+__attribute__((target("aes"), optimize("O2")))
+void tape_ctr8_aesni(int n, tapeStream * const streams[], unsigned char * const out[]) {
+	const __m128i plain = _mm_set1_epi8(TAPE_PLAIN);
+	__m128i b[TAPE_LANES];
+
+	for (int i = 0; i < n; i++) {
+		tapeStream * s = streams[i];
+		b[i] = _mm_xor_si128(TAPE_CTR(s->ctrHi, s->ctrLo), _mm_loadu_si128((const __m128i *)s->rk[0]));
+		if (++s->ctrLo == 0)
+			s->ctrHi++;
+	}
+	for (int r = 1; r < 10; r++)
+		for (int i = 0; i < n; i++)
+			b[i] = _mm_aesenc_si128(b[i], _mm_loadu_si128((const __m128i *)streams[i]->rk[r]));
+	for (int i = 0; i < n; i++) {
+		b[i] = _mm_aesenclast_si128(b[i], _mm_loadu_si128((const __m128i *)streams[i]->rk[10]));
+		_mm_storeu_si128((__m128i *)out[i], _mm_xor_si128(b[i], plain));
+	}
+}
+#endif
+
+int tape_select(const char * name) {
+	if (strcmp(name, "evp") == 0)
+		tape_aesni = 0;
+#ifdef TAPES_HAVE_AESNI
+	else if (strcmp(name, "aesni") == 0) {
+		if (!__builtin_cpu_supports("aes"))
+			return 1;
+		tape_aesni = 1;
+	}
+#endif
+	else
+		return 1;
+	tape_name = name;
+	return 0;
+}
+
+void tape_init() {
+	const char * force = getenv("ZKBOO_TAPES");
+
+	if (crypto_init() != 0)
+		abort();
+#ifdef TAPES_HAVE_AESNI
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("aes"))
+		tape_select("aesni");
+#endif
+	if (force && tape_select(force) != 0)
+		printf("Tape backend %s not available, using %s\n", force, tape_name);
+}
+
+void tape_open(tapeStream * s, const unsigned char key[16], const unsigned char * iv) {
+	s->ctx = NULL;
+#ifdef TAPES_HAVE_AESNI
+	if (tape_aesni) {
+		tape_expandKey_aesni(key, s->rk);
+		s->ctrHi = s->ctrLo = 0;
+		for (int i = 0; i < 8; i++) {
+			s->ctrHi = (s->ctrHi << 8) | iv[i];
+			s->ctrLo = (s->ctrLo << 8) | iv[8 + i];
+		}
+		return;
+	}
+#endif
+	s->ctx = EVP_CIPHER_CTX_new();
+	if (!s->ctx || (EVP_EncryptInit_ex(s->ctx, crypto_aes128ctr, NULL, key, iv) != 1)) {
+		printf("Unable to set up AES tape\n");
+		abort();
+	}
+}
+
+void tape_close(tapeStream * s) {
+	if (s->ctx)
+		EVP_CIPHER_CTX_free(s->ctx);
+	s->ctx = NULL;
+}
+
+/*
+ * Reads len bytes from each of n streams into outs[i]. With aesni a stream
+ * with at least TAPE_LANES blocks to give fills the lanes by itself; shorter
+ * reads are spread over the lanes one block per stream.
+ */
+void tape_readMany(int n, tapeStream * const streams[], unsigned char * const outs[], size_t len) {
+#ifdef TAPES_HAVE_AESNI
+	if (tape_aesni) {
+		size_t whole = len / TAPE_BLOCK;
+		size_t rest = len % TAPE_BLOCK;
+
+		if (whole >= TAPE_LANES) {
+			for (int s = 0; s < n; s++)
+				tape_ctr_aesni(streams[s], outs[s], whole);
+		}
+		else {
+			for (int first = 0; first < n; first += TAPE_LANES) {
+				int m = (n - first < TAPE_LANES) ? n - first : TAPE_LANES;
+				unsigned char * out[TAPE_LANES];
+				for (size_t b = 0; b < whole; b++) {
+					for (int i = 0; i < m; i++)
+						out[i] = outs[first + i] + b * TAPE_BLOCK;
+					tape_ctr8_aesni(m, &streams[first], out);
+				}
+			}
+		}
+		if (rest) {
+			unsigned char tail[TAPE_BLOCK];
+			for (int s = 0; s < n; s++) {
+				unsigned char * out = tail;
+				tape_ctr8_aesni(1, &streams[s], &out);
+				memcpy(outs[s] + whole * TAPE_BLOCK, tail, rest);
+			}
+		}
+		return;
+	}
+#endif
+	for (int s = 0; s < n; s++) {
+		int outLen;
+		memset(outs[s], TAPE_PLAIN, len);
+		if (EVP_EncryptUpdate(streams[s]->ctx, outs[s], &outLen, outs[s], len) != 1) {
+			printf("Unable to generate AES tape\n");
+			abort();
+		}
+	}
+}
+
+void tape_read(tapeStream * s, unsigned char * out, size_t len) {
+	tape_readMany(1, &s, &out, len);
+}
+
+void tape_expand(const unsigned char key[16], const unsigned char * iv, unsigned char * out, size_t len) {
+	tapeStream s;
+
+	if (!tape_aesni) {
+		int outLen;
+		memset(out, TAPE_PLAIN, len);
+		if (EVP_EncryptUpdate(crypto_cipher(key, iv), out, &outLen, out, len) != 1) {
+			printf("Unable to generate AES tape\n");
+			abort();
+		}
+		return;
+	}
+	tape_open(&s, key, iv);
+	tape_read(&s, out, len);
+	tape_close(&s);
+}
+
+// n tapes of len bytes, the tape of keys[i] at out + i * len
+void tape_expandKeys(int n, const unsigned char keys[][16], const unsigned char * iv, unsigned char * out, size_t len) {
+	tapeStream streams[TAPE_LANES];
+	tapeStream * sp[TAPE_LANES];
+	unsigned char * op[TAPE_LANES];
+
+	if (!tape_aesni) {
+		for (int i = 0; i < n; i++)
+			tape_expand(keys[i], iv, out + (size_t)i * len, len);
+		return;
+	}
+	for (int first = 0; first < n; first += TAPE_LANES) {
+		int m = (n - first < TAPE_LANES) ? n - first : TAPE_LANES;
+		for (int i = 0; i < m; i++) {
+			tape_open(&streams[i], keys[first + i], iv);
+			sp[i] = &streams[i];
+			op[i] = out + (size_t)(first + i) * len;
+		}
+		tape_readMany(m, sp, op, len);
+		for (int i = 0; i < m; i++)
+			tape_close(&streams[i]);
+	}
+}
+
+/*
+ * Tapes that are used up word by word, as the gates of a circuit consume
+ * them, do not need to be held in full. A window keeps the next TAPE_WINDOW
+ * bytes of each of up to TAPE_WINDOW_STREAMS streams and refills all of them
+ * at once when they run out. TAPE_WINDOW is sixteen AES blocks: every lane of
+ * tape_ctr_aesni() is busy during a refill, the refill calls stay rare next to
+ * the words handed out, and three streams still fit in 768 bytes. The window
+ * reads ahead, so its streams must not be read directly while it is in use.
+ *
+ *   tapeWindow w;
+ *   tape_window(&w, 3, streams);
+ *   tape_next64(&w, r);               // r[i]: next 8 bytes of streams[i]
+ */
+#define TAPE_WINDOW 256
+#define TAPE_WINDOW_STREAMS 3
+
+typedef struct {
+	int n;
+	int pos;
+	tapeStream * streams[TAPE_WINDOW_STREAMS];
+	unsigned char buf[TAPE_WINDOW_STREAMS][TAPE_WINDOW];
+} tapeWindow;
+
+void tape_window(tapeWindow * w, int n, tapeStream * const streams[]) {
+	w->n = n;
+	w->pos = TAPE_WINDOW;
+	for (int i = 0; i < n; i++)
+		w->streams[i] = streams[i];
+}
+
+void tape_refill(tapeWindow * w) {
+	unsigned char * outs[TAPE_WINDOW_STREAMS];
+
+	for (int i = 0; i < w->n; i++)
+		outs[i] = w->buf[i];
+	tape_readMany(w->n, w->streams, outs, TAPE_WINDOW);
+	w->pos = 0;
+}
+
+static inline void tape_next64(tapeWindow * w, uint64_t r[]) {
+	int pos = w->pos;
+
+	if (__builtin_expect(pos == TAPE_WINDOW, 0)) {
+		tape_refill(w);
+		pos = 0;
+	}
+	for (int i = 0; i < w->n; i++)
+		memcpy(&r[i], &w->buf[i][pos], 8);
+	w->pos = pos + 8;
+}
+
+#endif /* TAPES_H_ */